@@ -0,0 +1,131 @@
+/* Every fpkern variant on three data sets: throughput and accuracy.
+ *
+ *   bench_fpkern [n] [reps]
+ *
+ * n doubles per array (default 1M, i.e. 8 MiB: out of cache on most
+ * machines; try 4096 for the in-L1 numbers).  Data sets, from the same
+ * xorshift stream every run:
+ *
+ *   sum uniform   values in [0, 1): well conditioned, naive does fine
+ *   sum cancel    large values in [-1e8, 1e8) in the first half, their
+ *                 negations plus u * 1e-3 mirrored in the second: the
+ *                 true sum is the small parts alone, ~1e8 times smaller
+ *                 than the running sums, so every rounding shows
+ *   dot uniform   values in [-1, 1)
+ *
+ * Each kernel runs `reps` times after one warm-up; the best time gives
+ * GB/s (bytes read / ns).  The error is relative to the long-double
+ * Neumaier reference.  Links only libfpkern. */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "fpkern.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+/* [0, 1) with 53 random bits */
+static double unit(uint64_t *s) {
+    return (double)(xorshift(s) >> 11) * 0x1p-53;
+}
+
+/* keeps the result live without printing it */
+static volatile double sink;
+
+static void run_sum(const char *title, const double *x, size_t n, int reps) {
+    long double ref = fpk_sum_ref(x, n);
+    printf("\n%s  (n=%zu, reference %.17Lg)\n", title, n, ref);
+    printf("  %-9s %-7s %10s %12s\n", "algo", "isa", "GB/s", "rel.error");
+    for (int a = 0; a < FPK_ALGOS; ++a) {
+        for (int i = 0; i < FPK_ISAS; ++i) {
+            FpkSumFn fn = fpk_sum_fn((FpkAlgo)a, (FpkIsa)i);
+            if (!fn) {
+                printf("  %-9s %-7s %10s %12s\n", fpk_algo_name(a), fpk_isa_name(i), "n/a", "");
+                continue;
+            }
+            double got = fn(x, n);
+            uint64_t best = UINT64_MAX;
+            for (int r = 0; r < reps; ++r) {
+                uint64_t t0 = now_ns();
+                sink = fn(x, n);
+                uint64_t dt = now_ns() - t0;
+                if (dt < best) best = dt;
+            }
+            printf("  %-9s %-7s %10.2f %12.3e\n", fpk_algo_name(a), fpk_isa_name(i),
+                   (double)(n * sizeof(double)) / (double)(best ? best : 1),
+                   fpk_rel_error(got, ref));
+        }
+    }
+}
+
+static void run_dot(const char *title, const double *x, const double *y, size_t n, int reps) {
+    long double ref = fpk_dot_ref(x, y, n);
+    printf("\n%s  (n=%zu, reference %.17Lg)\n", title, n, ref);
+    printf("  %-9s %-7s %10s %12s\n", "algo", "isa", "GB/s", "rel.error");
+    for (int a = 0; a < FPK_ALGOS; ++a) {
+        for (int i = 0; i < FPK_ISAS; ++i) {
+            FpkDotFn fn = fpk_dot_fn((FpkAlgo)a, (FpkIsa)i);
+            if (!fn) {
+                printf("  %-9s %-7s %10s %12s\n", fpk_algo_name(a), fpk_isa_name(i), "n/a", "");
+                continue;
+            }
+            double got = fn(x, y, n);
+            uint64_t best = UINT64_MAX;
+            for (int r = 0; r < reps; ++r) {
+                uint64_t t0 = now_ns();
+                sink = fn(x, y, n);
+                uint64_t dt = now_ns() - t0;
+                if (dt < best) best = dt;
+            }
+            printf("  %-9s %-7s %10.2f %12.3e\n", fpk_algo_name(a), fpk_isa_name(i),
+                   (double)(2 * n * sizeof(double)) / (double)(best ? best : 1),
+                   fpk_rel_error(got, ref));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : (size_t)1 << 20;
+    int reps = argc > 2 ? atoi(argv[2]) : 20;
+    if (!n || reps <= 0) return 2;
+
+    double *x = malloc(n * sizeof(*x));
+    double *y = malloc(n * sizeof(*y));
+    if (!x || !y) return 1;
+
+    printf("fpkern: widest ISA here is %s\n", fpk_isa_name(fpk_detect_isa()));
+
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < n; ++i) x[i] = unit(&rng);
+    run_sum("sum uniform", x, n, reps);
+
+    for (size_t i = 0; i < n / 2; ++i) {
+        x[i] = (2.0 * unit(&rng) - 1.0) * 1e8;
+        x[n - 1 - i] = -x[i] + unit(&rng) * 1e-3;
+    }
+    if (n & 1) x[n / 2] = 0.0;
+    run_sum("sum cancel", x, n, reps);
+
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = 2.0 * unit(&rng) - 1.0;
+        y[i] = 2.0 * unit(&rng) - 1.0;
+    }
+    run_dot("dot uniform", x, y, n, reps);
+
+    free(x);
+    free(y);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/* Leaderboard at class-of-a-million scale.
+ *
+ *   bench_leaderboard [learners] [ops]
+ *
+ * Joins `learners` (default 1M), gives each a score on three random
+ * stations, then times `ops` random score updates, rank lookups, top-10
+ * and around-me queries, each op timed on its own.  Prints mean, p50 and
+ * p99 per kind and the memory held. */
+#include <time.h>
+
+#include "common.h"
+#include "leaderboard.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *what, uint64_t *ns, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += ns[i];
+    qsort(ns, n, sizeof(*ns), cmp_u64);
+    printf("  %-12s mean %7.0f ns   p50 %6llu ns   p99 %6llu ns\n", what, (double)sum / (double)n,
+           (unsigned long long)ns[n / 2], (unsigned long long)ns[n * 99 / 100]);
+}
+
+int main(int argc, char **argv) {
+    uint32_t learners = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 1000000;
+    size_t ops = argc > 2 ? (size_t)strtoull(argv[2], NULL, 10) : 1000000;
+    if (!learners || !ops) return 2;
+
+    Leaderboard *lb = lb_new();
+    uint64_t *ns = malloc(ops * sizeof(*ns));
+    if (!lb || !ns) return 1;
+
+    uint64_t rng = 0x2545f4914f6cdd1dull, t0 = now_ns();
+    for (uint32_t i = 0; i < learners; ++i) {
+        char name[LB_NAME_MAX];
+        snprintf(name, sizeof(name), "learner%u", i);
+        if (lb_join(lb, name) < 0) return 1;
+        for (int k = 0; k < 3; ++k) {
+            lb_set(lb, i, (int)(xorshift(&rng) % STATION_COUNT), 1 + (int)(xorshift(&rng) % 40));
+        }
+    }
+    printf("%u learners joined and scored in %.2f s; %.1f MiB (%.1f B per learner)\n", learners,
+           (double)(now_ns() - t0) / 1e9, (double)lb_bytes(lb) / (1 << 20),
+           (double)lb_bytes(lb) / learners);
+
+    /* scores only grow, as in play: a station's best result is kept */
+    for (size_t i = 0; i < ops; ++i) {
+        uint32_t who = (uint32_t)(xorshift(&rng) % learners);
+        int st = (int)(xorshift(&rng) % STATION_COUNT);
+        int score = lb_score(lb, 1 + st, who) + 1 + (int)(xorshift(&rng) % 4);
+        t0 = now_ns();
+        lb_set(lb, who, st, score);
+        ns[i] = now_ns() - t0;
+    }
+    report("update", ns, ops);
+
+    uint64_t check = 0;
+    for (size_t i = 0; i < ops; ++i) {
+        uint32_t who = (uint32_t)(xorshift(&rng) % learners);
+        t0 = now_ns();
+        check += lb_rank(lb, LB_OVERALL, who);
+        ns[i] = now_ns() - t0;
+    }
+    report("rank", ns, ops);
+
+    LbEntry e[16];
+    for (size_t i = 0; i < ops; ++i) {
+        int board = (int)(xorshift(&rng) % LB_BOARDS);
+        t0 = now_ns();
+        check += lb_top(lb, board, 1, e, 10);
+        ns[i] = now_ns() - t0;
+    }
+    report("top 10", ns, ops);
+
+    for (size_t i = 0; i < ops; ++i) {
+        uint32_t who = (uint32_t)(xorshift(&rng) % learners);
+        t0 = now_ns();
+        check += lb_around(lb, LB_OVERALL, who, 3, e, 16);
+        ns[i] = now_ns() - t0;
+    }
+    report("around +-3", ns, ops);
+
+    lb_top(lb, LB_OVERALL, 1, e, 1);
+    printf("leader: %s with %d pts (checksum %llu)\n", lb_name(lb, e[0].learner), e[0].score,
+           (unsigned long long)check);
+    free(ns);
+    lb_free(lb);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/* `find` over a bank far larger than the compiled-in ones.
+ *
+ *   bench_search [tasks] [reps]
+ *
+ * Generates `tasks` (default 100k) parametric tasks round-robin over the
+ * taskgen templates and indexes their prompt, hint and explanation, plus
+ * two words drawn from a 20k-word skewed vocabulary so the dictionary is
+ * not just the templates' own.  Then times `reps` runs of each query,
+ * each run on its own: rare and common exact words, prefixes, several
+ * words, and a miss.  Prints build time, index size, and mean, p50 and
+ * p99 per query. */
+#include <time.h>
+
+#include "common.h"
+#include "search.h"
+#include "taskgen.h"
+
+#define VOCAB  20000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *what, size_t hits, uint64_t *ns, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += ns[i];
+    qsort(ns, n, sizeof(*ns), cmp_u64);
+    printf("  %-22s %zu hits  mean %7.1f us   p50 %7.1f us   p99 %7.1f us\n", what, hits,
+           (double)sum / (double)n / 1e3, (double)ns[n / 2] / 1e3,
+           (double)ns[n * 99 / 100] / 1e3);
+}
+
+int main(int argc, char **argv) {
+    uint32_t tasks = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+    size_t reps = argc > 2 ? (size_t)strtoull(argv[2], NULL, 10) : 1000;
+    if (!tasks || !reps) return 2;
+
+    SearchIndex *ix = search_new();
+    uint64_t *ns = malloc(reps * sizeof(*ns));
+    if (!ix || !ns) return 1;
+
+    uint64_t t0 = now_ns(), gen = 0;
+    for (uint32_t i = 0; i < tasks; ++i) {
+        Task task;
+        TaskgenText text;
+        uint64_t g0 = now_ns();
+        taskgen_make((int)(i % (uint32_t)taskgen_count()), i, &task, &text);
+        gen += now_ns() - g0;
+        /* squaring a uniform draw skews it toward the first words */
+        uint64_t r = taskgen_mix(i);
+        uint32_t a = (uint32_t)((r & 0xffff) * (r & 0xffff) * VOCAB >> 32);
+        uint32_t b = (uint32_t)((r >> 16 & 0xffff) * (r >> 16 & 0xffff) * VOCAB >> 32);
+        char extra[48];
+        snprintf(extra, sizeof(extra), "topic%u topic%u", a, b);
+        const char *texts[] = { task.prompt, task.hint, task.why, extra };
+        if (search_add(ix, i, texts, 4) != OK) return 1;
+    }
+    if (search_finish(ix) != OK) return 1;
+    printf("%u tasks indexed in %.1f ms (%.1f ms of it generating them); %u terms, %.1f MiB\n",
+           search_docs(ix), (double)(now_ns() - t0) / 1e6, (double)gen / 1e6,
+           search_terms(ix), (double)search_bytes(ix) / (1 << 20));
+
+    static const char *const QUERIES[] = {
+        "topic19999",           /* rare exact */
+        "topic7",               /* exact + prefix of ~1k terms, capped */
+        "sizeof",               /* in a sixth of the tasks */
+        "int",                  /* in most of them */
+        "point",                /* prefix */
+        "unsigned long promot", /* three words */
+        "xyzzy",                /* miss */
+    };
+    SearchHit hits[5];
+    for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); ++q) {
+        size_t n = 0;
+        for (size_t i = 0; i < reps; ++i) {
+            t0 = now_ns();
+            n = search_query(ix, QUERIES[q], hits, 5);
+            ns[i] = now_ns() - t0;
+        }
+        report(QUERIES[q], n, ns, reps);
+    }
+    free(ns);
+    search_free(ix);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/* Tracking allocator vs raw malloc on a churn workload.
+ *
+ *   bench_tracker [ops] [live-slots]
+ *
+ * Keeps `live-slots` blocks alive and, per op, frees a random one and
+ * allocates a replacement of random size (16..1024 B, every 16th op a
+ * realloc).  Same PRNG stream for every run; one untimed warm-up, then
+ * raw and tracked alternate and the best of ROUNDS is reported. */
+#include <time.h>
+
+#include "common.h"
+#include "tracker.h"
+
+#define ROUNDS 3
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+#define CHURN(MALLOC, REALLOC, FREE)                                        \
+    do {                                                                    \
+        uint64_t rng = 0x9e3779b97f4a7c15ull;                               \
+        for (size_t i = 0; i < slots; ++i) live[i] = MALLOC(64);            \
+        for (size_t op = 0; op < ops; ++op) {                               \
+            uint64_t r = xorshift(&rng);                                    \
+            size_t k = (size_t)(r % slots);                                 \
+            size_t sz = 16 + (size_t)((r >> 32) % 1009);                    \
+            if ((op & 15) == 0) {                                           \
+                void *np = REALLOC(live[k], sz);                            \
+                if (np) live[k] = np;                                       \
+            } else {                                                        \
+                FREE(live[k]);                                              \
+                live[k] = MALLOC(sz);                                       \
+            }                                                               \
+            ((char *)live[k])[0] = (char)op;                                \
+        }                                                                   \
+        for (size_t i = 0; i < slots; ++i) FREE(live[i]);                   \
+    } while (0)
+
+int main(int argc, char **argv) {
+    size_t ops = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 5000000;
+    size_t slots = argc > 2 ? (size_t)strtoull(argv[2], NULL, 10) : 10000;
+    if (!ops || !slots) return 2;
+
+    void **live = malloc(slots * sizeof(*live));
+    if (!live) return 1;
+
+    uint64_t best_raw = UINT64_MAX, best_trk = UINT64_MAX;
+    CHURN(malloc, realloc, free);           /* warm the heap */
+    for (int r = 0; r < ROUNDS; ++r) {
+        uint64_t t0 = now_ns();
+        CHURN(malloc, realloc, free);
+        uint64_t t1 = now_ns();
+        CHURN(tracked_malloc, tracked_realloc, tracked_free);
+        uint64_t t2 = now_ns();
+        if (t1 - t0 < best_raw) best_raw = t1 - t0;
+        if (t2 - t1 < best_trk) best_trk = t2 - t1;
+    }
+
+    double raw = (double)best_raw / (double)ops;
+    double trk = (double)best_trk / (double)ops;
+    TrackerStats st = tracker_stats();
+
+    printf("ops %zu, live slots %zu, best of %d\n", ops, slots, ROUNDS);
+    printf("raw malloc/free    : %6.1f ns/op\n", raw);
+    printf("tracked            : %6.1f ns/op  (+%.1f ns, %.0f%%)\n", trk, trk - raw,
+           100.0 * (trk - raw) / raw);
+    printf("tracker peak       : %zu B, %llu allocs, leaks %zu\n", st.peak_bytes,
+           (unsigned long long)st.allocs, st.live_blocks);
+
+    free(live);
+    return st.live_blocks != 0;
+}
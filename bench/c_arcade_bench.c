@@ -0,0 +1,295 @@
+/* Grading-path benchmark: replays synthetic learner scripts.
+ *
+ *   c_arcade_bench [rounds]
+ *
+ * shell : `rounds` passes of "play 02", one wrong and one right answer per
+ *         task, then "map" and "score", fed through shell_loop() from a
+ *         temporary file with stdout on /dev/null.
+ * engine: the same answers fed straight to engine_feed() from memory, so
+ *         the figure is the cost of grading alone.
+ * match : TASK_ASK answer check on a MATCH_ANSWERS-answer task: exact
+ *         hit (one hash lookup) vs. a typo (lookup miss, then the
+ *         bit-parallel edit-distance scan) vs. a miss that fails both.
+ * expr  : compile + run of typical expression answers (cexpr_eval)
+ *         against station 09's declarations.
+ * review: a REVIEW_CARDS-card spaced-repetition deck; each op picks the
+ *         next due card and grades it (mixed recall quality).
+ *
+ * Reports commands/sec, ns per graded answer, tracked allocations per
+ * phase and peak RSS.  Same script on every run. */
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "answers.h"
+#include "cexpr.h"
+#include "engine.h"
+#include "review.h"
+#include "shell.h"
+#include "stations.h"
+#include "tracker.h"
+
+#define LINE_CAP 128
+#define REVIEW_CARDS (STATION_COUNT * 10000u)
+#define MATCH_ANSWERS 64
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int list_len(const char *const *list) {
+    int n = 0;
+    while (list && list[n]) n++;
+    return n;
+}
+
+/* Wrong then right answer for task `t`, varied by round so both the
+ * numeric and the index lookup paths are taken. */
+static void answers_for(const Task *t, size_t round, char wrong[LINE_CAP], char right[LINE_CAP]) {
+    if (t->type == TASK_QUIZ) {
+        int n = list_len(t->options);
+        snprintf(wrong, LINE_CAP, "%d", (t->correct_index + 1) % n + 1);
+        if (round & 1) {
+            snprintf(right, LINE_CAP, "%s", t->options[t->correct_index]);
+        } else {
+            snprintf(right, LINE_CAP, "%d", t->correct_index + 1);
+        }
+    } else {
+        int n = list_len(t->answers);
+        snprintf(wrong, LINE_CAP, "not %s", t->answers[0]);
+        snprintf(right, LINE_CAP, "%s", t->answers[round % (size_t)n]);
+    }
+}
+
+static FILE *write_script(const TaskBank *b, size_t rounds, size_t *lines) {
+    FILE *f = tmpfile();
+    if (!f) return NULL;
+    char wrong[LINE_CAP], right[LINE_CAP];
+    *lines = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+        fputs("play 02\n", f);
+        for (int i = 0; i < b->count; ++i) {
+            answers_for(&b->tasks[i], r, wrong, right);
+            fprintf(f, "%s\n%s\n", wrong, right);
+        }
+        fputs("map\nscore\n", f);
+        *lines += 3 + 2 * (size_t)b->count;
+    }
+    fputs("quit\n", f);
+    *lines += 1;
+    if (fflush(f) != 0) {
+        fclose(f);
+        return NULL;
+    }
+    rewind(f);
+    return f;
+}
+
+static uint64_t bench_shell(FILE *script) {
+    int null = open("/dev/null", O_WRONLY);
+    if (null < 0) return 0;
+    fflush(stdout);
+    dup2(fileno(script), STDIN_FILENO);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+
+    uint64_t t0 = now_ns();
+    shell_init();
+    shell_loop();
+    shell_teardown();
+    return now_ns() - t0;
+}
+
+static uint64_t bench_engine(TaskBank *b, size_t rounds, size_t *graded) {
+    char text[4096];
+    EngineOut out;
+    engine_out_init(&out, text, sizeof(text));
+
+    size_t per_round = 2 * (size_t)b->count;
+    char (*lines)[LINE_CAP] = malloc(2 * per_round * sizeof(*lines));
+    if (!lines) return 0;
+    for (size_t v = 0; v < 2; ++v) {
+        for (int i = 0; i < b->count; ++i) {
+            answers_for(&b->tasks[i], v, lines[v * per_round + 2 * (size_t)i],
+                        lines[v * per_round + 2 * (size_t)i + 1]);
+        }
+    }
+
+    *graded = 0;
+    uint64_t t0 = now_ns();
+    for (size_t r = 0; r < rounds; ++r) {
+        EngineSession *s = engine_begin_bank(2, b);
+        if (!s) break;
+        engine_start(s, &out);
+        const char (*round)[LINE_CAP] = lines + (r & 1) * per_round;
+        for (size_t k = 0; k < per_round; ++k) {
+            engine_out_reset(&out);
+            engine_feed(s, round[k], &out);
+        }
+        engine_out_reset(&out);
+        engine_end(s);
+        *graded += per_round;
+    }
+    uint64_t ns = now_ns() - t0;
+    free(lines);
+    return ns;
+}
+
+typedef struct {
+    uint64_t exact_ns, typo_ns, miss_ns;
+} MatchTimes;
+
+/* Inputs are normalized up front: this times matching, not trimming. */
+static uint64_t time_match(const AnswerIndex *ix, const char *input, size_t ops, bool *accepted) {
+    char norm[MAX_INPUT];
+    size_t len = answer_normalize(norm, sizeof(norm), input);
+    size_t hits = 0;
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < ops; ++i) {
+        int edits;
+        hits += answer_index_lookup(ix, 0, norm, len) >= 0 ||
+                answer_index_fuzzy(ix, 0, norm, len, ASK_TYPOS_AUTO, &edits) >= 0;
+    }
+    uint64_t ns = now_ns() - t0;
+    *accepted = hits == ops;
+    return ns ? ns : 1;
+}
+
+static bool bench_match(size_t ops, MatchTimes *mt) {
+    static const char *const WORDS[] = {
+        "pointer", "array", "stack", "heap", "frame", "linkage", "storage", "scope",
+        "macro", "token", "grammar", "operand", "lvalue", "promotion", "alignment", "padding"
+    };
+    static char text[MATCH_ANSWERS][40];
+    static const char *answers[MATCH_ANSWERS + 1];
+    for (int i = 0; i < MATCH_ANSWERS; ++i) {
+        snprintf(text[i], sizeof(text[i]), "%s %s %s", WORDS[i % 16], WORDS[(i / 16 + i) % 16],
+                 WORDS[(i * 7 + 3) % 16]);
+        answers[i] = text[i];
+    }
+    Task t = { .type = TASK_ASK, .prompt = "?", .typos = ASK_TYPOS_AUTO, .answers = answers };
+    AnswerIndex *ix = answer_index_build(&t, 1);
+    if (!ix) return false;
+
+    /* last answer with its first two letters swapped */
+    char typo[40];
+    snprintf(typo, sizeof(typo), "%s", text[MATCH_ANSWERS - 1]);
+    char c = typo[0]; typo[0] = typo[1]; typo[1] = c;
+
+    bool hit, fixed, missed;
+    mt->exact_ns = time_match(ix, text[MATCH_ANSWERS - 1], ops, &hit);
+    mt->typo_ns = time_match(ix, typo, ops, &fixed);
+    mt->miss_ns = time_match(ix, "register allocation pass", ops, &missed);
+    answer_index_free(ix);
+    return hit && fixed && !missed;
+}
+
+static const char *const EXPR_ANSWERS[] = {
+    "30", "*(a + 2)", "p + 2", "&a[3]", "p - a", "sizeof(int *)", "(a[0] + a[3]) / 2.0", "*(a"
+};
+#define EXPR_COUNT (sizeof(EXPR_ANSWERS) / sizeof(EXPR_ANSWERS[0]))
+
+static uint64_t bench_expr(size_t evals) {
+    const char *decls[] = { "int a[] = {10, 20, 30, 40}", "int *p = &a[1]", NULL };
+    char err[CEXPR_ERR];
+    CexprEnv *env = cexpr_env_new(decls, err, sizeof(err));
+    if (!env) return 0;
+    CexprResult r;
+    size_t ok = 0;
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < evals; ++i) {
+        ok += cexpr_eval(env, EXPR_ANSWERS[i % EXPR_COUNT], &r);
+    }
+    uint64_t ns = now_ns() - t0;
+    cexpr_env_free(env);
+    return ok ? ns : 0;
+}
+
+static uint64_t bench_review(size_t ops, ReviewDeck *d) {
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        if (review_deck_add(d, i, REVIEW_CARDS / STATION_COUNT) != OK) return 0;
+    }
+    uint32_t now = 1700000000u;
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    uint64_t t0 = now_ns();
+    for (size_t op = 0; op < ops; ++op) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        int32_t id = review_next(d);
+        if (id < 0) return 0;
+        review_grade(d, (uint32_t)id, (int)(rng % 6), now);
+        now += 7;
+    }
+    return now_ns() - t0;
+}
+
+int main(int argc, char **argv) {
+    size_t rounds = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 100000;
+    if (!rounds) return 2;
+
+    int report_fd = dup(STDOUT_FILENO);
+    FILE *report = report_fd >= 0 ? fdopen(report_fd, "w") : NULL;
+    if (!report) return 1;
+
+    size_t commands = 0;
+    FILE *script = write_script(&BANK_COMPILATION, rounds, &commands);
+    if (!script) {
+        fprintf(stderr, "c_arcade_bench: cannot write script\n");
+        return 1;
+    }
+
+    TrackerStats before = tracker_stats();
+    uint64_t shell_ns = bench_shell(script);
+    TrackerStats mid = tracker_stats();
+    fclose(script);
+
+    size_t graded = 0;
+    if (!task_bank_prepare(&BANK_COMPILATION)) return 1;
+    uint64_t engine_ns = bench_engine(&BANK_COMPILATION, rounds, &graded);
+    task_bank_release(&BANK_COMPILATION);
+    TrackerStats after = tracker_stats();
+
+    MatchTimes mt = { 0, 0, 0 };
+    size_t match_ops = rounds * 4;
+    bool match_ok = bench_match(match_ops, &mt);
+
+    size_t expr_evals = rounds * 4;
+    uint64_t expr_ns = bench_expr(expr_evals);
+
+    ReviewDeck *deck = review_deck_new();
+    size_t review_ops = rounds * 4;
+    uint64_t review_ns = deck ? bench_review(review_ops, deck) : 0;
+    review_deck_free(deck);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    if (!shell_ns || !engine_ns || !graded || !match_ok || !expr_ns || !review_ns) {
+        fprintf(stderr, "c_arcade_bench: run failed\n");
+        return 1;
+    }
+
+    fprintf(report, "rounds %zu, %d tasks per round\n", rounds, BANK_COMPILATION.count);
+    fprintf(report, "shell  : %zu commands in %.3f s, %.0f commands/s, %.0f ns/command\n",
+            commands, (double)shell_ns / 1e9, (double)commands * 1e9 / (double)shell_ns,
+            (double)shell_ns / (double)commands);
+    fprintf(report, "engine : %zu graded answers, %.1f ns/answer\n", graded,
+            (double)engine_ns / (double)graded);
+    fprintf(report, "match  : %d answers, exact %.1f ns, typo %.1f ns, miss %.1f ns\n", MATCH_ANSWERS,
+            (double)mt.exact_ns / (double)match_ops, (double)mt.typo_ns / (double)match_ops,
+            (double)mt.miss_ns / (double)match_ops);
+    fprintf(report, "expr   : %zu answers compiled and run, %.1f ns/answer\n", expr_evals,
+            (double)expr_ns / (double)expr_evals);
+    fprintf(report, "review : %zu next+grade on %u cards, %.1f ns/op\n", review_ops,
+            REVIEW_CARDS, (double)review_ns / (double)review_ops);
+    fprintf(report, "allocs : shell %llu, engine %llu (%.3f per answer), live at end %zu\n",
+            (unsigned long long)(mid.allocs - before.allocs),
+            (unsigned long long)(after.allocs - mid.allocs),
+            (double)(after.allocs - mid.allocs) / (double)graded, after.live_blocks);
+    fprintf(report, "peak   : tracked %zu B, RSS %ld KiB\n", after.peak_bytes, ru.ru_maxrss);
+    fclose(report);
+    return after.live_blocks != 0;
+}
@@ -0,0 +1,55 @@
+#ifndef ANSWERS_H
+#define ANSWERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine.h"
+
+/* Canonical form used on both sides of every comparison:
+ *   - ASCII letters folded to lower case
+ *   - leading/trailing whitespace dropped, inner runs collapsed to one space
+ *   - quotes removed, a '-' between two letters read as a space
+ *   - trailing sentence punctuation (. , ! ? ;) dropped
+ * Symbols that mean something in C (* & [] () % _ ...) are kept, so
+ * "*p" and "&p" stay distinct.  Returns the length written (< cap). */
+size_t answer_normalize(char *dst, size_t cap, const char *src);
+
+uint64_t answer_hash(const char *s, size_t len);
+
+/* Hash index over every task's accepted answers (TASK_ASK) and option
+ * texts (TASK_QUIZ), keyed by (task index, normalized text).  Built once
+ * per bank; lookups are one hash and one compare. */
+typedef struct AnswerIndex AnswerIndex;
+
+AnswerIndex *answer_index_build(const Task *tasks, int count);
+void answer_index_free(AnswerIndex *ix);
+
+/* For ASK tasks returns 0 on an accepted answer, for QUIZ the option index;
+ * -1 when `norm` (already normalized) is not in the task's set. */
+int answer_index_lookup(const AnswerIndex *ix, int task, const char *norm, size_t len);
+
+/* ===== Typo tolerance (TASK_ASK) =====
+ * After an exact miss: the accepted answer with the fewest edits
+ * (Levenshtein) from `norm`, within that answer's budget.  Budgets scale
+ * with the normalized answer's length: none below 5 characters, then 1, 2
+ * from 12 and 3 from 24; ASK_TYPOS_AUTO grants them only to answers made
+ * of letters and spaces, n > 0 caps them at n.  Answers longer than 64
+ * characters are exact-match only.
+ *
+ * Distance is Myers' bit-parallel algorithm in Hyyro's global form, one
+ * 64-bit word per answer, so a comparison costs O(input length).  Answers
+ * whose length differs by more than the budget are skipped unread, and a
+ * comparison stops as soon as the remaining input cannot bring it back
+ * under budget.  Before that, the bag distance (per-character count
+ * excess, from a histogram kept with each answer) rejects most wrong
+ * answers without running the recurrence.  Returns the index into Task.answers and sets *edits, or
+ * -1. */
+int answer_index_fuzzy(const AnswerIndex *ix, int task, const char *norm, size_t len,
+                       int tolerance, int *edits);
+
+/* Levenshtein distance of a (1..64 bytes) and b; any value above max
+ * means "more than max" (the scan may stop early). */
+int answer_edit_distance(const char *a, size_t alen, const char *b, size_t blen, int max);
+
+#endif /* ANSWERS_H */
@@ -0,0 +1,73 @@
+#ifndef BANK_H
+#define BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "engine.h"
+
+/* ===== On-disk task bank (*.bank) =====
+ * Little-endian, native alignment, produced by tools/bankc:
+ *
+ *   BankHeader
+ *   BankTask      tasks[task_count]
+ *   BankStr       refs[ref_count]      options then answers, per task
+ *   char          pool[pool_size]      NUL-terminated strings
+ *
+ * Every BankStr points into pool and the byte at off+len is '\0', so a
+ * loaded Task's strings are plain `const char *` views into the mapping. */
+
+#define BANK_MAGIC    "CARCBANK"
+#define BANK_VERSION  4u              /* 2: harness, TASK_CODE; 3: TASK_EXPR; 4: TASK_MACRO */
+#define BANK_NONE     UINT32_MAX        /* absent string */
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t station_id;
+    uint32_t task_count;
+    uint32_t ref_count;
+    uint32_t pool_size;
+    uint32_t checksum;                  /* FNV-1a of everything after the header */
+} BankHeader;
+
+typedef struct {
+    uint32_t off;                       /* into pool, or BANK_NONE */
+    uint32_t len;
+} BankStr;
+
+typedef struct {
+    uint8_t type;                       /* TaskType */
+    uint8_t reserved;
+    uint16_t option_count;
+    uint16_t answer_count;
+    int16_t per_type;                   /* correct_index, typos or expr_flags */
+    uint32_t first_ref;                 /* options start here, answers follow */
+    BankStr prompt;
+    BankStr hint;
+    BankStr why;
+    BankStr harness;
+} BankTask;
+
+/* A mapped bank.  `bank` is ready for engine_begin_bank()/run_station();
+ * the only allocations are one Task array and one pointer array. */
+typedef struct {
+    TaskBank bank;
+    int station_id;
+    void *map;
+    size_t map_len;
+    Task *tasks;
+    const char **lists;                 /* NULL-terminated option/answer lists */
+} BankFile;
+
+Status bank_open(BankFile *bf, const char *path);
+/* Same, from a private copy of the file, for files that may be rewritten
+ * in place while loaded. */
+Status bank_load(BankFile *bf, const char *path);
+void bank_close(BankFile *bf);
+
+/* Serializes tasks to `path` (written to a temp file, then renamed). */
+Status bank_write(const char *path, int station_id, const Task *tasks, int count);
+
+#endif /* BANK_H */
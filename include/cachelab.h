@@ -0,0 +1,79 @@
+#ifndef CACHELAB_H
+#define CACHELAB_H
+
+#include "common.h"
+
+/* ===== Memory-hierarchy experiments for stations 10 and 11 =====
+ * Each experiment walks a buffer of a given size in one access pattern and
+ * reports ns per element, plus hardware counters per element when
+ * perf_event_open(2) lets this process count its own user-space events
+ * (perf_event_paranoid <= 2, and a PMU the kernel or hypervisor exposes).
+ * Without them the results are timing only.
+ *
+ *   chase          dependent loads around a random cycle of cache lines:
+ *                  pure latency, the clearest view of each cache level
+ *   strided        one 8-byte load every `stride` bytes
+ *   aos / soa      sum one field of 32-byte structs vs the same field in
+ *                  its own array
+ *   row / column   sum an n x n double matrix along rows / down columns
+ *   transpose      naive vs CACHELAB_TILE x CACHELAB_TILE blocks
+ *
+ * Buffers come from the tracking allocator and are freed before
+ * cachelab_run() returns.  Small sets are walked repeatedly, so every run
+ * does at least CACHELAB_MIN_TOUCHES accesses. */
+
+#define CACHELAB_MAX_DEFAULT ((size_t)64 << 20)
+#define CACHELAB_MIN_BYTES   ((size_t)4 << 10)
+#define CACHELAB_MIN_TOUCHES ((size_t)1 << 22)
+#define CACHELAB_TILE        16
+
+typedef enum {
+    CL_CHASE,
+    CL_STRIDED,
+    CL_AOS,
+    CL_SOA,
+    CL_ROW_MAJOR,
+    CL_COL_MAJOR,
+    CL_TRANSPOSE,
+    CL_TRANSPOSE_TILED,
+    CL_KINDS
+} ClKind;
+
+typedef enum {
+    CL_EV_L1D_MISS,
+    CL_EV_LLC_MISS,
+    CL_EV_DTLB_MISS,
+    CL_EVENTS
+} ClEvent;
+
+typedef struct {
+    size_t bytes;           /* working set actually used */
+    size_t elements;        /* accesses timed */
+    double ns_per_element;
+    bool have[CL_EVENTS];   /* counter opened and ran */
+    double per_element[CL_EVENTS];
+} ClResult;
+
+/* Largest working set the stations sweep to (c_arcade --lab-max <MiB>). */
+void cachelab_set_max_bytes(size_t bytes);
+size_t cachelab_max_bytes(void);
+
+const char *cachelab_kind_name(ClKind kind);
+const char *cachelab_event_name(ClEvent ev);
+
+/* Whether any counter can be opened; *why says why not (probed once). */
+bool cachelab_counters(const char **why);
+
+/* `stride` is used by CL_STRIDED only.  ERR when out of memory. */
+Status cachelab_run(ClKind kind, size_t bytes, size_t stride, ClResult *out);
+
+/* "16 KiB", "4 MiB": for row labels. */
+void cachelab_format_size(char *buf, size_t cap, size_t bytes);
+
+/* Table output for the stations: a line saying whether counters are in,
+ * a header naming the first column, then one row per result. */
+void cachelab_print_counters_note(void);
+void cachelab_print_header(const char *label);
+void cachelab_print_row(const char *label, const ClResult *r);
+
+#endif /* CACHELAB_H */
@@ -0,0 +1,99 @@
+#ifndef CEXPR_H
+#define CEXPR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "engine.h"
+
+/* ===== In-process C-expression evaluator (TASK_EXPR) =====
+ * A task's options are declarations ("int a[] = {10, 20, 30}",
+ * "int *p = &a[1]", "char s[] = \"hi\"") laid out in a small byte arena
+ * with the target ABI's sizes and alignment (x86-64 System V, LP64).  An
+ * expression is parsed once into a compact stack bytecode with every
+ * operand's type resolved at compile time: integer promotions, the usual
+ * arithmetic conversions, array decay, pointer scaling and sizeof all
+ * follow C17.  The VM then runs it against the arena; reads outside any
+ * object, signed overflow, division by zero, bad shifts and pointer
+ * arithmetic that leaves its array are reported as undefined behavior
+ * instead of producing a number.
+ *
+ * Expressions are pure: no assignment, ++/--, calls or structs.  long
+ * double has its ABI size (16) but is computed in double precision.  An
+ * environment is read-only once built, so any number of threads may
+ * evaluate against it. */
+
+#define CEXPR_MEM       1024    /* arena bytes per environment */
+#define CEXPR_OBJS      32      /* named variables + string literals */
+#define CEXPR_NAME      24
+#define CEXPR_TYPES     64
+#define CEXPR_CODE      256     /* instructions per expression */
+#define CEXPR_STACK     64
+#define CEXPR_NEST      48      /* parenthesis / unary nesting */
+#define CEXPR_ERR       96
+
+typedef enum {
+    CEXPR_SIGNED,
+    CEXPR_UNSIGNED,
+    CEXPR_FLOAT,
+    CEXPR_POINTER
+} CexprClass;
+
+typedef union {
+    int64_t i;
+    uint64_t u;         /* unsigned integers and pointers (arena addresses) */
+    double f;
+} CexprValue;
+
+typedef struct {
+    bool ok;
+    bool syntax;            /* !ok: not an expression (vs. undefined behavior) */
+    int column;             /* 1-based, for syntax errors */
+    uint32_t vars;          /* bit i: names the environment's i-th variable */
+    CexprClass cls;
+    uint32_t size;          /* sizeof the result type */
+    uint32_t pointee;       /* pointers: sizeof what they point to */
+    CexprValue v;
+    char type[48];          /* "unsigned long", "int (*)[3]", ... */
+    char error[CEXPR_ERR];
+} CexprResult;
+
+typedef struct CexprEnv CexprEnv;
+
+/* NULL-terminated declaration list (NULL = no variables).  NULL on a bad
+ * declaration, with the reason in err, or when out of memory. */
+CexprEnv *cexpr_env_new(const char *const *decls, char *err, size_t errcap);
+void cexpr_env_free(CexprEnv *env);
+
+/* Compiles and runs `src` (one expression, EOL optional).  false when it
+ * does not parse or has undefined behavior; r says which. */
+bool cexpr_eval(const CexprEnv *env, const char *src, CexprResult *r);
+
+/* Does `got` answer `ref` under the task's EXPR_* flags? */
+bool cexpr_match(const CexprResult *ref, const CexprResult *got, int flags);
+
+/* The value as a learner would write it: 3, 3.5, 104 ('h'), &a[2]. */
+void cexpr_format(const CexprEnv *env, const CexprResult *r, char *buf, size_t cap);
+
+/* The variables in a CexprResult.vars mask, as "p" or "a and p". */
+void cexpr_var_names(const CexprEnv *env, uint32_t vars, char *buf, size_t cap);
+
+/* ===== Per-bank table =====
+ * Every TASK_EXPR task's environment and reference value, built once by
+ * task_bank_prepare().  A task whose declarations or reference do not
+ * compile keeps the reason in `error` instead of failing the bank. */
+typedef struct {
+    CexprEnv *env;
+    CexprResult ref;
+    char error[128];
+} CexprTask;
+
+typedef struct CexprTable CexprTable;
+
+CexprTable *cexpr_table_build(const Task *tasks, int count);
+void cexpr_table_free(CexprTable *tab);
+/* NULL for tasks that are not TASK_EXPR. */
+const CexprTask *cexpr_table_task(const CexprTable *tab, int task);
+
+#endif /* CEXPR_H */
@@ -0,0 +1,96 @@
+#ifndef COHORT_H
+#define COHORT_H
+
+#include "common.h"
+#include "fpkern.h"
+
+/* ===== Columnar cohort store (*.cohort) =====
+ * The GameState of many learners, one column per field and station, in
+ * one file that is mmap'ed and scanned in place:
+ *
+ *   CohortHeader                                    64 bytes
+ *   int32_t   score[STATION_COUNT][capacity]
+ *   uint16_t  attempts[STATION_COUNT][capacity]     saturates at 65535
+ *   uint64_t  completed[STATION_COUNT][capacity / 64]   bit i = learner i
+ *
+ * Little-endian, native layout.  capacity is a multiple of 512, so every
+ * column starts on a 64-byte boundary, and rows past `learners` are zero.
+ * Station indexes are REG order (0 = station 02).
+ *
+ * Scans read one column, or one bitset per station, start to end.  The
+ * bitsets answer completion filters 64 learners per word; score and
+ * attempt scans run SSE2/AVX2 kernels picked like strkern's. */
+
+#define COHORT_MAGIC    "CARCCOHT"
+#define COHORT_VERSION  1u
+#define COHORT_ROWS     512u        /* capacity granularity */
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t stations;              /* STATION_COUNT when written */
+    uint32_t capacity;
+    uint32_t learners;              /* rows in use */
+    uint8_t reserved[40];
+} CohortHeader;
+
+typedef struct {
+    CohortHeader *hdr;
+    void *map;
+    size_t map_len;
+    bool writable;
+    int32_t *score[STATION_COUNT];
+    uint16_t *attempts[STATION_COUNT];
+    uint64_t *completed[STATION_COUNT];
+} Cohort;
+
+/* New zero-filled store for `capacity` learners (rounded up), or open an
+ * existing one.  ERR with a message on stderr. */
+Status cohort_create(Cohort *c, const char *path, uint32_t capacity);
+Status cohort_open(Cohort *c, const char *path, bool writable);
+void cohort_close(Cohort *c);
+
+uint32_t cohort_learners(const Cohort *c);
+/* Appends a row; its index, or -1 when the store is full or read-only. */
+int64_t cohort_append(Cohort *c, const GameState *g);
+void cohort_put(Cohort *c, uint32_t learner, const GameState *g);
+void cohort_get(const Cohort *c, uint32_t learner, GameState *g);
+
+/* ===== queries over every row in use ===== */
+typedef struct {
+    int64_t sum;
+    int32_t min, max;
+    uint32_t nonzero;
+} CohortScoreStats;
+
+CohortScoreStats cohort_score_stats(const Cohort *c, int station);
+uint32_t cohort_completed(const Cohort *c, int station);
+/* bins[k] counts scores in [k * width, (k + 1) * width); the last bin
+ * also takes everything above, bin 0 everything below. */
+void cohort_histogram(const Cohort *c, int station, int32_t width, uint32_t *bins, int nbins);
+/* Learners that completed every station in `have` and none in `lack`
+ * (bit s = REG index s).  `out`, if not NULL, gets the matches as a
+ * bitset of capacity / 64 words. */
+uint32_t cohort_filter(const Cohort *c, uint32_t have, uint32_t lack, uint64_t *out);
+/* Attempted `station` at least `min_attempts` (>= 1) times, not completed. */
+uint32_t cohort_stuck(const Cohort *c, int station, uint16_t min_attempts, uint64_t *out);
+
+/* ===== kernels, for benchmarks ===== */
+typedef struct {
+    /* score column [0, n) */
+    void (*score_stats)(const int32_t *x, size_t n, CohortScoreStats *st);
+    /* words * 64 attempts: bit set where a >= min and the done bit is clear */
+    uint32_t (*stuck)(const uint16_t *a, const uint64_t *done, size_t words, uint16_t min,
+                      uint64_t *out);
+    /* AND of have[0..nh) and NOT lack[0..nl), word by word */
+    uint32_t (*filter)(const uint64_t *const *have, int nh, const uint64_t *const *lack, int nl,
+                       size_t words, uint64_t *out);
+} CohortKernels;
+
+/* NULL when this build or CPU lacks `isa`. */
+const CohortKernels *cohort_kernels(FpkIsa isa);
+/* Select the set the queries use (benchmarks); false if unavailable. */
+bool cohort_use_isa(FpkIsa isa);
+FpkIsa cohort_active_isa(void);
+
+#endif /* COHORT_H */
@@ -7,6 +7,8 @@
 #include <stdint.h>
 #include <ctype.h>
 
+#include "strkern.h"
+
 #ifndef DEBUG
 #define DEBUG 1
 #endif
@@ -24,16 +26,15 @@ typedef struct {
     int attempted[STATION_COUNT];
 } GameState;
 
-/* tiny helpers */
-static inline void trim_eol(char *s) {
-    if (!s) return;
-    size_t n = strlen(s);
-    while (n && (s[n-1] == '\n' || s[n-1] == '\r')) { s[--n] = '\0'; }
+/* tiny helpers (strkern.h has the vectorized scans behind them) */
+static inline void trim_eol(char *s, size_t cap) {
+    if (!s || !cap) return;
+    s[strk_eol(s, cap - 1)] = '\0';
 }
 
 static inline void lower_inplace(char *s) {
     if (!s) return;
-    for (; *s; ++s) *s = (char)tolower((unsigned char)*s);
+    strk_lower(s, strlen(s));
 }
 
 /* color (you can disable if you prefer) */
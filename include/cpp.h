@@ -0,0 +1,108 @@
+#ifndef CPP_H
+#define CPP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "engine.h"
+
+/* ===== In-process mini preprocessor (TASK_MACRO) =====
+ * Translation phases 2-4 of C17, enough to answer "what does this expand
+ * to?" without forking cc -E: line splices and comments, object- and
+ * function-like macros (variadic ones too), # and ##, #undef, #if /
+ * #ifdef / #ifndef / #elif / #else / #endif with `defined` and integer
+ * constant expressions in intmax_t / uintmax_t, #error, and #include of
+ * in-memory headers.  A header wrapped in #ifndef X ... #endif, or marked
+ * #pragma once, is not read again once X is defined (or it was included).
+ *
+ * Rescanning follows the standard's hide-set rules: a macro name met
+ * again inside its own expansion is painted blue and stays as it is.
+ * Every step -- a replacement, an argument turned into a string, two
+ * tokens pasted, a name painted blue, an #if decided, a header skipped --
+ * is logged as a trace line for the learner.  Arguments are expanded
+ * before their macro is, so their steps come first, indented.
+ *
+ * Not handled: predefined macros (__LINE__, __FILE__, __STDC__, ...),
+ * _Pragma, digraphs, trigraphs, computed #include, and GNU extensions such
+ * as `, ## __VA_ARGS__` and named variadic parameters.  #line, #warning
+ * and pragmas other than `once` are dropped.
+ *
+ * A macro set is read-only once built, so any number of threads may
+ * expand against it; the memo behind cpp_expand() takes a mutex. */
+
+#define CPP_MACROS      64      /* definitions per run, #undef'd ones included */
+#define CPP_PARAMS      16
+#define CPP_BODY        128     /* replacement-list tokens per macro */
+#define CPP_FILES       8       /* in-memory headers per set */
+#define CPP_NAME        32      /* header names */
+#define CPP_INCLUDE     8       /* #include depth */
+#define CPP_NEST        32      /* #if depth */
+#define CPP_TOKENS      8192    /* tokens alive at once in a run */
+#define CPP_OUT         1024    /* preprocessed text */
+#define CPP_TRACE       2048
+#define CPP_ERR         128
+#define CPP_MEMO_SLOTS  512     /* direct-mapped: a new entry evicts the slot's old one */
+
+typedef struct {
+    bool ok;
+    char text[CPP_OUT];     /* the output tokens, a line per output line */
+    int steps;              /* trace lines, counting any that did not fit */
+    bool truncated;         /* the trace did not fit */
+    char trace[CPP_TRACE];  /* one step per line */
+    char error[CPP_ERR];
+} CppResult;
+
+typedef struct CppMacros CppMacros;
+
+/* Preprocesses the NULL-terminated list `lines` (NULL = nothing) and keeps
+ * the macros it leaves defined.  An entry whose first line is "// name"
+ * is not source but the header `name`, for #include "name".  The source
+ * may only hold directives.  NULL on an error, with the reason in err, or
+ * when out of memory. */
+CppMacros *cpp_macros_new(const char *const *lines, char *err, size_t errcap);
+void cpp_macros_free(CppMacros *m);
+/* Same macros (names, parameters, replacement lists), headers and
+ * #pragma once state -> same hash, whatever order they were defined in. */
+uint64_t cpp_macros_hash(const CppMacros *m);
+
+/* Preprocesses `src` (any number of lines) against `m`.  Directives in
+ * src apply to the rest of src only.  false when src is in error; r->error
+ * says why. */
+bool cpp_run(const CppMacros *m, const char *src, CppResult *r);
+/* cpp_run() memoized by (cpp_macros_hash(m), src). */
+bool cpp_expand(const CppMacros *m, const char *src, CppResult *r);
+
+typedef struct {
+    uint64_t hits, misses;
+    uint32_t entries;
+} CppMemoStats;
+
+CppMemoStats cpp_memo_stats(void);
+void cpp_memo_clear(void);
+
+/* Do `a` and `b` hold the same tokens?  Whitespace between tokens does not
+ * count.  *same gets how many leading tokens agree (NULL = not wanted). */
+bool cpp_same_tokens(const char *a, const char *b, int *same);
+
+/* Is this Task.options entry a header ("// name" then its text)? */
+bool cpp_is_header(const char *entry);
+
+/* ===== Per-bank table =====
+ * Every TASK_MACRO task's macro set and the preprocessed reference, built
+ * once by task_bank_prepare().  A task whose source does not preprocess
+ * keeps the reason in `error` instead of failing the bank. */
+typedef struct {
+    CppMacros *macros;
+    CppResult ref;
+    char error[CPP_ERR + 64];
+} CppTask;
+
+typedef struct CppTable CppTable;
+
+CppTable *cpp_table_build(const Task *tasks, int count);
+void cpp_table_free(CppTable *tab);
+/* NULL for tasks that are not TASK_MACRO. */
+const CppTask *cpp_table_task(const CppTable *tab, int task);
+
+#endif /* CPP_H */
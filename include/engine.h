@@ -1,24 +1,55 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 
 typedef enum {
     TASK_ASK,
-    TASK_QUIZ
+    TASK_QUIZ,
+    TASK_CODE,      /* C snippet run by the sandbox: options[i] is the stdin of
+                       test i, answers[i] its expected stdout */
+    TASK_EXPR,      /* C expression evaluated in-process (cexpr.h): options are
+                       declarations, answers[0] the reference expression */
+    TASK_MACRO      /* preprocessor output (cpp.h): options are definitions and
+                       "// name" headers, answers[0] the source to preprocess */
 } TaskType;
 
+/* TASK_ASK typo tolerance, kept in Task.typos.  n > 0 allows at
+ * most n edits; either way short answers get fewer (see answers.h). */
+#define ASK_TYPOS_AUTO  -1  /* scales with length; words only, not numbers or code */
+#define ASK_TYPOS_EXACT 0
+
+/* TASK_EXPR check flags, kept in Task.expr_flags */
+#define EXPR_CONSTANT   1   /* answer may not name the task's variables */
+#define EXPR_SAME_TYPE  2   /* type must match too, not just the value */
+#define EXPR_APPROX     4   /* floating values within 1e-6 (relative) */
+#define EXPR_SAME_VARS  8   /* answer must name every variable the reference names */
+
+/* options/answers are NULL-terminated lists of any length (NULL = none).
+ * harness (TASK_CODE only) is compiled after the learner's snippet, e.g. a
+ * main() that calls the function the task asks for; NULL = the snippet is
+ * a whole program.  The union holds the one per-type setting; name the
+ * member for the task's type. */
 typedef struct {
     TaskType type;
     const char *prompt;
-    const char *options[5];
-    int correct_index;
-    const char *answers[5];
+    const char *const *options;
+    union {
+        int correct_index;      /* TASK_QUIZ: index into options */
+        int typos;              /* TASK_ASK: ASK_TYPOS_* or an edit limit */
+        int expr_flags;         /* TASK_EXPR: EXPR_* */
+    };
+    const char *const *answers;
     const char *hint;
     const char *why;
+    const char *harness;
 } Task;
 
+/* Static list literal for Task.options / Task.answers. */
+#define TASK_LIST(...) ((const char *const[]){ __VA_ARGS__, NULL })
+
 typedef struct {
     int station_id;
     int total_tasks;
@@ -27,6 +58,96 @@ typedef struct {
     int total_points;
 } StationResult;
 
+/* A station's task list, shared read-only by every session that plays it. */
+typedef struct {
+    const Task *tasks;
+    int count;
+    struct AnswerIndex *index;  /* built once by task_bank_prepare() */
+    struct CexprTable *exprs;   /* TASK_EXPR environments, same */
+    struct CppTable *macros;    /* TASK_MACRO macro sets, same */
+} TaskBank;
+
+/* Blocking stdin/stdout front end over the session API below. */
 StationResult run_station(int station_id, const Task *tasks, int task_count);
 
+/* ===== Re-entrant session API =====
+ * A session owns every bit of per-station state, so any number of them can
+ * be stepped from one thread.  Output is appended to a caller-supplied
+ * buffer; the engine never reads stdin or writes stdout itself. */
+
+typedef struct EngineOut EngineOut;
+struct EngineOut {
+    char *data;         /* caller storage, always NUL-terminated */
+    size_t cap;
+    size_t len;
+    bool truncated;     /* set when a write did not fit */
+    /* Optional.  Called when a write does not fit: ships data[0..len) and
+     * returns true, after which the buffer is emptied and the write retried
+     * once.  Without it (or when it fails) the write is cut short. */
+    bool (*spill)(EngineOut *out);
+    void *ctx;          /* for spill */
+};
+
+typedef enum {
+    ENGINE_NEED_INPUT,      /* prompt written; feed the next line */
+    ENGINE_TASK_DONE,       /* a task finished; next prompt already written */
+    ENGINE_STATION_DONE,    /* summary written; session is finished */
+    ENGINE_GRADING          /* code sent to the sandbox: feed nothing until
+                               engine_resume() */
+} EngineStatus;
+
+/* How the last engine_feed() line was graded. */
+typedef enum {
+    GRADE_NONE,             /* not an answer: hint, exit, a line of code, ... */
+    GRADE_WRONG,
+    GRADE_CORRECT,          /* first try, no hint */
+    GRADE_PARTIAL,          /* correct after a miss or a hint */
+    GRADE_SKIPPED
+} EngineGrade;
+
+typedef struct EngineSession EngineSession;
+
+void engine_out_init(EngineOut *out, char *storage, size_t cap);
+void engine_out_reset(EngineOut *out);
+void engine_out_printf(EngineOut *out, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+void engine_out_vprintf(EngineOut *out, const char *fmt, va_list ap)
+    __attribute__((format(printf, 2, 0)));
+void engine_out_puts(EngineOut *out, const char *s);
+
+/* Builds the bank's answer index and expression table on first use.
+ * false when out of memory. */
+bool task_bank_prepare(TaskBank *bank);
+void task_bank_release(TaskBank *bank);
+
+/* NULL when out of memory.  Tasks must outlive the session.  The plain
+ * form indexes the tasks privately; the bank form shares bank->index. */
+EngineSession *engine_begin(int station_id, const Task *tasks, int task_count);
+EngineSession *engine_begin_bank(int station_id, TaskBank *bank);
+/* Just task `task` of `bank`, with no station summary (review mode). */
+EngineSession *engine_begin_task(int station_id, TaskBank *bank, int task);
+
+/* Writes the first prompt (or the "no tasks" notice). */
+EngineStatus engine_start(EngineSession *s, EngineOut *out);
+
+/* One raw input line (EOL optional).  Trimming and case folding happen here. */
+EngineStatus engine_feed(EngineSession *s, const char *line, EngineOut *out);
+
+/* The input side went away: abort the station and write the summary. */
+EngineStatus engine_close(EngineSession *s, EngineOut *out);
+
+/* Code submissions normally block engine_feed() until the sandbox has
+ * graded them.  Given a ctx, engine_feed() submits them with
+ * sandbox_submit(ctx) and returns ENGINE_GRADING instead; the verdict
+ * sandbox_reap() returns for ctx then goes to engine_resume(). */
+struct SandboxResult;
+void engine_grade_async(EngineSession *s, void *ctx);
+EngineStatus engine_resume(EngineSession *s, const struct SandboxResult *r, EngineOut *out);
+
+bool engine_done(const EngineSession *s);
+/* Grade of the last engine_feed() line; *task gets the task it was for. */
+EngineGrade engine_last_grade(const EngineSession *s, int *task);
+StationResult engine_result(const EngineSession *s);
+void engine_end(EngineSession *s);
+
 #endif /* ENGINE_H */
@@ -0,0 +1,73 @@
+#ifndef FPKERN_H
+#define FPKERN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ===== Floating-point summation kernels (libfpkern) =====
+ * Sum and dot product of double arrays by four algorithms, each built
+ * for three instruction sets:
+ *
+ *   naive     one running sum; error grows with n (worst case ~n*eps)
+ *   kahan     compensated: carries the low bits each add loses
+ *   neumaier  Kahan that also survives terms larger than the running sum
+ *   pairwise  halves recursively down to FPK_PAIRWISE_BLOCK elements,
+ *             which are summed naively; error grows with log n
+ *
+ * SIMD variants keep one sum per lane (several vectors of them for the
+ * naive kernel, to hide add latency), so their rounding differs from the
+ * scalar loop; compensated kernels fold their lanes (and the tail) with
+ * Neumaier.  The dot products round
+ * each product before adding it (no FMA), so only the additions are
+ * compensated.
+ *
+ * fpk_sum()/fpk_dot() dispatch to the widest instruction set both CPU and
+ * OS support (CPUID, plus XGETBV for the AVX register state), capped by
+ * fpk_set_isa().  Arrays need no alignment.  The library does not
+ * allocate and has no dependency on the rest of the arcade. */
+
+#define FPK_PAIRWISE_BLOCK 128
+
+typedef enum {
+    FPK_NAIVE,
+    FPK_KAHAN,
+    FPK_NEUMAIER,
+    FPK_PAIRWISE,
+    FPK_ALGOS
+} FpkAlgo;
+
+typedef enum {
+    FPK_SCALAR,
+    FPK_SSE2,
+    FPK_AVX2,
+    FPK_ISAS
+} FpkIsa;
+
+typedef double (*FpkSumFn)(const double *x, size_t n);
+typedef double (*FpkDotFn)(const double *x, const double *y, size_t n);
+
+const char *fpk_algo_name(FpkAlgo algo);
+const char *fpk_isa_name(FpkIsa isa);
+
+/* Widest ISA this machine runs (detected once). */
+FpkIsa fpk_detect_isa(void);
+bool fpk_isa_supported(FpkIsa isa);
+/* Dispatch no wider than `isa` from now on (benchmarks, reproducibility). */
+void fpk_set_isa(FpkIsa isa);
+FpkIsa fpk_active_isa(void);
+
+double fpk_sum(FpkAlgo algo, const double *x, size_t n);
+double fpk_dot(FpkAlgo algo, const double *x, const double *y, size_t n);
+
+/* One specific variant; NULL when this build or CPU cannot run it. */
+FpkSumFn fpk_sum_fn(FpkAlgo algo, FpkIsa isa);
+FpkDotFn fpk_dot_fn(FpkAlgo algo, FpkIsa isa);
+
+/* Neumaier in long double: the yardstick for the kernels' error. */
+long double fpk_sum_ref(const double *x, size_t n);
+long double fpk_dot_ref(const double *x, const double *y, size_t n);
+
+/* |got - ref| / |ref|, or the absolute error when ref is 0. */
+double fpk_rel_error(double got, long double ref);
+
+#endif /* FPKERN_H */
@@ -0,0 +1,37 @@
+#ifndef GRADE_H
+#define GRADE_H
+
+#include "common.h"
+
+/* ===== Offline batch grader (c_arcade --grade <dir>) =====
+ * Every regular file in the directory (dot-files skipped) is a learner
+ * transcript: the lines a learner typed, as in tests/golden_path.txt.  Each
+ * one is replayed through its own Shell exactly as shell_loop() would read
+ * it, with no terminal, journal, launchers or stats, against the banks the
+ * process was started with.
+ *
+ * Transcripts are split into equal index ranges, one per worker thread;
+ * a worker that runs dry steals half of another's remaining range with a
+ * single CAS, so a few long transcripts do not leave cores idle.  Each
+ * worker sums finished station sessions into tallies in its own heap
+ * block and writes its transcripts' rows into disjoint slots, so the only
+ * synchronisation is the join before the report.
+ *
+ * The report lists one row per transcript (name order): lines read, final
+ * score and per-station scores.  CSV goes to stdout unless `report` names
+ * a file; a name ending in ".json" selects JSON, which adds the station
+ * tallies.  A summary with throughput goes to stderr. */
+
+#define GRADE_WORKERS_MAX 256
+
+typedef struct {
+    const char *dir;
+    const char *report;     /* NULL = CSV on stdout */
+    int workers;            /* <= 0: one per online CPU */
+} GradeOptions;
+
+/* Process exit code: 0, or 1 when the directory or a transcript could not
+ * be read or the report could not be written. */
+int grade_run(const GradeOptions *opt);
+
+#endif /* GRADE_H */
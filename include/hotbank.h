@@ -0,0 +1,44 @@
+#ifndef HOTBANK_H
+#define HOTBANK_H
+
+#include "bank.h"
+
+/* ===== Live bank directory (--bank-dir) =====
+ * Every *.bank file in one directory, kept current while the arcade runs:
+ * an inotify watcher reloads a file when it is replaced (bankc writes a
+ * temp file and renames it) and unloads it when it is removed.  A file
+ * that does not load leaves the previous version in place.  Each version
+ * is a private copy, so even a file rewritten in place cannot change tasks
+ * under a running session.
+ *
+ * Versions are swapped RCU-style.  Each station has one published
+ * pointer; hotbank_acquire() pins whatever it points at, and the pinned
+ * version stays mapped until its last hotbank_release(), however many
+ * reloads happen in between.  A station session pins its version for its
+ * whole run, so learners mid-station finish on the tasks they started
+ * with and the next `play` gets the new ones.
+ *
+ * The bank's station id comes from its header, not the file name. */
+
+#define HOTBANK_IDS  32     /* station ids 0..31 */
+
+typedef struct HotBank HotBank;
+
+/* Loads every bank in `dir`; ERR (reason on stderr) when one does not load
+ * or two are for the same station.  With `watch`, starts the watcher. */
+Status hotbank_open(const char *dir, bool watch);
+/* Stops the watcher and drops the published versions.  Pinned ones are
+ * freed by their last release. */
+void hotbank_close(void);
+
+/* Pins the current version for `station_id`; NULL when there is none.
+ * Safe from any thread, lock-free. */
+HotBank *hotbank_acquire(int station_id);
+void hotbank_release(HotBank *v);       /* NULL is fine */
+
+/* Prepared (answer index and expressions built) and read-only. */
+TaskBank *hotbank_bank(HotBank *v);
+/* 1 for the first load of a station, +1 for every reload. */
+uint32_t hotbank_version(const HotBank *v);
+
+#endif /* HOTBANK_H */
@@ -0,0 +1,42 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "common.h"
+
+/* ===== Progress journal =====
+ * <dir>/progress.snap     last compacted GameState (+ sequence number)
+ * <dir>/progress.journal  fixed-size records appended since that snapshot
+ *
+ * Updates are buffered and made durable together by journal_commit()
+ * (one write + one fdatasync per batch).  Records carry absolute values and
+ * a CRC, so replay is idempotent and a torn tail is detected and cut off.
+ * While commits fail (disk full, EIO) the buffer keeps only the newest
+ * record per (kind, station), so it stays within JOURNAL_BATCH and the
+ * next commit that succeeds writes the latest state.
+ * Once the journal holds JOURNAL_COMPACT_AT records a fresh snapshot is
+ * written and the journal truncated, which keeps recovery bounded. */
+
+#define JOURNAL_BATCH       64      /* pending records forcing a commit */
+#define JOURNAL_COMPACT_AT  1024    /* journal records triggering a snapshot */
+
+typedef enum {
+    JR_SCORE = 1,       /* station_scores[station] = value */
+    JR_ATTEMPTED,       /* attempted[station] = value */
+    JR_COMPLETED        /* completed[station] = value != 0 */
+} JournalKind;
+
+typedef struct Journal Journal;
+
+/* Opens (creating if needed) the state in `dir` and recovers it into
+ * *state.  NULL on error, with a message on stderr. */
+Journal *journal_open(const char *dir, GameState *state);
+
+void journal_append(Journal *j, JournalKind kind, int station, int value);
+
+/* Makes every appended record durable.  No-op when nothing is pending. */
+Status journal_commit(Journal *j);
+
+/* Commits, snapshots, truncates the journal and frees j. */
+void journal_close(Journal *j);
+
+#endif /* JOURNAL_H */
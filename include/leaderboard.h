@@ -0,0 +1,57 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include "common.h"
+
+/* ===== Leaderboard =====
+ * Every learner that joined, ranked by total score (board 0) and by score
+ * per station (board 1 + REG index; only learners who scored there).
+ *
+ * Each board is an indexable skip list: ordered by (score desc, learner
+ * asc), and every link also stores how many positions it skips.  A
+ * search then counts how many nodes it passed, so an update, a
+ * rank-of-learner and a jump to the k-th place all cost O(log n).  Nodes
+ * live in one growable array of 32-bit words per board, linked by offset
+ * rather than pointer.  With p = 1/4 a node averages under 24 bytes.
+ *
+ * Ranks are competition ranks: equal scores share a rank ("1224").
+ * Not thread-safe; the shell and the server use it from one thread. */
+
+#define LB_BOARDS    (STATION_COUNT + 1)
+#define LB_OVERALL   0
+#define LB_NAME_MAX  24         /* longer names are cut */
+
+typedef struct {
+    uint32_t learner;
+    int32_t score;
+    uint32_t rank;
+} LbEntry;
+
+typedef struct Leaderboard Leaderboard;
+
+Leaderboard *lb_new(void);      /* NULL when out of memory */
+void lb_free(Leaderboard *lb);
+
+/* A new learner with score 0 on board 0; its id, or -1 when out of memory. */
+int32_t lb_join(Leaderboard *lb, const char *name);
+/* Station REG index `station` now scores `score` (0..UINT16_MAX) for
+ * `learner`; moves it on that station's board and on board 0. */
+Status lb_set(Leaderboard *lb, uint32_t learner, int station, int score);
+
+uint32_t lb_learners(const Leaderboard *lb);
+uint32_t lb_size(const Leaderboard *lb, int board);
+const char *lb_name(const Leaderboard *lb, uint32_t learner);
+int32_t lb_score(const Leaderboard *lb, int board, uint32_t learner);
+/* 1-based competition rank, or 0 when the learner is not on the board. */
+uint32_t lb_rank(const Leaderboard *lb, int board, uint32_t learner);
+
+/* Entries from place `first` (1-based) on; how many were written. */
+size_t lb_top(const Leaderboard *lb, int board, uint32_t first, LbEntry *out, size_t max);
+/* Up to `radius` places either side of the learner, and the learner. */
+size_t lb_around(const Leaderboard *lb, int board, uint32_t learner, uint32_t radius,
+                 LbEntry *out, size_t max);
+
+/* Heap held by the boards, learner table and names. */
+size_t lb_bytes(const Leaderboard *lb);
+
+#endif /* LEADERBOARD_H */
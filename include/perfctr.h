@@ -0,0 +1,29 @@
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include <linux/perf_event.h>
+
+#include "common.h"
+
+/* ===== Hardware event counters (perf_event_open(2)) =====
+ * One counter per PerfCounter: this thread, any CPU, user space only, so
+ * perf_event_paranoid <= 2 is enough.  Many VMs expose no PMU at all;
+ * callers treat a failed open as "timing only" and can show
+ * perf_counter_why(errno) to say why. */
+
+typedef struct {
+    int fd;                 /* -1 when not open */
+} PerfCounter;
+
+/* type/config as in struct perf_event_attr (PERF_TYPE_HARDWARE, ...).
+ * false, with errno set, when the event cannot be counted here. */
+bool perf_counter_open(PerfCounter *c, uint32_t type, uint64_t config);
+void perf_counter_start(PerfCounter *c);        /* reset and enable */
+/* Disable and read; false when the counter is not open. */
+bool perf_counter_stop(PerfCounter *c, uint64_t *count);
+void perf_counter_close(PerfCounter *c);
+
+/* A short reason for an errno from perf_counter_open(). */
+const char *perf_counter_why(int err);
+
+#endif /* PERFCTR_H */
@@ -0,0 +1,99 @@
+#ifndef RECLOG_H
+#define RECLOG_H
+
+#include "common.h"
+#include "engine.h"
+
+/* ===== Session recorder (*.rec) =====
+ * Every learner stream the shell runs (the stdin learner, each --serve
+ * connection) is logged as it happens: the stream's starting state, each
+ * input line, what it was dispatched to, and how the engine graded it.
+ *
+ *   "CARCREC1"                                   once, at file start
+ *   record*:  kind:u8  dt:varint  stream:varint  payload
+ *
+ * dt is microseconds since the previous record (monotonic clock); a
+ * REC_BEGIN record starts each run and carries the wall-clock time.
+ * Varints are LEB128, signed values zigzag-encoded, strings a varint
+ * length and bytes.  A typical input costs 8-20 bytes.
+ *
+ * Records go into a RECLOG_RING-byte ring and reach the file in one
+ * write() per batch: when RECLOG_BATCH bytes are pending, when a stream
+ * closes, at reclog_close(), and once the oldest pending record is
+ * RECLOG_MAX_AGE_MS old.  The age is checked as records arrive and by
+ * reclog_tick(), which --serve calls whenever its epoll_wait() returns,
+ * with reclog_due_ms() as the timeout.  The stdin shell blocks in read
+ * between lines, so there an idle learner's last records wait for the next
+ * line.  A crash loses at most the unflushed batch; a torn final record
+ * is ignored by the reader.
+ *
+ * Not thread-safe; the shell and the server record from one thread. */
+
+#define RECLOG_MAGIC       "CARCREC1"
+#define RECLOG_RING        (64 * 1024)
+#define RECLOG_BATCH       (16 * 1024)
+#define RECLOG_MAX_AGE_MS  1000
+#define RECLOG_NAME_MAX    32
+
+typedef enum {
+    REC_BEGIN = 1,      /* payload: wall-clock ns (varint) */
+    REC_OPEN,           /* flags, salt, name, then per station: score, attempted, completed */
+    REC_INPUT,          /* the line, without its EOL */
+    REC_DISPATCH,       /* command name; "" = the station session, "?" = unknown */
+    REC_GRADE,          /* station id, task index, EngineGrade */
+    REC_CLOSE           /* input ended */
+} RecKind;
+
+#define REC_LAUNCHERS 1u    /* REC_OPEN flag: the stream could run launchers */
+
+/* Start appending to `path` (created if missing).  ERR with a message on
+ * stderr; recording then stays off. */
+Status reclog_open(const char *path);
+/* Flushes and closes; recording is off afterwards. */
+void reclog_close(void);
+bool reclog_active(void);
+
+/* Milliseconds until the pending batch is due by age (0 = overdue), -1
+ * when nothing is pending: a timeout for poll()/epoll_wait(). */
+int reclog_due_ms(void);
+/* Flushes the pending batch if it is due by age. */
+void reclog_tick(void);
+
+/* A new stream id, or 0 when recording is off (every call below then
+ * does nothing). */
+uint32_t reclog_stream_open(const char *name, uint32_t flags, uint64_t salt, const GameState *g);
+void reclog_stream_close(uint32_t stream);
+
+void reclog_input(uint32_t stream, const char *line);
+void reclog_dispatch(uint32_t stream, const char *target);
+void reclog_grade(uint32_t stream, int station_id, int task, EngineGrade grade);
+
+/* ===== reading ===== */
+typedef struct {
+    RecKind kind;
+    uint32_t stream;
+    uint64_t t_us;          /* since the run's REC_BEGIN */
+    uint64_t wall_ns;       /* REC_BEGIN */
+    uint32_t flags;         /* REC_OPEN */
+    uint64_t salt;
+    GameState g;
+    int station_id, task;   /* REC_GRADE */
+    EngineGrade grade;
+    char text[MAX_INPUT];   /* REC_OPEN name, REC_INPUT line, REC_DISPATCH target */
+} RecEvent;
+
+typedef struct {
+    const unsigned char *p, *end;
+    void *map;
+    size_t map_len;
+    uint64_t t_us;
+} RecReader;
+
+Status reclog_reader_open(RecReader *r, const char *path);
+/* false at the end of the log, or at a torn or unknown record. */
+bool reclog_next(RecReader *r, RecEvent *ev);
+void reclog_reader_close(RecReader *r);
+
+const char *reclog_grade_name(EngineGrade grade);
+
+#endif /* RECLOG_H */
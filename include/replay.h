@@ -0,0 +1,17 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/* ===== Session replay (c_arcade --replay <log>) =====
+ * Feeds a session log (reclog.h) back through the shell: every recorded
+ * stream gets its own Shell, starting from the progress and drill salt it
+ * had when it was recorded, and its input lines are dispatched in the
+ * recorded order, against the banks this process was started with.  The
+ * shells' output goes to stdout.
+ *
+ * Each line's dispatch and grade are compared with the recorded ones;
+ * differences are listed on stderr with a summary, and make the exit
+ * code 1.  pace <= 0 replays at full speed, 1 at the recorded pace, 2
+ * twice as fast.  Nothing is recorded or journaled while replaying. */
+int replay_run(const char *log_path, double pace);
+
+#endif /* REPLAY_H */
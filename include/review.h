@@ -0,0 +1,51 @@
+#ifndef REVIEW_H
+#define REVIEW_H
+
+#include "common.h"
+
+/* ===== Spaced-repetition deck =====
+ * One card per graded task of every station that has a bank.  Each card
+ * carries SM-2 state (easiness, interval, repetition count) and its due
+ * time; a binary min-heap of card ids keyed by (due, id) gives the next
+ * card in O(1) and reschedules in O(log n).  New cards are due at 0, so
+ * they come up in station/task order before anything already learned.
+ *
+ * Card ids are dense: station_base[station] + task. */
+
+#define REVIEW_EASE_INIT    250     /* SM-2 easiness factor x100 */
+#define REVIEW_EASE_MIN     130
+#define REVIEW_RELEARN_SECS 600     /* a failed card comes back after this */
+#define REVIEW_DAY          86400u
+
+typedef struct {
+    uint32_t due;           /* unix seconds; 0 = never reviewed */
+    uint32_t task;          /* index into the station's bank */
+    uint16_t interval;      /* days until the next review after a pass */
+    uint16_t ease;          /* SM-2 easiness x100 */
+    uint8_t station;        /* REG index */
+    uint8_t reps;           /* consecutive passes */
+    uint16_t lapses;        /* times failed after having passed */
+} ReviewCard;
+
+typedef struct ReviewDeck ReviewDeck;
+
+ReviewDeck *review_deck_new(void);
+void review_deck_free(ReviewDeck *d);
+
+/* Append `task_count` new cards for REG index `station`; each station once. */
+Status review_deck_add(ReviewDeck *d, int station, uint32_t task_count);
+uint32_t review_deck_size(const ReviewDeck *d);
+
+/* Card with the earliest due time, or -1 for an empty deck. */
+int32_t review_next(const ReviewDeck *d);
+const ReviewCard *review_card(const ReviewDeck *d, uint32_t id);
+
+/* SM-2 update with recall quality 0..5 (< 3 = failed), then reschedule. */
+void review_grade(ReviewDeck *d, uint32_t id, int quality, uint32_t now);
+
+/* Card state by (station, task); cards of stations whose task count
+ * changed since the save are left new. */
+Status review_save(const ReviewDeck *d, const char *path);
+Status review_load(ReviewDeck *d, const char *path);
+
+#endif /* REVIEW_H */
@@ -0,0 +1,51 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include "common.h"
+
+/* ===== Name router: command and station words in one hash probe =====
+ * A Router maps every accepted spelling to a value: the names, their
+ * aliases, and every prefix of either that only one value claims
+ * ("rev" -> review, but not "s", shared by score and stats).  Keys are
+ * ASCII case-insensitive.
+ *
+ * The key set is fixed when the router is built, so the table is a
+ * perfect hash (hash-and-displace): a key's 64-bit hash picks a bucket,
+ * the bucket's displacement d, mixed into the hash again, picks its slot,
+ * and the build searches each bucket's d until its keys land in free
+ * slots.  A lookup is one hash, one slot, one compare, hit or miss.
+ *
+ * The Router is a plain struct: no allocation, safe to read from any
+ * thread once built. */
+
+#define ROUTER_KEY_MAX  16      /* longest key + 1 */
+#define ROUTER_SLOTS    256     /* keys, prefixes included, must fit */
+
+typedef struct {
+    const char *name;
+    int value;                  /* >= 0 */
+} RouteName;
+
+typedef struct {
+    char key[ROUTER_KEY_MAX];   /* lower case; empty slot: len 0 */
+    uint8_t len;
+    bool prefix;                /* an abbreviation, not a name or alias */
+    int16_t value;
+} RouteSlot;
+
+typedef struct {
+    uint32_t mask;              /* slots - 1 */
+    uint32_t buckets;
+    uint32_t keys, prefixes;
+    uint16_t disp[ROUTER_SLOTS];
+    RouteSlot slot[ROUTER_SLOTS];
+} Router;
+
+/* Names and aliases, in any order.  ERR when two explicit keys collide,
+ * a key is too long, or the keys do not fit. */
+Status router_build(Router *r, const RouteName *names, size_t n);
+
+/* The value for key[0..len), or -1. */
+int router_lookup(const Router *r, const char *key, size_t len);
+
+#endif /* ROUTER_H */
@@ -0,0 +1,93 @@
+#ifndef SANDBOX_H
+#define SANDBOX_H
+
+#include "common.h"
+#include "engine.h"
+
+/* ===== Code-submission sandbox =====
+ * TASK_CODE submissions are compiled with the local `cc` and run against
+ * the task's test vectors by a pool of preforked worker processes.  Each
+ * worker compiles and runs in children of its own, under setrlimit (CPU,
+ * address space, file size, open files, no core).  Where user namespaces
+ * work, each child also gets a private filesystem: /usr and the loader
+ * cache read-only, plus its own directory at /work, which for a test run
+ * holds only a read-only copy of the binary.  The build cache is not
+ * there, and a pid namespace of its own hides every other process.  On
+ * x86-64 a seccomp allowlist lets test runs compute, allocate, use the
+ * descriptors they were given, open files read-only, read the clock and
+ * signal themselves; sockets, fork/clone, ptrace, io_uring, a second exec
+ * and anything that writes, renames or removes a file fail.
+ *
+ * Both fail closed: a test whose filter cannot be installed (other
+ * architectures included) does not run, and without user namespaces
+ * nothing is graded (SB_UNAVAILABLE) unless sandbox_configure() was told
+ * `unjailed`.  Then builds and tests run in the worker's scratch
+ * directory with the whole filesystem readable, and compiler diagnostics
+ * about files other than the submission are dropped.
+ *
+ * Builds are cached by the SHA-256 of the compiler flags and the
+ * normalized source (trailing blanks and surrounding blank lines dropped)
+ * with the task harness: <cache>/<hex digest> is the binary, <hex
+ * digest>.err the diagnostics of a failed build.  Identical submissions
+ * never recompile, and a cached binary is never served for other code. */
+
+#define SANDBOX_WORKERS_DEFAULT 2
+#define SANDBOX_WORKERS_MAX     16
+#define SANDBOX_CODE_MAX        8192        /* learner snippet */
+#define SANDBOX_REQ_MAX         65536       /* snippet + harness + vectors */
+#define SANDBOX_CC              "cc"
+#define SANDBOX_CFLAGS          "-std=gnu17", "-O1", "-w"
+#define SANDBOX_CPU_SECS        1           /* per test run */
+#define SANDBOX_WALL_MS         2000
+#define SANDBOX_COMPILE_MS      20000
+#define SANDBOX_MEM_BYTES       (256ul << 20)
+#define SANDBOX_OUTPUT_MAX      4096        /* captured stdout per test */
+
+typedef enum {
+    SB_PASS,
+    SB_FAIL,                /* ran, wrong output on some vector */
+    SB_COMPILE_ERROR,
+    SB_RUNTIME_ERROR,       /* crashed or exited non-zero */
+    SB_TIMEOUT,
+    SB_UNAVAILABLE          /* pool could not start / worker died */
+} SandboxVerdict;
+
+typedef struct SandboxResult {
+    SandboxVerdict verdict;
+    int passed, total;      /* test vectors */
+    bool cached;            /* build came from the cache */
+    char detail[512];       /* diagnostics or the first mismatch */
+} SandboxResult;
+
+/* Optional; the pool otherwise starts with defaults on first use.
+ * workers == 0 disables code grading.  cache_dir NULL = default
+ * ($XDG_CACHE_HOME or ~/.cache, then /tmp).  `unjailed` grades even
+ * where user namespaces are unavailable (see above). */
+void sandbox_configure(int workers, const char *cache_dir, bool unjailed);
+Status sandbox_start(void);
+void sandbox_stop(void);
+
+/* Grades `code` for a TASK_CODE task.  Thread-safe: blocks until a worker
+ * is free. */
+void sandbox_grade(const Task *t, const char *code, SandboxResult *r);
+
+/* ===== Asynchronous grading =====
+ * For an event loop (--serve), from one thread.  sandbox_submit() hands
+ * the submission to an idle worker, or queues it until one is, and
+ * returns at once.  sandbox_fd() polls readable when a worker answers and
+ * sandbox_due_ms() is the time left to the nearest deadline; after either,
+ * sandbox_reap() returns the finished jobs one at a time.  A worker that
+ * overruns its budget is replaced, as in sandbox_grade(). */
+typedef struct SandboxJob SandboxJob;
+
+/* NULL with *r filled in when grading cannot start; `ctx` is what
+ * sandbox_reap() returns for the job. */
+SandboxJob *sandbox_submit(const Task *t, const char *code, void *ctx, SandboxResult *r);
+/* The job's owner went away: the verdict is dropped, the worker kept. */
+void sandbox_cancel(SandboxJob *j);
+int sandbox_fd(void);                       /* -1 if it cannot be made */
+int sandbox_due_ms(void);                   /* 0 = reap now, -1 = nothing running */
+/* ctx of a finished job, its verdict in *r; NULL when none has finished. */
+void *sandbox_reap(SandboxResult *r);
+
+#endif /* SANDBOX_H */
@@ -0,0 +1,55 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "common.h"
+
+/* ===== Full-text search (`find`) =====
+ * An inverted index over short documents (one per task: prompt, options,
+ * hint and explanation).  Text is split into ASCII words of letters,
+ * digits and '_' (so `strcspn`, `size_t` and `0x7f` are words), folded to
+ * lower case; one-letter words are not indexed.
+ *
+ * search_add() collects (term, document, count) triples; search_finish()
+ * lays them out as one postings array grouped by term, each posting
+ * carrying its document's share of the BM25 score (k1 = 1.2, b = 0.75),
+ * best first, plus a dictionary sorted by spelling.  A query word costs
+ * one hash probe (exact) and, for words of SEARCH_PREFIX_MIN letters or
+ * more, a binary search for the terms it is a prefix of; a term matched
+ * only by prefix counts SEARCH_PREFIX_WEIGHT of an exact one.  When the
+ * query comes down to one term the best postings are the answer;
+ * otherwise the terms' postings are summed per document and the best
+ * sums kept.
+ *
+ * Queries share the index's scratch space: one at a time. */
+
+#define SEARCH_TOKEN_MAX     32     /* longer words are cut */
+#define SEARCH_QUERY_TERMS   8      /* query words past this are ignored */
+#define SEARCH_PREFIX_MIN    3
+#define SEARCH_PREFIX_WEIGHT 0.5f
+#define SEARCH_EXPAND_MAX    64     /* dictionary terms per prefix */
+
+typedef struct {
+    uint32_t key;                   /* as given to search_add() */
+    float score;
+} SearchHit;
+
+typedef struct SearchIndex SearchIndex;
+
+SearchIndex *search_new(void);      /* NULL when out of memory */
+void search_free(SearchIndex *ix);
+
+/* One document made of `n` texts (NULL ones are skipped), found as `key`. */
+Status search_add(SearchIndex *ix, uint32_t key, const char *const *texts, size_t n);
+/* Builds postings and dictionary; ERR when out of memory.  Nothing can be
+ * added afterwards. */
+Status search_finish(SearchIndex *ix);
+
+/* Best matches first (ties in the order they were added); how many were
+ * written, at most `max`.  0 before search_finish(). */
+size_t search_query(SearchIndex *ix, const char *query, SearchHit *hits, size_t max);
+
+uint32_t search_docs(const SearchIndex *ix);
+uint32_t search_terms(const SearchIndex *ix);
+size_t search_bytes(const SearchIndex *ix);
+
+#endif /* SEARCH_H */
@@ -0,0 +1,11 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+/* Multi-learner server: one process, one thread, epoll over a Unix stream
+ * socket.  Every connection gets its own Shell (GameState + station
+ * session).  Code is graded asynchronously (sandbox_submit): the sandbox's
+ * fd is in the same epoll set, and a connection's input waits while its
+ * verdict is pending.  Returns the process exit code. */
+int serve_run(const char *socket_path);
+
+#endif /* SERVE_H */
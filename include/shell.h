@@ -1,6 +1,83 @@
 #pragma once
 #include "common.h"
+#include "engine.h"
+#include "hotbank.h"
+#include "journal.h"
+#include "review.h"
+#include "router.h"
+
+/* Finished station sessions summed per station (batch grader). */
+typedef struct {
+    int sessions;
+    StationResult sum;
+} StationTally;
+
+/* One learner's REPL.  The stdin shell owns one; the server owns one per
+ * connection.  Everything a command prints goes to the EngineOut passed in. */
+typedef struct Shell {
+    GameState g;
+    EngineSession *session;         /* station in progress, or NULL */
+    int station_idx;                /* REG index of that station */
+    HotBank *held;                  /* --bank-dir version it runs on, pinned */
+    int32_t learner;                /* leaderboard id, or -1 (not on it) */
+    bool quit;
+    Journal *journal;               /* durable progress, or NULL */
+    const char *state_dir;          /* where journal and review deck live */
+    ReviewDeck *deck;               /* built on first `review` */
+    bool reviewing;                 /* session is a review card */
+    uint32_t review_id;             /* card being reviewed */
+    struct Drill *drill;            /* generated tasks the session runs */
+    uint32_t drills;                /* drills started, for fresh seeds */
+    uint64_t salt;                  /* seeds this learner's drills */
+    /* What the last fed line did, for the session recorder and replay */
+    uint32_t rec;                   /* reclog stream, 0 = not recorded */
+    const char *last_target;        /* command name, "" = station session */
+    EngineGrade last_grade;
+    int last_station, last_task;    /* station id and task it graded */
+    /* Front end renders through ui_frame(): fn-style station launchers,
+     * which print with ui_printf(), may run. */
+    bool launchers;
+    /* Batch grader replaying a transcript: no files are written, and every
+     * finished station session is added to tally[station index]. */
+    bool grading;
+    StationTally *tally;
+    /* Event-loop front end: code is graded in the background, with this
+     * as the sandbox_reap() ctx (engine_grade_async).  While `waiting`,
+     * hold input back until shell_session_resume(). */
+    void *grade_ctx;
+    bool waiting;
+} Shell;
 
 void shell_init(void);
 void shell_loop(void);
 void shell_teardown(void);
+
+/* Build every station bank's answer index up front, so sessions on other
+ * threads only read them (batch grader).  Released by shell_teardown() or
+ * shell_release_banks(). */
+Status shell_prepare_banks(void);
+void shell_release_banks(void);
+
+/* Serve `bank` for station `station_id` instead of its compiled-in tasks.
+ * The bank must stay alive until shell teardown. */
+Status shell_use_bank(int station_id, TaskBank *bank);
+
+/* Recover the stdin learner's progress from `dir` and keep journaling it. */
+Status shell_open_state(const char *dir);
+/* Write Prometheus stats here on `stats dump` and at teardown. */
+void shell_set_stats_file(const char *path);
+
+/* The shell's own routers (station 14 shows them off); see router.h. */
+const Router *shell_command_router(void);
+const Router *shell_station_router(void);
+
+void shell_session_init(Shell *sh, bool launchers);
+/* Put this learner on the shared leaderboard (rank/top) under `name`,
+ * and start recording it when the session recorder is on. */
+Status shell_session_join(Shell *sh, const char *name);
+void shell_session_welcome(Shell *sh, EngineOut *out);  /* greeting + prompt */
+void shell_session_feed(Shell *sh, const char *line, EngineOut *out);
+/* The verdict sandbox_reap() returned for sh->grade_ctx. */
+void shell_session_resume(Shell *sh, const struct SandboxResult *r, EngineOut *out);
+void shell_session_close(Shell *sh, EngineOut *out);    /* input hit EOF */
+void shell_session_free(Shell *sh);
@@ -1,5 +1,6 @@
 #pragma once
 #include "common.h"
+#include "engine.h"
 
 /* Station entry (registry row) */
 typedef struct {
@@ -7,8 +8,14 @@ typedef struct {
     const char *keyword;    /* e.g., "compilation" */
     const char *title;      /* pretty name */
     void (*fn)(void);       /* launcher */
+    TaskBank *bank;         /* tasks the shell drives itself; NULL = use fn */
 } Station;
 
+/* Task banks for stations that have graded tasks */
+extern TaskBank BANK_COMPILATION;
+extern TaskBank BANK_PREPROCESSOR;
+extern TaskBank BANK_POINTERS;
+
 /* 14 stations: 02..15 */
 void station_compilation(void);     /* 02 */
 void station_fundamentals(void);    /* 03 */
@@ -0,0 +1,62 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "common.h"
+#include "engine.h"
+
+/* ===== Response-time statistics =====
+ * Log-linear (HDR-style) histograms: values below HIST_SUB are exact, above
+ * that every power of two is split into HIST_SUB equal buckets, so any
+ * recorded value is within 1/HIST_SUB (12.5%) of its bucket bound.  Values
+ * of 2^HIST_MAX_BITS and up land in the last bucket.
+ *
+ * The engine records per input line (think time, engine time) and per
+ * finished task (attempts, hints) into one histogram set per station and
+ * one per task.  Task sets come from a fixed table of STATS_TASK_SLOTS;
+ * once it is full new tasks are counted at station level only.  All
+ * storage is static: recording never allocates. */
+
+#define HIST_SUB_BITS   3
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS   38
+#define HIST_BUCKETS    ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+
+#define STATS_TASK_SLOTS 256
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint32_t buckets[HIST_BUCKETS];
+} Histogram;
+
+void hist_record(Histogram *h, uint64_t value);
+/* Upper bound of the bucket holding the p-th percentile (0 < p <= 100). */
+uint64_t hist_percentile(const Histogram *h, double p);
+
+typedef enum {
+    STAT_THINK_US,      /* prompt shown -> learner's line arrived */
+    STAT_ENGINE_NS,     /* engine_feed() processing one line */
+    STAT_ATTEMPTS,      /* graded answers per finished task */
+    STAT_HINTS,         /* hint requests per finished task */
+    STAT_METRICS
+} StatMetric;
+
+uint64_t stats_now_ns(void);
+
+/* Recording is single-threaded; the batch grader turns it off before
+ * replaying transcripts on several threads. */
+void stats_set_enabled(bool on);
+
+/* task is the 0-based index in the station's task list */
+void stats_record(int station_id, int task, StatMetric m, uint64_t value);
+/* one shell command, from line in to reply built */
+void stats_record_dispatch(uint64_t ns);
+
+/* station_id 0: one row per station; otherwise one row per task of it. */
+void stats_print(EngineOut *out, int station_id);
+
+/* Prometheus text exposition format; tmp file + rename. */
+Status stats_write_prometheus(const char *path);
+
+#endif /* STATS_H */
@@ -0,0 +1,52 @@
+#ifndef STRKERN_H
+#define STRKERN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fpkern.h"
+
+/* ===== Byte-string kernels for the input path =====
+ * The scans every input line goes through: find the line end, skip and
+ * trim whitespace, split off a word, fold ASCII case, compare ignoring
+ * case.  Each exists as a scalar loop and as SSE2/AVX2 versions that test
+ * 16/32 bytes per step (compare, movemask, count trailing zeros).
+ *
+ * "Whitespace" is isspace() in the C locale: ' ' and '\t' .. '\r'.  Case
+ * folding only touches 'A'..'Z'; other bytes, UTF-8 included, pass
+ * through.  No kernel reads past s + n: whole vectors while they fit, then
+ * a scalar tail.
+ *
+ * The strk_* entry points use the widest kernels the CPU runs (detected
+ * once via fpk_detect_isa()); strk_kernels() hands out one specific set for
+ * benchmarks. */
+
+typedef struct {
+    /* index of the first '\0', '\n' or '\r' in s[0..n), else n */
+    size_t (*eol)(const char *s, size_t n);
+    /* length of the leading run of whitespace / non-whitespace in s[0..n) */
+    size_t (*span_space)(const char *s, size_t n);
+    size_t (*span_word)(const char *s, size_t n);
+    /* length of the trailing run of whitespace in s[0..n) */
+    size_t (*rspan_space)(const char *s, size_t n);
+    /* dst[i] = ASCII lowercase of src[i]; dst may equal src */
+    void (*lower)(char *dst, const char *src, size_t n);
+    /* like strncasecmp, but over exactly n bytes ('\0' is not special) */
+    int (*casecmp)(const char *a, const char *b, size_t n);
+} StrKernels;
+
+/* NULL when this build or CPU cannot run `isa`. */
+const StrKernels *strk_kernels(FpkIsa isa);
+FpkIsa strk_active_isa(void);
+
+size_t strk_eol(const char *s, size_t n);
+size_t strk_span_space(const char *s, size_t n);
+size_t strk_span_word(const char *s, size_t n);
+/* Whitespace-trimmed view of s[0..n): returns its length, *start its offset. */
+size_t strk_trim(const char *s, size_t n, size_t *start);
+void strk_lower(char *s, size_t n);
+void strk_lower_copy(char *dst, const char *src, size_t n);
+int strk_casecmp(const char *a, const char *b, size_t n);
+bool strk_equals_ignore_case(const char *a, size_t alen, const char *b, size_t blen);
+
+#endif /* STRKERN_H */
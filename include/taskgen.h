@@ -0,0 +1,49 @@
+#ifndef TASKGEN_H
+#define TASKGEN_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "engine.h"
+
+/* ===== Parametric tasks =====
+ * A template writes one TASK_ASK from a 64-bit seed: it draws the
+ * parameters (array contents, an index, two operand types, ...) from a
+ * splitmix64 stream seeded by (template, seed), formats the prompt, and
+ * computes the answer, hint and explanation in C at the same time.  The
+ * same (template, seed) always gives the same task, so nothing per
+ * variant is stored: a seed is enough to show a learner their task
+ * again.  Generation is a handful of snprintf calls into caller storage,
+ * with no heap.
+ *
+ * Values assume x86-64 LP64, like TASK_EXPR. */
+
+#define TASKGEN_PROMPT   256
+#define TASKGEN_ANSWERS  4          /* accepted spellings per task */
+#define TASKGEN_ANSWER   32
+#define TASKGEN_HINT     128
+#define TASKGEN_WHY      256
+
+/* Backing store for the strings of one generated Task. */
+typedef struct {
+    char prompt[TASKGEN_PROMPT];
+    char answer[TASKGEN_ANSWERS][TASKGEN_ANSWER];
+    const char *answers[TASKGEN_ANSWERS + 1];
+    char hint[TASKGEN_HINT];
+    char why[TASKGEN_WHY];
+} TaskgenText;
+
+int taskgen_count(void);
+const char *taskgen_name(int tmpl);
+int taskgen_station(int tmpl);              /* station id, 2..15 */
+/* Template index by exact name, or -1. */
+int taskgen_find(const char *name);
+
+/* Variant `seed` of template `tmpl` into *task; its strings point into
+ * *text, which must outlive it. */
+void taskgen_make(int tmpl, uint64_t seed, Task *task, TaskgenText *text);
+
+/* splitmix64 step: a well-mixed 64-bit value from any counter. */
+uint64_t taskgen_mix(uint64_t x);
+
+#endif /* TASKGEN_H */
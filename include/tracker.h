@@ -1,4 +1,60 @@
 #ifndef TRACKER_H
 #define TRACKER_H
 
+#include <stdint.h>
+#include <stdio.h>
+
+/* ===== Tracking allocator =====
+ * tracked_malloc/calloc/realloc/free record every live block (call site,
+ * size, coarse monotonic timestamp) in an open-addressing table keyed by
+ * address.  Frees of unknown pointers (double frees, foreign pointers) are
+ * reported and ignored instead of corrupting the heap.  Blocks still live
+ * at exit are listed by tracker_install_exit_report().
+ *
+ * Build with -DTRACKER_OFF to compile the macros down to plain libc. */
+
+typedef struct {
+    size_t live_bytes;
+    size_t live_blocks;
+    size_t peak_bytes;          /* high-water mark of live_bytes */
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bad_frees;         /* double frees / untracked pointers */
+} TrackerStats;
+
+void *tracker_malloc(size_t size, const char *file, int line);
+void *tracker_calloc(size_t count, size_t size, const char *file, int line);
+void *tracker_realloc(void *ptr, size_t size, const char *file, int line);
+void tracker_free(void *ptr, const char *file, int line);
+
+TrackerStats tracker_stats(void);
+
+typedef struct {
+    const char *file;
+    int line;
+    size_t bytes;
+    size_t blocks;
+} TrackerSite;
+
+/* Live blocks grouped by call site, largest first; fills at most `max`
+ * rows and returns how many were filled. */
+int tracker_sites(TrackerSite *out, int max);
+
+/* Lists every live block; returns how many there were. */
+size_t tracker_report_leaks(FILE *f);
+void tracker_install_exit_report(void);
+
+#ifndef TRACKER_OFF
+#  define tracked_malloc(n)        tracker_malloc((n), __FILE__, __LINE__)
+#  define tracked_calloc(c, n)     tracker_calloc((c), (n), __FILE__, __LINE__)
+#  define tracked_realloc(p, n)    tracker_realloc((p), (n), __FILE__, __LINE__)
+#  define tracked_free(p)          tracker_free((p), __FILE__, __LINE__)
+#else
+#  include <stdlib.h>
+#  define tracked_malloc(n)        malloc(n)
+#  define tracked_calloc(c, n)     calloc((c), (n))
+#  define tracked_realloc(p, n)    realloc((p), (n))
+#  define tracked_free(p)          free(p)
+#endif
+
 #endif /* TRACKER_H */
@@ -1,4 +1,38 @@
 #ifndef UI_H
 #define UI_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "engine.h"
+
+/* ===== Frame renderer for stdout =====
+ * Everything the local REPL shows for one prompt/feedback cycle is built
+ * in one reusable frame and handed to the kernel with a single write() by
+ * ui_flush().  The C_* color codes are stripped at flush time when stdout
+ * is not a terminal (or NO_COLOR is set), so callers always write colors. */
+
+#define UI_FRAME_CAP 16384
+
+typedef struct {
+    uint64_t frames;        /* ui_flush() calls that had output */
+    uint64_t writes;        /* write() syscalls issued */
+    uint64_t bytes;
+} UiStats;
+
+/* The process-wide stdout frame; pass it wherever an EngineOut is wanted.
+ * engine_out_printf() into it flushes a full frame just like ui_printf(). */
+EngineOut *ui_frame(void);
+
+/* Append to the frame; a full frame is flushed first rather than truncated. */
+void ui_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void ui_puts(const char *s);
+
+void ui_flush(void);
+bool ui_color(void);
+UiStats ui_stats(void);
+
+/* Removes ESC '[' ... 'm' sequences in place; returns the new length. */
+size_t ui_strip_ansi(char *s, size_t len);
+
 #endif /* UI_H */
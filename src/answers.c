@@ -0,0 +1,345 @@
+#include "common.h"
+#include "answers.h"
+#include "tracker.h"
+
+typedef struct {
+    uint64_t hash;          /* 0 = empty slot */
+    uint32_t task;
+    int32_t value;
+    uint32_t off;           /* into pool */
+    uint32_t len;
+} Slot;
+
+/* ASK answers in task order, for the typo scan */
+#define HIST_CLASSES 32
+
+typedef struct {
+    uint8_t hist[HIST_CLASSES]; /* char_hist() of the text */
+    uint32_t off;           /* into pool */
+    uint32_t len;
+    int32_t answer;         /* index in Task.answers */
+    uint8_t budget;         /* typo budget for the length, see answers.h */
+    bool words;             /* letters and spaces only */
+} Entry;
+
+struct AnswerIndex {
+    Slot *slots;
+    size_t mask;
+    char *pool;
+    Entry *entries;
+    uint32_t *first;        /* task i: entries[first[i] .. first[i + 1]) */
+    int count;
+};
+
+static bool is_quote(int c) {
+    return c == '\'' || c == '"' || c == '`';
+}
+
+static bool is_trailing_punct(int c) {
+    return c == '.' || c == ',' || c == '!' || c == '?' || c == ';';
+}
+
+static bool plain_word(const char *w, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (is_quote((unsigned char)w[i]) || w[i] == '-') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The byte-at-a-time normalizer for src[0..len), appending at dst[n]:
+ * quotes dropped, whitespace runs squeezed, a dash between letters read as
+ * a space. */
+static size_t normalize_bytes(char *dst, size_t cap, size_t n, const char *src, size_t len,
+                              bool *pending_space) {
+    const unsigned char *p = (const unsigned char *)src, *end = p + len;
+    for (; p < end && n + 1 < cap; ++p) {
+        int c = *p;
+        if (is_quote(c)) {
+            continue;
+        }
+        if (c == '-' && n > 0 && isalpha((unsigned char)dst[n - 1]) && p + 1 < end && isalpha(p[1])) {
+            c = ' ';
+        }
+        if (isspace(c)) {
+            *pending_space = n > 0;
+            continue;
+        }
+        if (*pending_space) {
+            dst[n++] = ' ';
+            *pending_space = false;
+            if (n + 1 >= cap) {
+                break;
+            }
+        }
+        dst[n++] = (char)tolower(c);
+    }
+    return n;
+}
+
+/* Drops trailing punctuation and spaces, terminates, returns the length. */
+static size_t finish(char *dst, size_t n) {
+    while (n > 0 && (is_trailing_punct((unsigned char)dst[n - 1]) || dst[n - 1] == ' ')) {
+        n--;
+    }
+    dst[n] = '\0';
+    return n;
+}
+
+size_t answer_normalize(char *dst, size_t cap, const char *src) {
+    size_t n = 0;
+    bool pending_space = false;
+
+    if (cap == 0) {
+        return 0;
+    }
+    if (!src) {
+        src = "";
+    }
+
+    size_t len = strk_eol(src, strlen(src));
+    if (len < 16) {
+        /* shorter than one vector: more kernel calls would cost more */
+        return finish(dst, normalize_bytes(dst, cap, n, src, len, &pending_space));
+    }
+    size_t start;
+    len = strk_trim(src, len, &start);
+    const char *p = src + start, *end = p + len;
+    /* word by word: words without quotes or dashes are case-folded in bulk */
+    while (p < end && n + 1 < cap) {
+        size_t w = strk_span_word(p, (size_t)(end - p));
+        if (!plain_word(p, w)) {
+            n = normalize_bytes(dst, cap, n, p, w, &pending_space);
+        } else {
+            if (pending_space) {
+                dst[n++] = ' ';
+                pending_space = false;
+                if (n + 1 >= cap) {
+                    break;
+                }
+            }
+            size_t k = w < cap - 1 - n ? w : cap - 1 - n;
+            strk_lower_copy(dst + n, p, k);
+            n += k;
+        }
+        p += w;
+        if (p < end) {
+            pending_space = n > 0;
+            p += strk_span_space(p, (size_t)(end - p));
+        }
+    }
+    return finish(dst, n);
+}
+
+/* FNV-1a, then a final avalanche so the low bits are usable as a slot index */
+uint64_t answer_hash(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t slot_hash(int task, const char *s, size_t len) {
+    uint64_t h = answer_hash(s, len) ^ ((uint64_t)(uint32_t)task * 0x9e3779b97f4a7c15ull);
+    return h ? h : 1;
+}
+
+static const char *const *task_texts(const Task *t) {
+    switch (t->type) {
+        case TASK_QUIZ: return t->options;
+        case TASK_ASK:  return t->answers;
+        default:        return NULL;    /* TASK_CODE is graded by running it */
+    }
+}
+
+/* Character counts folded into 32 classes (letters stay distinct), capped
+ * at 255.  Folding and capping only merge counts, so the bag distance
+ * computed from two histograms is still a lower bound on the edit
+ * distance of the texts. */
+static void char_hist(uint8_t h[HIST_CLASSES], const char *s, size_t len) {
+    memset(h, 0, HIST_CLASSES);
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t *c = &h[(unsigned char)s[i] % HIST_CLASSES];
+        if (*c < UINT8_MAX) (*c)++;
+    }
+}
+
+AnswerIndex *answer_index_build(const Task *tasks, int count) {
+    size_t entries = 0, pool_len = 0;
+    for (int i = 0; i < count; ++i) {
+        const char *const *texts = task_texts(&tasks[i]);
+        for (int j = 0; texts && texts[j]; ++j) {
+            entries++;
+            pool_len += strlen(texts[j]) + 1;
+        }
+    }
+
+    size_t cap = 8;
+    while (cap < entries * 2) {
+        cap <<= 1;
+    }
+
+    AnswerIndex *ix = tracked_calloc(1, sizeof(*ix));
+    if (!ix) {
+        return NULL;
+    }
+    ix->slots = tracked_calloc(cap, sizeof(Slot));
+    ix->pool = tracked_malloc(pool_len ? pool_len : 1);
+    ix->entries = tracked_malloc((entries ? entries : 1) * sizeof(Entry));
+    ix->first = tracked_malloc(((size_t)count + 1) * sizeof(uint32_t));
+    if (!ix->slots || !ix->pool || !ix->entries || !ix->first) {
+        answer_index_free(ix);
+        return NULL;
+    }
+    ix->mask = cap - 1;
+    ix->count = count;
+
+    size_t used = 0;
+    uint32_t listed = 0;
+    for (int i = 0; i < count; ++i) {
+        const char *const *texts = task_texts(&tasks[i]);
+        ix->first[i] = listed;
+        for (int j = 0; texts && texts[j]; ++j) {
+            char *norm = ix->pool + used;
+            size_t len = answer_normalize(norm, pool_len - used, texts[j]);
+            int value = tasks[i].type == TASK_QUIZ ? j : 0;
+            if (answer_index_lookup(ix, i, norm, len) >= 0) {
+                continue;   /* duplicate spelling: first one wins */
+            }
+
+            uint64_t h = slot_hash(i, norm, len);
+            size_t k = (size_t)h & ix->mask;
+            while (ix->slots[k].hash) {
+                k = (k + 1) & ix->mask;
+            }
+            ix->slots[k] = (Slot){ h, (uint32_t)i, value, (uint32_t)used, (uint32_t)len };
+            if (tasks[i].type == TASK_ASK && len > 0) {
+                Entry *en = &ix->entries[listed++];
+                char_hist(en->hist, norm, len);
+                en->off = (uint32_t)used;
+                en->len = (uint32_t)len;
+                en->answer = j;
+                en->budget = (uint8_t)(len < 5 || len > 64 ? 0 : len < 12 ? 1 : len < 24 ? 2 : 3);
+                en->words = strspn(norm, "abcdefghijklmnopqrstuvwxyz ") == len;
+            }
+            used += len + 1;
+        }
+    }
+    ix->first[count] = listed;
+    return ix;
+}
+
+void answer_index_free(AnswerIndex *ix) {
+    if (!ix) {
+        return;
+    }
+    tracked_free(ix->slots);
+    tracked_free(ix->pool);
+    tracked_free(ix->entries);
+    tracked_free(ix->first);
+    tracked_free(ix);
+}
+
+int answer_index_lookup(const AnswerIndex *ix, int task, const char *norm, size_t len) {
+    if (!ix || len == 0) {
+        return -1;
+    }
+    uint64_t h = slot_hash(task, norm, len);
+    for (size_t k = (size_t)h & ix->mask; ix->slots[k].hash; k = (k + 1) & ix->mask) {
+        const Slot *s = &ix->slots[k];
+        if (s->hash == h && s->task == (uint32_t)task && s->len == len &&
+            memcmp(ix->pool + s->off, norm, len) == 0) {
+            return s->value;
+        }
+    }
+    return -1;
+}
+
+/* ===== typo tolerance ===== */
+int answer_edit_distance(const char *a, size_t alen, const char *b, size_t blen, int max) {
+    /* Only the entries b can read need to be defined. */
+    uint64_t peq[256];
+    for (size_t j = 0; j < blen; ++j) peq[(unsigned char)b[j]] = 0;
+    for (size_t i = 0; i < alen; ++i) peq[(unsigned char)a[i]] = 0;
+    for (size_t i = 0; i < alen; ++i) peq[(unsigned char)a[i]] |= 1ull << i;
+
+    /* Column j of the DP matrix as vertical deltas: pv/mv mark +1/-1 steps.
+     * Shifting a 1 into ph each column makes row 0 count up (global
+     * distance, not substring search). */
+    const uint64_t last = 1ull << (alen - 1);
+    uint64_t pv = ~0ull, mv = 0;
+    int score = (int)alen;
+    for (size_t j = 0; j < blen; ++j) {
+        uint64_t eq = peq[(unsigned char)b[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last) score++;
+        else if (mh & last) score--;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        /* each remaining character lowers the distance by at most one */
+        if (score - (int)(blen - j - 1) > max) return max + 1;
+    }
+    return score;
+}
+
+/* Bag distance: characters one side has more copies of than the other.
+ * Plain byte loops, so the compiler vectorizes them. */
+static int bag_distance(const uint8_t a[HIST_CLASSES], const uint8_t b[HIST_CLASSES]) {
+    int more = 0, fewer = 0;
+    for (int i = 0; i < HIST_CLASSES; ++i) {
+        more += a[i] > b[i] ? a[i] - b[i] : 0;
+        fewer += b[i] > a[i] ? b[i] - a[i] : 0;
+    }
+    return more > fewer ? more : fewer;
+}
+
+static int typo_budget(int tolerance, const Entry *en) {
+    if (tolerance == ASK_TYPOS_EXACT) {
+        return 0;
+    }
+    if (tolerance > 0) {
+        return tolerance < en->budget ? tolerance : en->budget;
+    }
+    return en->words ? en->budget : 0;
+}
+
+int answer_index_fuzzy(const AnswerIndex *ix, int task, const char *norm, size_t len,
+                       int tolerance, int *edits) {
+    if (!ix || len == 0 || task < 0 || task >= ix->count) {
+        return -1;
+    }
+    uint8_t hist[HIST_CLASSES];
+    char_hist(hist, norm, len);
+    int best = -1, best_edits = 0;
+    for (uint32_t e = ix->first[task]; e < ix->first[task + 1]; ++e) {
+        const Entry *en = &ix->entries[e];
+        int max = typo_budget(tolerance, en);
+        if (best >= 0 && max >= best_edits) {
+            max = best_edits - 1;       /* only a closer answer matters now */
+        }
+        size_t diff = len > en->len ? len - en->len : en->len - len;
+        if (max <= 0 || diff > (size_t)max || bag_distance(en->hist, hist) > max) {
+            continue;
+        }
+        int d = answer_edit_distance(ix->pool + en->off, en->len, norm, len, max);
+        if (d <= max) {
+            best = en->answer;
+            best_edits = d;
+        }
+    }
+    if (best >= 0) {
+        *edits = best_edits;
+    }
+    return best;
+}
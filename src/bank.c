@@ -0,0 +1,296 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bank.h"
+#include "answers.h"
+#include "cexpr.h"
+#include "cpp.h"
+#include "tracker.h"
+
+#define FNV32_INIT 2166136261u
+
+static uint32_t fnv1a32(uint32_t h, const void *data, size_t n) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* ===== loading ===== */
+static bool str_ok(const BankStr *s, const char *pool, uint32_t pool_size) {
+    if (s->off == BANK_NONE) {
+        return true;
+    }
+    return s->off <= pool_size && s->len < pool_size - s->off &&
+           pool[s->off + s->len] == '\0';
+}
+
+static const char *str_at(const BankStr *s, const char *pool) {
+    return s->off == BANK_NONE ? NULL : pool + s->off;
+}
+
+static Status bank_fail(BankFile *bf, const char *path, const char *why) {
+    fprintf(stderr, "%s: %s\n", path, why);
+    bank_close(bf);
+    return ERR;
+}
+
+/* Fills bf->map from an open fd: a file mapping, or an anonymous one the
+ * file is read into.  Closes fd. */
+static Status map_file(BankFile *bf, int fd, const char *path, bool copy) {
+    if (!copy) {
+        bf->map = mmap(NULL, bf->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    } else {
+        bf->map = mmap(NULL, bf->map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        for (size_t got = 0; bf->map != MAP_FAILED && got < bf->map_len;) {
+            ssize_t n = pread(fd, (char *)bf->map + got, bf->map_len - got, (off_t)got);
+            if (n > 0) {
+                got += (size_t)n;
+            } else if (n == 0 || errno != EINTR) {
+                munmap(bf->map, bf->map_len);
+                bf->map = MAP_FAILED;
+                if (n == 0) errno = EIO;    /* shrank while reading */
+            }
+        }
+        if (bf->map != MAP_FAILED) mprotect(bf->map, bf->map_len, PROT_READ);
+    }
+    close(fd);
+    if (bf->map == MAP_FAILED) {
+        bf->map = NULL;
+        perror(path);
+        return ERR;
+    }
+    return OK;
+}
+
+static Status open_bank(BankFile *bf, const char *path, bool copy) {
+    memset(bf, 0, sizeof(*bf));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return ERR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(BankHeader)) {
+        close(fd);
+        fprintf(stderr, "%s: not a task bank\n", path);
+        return ERR;
+    }
+    bf->map_len = (size_t)st.st_size;
+    if (map_file(bf, fd, path, copy) != OK) {
+        return ERR;
+    }
+
+    const unsigned char *base = bf->map;
+    const BankHeader *h = bf->map;
+    if (memcmp(h->magic, BANK_MAGIC, sizeof(h->magic)) != 0) {
+        return bank_fail(bf, path, "bad magic");
+    }
+    if (h->version != BANK_VERSION) {
+        return bank_fail(bf, path, "unsupported bank version");
+    }
+
+    uint64_t need = sizeof(BankHeader) + (uint64_t)h->task_count * sizeof(BankTask) +
+                    (uint64_t)h->ref_count * sizeof(BankStr) + h->pool_size;
+    if (need != bf->map_len || h->task_count > INT32_MAX) {
+        return bank_fail(bf, path, "truncated or oversized");
+    }
+    if (fnv1a32(FNV32_INIT, base + sizeof(BankHeader), bf->map_len - sizeof(BankHeader)) != h->checksum) {
+        return bank_fail(bf, path, "checksum mismatch");
+    }
+
+    const BankTask *bt = (const BankTask *)(base + sizeof(BankHeader));
+    const BankStr *refs = (const BankStr *)(bt + h->task_count);
+    const char *pool = (const char *)(refs + h->ref_count);
+
+    bf->tasks = tracked_calloc(h->task_count ? h->task_count : 1, sizeof(Task));
+    bf->lists = tracked_calloc((size_t)h->ref_count + 2u * h->task_count + 1, sizeof(char *));
+    if (!bf->tasks || !bf->lists) {
+        return bank_fail(bf, path, "out of memory");
+    }
+
+    size_t li = 0;
+    for (uint32_t i = 0; i < h->task_count; ++i) {
+        const BankTask *b = &bt[i];
+        uint64_t nrefs = (uint64_t)b->option_count + b->answer_count;
+        if ((uint64_t)b->first_ref + nrefs > h->ref_count ||
+            b->type > TASK_MACRO ||
+            !str_ok(&b->prompt, pool, h->pool_size) ||
+            !str_ok(&b->hint, pool, h->pool_size) ||
+            !str_ok(&b->why, pool, h->pool_size) ||
+            !str_ok(&b->harness, pool, h->pool_size)) {
+            return bank_fail(bf, path, "corrupt task record");
+        }
+        for (uint64_t r = 0; r < nrefs; ++r) {
+            const BankStr *s = &refs[b->first_ref + r];
+            if (s->off == BANK_NONE || !str_ok(s, pool, h->pool_size)) {
+                return bank_fail(bf, path, "corrupt string ref");
+            }
+        }
+
+        Task *t = &bf->tasks[i];
+        t->type = (TaskType)b->type;
+        t->prompt = str_at(&b->prompt, pool);
+        t->hint = str_at(&b->hint, pool);
+        t->why = str_at(&b->why, pool);
+        t->harness = str_at(&b->harness, pool);
+        t->correct_index = b->per_type;     /* the whole union */
+
+        const BankStr *r = &refs[b->first_ref];
+        if (b->option_count) {
+            t->options = &bf->lists[li];
+            for (uint16_t k = 0; k < b->option_count; ++k) bf->lists[li++] = str_at(r++, pool);
+            bf->lists[li++] = NULL;
+        }
+        if (b->answer_count) {
+            t->answers = &bf->lists[li];
+            for (uint16_t k = 0; k < b->answer_count; ++k) bf->lists[li++] = str_at(r++, pool);
+            bf->lists[li++] = NULL;
+        }
+    }
+
+    bf->station_id = (int)h->station_id;
+    bf->bank.tasks = bf->tasks;
+    bf->bank.count = (int)h->task_count;
+    bf->bank.index = NULL;
+    bf->bank.exprs = NULL;
+    bf->bank.macros = NULL;
+    return OK;
+}
+
+Status bank_open(BankFile *bf, const char *path) {
+    return open_bank(bf, path, false);
+}
+
+Status bank_load(BankFile *bf, const char *path) {
+    return open_bank(bf, path, true);
+}
+
+void bank_close(BankFile *bf) {
+    answer_index_free(bf->bank.index);
+    cexpr_table_free(bf->bank.exprs);
+    cpp_table_free(bf->bank.macros);
+    tracked_free(bf->tasks);
+    tracked_free(bf->lists);
+    if (bf->map) {
+        munmap(bf->map, bf->map_len);
+    }
+    memset(bf, 0, sizeof(*bf));
+}
+
+/* ===== writing ===== */
+typedef struct {
+    char *data;
+    size_t len, cap;
+    bool failed;
+} Buf;
+
+static void buf_put(Buf *b, const void *p, size_t n) {
+    if (b->failed) return;
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) cap *= 2;
+        char *nd = tracked_realloc(b->data, cap);
+        if (!nd) { b->failed = true; return; }
+        b->data = nd;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static BankStr pool_add(Buf *pool, const char *s) {
+    BankStr r = { BANK_NONE, 0 };
+    if (!s) return r;
+    size_t n = strlen(s);
+    r.off = (uint32_t)pool->len;
+    r.len = (uint32_t)n;
+    buf_put(pool, s, n + 1);
+    return r;
+}
+
+static uint16_t list_len(const char *const *l) {
+    uint16_t n = 0;
+    while (l && l[n]) n++;
+    return n;
+}
+
+Status bank_write(const char *path, int station_id, const Task *tasks, int count) {
+    Buf recs = {0}, refs = {0}, pool = {0};
+
+    for (int i = 0; i < count; ++i) {
+        const Task *t = &tasks[i];
+        BankTask b;
+        memset(&b, 0, sizeof(b));
+        b.type = (uint8_t)t->type;
+        b.option_count = list_len(t->options);
+        b.answer_count = list_len(t->answers);
+        b.per_type = (int16_t)t->correct_index;
+        b.first_ref = (uint32_t)(refs.len / sizeof(BankStr));
+        b.prompt = pool_add(&pool, t->prompt);
+        b.hint = pool_add(&pool, t->hint);
+        b.why = pool_add(&pool, t->why);
+        b.harness = pool_add(&pool, t->harness);
+        for (uint16_t k = 0; k < b.option_count; ++k) {
+            BankStr r = pool_add(&pool, t->options[k]);
+            buf_put(&refs, &r, sizeof(r));
+        }
+        for (uint16_t k = 0; k < b.answer_count; ++k) {
+            BankStr r = pool_add(&pool, t->answers[k]);
+            buf_put(&refs, &r, sizeof(r));
+        }
+        buf_put(&recs, &b, sizeof(b));
+    }
+
+    Status rc = ERR;
+    if (recs.failed || refs.failed || pool.failed || pool.len >= BANK_NONE) {
+        fprintf(stderr, "%s: bank too large or out of memory\n", path);
+        goto done;
+    }
+
+    BankHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BANK_MAGIC, sizeof(h.magic));
+    h.version = BANK_VERSION;
+    h.station_id = (uint32_t)station_id;
+    h.task_count = (uint32_t)count;
+    h.ref_count = (uint32_t)(refs.len / sizeof(BankStr));
+    h.pool_size = (uint32_t)pool.len;
+
+    /* checksum runs over the three sections as they will sit on disk */
+    const Buf *parts[] = { &recs, &refs, &pool };
+    h.checksum = FNV32_INIT;
+    for (size_t p = 0; p < 3; ++p) {
+        h.checksum = fnv1a32(h.checksum, parts[p]->data, parts[p]->len);
+    }
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) { perror(tmp); goto done; }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (size_t p = 0; p < 3 && ok; ++p) {
+        ok = parts[p]->len == 0 || fwrite(parts[p]->data, parts[p]->len, 1, f) == 1;
+    }
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+        goto done;
+    }
+    rc = OK;
+
+done:
+    tracked_free(recs.data);
+    tracked_free(refs.data);
+    tracked_free(pool.data);
+    return rc;
+}
@@ -0,0 +1,321 @@
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "cachelab.h"
+#include "perfctr.h"
+#include "tracker.h"
+#include "ui.h"
+
+#define LINE 64
+
+typedef struct {
+    double x, y, z, w;
+} Particle;
+
+/* Everything one experiment touches; a pass walks it once. */
+typedef struct {
+    ClKind kind;
+    size_t n;               /* elements, lines or matrix side */
+    size_t step;            /* CL_STRIDED: elements between loads */
+    size_t *next;           /* CL_CHASE: LINE-spaced links */
+    size_t at;              /* CL_CHASE: where the chain stands */
+    double *a, *b;
+    double *soa[4];
+    Particle *aos;
+} Lab;
+
+static size_t g_max_bytes = CACHELAB_MAX_DEFAULT;
+static volatile double sink;
+
+static const char *const KIND_NAMES[CL_KINDS] = {
+    "chase", "strided", "aos", "soa", "row", "column", "transpose", "tiled",
+};
+
+static const char *const EVENT_NAMES[CL_EVENTS] = { "L1D miss", "LLC miss", "dTLB miss" };
+
+void cachelab_set_max_bytes(size_t bytes) {
+    g_max_bytes = bytes < CACHELAB_MIN_BYTES ? CACHELAB_MIN_BYTES : bytes;
+}
+
+size_t cachelab_max_bytes(void) {
+    return g_max_bytes;
+}
+
+const char *cachelab_kind_name(ClKind kind) {
+    return (unsigned)kind < CL_KINDS ? KIND_NAMES[kind] : "?";
+}
+
+const char *cachelab_event_name(ClEvent ev) {
+    return (unsigned)ev < CL_EVENTS ? EVENT_NAMES[ev] : "?";
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+/* ===== hardware counters ===== */
+#define HW_CACHE(cache, result) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | ((result) << 16))
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} EVENTS[CL_EVENTS] = {
+    [CL_EV_L1D_MISS]  = { PERF_TYPE_HW_CACHE,
+                          HW_CACHE(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    [CL_EV_LLC_MISS]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    [CL_EV_DTLB_MISS] = { PERF_TYPE_HW_CACHE,
+                          HW_CACHE(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+};
+
+static bool counter_open(PerfCounter *c, ClEvent ev) {
+    return perf_counter_open(c, EVENTS[ev].type, EVENTS[ev].config);
+}
+
+bool cachelab_counters(const char **why) {
+    static int state = -1;          /* -1 unprobed, 0 none, 1 some */
+    static const char *reason;
+    if (state < 0) {
+        int err = 0;
+        state = 0;
+        for (int ev = 0; ev < CL_EVENTS; ++ev) {
+            PerfCounter c;
+            if (counter_open(&c, (ClEvent)ev)) {
+                perf_counter_close(&c);
+                state = 1;
+            } else if (!err) {
+                err = errno;
+            }
+        }
+        reason = state ? NULL : perf_counter_why(err);
+    }
+    if (why) *why = reason;
+    return state == 1;
+}
+
+/* ===== experiments ===== */
+static void lab_free(Lab *lab) {
+    tracked_free(lab->next);
+    tracked_free(lab->a);
+    tracked_free(lab->b);
+    for (int i = 0; i < 4; ++i) tracked_free(lab->soa[i]);
+    tracked_free(lab->aos);
+}
+
+/* Allocates and fills the buffers; returns the bytes in the working set,
+ * or 0 when out of memory. */
+static size_t lab_setup(Lab *lab, size_t bytes, size_t stride) {
+    switch (lab->kind) {
+        case CL_CHASE: {
+            lab->n = bytes / LINE > 1 ? bytes / LINE : 2;
+            size_t words = LINE / sizeof(size_t);
+            lab->next = tracked_calloc(lab->n * words, sizeof(size_t));
+            size_t *order = tracked_malloc(lab->n * sizeof(size_t));
+            if (!lab->next || !order) {
+                tracked_free(order);
+                return 0;
+            }
+            /* one random cycle through every line, so prefetchers can't guess */
+            uint64_t rng = 0x9e3779b97f4a7c15ull;
+            for (size_t i = 0; i < lab->n; ++i) order[i] = i;
+            for (size_t i = lab->n - 1; i > 0; --i) {
+                size_t j = (size_t)(xorshift(&rng) % (i + 1));
+                size_t t = order[i]; order[i] = order[j]; order[j] = t;
+            }
+            for (size_t i = 0; i < lab->n; ++i) {
+                lab->next[order[i] * words] = order[(i + 1) % lab->n] * words;
+            }
+            lab->at = order[0] * words;
+            tracked_free(order);
+            return lab->n * LINE;
+        }
+        case CL_STRIDED:
+            lab->n = bytes / sizeof(double);
+            lab->step = stride >= sizeof(double) ? stride / sizeof(double) : 1;
+            if (lab->step > lab->n) lab->step = lab->n;
+            lab->a = tracked_malloc(lab->n * sizeof(double));
+            if (!lab->a) return 0;
+            for (size_t i = 0; i < lab->n; ++i) lab->a[i] = (double)(i & 7);
+            return lab->n * sizeof(double);
+        case CL_AOS:
+            lab->n = bytes / sizeof(Particle);
+            lab->aos = tracked_malloc(lab->n * sizeof(Particle));
+            if (!lab->aos) return 0;
+            for (size_t i = 0; i < lab->n; ++i) {
+                lab->aos[i] = (Particle){ (double)(i & 7), 1.0, 2.0, 3.0 };
+            }
+            return lab->n * sizeof(Particle);
+        case CL_SOA:
+            lab->n = bytes / sizeof(Particle);
+            for (int f = 0; f < 4; ++f) {
+                lab->soa[f] = tracked_malloc(lab->n * sizeof(double));
+                if (!lab->soa[f]) return 0;
+                for (size_t i = 0; i < lab->n; ++i) lab->soa[f][i] = f ? (double)f : (double)(i & 7);
+            }
+            return 4 * lab->n * sizeof(double);
+        case CL_ROW_MAJOR:
+        case CL_COL_MAJOR:
+        case CL_TRANSPOSE:
+        case CL_TRANSPOSE_TILED: {
+            int mats = lab->kind == CL_ROW_MAJOR || lab->kind == CL_COL_MAJOR ? 1 : 2;
+            lab->n = (size_t)sqrt((double)(bytes / (mats * sizeof(double))));
+            lab->n -= lab->n % CACHELAB_TILE;
+            if (lab->n < CACHELAB_TILE) lab->n = CACHELAB_TILE;
+            size_t cells = lab->n * lab->n;
+            lab->a = tracked_malloc(cells * sizeof(double));
+            if (!lab->a) return 0;
+            for (size_t i = 0; i < cells; ++i) lab->a[i] = (double)(i & 7);
+            if (mats == 2) {
+                lab->b = tracked_calloc(cells, sizeof(double));
+                if (!lab->b) return 0;
+            }
+            return mats * cells * sizeof(double);
+        }
+        default:
+            return 0;
+    }
+}
+
+/* Elements one pass touches. */
+static size_t lab_touches(const Lab *lab) {
+    switch (lab->kind) {
+        case CL_STRIDED: return (lab->n + lab->step - 1) / lab->step;
+        case CL_ROW_MAJOR:
+        case CL_COL_MAJOR:
+        case CL_TRANSPOSE:
+        case CL_TRANSPOSE_TILED: return lab->n * lab->n;
+        default: return lab->n;
+    }
+}
+
+static double lab_pass(Lab *lab) {
+    const size_t n = lab->n;
+    double s = 0.0;
+    switch (lab->kind) {
+        case CL_CHASE: {
+            size_t p = lab->at;
+            for (size_t i = 0; i < n; ++i) p = lab->next[p];
+            lab->at = p;
+            return (double)p;
+        }
+        case CL_STRIDED:
+            for (size_t i = 0; i < n; i += lab->step) s += lab->a[i];
+            return s;
+        case CL_AOS:
+            for (size_t i = 0; i < n; ++i) s += lab->aos[i].x;
+            return s;
+        case CL_SOA:
+            for (size_t i = 0; i < n; ++i) s += lab->soa[0][i];
+            return s;
+        case CL_ROW_MAJOR:
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < n; ++j) s += lab->a[i * n + j];
+            return s;
+        case CL_COL_MAJOR:
+            for (size_t j = 0; j < n; ++j)
+                for (size_t i = 0; i < n; ++i) s += lab->a[i * n + j];
+            return s;
+        case CL_TRANSPOSE:
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < n; ++j) lab->b[j * n + i] = lab->a[i * n + j];
+            return lab->b[n - 1];
+        case CL_TRANSPOSE_TILED:
+            for (size_t ii = 0; ii < n; ii += CACHELAB_TILE)
+                for (size_t jj = 0; jj < n; jj += CACHELAB_TILE)
+                    for (size_t i = ii; i < ii + CACHELAB_TILE; ++i)
+                        for (size_t j = jj; j < jj + CACHELAB_TILE; ++j)
+                            lab->b[j * n + i] = lab->a[i * n + j];
+            return lab->b[n - 1];
+        default:
+            return 0.0;
+    }
+}
+
+Status cachelab_run(ClKind kind, size_t bytes, size_t stride, ClResult *out) {
+    memset(out, 0, sizeof(*out));
+    if ((unsigned)kind >= CL_KINDS) {
+        return ERR;
+    }
+    Lab lab = { .kind = kind };
+    out->bytes = lab_setup(&lab, bytes, stride);
+    if (!out->bytes) {
+        lab_free(&lab);
+        return ERR;
+    }
+    size_t touches = lab_touches(&lab);
+    size_t passes = (CACHELAB_MIN_TOUCHES + touches - 1) / touches;
+
+    PerfCounter ctr[CL_EVENTS];
+    bool counting = cachelab_counters(NULL);
+    for (int ev = 0; ev < CL_EVENTS; ++ev) {
+        if (!counting || !counter_open(&ctr[ev], (ClEvent)ev)) ctr[ev].fd = -1;
+    }
+
+    sink = lab_pass(&lab);          /* warm up: page faults, cache fill */
+    for (int ev = 0; ev < CL_EVENTS; ++ev) perf_counter_start(&ctr[ev]);
+    uint64_t t0 = now_ns();
+    for (size_t p = 0; p < passes; ++p) sink = lab_pass(&lab);
+    uint64_t dt = now_ns() - t0;
+    uint64_t counts[CL_EVENTS];
+    for (int ev = 0; ev < CL_EVENTS; ++ev) {
+        out->have[ev] = perf_counter_stop(&ctr[ev], &counts[ev]);
+        perf_counter_close(&ctr[ev]);
+    }
+
+    out->elements = passes * touches;
+    out->ns_per_element = (double)dt / (double)out->elements;
+    for (int ev = 0; ev < CL_EVENTS; ++ev) {
+        if (out->have[ev]) out->per_element[ev] = (double)counts[ev] / (double)out->elements;
+    }
+    lab_free(&lab);
+    return OK;
+}
+
+/* ===== output ===== */
+void cachelab_format_size(char *buf, size_t cap, size_t bytes) {
+    if (bytes >= ((size_t)1 << 20) && bytes % ((size_t)1 << 20) == 0) {
+        snprintf(buf, cap, "%zu MiB", bytes >> 20);
+    } else {
+        snprintf(buf, cap, "%zu KiB", bytes >> 10);
+    }
+}
+
+void cachelab_print_counters_note(void) {
+    const char *why;
+    if (cachelab_counters(&why)) {
+        ui_puts(C_DIM "Counters are per element, user space only." C_RESET);
+    } else {
+        ui_printf(C_DIM "Hardware counters unavailable: %s; timing only." C_RESET "\n", why);
+    }
+}
+
+void cachelab_print_header(const char *label) {
+    ui_printf("  %-16s %9s", label, "ns/elem");
+    if (cachelab_counters(NULL)) {
+        for (int ev = 0; ev < CL_EVENTS; ++ev) ui_printf(" %10s", EVENT_NAMES[ev]);
+    }
+    ui_puts("");
+}
+
+void cachelab_print_row(const char *label, const ClResult *r) {
+    ui_printf("  %-16s %9.2f", label, r->ns_per_element);
+    if (cachelab_counters(NULL)) {
+        for (int ev = 0; ev < CL_EVENTS; ++ev) {
+            if (r->have[ev]) ui_printf(" %10.3f", r->per_element[ev]);
+            else ui_printf(" %10s", "-");
+        }
+    }
+    ui_puts("");
+    ui_flush();
+}
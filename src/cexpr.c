@@ -0,0 +1,1740 @@
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+
+#include "common.h"
+#include "cexpr.h"
+#include "tracker.h"
+
+/* ===== target ABI: x86-64 System V (LP64, plain char signed) ===== */
+typedef enum {
+    K_VOID, K_BOOL, K_CHAR, K_SCHAR, K_UCHAR, K_SHORT, K_USHORT,
+    K_INT, K_UINT, K_LONG, K_ULONG, K_LLONG, K_ULLONG,
+    K_FLOAT, K_DOUBLE, K_LDOUBLE,
+    K_PTR, K_ARRAY
+} Kind;
+
+#define K_BASIC K_PTR           /* types[0..K_BASIC) are the scalar kinds */
+
+static const struct {
+    const char *name;
+    uint8_t size, align, rank;
+    bool is_signed;
+} ABI[] = {
+    [K_VOID]    = { "void",               1,  1, 0, false },
+    [K_BOOL]    = { "_Bool",              1,  1, 1, false },
+    [K_CHAR]    = { "char",               1,  1, 2, true  },
+    [K_SCHAR]   = { "signed char",        1,  1, 2, true  },
+    [K_UCHAR]   = { "unsigned char",      1,  1, 2, false },
+    [K_SHORT]   = { "short",              2,  2, 3, true  },
+    [K_USHORT]  = { "unsigned short",     2,  2, 3, false },
+    [K_INT]     = { "int",                4,  4, 4, true  },
+    [K_UINT]    = { "unsigned int",       4,  4, 4, false },
+    [K_LONG]    = { "long",               8,  8, 5, true  },
+    [K_ULONG]   = { "unsigned long",      8,  8, 5, false },
+    [K_LLONG]   = { "long long",          8,  8, 6, true  },
+    [K_ULLONG]  = { "unsigned long long", 8,  8, 6, false },
+    [K_FLOAT]   = { "float",              4,  4, 0, true  },
+    [K_DOUBLE]  = { "double",             8,  8, 0, true  },
+    [K_LDOUBLE] = { "long double",        16, 16, 0, true },
+    [K_PTR]     = { "",                   8,  8, 0, false },
+};
+
+/* <stddef.h>/<stdint.h>/<stdbool.h> names a learner may use */
+static const struct { const char *name; Kind kind; } TYPEDEFS[] = {
+    { "size_t", K_ULONG }, { "ptrdiff_t", K_LONG }, { "intptr_t", K_LONG },
+    { "uintptr_t", K_ULONG }, { "bool", K_BOOL },
+    { "int8_t", K_SCHAR }, { "uint8_t", K_UCHAR }, { "int16_t", K_SHORT },
+    { "uint16_t", K_USHORT }, { "int32_t", K_INT }, { "uint32_t", K_UINT },
+    { "int64_t", K_LONG }, { "uint64_t", K_ULONG },
+};
+
+static bool is_int(Kind k)   { return k >= K_BOOL && k <= K_ULLONG; }
+static bool is_float(Kind k) { return k >= K_FLOAT && k <= K_LDOUBLE; }
+static bool is_arith(Kind k) { return is_int(k) || is_float(k); }
+static bool is_scalar(Kind k) { return is_arith(k) || k == K_PTR; }
+
+/* ===== types ===== */
+typedef struct {
+    uint8_t kind;
+    uint8_t align;
+    uint16_t base;              /* pointee / element type */
+    uint32_t count;             /* arrays; 0 = size still unknown */
+    uint32_t size;
+} CType;
+
+typedef struct {
+    CType t[CEXPR_TYPES];
+    int n;
+} TypeTab;
+
+/* A declared variable, or (empty name) a string literal. */
+typedef struct {
+    char name[CEXPR_NAME];
+    uint16_t type;
+    uint32_t addr, size;
+} Obj;
+
+/* Arena addresses start above 0 so a null pointer is never an object.
+ * Objects are GUARD bytes apart: a one-past-the-end pointer never lands on
+ * the next object, so reading through it is caught. */
+#define MEM_BASE    0x1000u
+#define GUARD       16u
+#define RODATA_CAP  512u        /* string literals in one expression */
+#define RODATA_BASE (MEM_BASE + CEXPR_MEM + GUARD)
+#define PROG_STRS   8
+
+struct CexprEnv {
+    TypeTab tt;
+    Obj objs[CEXPR_OBJS];
+    int nobjs;
+    uint32_t used;              /* variables grow up from 0 ... */
+    uint32_t top;               /* ... string literals down from CEXPR_MEM */
+    unsigned char mem[CEXPR_MEM];
+};
+
+/* ===== bytecode ===== */
+typedef enum {
+    OP_NOP,         /* patched-out conversion slot; dropped before running */
+    OP_PUSH,        /* consts[arg] */
+    OP_LOAD,        /* addr -> value of `kind` */
+    OP_CONV,        /* aux kind -> kind */
+    OP_NEG, OP_BNOT, OP_LNOT,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+    OP_SHL, OP_SHR,             /* aux: kind of the count */
+    OP_AND, OP_OR, OP_XOR,
+    OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE,
+    OP_PADD,        /* ptr, long -> ptr; arg = element size, aux 1 = subtract */
+    OP_PDIFF,       /* ptr, ptr -> long; arg = element size */
+    OP_SWAP,
+    OP_JMP, OP_JZ, OP_JNZ       /* JZ/JNZ pop a `kind` value */
+} Op;
+
+typedef struct {
+    uint8_t op, kind, aux, pad;
+    int32_t arg;
+} Insn;
+
+typedef struct {
+    TypeTab tt;                 /* the environment's types + this expression's */
+    Insn code[CEXPR_CODE];
+    int ncode;
+    CexprValue consts[CEXPR_CODE / 2];
+    int nconsts;
+    Obj strs[PROG_STRS];
+    int nstrs;
+    uint32_t rolen;
+    unsigned char rodata[RODATA_CAP];
+    int depth, max_depth;
+    uint32_t vars;
+} Prog;
+
+/* ===== lexer ===== */
+typedef enum { TK_END, TK_NUM, TK_CHAR, TK_STR, TK_IDENT, TK_PUNCT } TokKind;
+
+enum {
+    P_SHL = 256, P_SHR, P_LE, P_GE, P_EQ, P_NE, P_ANDAND, P_OROR,
+    P_INC, P_DEC, P_ARROW, P_ASSIGN_OP
+};
+
+typedef struct {
+    const char *src;
+    const char *p;
+    TokKind kind;
+    const char *start;
+    size_t len;
+    int punct;
+    Kind numkind;               /* TK_NUM / TK_CHAR */
+    CexprValue num;
+    uint32_t slen;              /* TK_STR, without the NUL */
+    char str[MAX_INPUT];
+} Lex;
+
+typedef struct {
+    Lex lx;
+    const CexprEnv *env;
+    CexprEnv *build;            /* set while declaring: literals go to the arena */
+    TypeTab *tt;
+    Prog *pg;
+    int nest;
+    bool failed;
+    int errcol;
+    char err[CEXPR_ERR];
+} Comp;
+
+typedef struct {
+    uint16_t type;
+    bool lval;                  /* its address is on the stack, not its value */
+} Ex;
+
+static void fail(Comp *c, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void fail(Comp *c, const char *fmt, ...) {
+    if (c->failed) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(c->err, sizeof(c->err), fmt, ap);
+    va_end(ap);
+    c->failed = true;
+    c->errcol = (int)((c->lx.start ? c->lx.start : c->lx.p) - c->lx.src) + 1;
+    c->lx.kind = TK_END;        /* every parse loop now winds down */
+}
+
+static int escape(Comp *c, const char **pp) {
+    const char *p = *pp;
+    int v;
+    switch (*p) {
+        case 'n': v = '\n'; p++; break;
+        case 't': v = '\t'; p++; break;
+        case 'r': v = '\r'; p++; break;
+        case 'a': v = '\a'; p++; break;
+        case 'b': v = '\b'; p++; break;
+        case 'f': v = '\f'; p++; break;
+        case 'v': v = '\v'; p++; break;
+        case '\\': case '\'': case '"': case '?': v = *p++; break;
+        case 'x':
+            p++;
+            if (!isxdigit((unsigned char)*p)) { fail(c, "\\x needs hex digits"); return 0; }
+            for (v = 0; isxdigit((unsigned char)*p); ++p) {
+                v = (v * 16 + (isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10)) & 0xff;
+            }
+            break;
+        default:
+            if (*p < '0' || *p > '7') { fail(c, "unknown escape '\\%c'", *p ? *p : ' '); return 0; }
+            v = 0;
+            for (int i = 0; i < 3 && *p >= '0' && *p <= '7'; ++i) v = v * 8 + (*p++ - '0');
+            v &= 0xff;
+    }
+    *pp = p;
+    return v;
+}
+
+static bool fits(Kind k, uint64_t v) {
+    unsigned bits = ABI[k].size * 8u - (ABI[k].is_signed ? 1u : 0u);
+    return bits >= 64 || v <= (1ull << bits) - 1;
+}
+
+/* C17 6.4.4.1: the first type in the suffix's list that holds the value */
+static void lex_int(Comp *c, const char *s, const char *end) {
+    Lex *l = &c->lx;
+    int base = 10;
+    const char *d = s;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) { base = 16; d += 2; }
+    else if (s[0] == '0') base = 8;
+
+    char *stop;
+    errno = 0;
+    uint64_t v = strtoull(d, &stop, base);
+    if (stop == d && base == 16) { fail(c, "bad hex literal"); return; }
+    if (errno == ERANGE) { fail(c, "integer literal too large"); return; }
+
+    int u = 0, lg = 0;
+    for (const char *p = stop; p < end; ++p) {
+        if ((*p == 'u' || *p == 'U') && !u) u = 1;
+        else if ((*p == 'l' || *p == 'L') && !lg) {
+            lg = 1;
+            if (p + 1 < end && p[1] == *p) { lg = 2; p++; }
+        } else { fail(c, "bad integer suffix '%.*s'", (int)(end - stop), stop); return; }
+    }
+
+    static const Kind DEC[3][3] = { { K_INT, K_LONG, K_LLONG }, { K_LONG, K_LLONG }, { K_LLONG } };
+    static const Kind OTHER[3][6] = {
+        { K_INT, K_UINT, K_LONG, K_ULONG, K_LLONG, K_ULLONG },
+        { K_LONG, K_ULONG, K_LLONG, K_ULLONG }, { K_LLONG, K_ULLONG } };
+    static const Kind UNS[3][3] = { { K_UINT, K_ULONG, K_ULLONG }, { K_ULONG, K_ULLONG }, { K_ULLONG } };
+    const Kind *list = u ? UNS[lg] : base == 10 ? DEC[lg] : OTHER[lg];
+    int n = u ? 3 - lg : base == 10 ? 3 - lg : 6 - 2 * lg;
+    for (int i = 0; i < n; ++i) {
+        if (fits(list[i], v)) {
+            l->numkind = list[i];
+            l->num.u = v;
+            return;
+        }
+    }
+    fail(c, "integer literal too large for any type");
+}
+
+static void lex_number(Comp *c, const char *s, const char *end) {
+    Lex *l = &c->lx;
+    bool hex = s[0] == '0' && (s[1] == 'x' || s[1] == 'X');
+    bool flt = false;
+    for (const char *p = s; p < end; ++p) {
+        if (*p == '.' || (!hex && (*p == 'e' || *p == 'E')) || (hex && (*p == 'p' || *p == 'P'))) flt = true;
+    }
+    if (!flt) {
+        lex_int(c, s, end);
+        return;
+    }
+    char *stop;
+    double v = strtod(s, &stop);
+    Kind k = K_DOUBLE;
+    if (stop < end && (*stop == 'f' || *stop == 'F')) { k = K_FLOAT; stop++; }
+    else if (stop < end && (*stop == 'l' || *stop == 'L')) { k = K_LDOUBLE; stop++; }
+    if (stop != end) { fail(c, "bad floating literal"); return; }
+    l->numkind = k;
+    l->num.f = k == K_FLOAT ? (double)(float)v : v;
+}
+
+static void lex_next(Comp *c) {
+    Lex *l = &c->lx;
+    if (c->failed) { l->kind = TK_END; return; }
+    const char *p = l->p;
+    while (isspace((unsigned char)*p)) p++;
+    l->start = p;
+
+    if (!*p) {
+        l->kind = TK_END;
+        l->len = 0;
+        l->p = p;
+        return;
+    }
+    if (isdigit((unsigned char)*p) || (*p == '.' && isdigit((unsigned char)p[1]))) {
+        bool hex = p[0] == '0' && (p[1] == 'x' || p[1] == 'X');
+        const char *e = p;
+        while (isalnum((unsigned char)*e) || *e == '.' || *e == '_' ||
+               ((*e == '+' || *e == '-') &&
+                (hex ? (e[-1] == 'p' || e[-1] == 'P') : (e[-1] == 'e' || e[-1] == 'E')))) {
+            e++;
+        }
+        l->kind = TK_NUM;
+        l->len = (size_t)(e - p);
+        l->p = e;
+        lex_number(c, p, e);
+        return;
+    }
+    if (isalpha((unsigned char)*p) || *p == '_') {
+        const char *e = p;
+        while (isalnum((unsigned char)*e) || *e == '_') e++;
+        l->kind = TK_IDENT;
+        l->len = (size_t)(e - p);
+        l->p = e;
+        return;
+    }
+    if (*p == '\'') {
+        const char *q = p + 1;
+        if (!*q) { fail(c, "unterminated character literal"); return; }
+        int v = *q == '\\' ? (q++, escape(c, &q)) : (unsigned char)*q++;
+        if (c->failed) return;
+        if (*q != '\'' || p[1] == '\'') { l->p = q; fail(c, "a character literal holds one character"); return; }
+        l->kind = TK_CHAR;
+        l->numkind = K_INT;
+        l->num.i = (int8_t)v;           /* plain char is signed */
+        l->p = q + 1;
+        l->len = (size_t)(l->p - p);
+        return;
+    }
+    if (*p == '"') {
+        const char *q = p + 1;
+        l->slen = 0;
+        while (*q && *q != '"' && *q != '\n') {
+            int ch = *q == '\\' ? (q++, escape(c, &q)) : (unsigned char)*q++;
+            if (c->failed) return;
+            if (l->slen + 1 >= sizeof(l->str)) { fail(c, "string literal too long"); return; }
+            l->str[l->slen++] = (char)ch;
+        }
+        if (*q != '"') { fail(c, "unterminated string literal"); return; }
+        l->str[l->slen] = '\0';
+        l->kind = TK_STR;
+        l->p = q + 1;
+        l->len = (size_t)(l->p - p);
+        return;
+    }
+
+    static const struct { char s[4]; int punct; } MULTI[] = {
+        { "<<=", P_ASSIGN_OP }, { ">>=", P_ASSIGN_OP },
+        { "<<", P_SHL }, { ">>", P_SHR }, { "<=", P_LE }, { ">=", P_GE },
+        { "==", P_EQ }, { "!=", P_NE }, { "&&", P_ANDAND }, { "||", P_OROR },
+        { "++", P_INC }, { "--", P_DEC }, { "->", P_ARROW },
+        { "+=", P_ASSIGN_OP }, { "-=", P_ASSIGN_OP }, { "*=", P_ASSIGN_OP },
+        { "/=", P_ASSIGN_OP }, { "%=", P_ASSIGN_OP }, { "&=", P_ASSIGN_OP },
+        { "|=", P_ASSIGN_OP }, { "^=", P_ASSIGN_OP },
+    };
+    l->kind = TK_PUNCT;
+    for (size_t i = 0; i < sizeof(MULTI) / sizeof(MULTI[0]); ++i) {
+        size_t n = strlen(MULTI[i].s);
+        if (strncmp(p, MULTI[i].s, n) == 0) {
+            l->punct = MULTI[i].punct;
+            l->len = n;
+            l->p = p + n;
+            return;
+        }
+    }
+    if (!strchr("+-*/%&|^~!<>=?:()[]{},;.", *p)) {
+        fail(c, "unexpected character '%c'", isprint((unsigned char)*p) ? *p : '?');
+        return;
+    }
+    l->punct = *p;
+    l->len = 1;
+    l->p = p + 1;
+}
+
+static bool at(const Comp *c, int punct) {
+    return c->lx.kind == TK_PUNCT && c->lx.punct == punct;
+}
+
+static bool accept(Comp *c, int punct) {
+    if (!at(c, punct)) return false;
+    lex_next(c);
+    return true;
+}
+
+static void expect(Comp *c, int punct, const char *what) {
+    if (!accept(c, punct)) {
+        if (c->lx.kind == TK_END) fail(c, "expected %s at the end", what);
+        else fail(c, "expected %s before '%.*s'", what, (int)c->lx.len, c->lx.start);
+    }
+}
+
+static bool is_word(const Comp *c, const char *w) {
+    return c->lx.kind == TK_IDENT && c->lx.len == strlen(w) && strncmp(c->lx.start, w, c->lx.len) == 0;
+}
+
+/* ===== type table ===== */
+static void types_init(TypeTab *tt) {
+    for (int k = 0; k < K_BASIC; ++k) {
+        tt->t[k] = (CType){ (uint8_t)k, ABI[k].align, 0, 0, ABI[k].size };
+    }
+    tt->n = K_BASIC;
+}
+
+static uint16_t intern(Comp *c, CType t) {
+    TypeTab *tt = c->tt;
+    for (int i = K_BASIC; i < tt->n; ++i) {
+        const CType *x = &tt->t[i];
+        if (x->kind == t.kind && x->base == t.base && x->count == t.count) return (uint16_t)i;
+    }
+    if (tt->n == CEXPR_TYPES) {
+        fail(c, "too many distinct types");
+        return K_INT;
+    }
+    tt->t[tt->n] = t;
+    return (uint16_t)tt->n++;
+}
+
+static uint16_t ptr_to(Comp *c, uint16_t base) {
+    return intern(c, (CType){ K_PTR, 8, base, 0, 8 });
+}
+
+static uint16_t array_of(Comp *c, uint16_t elem, uint32_t count) {
+    const CType *e = &c->tt->t[elem];
+    if (e->kind == K_VOID || (e->kind == K_ARRAY && e->count == 0)) {
+        fail(c, "array of incomplete type");
+        return K_INT;
+    }
+    if (count && (uint64_t)e->size * count > INT32_MAX) {
+        fail(c, "array too large");
+        return K_INT;
+    }
+    return intern(c, (CType){ K_ARRAY, e->align, elem, count, e->size * count });
+}
+
+static Kind kind_of(const Comp *c, uint16_t t) {
+    return (Kind)c->tt->t[t].kind;
+}
+
+/* "int", "char *", "int (*)[3]", "int *[3]" */
+static void type_name(const TypeTab *tt, uint16_t t, char *buf, size_t cap) {
+    char decl[64] = "";
+    while (tt->t[t].kind == K_PTR || tt->t[t].kind == K_ARRAY) {
+        char tmp[64];
+        const CType *x = &tt->t[t];
+        if (x->kind == K_PTR) {
+            snprintf(tmp, sizeof(tmp), "*%.60s", decl);
+        } else if (decl[0] == '*') {
+            snprintf(tmp, sizeof(tmp), "(%.40s)[%u]", decl, x->count);
+        } else {
+            snprintf(tmp, sizeof(tmp), "%.40s[%u]", decl, x->count);
+        }
+        memcpy(decl, tmp, sizeof(decl));
+        t = x->base;
+    }
+    snprintf(buf, cap, "%s%s%s", ABI[tt->t[t].kind].name, decl[0] ? " " : "", decl);
+}
+
+/* ===== code emission ===== */
+static const int8_t STACK_EFFECT[] = {
+    [OP_NOP] = 0, [OP_PUSH] = 1, [OP_LOAD] = 0, [OP_CONV] = 0,
+    [OP_NEG] = 0, [OP_BNOT] = 0, [OP_LNOT] = 0,
+    [OP_ADD] = -1, [OP_SUB] = -1, [OP_MUL] = -1, [OP_DIV] = -1, [OP_MOD] = -1,
+    [OP_SHL] = -1, [OP_SHR] = -1, [OP_AND] = -1, [OP_OR] = -1, [OP_XOR] = -1,
+    [OP_LT] = -1, [OP_LE] = -1, [OP_GT] = -1, [OP_GE] = -1, [OP_EQ] = -1, [OP_NE] = -1,
+    [OP_PADD] = -1, [OP_PDIFF] = -1, [OP_SWAP] = 0,
+    [OP_JMP] = 0, [OP_JZ] = -1, [OP_JNZ] = -1,
+};
+
+static int emit(Comp *c, Op op, Kind kind, int aux, int32_t arg) {
+    Prog *pg = c->pg;
+    if (c->failed) return 0;
+    if (pg->ncode == CEXPR_CODE) {
+        fail(c, "expression too long");
+        return 0;
+    }
+    pg->code[pg->ncode] = (Insn){ (uint8_t)op, (uint8_t)kind, (uint8_t)aux, 0, arg };
+    pg->depth += STACK_EFFECT[op];
+    if (pg->depth > pg->max_depth) pg->max_depth = pg->depth;
+    if (pg->max_depth > CEXPR_STACK) fail(c, "expression too deep");
+    return pg->ncode++;
+}
+
+static void push(Comp *c, Kind kind, CexprValue v) {
+    Prog *pg = c->pg;
+    if ((size_t)pg->nconsts == sizeof(pg->consts) / sizeof(pg->consts[0])) {
+        fail(c, "too many constants");
+        return;
+    }
+    pg->consts[pg->nconsts] = v;
+    emit(c, OP_PUSH, kind, 0, pg->nconsts++);
+}
+
+static void push_int(Comp *c, int64_t v) {
+    push(c, K_INT, (CexprValue){ .i = v });
+}
+
+/* Target of a jump emitted at `from`: the next instruction. */
+static void land(Comp *c, int from) {
+    if (!c->failed) c->pg->code[from].arg = c->pg->ncode;
+}
+
+static void convert(Comp *c, Kind from, Kind to) {
+    if (from != to) emit(c, OP_CONV, to, from, 0);
+}
+
+/* Fill a conversion slot reserved (as OP_NOP) before the next operand. */
+static void convert_at(Comp *c, int slot, Kind from, Kind to) {
+    if (!c->failed && from != to) c->pg->code[slot] = (Insn){ OP_CONV, (uint8_t)to, (uint8_t)from, 0, 0 };
+}
+
+/* ===== expressions ===== */
+static Ex expr_cond(Comp *c);
+static Ex expr_cast(Comp *c);
+static Ex expr_unary(Comp *c);
+
+static Ex rvalue(Comp *c, Ex e) {
+    if (!e.lval) return e;
+    const CType *t = &c->tt->t[e.type];
+    if (t->kind == K_ARRAY) return (Ex){ ptr_to(c, t->base), false };     /* decay */
+    if (t->kind == K_VOID) {
+        fail(c, "void value not ignored");
+        return (Ex){ K_INT, false };
+    }
+    emit(c, OP_LOAD, (Kind)t->kind, 0, 0);
+    return (Ex){ e.type, false };
+}
+
+static Kind promote(Kind k) {
+    return is_int(k) && ABI[k].rank < ABI[K_INT].rank ? K_INT : k;
+}
+
+/* C17 6.3.1.8 */
+static Kind usual(Kind a, Kind b) {
+    a = promote(a);
+    b = promote(b);
+    if (a == K_LDOUBLE || b == K_LDOUBLE) return K_LDOUBLE;
+    if (a == K_DOUBLE || b == K_DOUBLE) return K_DOUBLE;
+    if (a == K_FLOAT || b == K_FLOAT) return K_FLOAT;
+    if (a == b) return a;
+    if (ABI[a].is_signed == ABI[b].is_signed) return ABI[a].rank > ABI[b].rank ? a : b;
+    Kind u = ABI[a].is_signed ? b : a;
+    Kind s = ABI[a].is_signed ? a : b;
+    if (ABI[u].rank >= ABI[s].rank) return u;
+    if (ABI[s].size > ABI[u].size) return s;
+    return (Kind)(s + 1);           /* the unsigned partner */
+}
+
+static bool is_type_start(const Comp *c) {
+    static const char *const KW[] = {
+        "void", "char", "short", "int", "long", "float", "double", "signed",
+        "unsigned", "_Bool", "const", "volatile"
+    };
+    if (c->lx.kind != TK_IDENT) return false;
+    for (size_t i = 0; i < sizeof(KW) / sizeof(KW[0]); ++i) if (is_word(c, KW[i])) return true;
+    for (size_t i = 0; i < sizeof(TYPEDEFS) / sizeof(TYPEDEFS[0]); ++i) {
+        if (is_word(c, TYPEDEFS[i].name)) return true;
+    }
+    return false;
+}
+
+static uint16_t specifiers(Comp *c) {
+    int nlong = 0, nshort = 0, nint = 0, nchar = 0, nsigned = 0, nunsigned = 0;
+    int nfloat = 0, ndouble = 0, nvoid = 0, nbool = 0, ntypedef = 0;
+    Kind td = K_INT;
+    while (is_type_start(c)) {
+        if (is_word(c, "long")) nlong++;
+        else if (is_word(c, "short")) nshort++;
+        else if (is_word(c, "int")) nint++;
+        else if (is_word(c, "char")) nchar++;
+        else if (is_word(c, "signed")) nsigned++;
+        else if (is_word(c, "unsigned")) nunsigned++;
+        else if (is_word(c, "float")) nfloat++;
+        else if (is_word(c, "double")) ndouble++;
+        else if (is_word(c, "void")) nvoid++;
+        else if (is_word(c, "_Bool")) nbool++;
+        else if (!is_word(c, "const") && !is_word(c, "volatile")) {
+            for (size_t i = 0; i < sizeof(TYPEDEFS) / sizeof(TYPEDEFS[0]); ++i) {
+                if (is_word(c, TYPEDEFS[i].name)) td = TYPEDEFS[i].kind;
+            }
+            ntypedef++;
+        }
+        lex_next(c);
+    }
+    int others = nshort + nint + nchar + nsigned + nunsigned + nfloat + ndouble + nvoid + nbool;
+    if (ntypedef) {
+        if (ntypedef > 1 || others || nlong) fail(c, "invalid type");
+        return td;
+    }
+    if (nsigned + nunsigned > 1 || nlong > 2 || nshort > 1 || nint > 1 ||
+        nfloat + ndouble + nvoid + nbool + nchar > 1 || (nshort && nlong)) {
+        fail(c, "invalid combination of type specifiers");
+        return K_INT;
+    }
+    if (nvoid || nbool || nfloat) {
+        if (others + nlong > 1) fail(c, "invalid type");
+        return nvoid ? K_VOID : nbool ? K_BOOL : K_FLOAT;
+    }
+    if (ndouble) {
+        if (nsigned || nunsigned || nshort || nint || nlong > 1) fail(c, "invalid type");
+        return nlong ? K_LDOUBLE : K_DOUBLE;
+    }
+    if (nchar) {
+        if (nlong || nshort || nint) fail(c, "invalid type");
+        return nunsigned ? K_UCHAR : nsigned ? K_SCHAR : K_CHAR;
+    }
+    if (!others && !nlong) fail(c, "expected a type");
+    if (nshort) return nunsigned ? K_USHORT : K_SHORT;
+    if (nlong == 1) return nunsigned ? K_ULONG : K_LONG;
+    if (nlong == 2) return nunsigned ? K_ULLONG : K_LLONG;
+    return nunsigned ? K_UINT : K_INT;
+}
+
+/* [N][M]... applied right to left; [] (declarations only) leaves count 0. */
+static uint16_t array_suffixes(Comp *c, uint16_t t, bool allow_open) {
+    uint32_t dims[8];
+    int n = 0;
+    while (accept(c, '[')) {
+        uint32_t d = 0;
+        if (c->lx.kind == TK_NUM && is_int(c->lx.numkind)) {
+            if (c->lx.num.u == 0 || c->lx.num.u > INT32_MAX) fail(c, "bad array size");
+            d = (uint32_t)c->lx.num.u;
+            lex_next(c);
+        } else if (!allow_open || n > 0 || !at(c, ']')) {
+            fail(c, "array size must be an integer literal");
+        }
+        expect(c, ']', "']'");
+        if (n == 8) fail(c, "too many array dimensions");
+        else dims[n++] = d;
+    }
+    while (n-- > 0 && !c->failed) t = array_of(c, t, dims[n]);
+    return t;
+}
+
+/* Declarator or abstract declarator around `t`: "*p", "(*p)[3]", "*[2]". */
+static uint16_t declarator(Comp *c, uint16_t t, char *name, bool allow_open) {
+    while (accept(c, '*')) {
+        t = ptr_to(c, t);
+        while (is_word(c, "const") || is_word(c, "volatile")) lex_next(c);
+    }
+    if (at(c, '(')) {
+        lex_next(c);
+        Lex inner = c->lx;
+        for (int depth = 1; depth > 0 && c->lx.kind != TK_END; ) {
+            if (at(c, '(')) depth++;
+            if (at(c, ')')) depth--;
+            lex_next(c);
+        }
+        t = array_suffixes(c, t, false);
+        Lex after = c->lx;
+        c->lx = inner;
+        t = declarator(c, t, name, false);
+        expect(c, ')', "')'");
+        if (!c->failed) c->lx = after;
+        return t;
+    }
+    if (name) {
+        if (c->lx.kind != TK_IDENT) {
+            fail(c, "expected a variable name");
+            return t;
+        }
+        if (c->lx.len >= CEXPR_NAME) fail(c, "name too long");
+        else snprintf(name, CEXPR_NAME, "%.*s", (int)c->lx.len, c->lx.start);
+        lex_next(c);
+    }
+    return array_suffixes(c, t, allow_open);
+}
+
+static uint16_t type_operand(Comp *c) {
+    uint16_t t = specifiers(c);
+    return declarator(c, t, NULL, false);
+}
+
+static const Obj *find_obj(const CexprEnv *env, const char *name, size_t len) {
+    for (int i = 0; i < env->nobjs; ++i) {
+        const Obj *o = &env->objs[i];
+        if (o->name[0] && strlen(o->name) == len && strncmp(o->name, name, len) == 0) return o;
+    }
+    return NULL;
+}
+
+static Ex string_literal(Comp *c) {
+    Lex *l = &c->lx;
+    uint32_t size = l->slen + 1;
+    uint16_t t = array_of(c, K_CHAR, size);
+    uint32_t addr;
+    if (c->build) {
+        CexprEnv *env = c->build;
+        if (env->top < env->used + GUARD + size || env->nobjs == CEXPR_OBJS) {
+            fail(c, "out of room for string literals");
+            return (Ex){ K_INT, false };
+        }
+        env->top -= size;
+        memcpy(env->mem + env->top, l->str, size);
+        addr = MEM_BASE + env->top;
+        env->objs[env->nobjs++] = (Obj){ "", t, addr, size };
+        env->top = env->top > GUARD ? env->top - GUARD : 0;
+    } else {
+        Prog *pg = c->pg;
+        if (pg->rolen + size + GUARD > RODATA_CAP || pg->nstrs == PROG_STRS) {
+            fail(c, "too many string literals");
+            return (Ex){ K_INT, false };
+        }
+        memcpy(pg->rodata + pg->rolen, l->str, size);
+        addr = RODATA_BASE + pg->rolen;
+        pg->strs[pg->nstrs++] = (Obj){ "", t, addr, size };
+        pg->rolen += size + GUARD;
+    }
+    lex_next(c);
+    push(c, K_PTR, (CexprValue){ .u = addr });
+    return (Ex){ t, true };
+}
+
+static Ex expr_primary(Comp *c) {
+    Lex *l = &c->lx;
+    if (l->kind == TK_NUM || l->kind == TK_CHAR) {
+        Kind k = l->numkind;
+        push(c, k, l->num);
+        lex_next(c);
+        return (Ex){ (uint16_t)k, false };
+    }
+    if (l->kind == TK_STR) {
+        return string_literal(c);
+    }
+    if (l->kind == TK_IDENT) {
+        if (is_type_start(c)) {
+            fail(c, "expected an expression before '%.*s'", (int)l->len, l->start);
+            return (Ex){ K_INT, false };
+        }
+        const CexprEnv *env = c->build ? c->build : c->env;
+        const Obj *o = find_obj(env, l->start, l->len);
+        if (!o) {
+            fail(c, "'%.*s' is not declared in this task", (int)l->len, l->start);
+            return (Ex){ K_INT, false };
+        }
+        c->pg->vars |= 1u << (o - env->objs);
+        push(c, K_PTR, (CexprValue){ .u = o->addr });
+        lex_next(c);
+        return (Ex){ o->type, true };
+    }
+    if (accept(c, '(')) {
+        Ex e = expr_cond(c);
+        expect(c, ')', "')'");
+        return e;
+    }
+    if (l->kind == TK_END) fail(c, "expected an expression");
+    else fail(c, "expected an expression before '%.*s'", (int)l->len, l->start);
+    return (Ex){ K_INT, false };
+}
+
+static Ex binary(Comp *c, int op, Ex l, int slot, Ex r);
+
+static Ex expr_postfix(Comp *c) {
+    Ex e = expr_primary(c);
+    for (;;) {
+        if (at(c, '[')) {
+            lex_next(c);
+            Ex base = rvalue(c, e);
+            int slot = emit(c, OP_NOP, K_VOID, 0, 0);
+            Ex idx = rvalue(c, expr_cond(c));
+            expect(c, ']', "']'");
+            Ex sum = binary(c, '+', base, slot, idx);
+            if (kind_of(c, sum.type) != K_PTR) {
+                fail(c, "subscripted value is neither array nor pointer");
+                return (Ex){ K_INT, false };
+            }
+            e = (Ex){ c->tt->t[sum.type].base, true };
+        } else if (at(c, '(')) {
+            fail(c, "function calls are not supported here");
+        } else if (at(c, '.') || at(c, P_ARROW)) {
+            fail(c, "there are no structs in this task");
+        } else if (at(c, P_INC) || at(c, P_DEC)) {
+            fail(c, "++ and -- modify variables; write an expression without side effects");
+        } else {
+            return e;
+        }
+    }
+}
+
+static Ex expr_unary(Comp *c) {
+    if (++c->nest > CEXPR_NEST) {
+        fail(c, "expression nested too deeply");
+    }
+    Ex e;
+    if (c->lx.kind == TK_PUNCT && c->lx.punct < 256 && strchr("+-~!", c->lx.punct)) {
+        int op = c->lx.punct;
+        lex_next(c);
+        e = rvalue(c, expr_cast(c));
+        Kind k = kind_of(c, e.type);
+        if (op == '!') {
+            if (!is_scalar(k)) fail(c, "'!' needs a scalar operand");
+            emit(c, OP_LNOT, k, 0, 0);
+            e = (Ex){ K_INT, false };
+        } else if (op == '~' ? !is_int(k) : !is_arith(k)) {
+            fail(c, "invalid operand to unary '%c'", op);
+        } else {
+            Kind p = promote(k);
+            convert(c, k, p);
+            if (op == '-') emit(c, OP_NEG, p, 0, 0);
+            if (op == '~') emit(c, OP_BNOT, p, 0, 0);
+            e = (Ex){ (uint16_t)p, false };
+        }
+    } else if (accept(c, '*')) {
+        e = rvalue(c, expr_cast(c));
+        const CType *t = &c->tt->t[e.type];
+        if (t->kind != K_PTR) fail(c, "'*' needs a pointer operand");
+        else if (kind_of(c, t->base) == K_VOID) fail(c, "dereferencing a void pointer");
+        else e = (Ex){ t->base, true };
+    } else if (accept(c, '&')) {
+        e = expr_cast(c);
+        if (!e.lval) fail(c, "'&' needs a variable or element, not a value");
+        e = (Ex){ ptr_to(c, e.type), false };
+    } else if (is_word(c, "sizeof")) {
+        lex_next(c);
+        Prog *pg = c->pg;
+        int ncode = pg->ncode, depth = pg->depth;
+        uint16_t t;
+        Lex save = c->lx;
+        if (accept(c, '(') && is_type_start(c)) {
+            t = type_operand(c);
+            expect(c, ')', "')'");
+        } else {
+            c->lx = save;
+            t = expr_unary(c).type;     /* not evaluated: arrays keep their type */
+        }
+        pg->ncode = ncode;
+        pg->depth = depth;
+        const CType *x = &c->tt->t[t];
+        if (x->kind == K_VOID || (x->kind == K_ARRAY && x->count == 0)) fail(c, "sizeof of an incomplete type");
+        push(c, K_ULONG, (CexprValue){ .u = x->size });
+        e = (Ex){ K_ULONG, false };
+    } else if (at(c, P_INC) || at(c, P_DEC)) {
+        fail(c, "++ and -- modify variables; write an expression without side effects");
+        e = (Ex){ K_INT, false };
+    } else {
+        e = expr_postfix(c);
+    }
+    c->nest--;
+    return e;
+}
+
+static Ex expr_cast(Comp *c) {
+    if (at(c, '(')) {
+        Lex save = c->lx;
+        lex_next(c);
+        if (is_type_start(c)) {
+            if (++c->nest > CEXPR_NEST) fail(c, "expression nested too deeply");
+            uint16_t t = type_operand(c);
+            expect(c, ')', "')'");
+            Ex e = rvalue(c, expr_cast(c));
+            Kind from = kind_of(c, e.type), to = kind_of(c, t);
+            if (to == K_VOID || to == K_ARRAY || (to == K_PTR && is_float(from)) ||
+                (is_float(to) && from == K_PTR) || !is_scalar(from)) {
+                char a[48], b[48];
+                type_name(c->tt, e.type, a, sizeof(a));
+                type_name(c->tt, t, b, sizeof(b));
+                fail(c, "cannot cast %s to %s", a, b);
+            }
+            convert(c, from, to);
+            c->nest--;
+            return (Ex){ t, false };
+        }
+        c->lx = save;
+    }
+    return expr_unary(c);
+}
+
+static bool same_pointee(const Comp *c, uint16_t a, uint16_t b) {
+    uint16_t pa = c->tt->t[a].base, pb = c->tt->t[b].base;
+    return pa == pb || kind_of(c, pa) == K_VOID || kind_of(c, pb) == K_VOID;
+}
+
+static uint32_t elem_size(Comp *c, uint16_t ptr) {
+    const CType *t = &c->tt->t[c->tt->t[ptr].base];
+    if (t->kind == K_VOID || (t->kind == K_ARRAY && t->count == 0)) {
+        fail(c, "arithmetic on a pointer to an incomplete type");
+        return 1;
+    }
+    return t->size;
+}
+
+/* l was emitted, then the conversion slot, then r. */
+static Ex binary(Comp *c, int op, Ex l, int slot, Ex r) {
+    Kind lk = kind_of(c, l.type), rk = kind_of(c, r.type);
+    bool cmp = op == '<' || op == '>' || op == P_LE || op == P_GE || op == P_EQ || op == P_NE;
+
+    if ((op == '+' || op == '-') && lk == K_PTR && is_int(rk)) {
+        convert(c, rk, K_LONG);
+        emit(c, OP_PADD, K_PTR, op == '-', (int32_t)elem_size(c, l.type));
+        return l;
+    }
+    if (op == '+' && is_int(lk) && rk == K_PTR) {
+        convert_at(c, slot, lk, K_LONG);
+        emit(c, OP_SWAP, K_VOID, 0, 0);
+        emit(c, OP_PADD, K_PTR, 0, (int32_t)elem_size(c, r.type));
+        return r;
+    }
+    if (op == '-' && lk == K_PTR && rk == K_PTR) {
+        if (c->tt->t[l.type].base != c->tt->t[r.type].base) fail(c, "subtracting pointers to different types");
+        emit(c, OP_PDIFF, K_LONG, 0, (int32_t)elem_size(c, l.type));
+        return (Ex){ K_LONG, false };
+    }
+    if (cmp && (lk == K_PTR || rk == K_PTR)) {
+        bool eq = op == P_EQ || op == P_NE;
+        if (lk == K_PTR && rk == K_PTR) {
+            if (!same_pointee(c, l.type, r.type)) fail(c, "comparing pointers to different types");
+        } else if (eq && (is_int(lk) || is_int(rk))) {
+            if (lk != K_PTR) convert_at(c, slot, lk, K_PTR);
+            else convert(c, rk, K_PTR);
+        } else {
+            fail(c, "comparison between pointer and %s", eq ? "non-integer" : "integer");
+        }
+        emit(c, (Op)(op == '<' ? OP_LT : op == '>' ? OP_GT : op == P_LE ? OP_LE :
+                     op == P_GE ? OP_GE : op == P_EQ ? OP_EQ : OP_NE), K_PTR, 0, 0);
+        return (Ex){ K_INT, false };
+    }
+
+    bool ints_only = op == '%' || op == '&' || op == '|' || op == '^' || op == P_SHL || op == P_SHR;
+    if (ints_only ? !(is_int(lk) && is_int(rk)) : !(is_arith(lk) && is_arith(rk))) {
+        char a[48], b[48];
+        type_name(c->tt, l.type, a, sizeof(a));
+        type_name(c->tt, r.type, b, sizeof(b));
+        fail(c, "invalid operands (%s and %s)", a, b);
+        return (Ex){ K_INT, false };
+    }
+    if (op == P_SHL || op == P_SHR) {
+        Kind pl = promote(lk), pr = promote(rk);
+        convert_at(c, slot, lk, pl);
+        convert(c, rk, pr);
+        emit(c, op == P_SHL ? OP_SHL : OP_SHR, pl, pr, 0);
+        return (Ex){ (uint16_t)pl, false };
+    }
+
+    Kind k = usual(lk, rk);
+    convert_at(c, slot, lk, k);
+    convert(c, rk, k);
+    Op o;
+    switch (op) {
+        case '+': o = OP_ADD; break;
+        case '-': o = OP_SUB; break;
+        case '*': o = OP_MUL; break;
+        case '/': o = OP_DIV; break;
+        case '%': o = OP_MOD; break;
+        case '&': o = OP_AND; break;
+        case '|': o = OP_OR; break;
+        case '^': o = OP_XOR; break;
+        case '<': o = OP_LT; break;
+        case '>': o = OP_GT; break;
+        case P_LE: o = OP_LE; break;
+        case P_GE: o = OP_GE; break;
+        case P_EQ: o = OP_EQ; break;
+        default: o = OP_NE; break;
+    }
+    emit(c, o, k, 0, 0);
+    return (Ex){ cmp ? (uint16_t)K_INT : (uint16_t)k, false };
+}
+
+static int precedence(const Comp *c) {
+    if (c->lx.kind != TK_PUNCT) return 0;
+    switch (c->lx.punct) {
+        case P_OROR: return 1;
+        case P_ANDAND: return 2;
+        case '|': return 3;
+        case '^': return 4;
+        case '&': return 5;
+        case P_EQ: case P_NE: return 6;
+        case '<': case '>': case P_LE: case P_GE: return 7;
+        case P_SHL: case P_SHR: return 8;
+        case '+': case '-': return 9;
+        case '*': case '/': case '%': return 10;
+        default: return 0;
+    }
+}
+
+static Ex expr_binary(Comp *c, int min) {
+    Ex l = expr_cast(c);
+    for (int prec; (prec = precedence(c)) >= min && prec > 0; ) {
+        int op = c->lx.punct;
+        lex_next(c);
+        l = rvalue(c, l);
+        if (op == P_ANDAND || op == P_OROR) {
+            /* a && b: [a] JZ F [b] JZ F 1 JMP E F: 0 E:   (|| mirrors it) */
+            Op skip = op == P_ANDAND ? OP_JZ : OP_JNZ;
+            if (!is_scalar(kind_of(c, l.type))) fail(c, "logical operator needs scalar operands");
+            int j1 = emit(c, skip, kind_of(c, l.type), 0, 0);
+            Ex r = rvalue(c, expr_binary(c, prec + 1));
+            if (!is_scalar(kind_of(c, r.type))) fail(c, "logical operator needs scalar operands");
+            int j2 = emit(c, skip, kind_of(c, r.type), 0, 0);
+            push_int(c, op == P_ANDAND);
+            int j3 = emit(c, OP_JMP, K_VOID, 0, 0);
+            c->pg->depth--;
+            land(c, j1);
+            land(c, j2);
+            push_int(c, op != P_ANDAND);
+            land(c, j3);
+            l = (Ex){ K_INT, false };
+            continue;
+        }
+        int slot = emit(c, OP_NOP, K_VOID, 0, 0);
+        Ex r = rvalue(c, expr_binary(c, prec + 1));
+        l = binary(c, op, l, slot, r);
+    }
+    return l;
+}
+
+static Ex expr_cond(Comp *c) {
+    Ex e = expr_binary(c, 1);
+    if (!accept(c, '?')) return e;
+    e = rvalue(c, e);
+    if (!is_scalar(kind_of(c, e.type))) fail(c, "'?:' needs a scalar condition");
+    int jz = emit(c, OP_JZ, kind_of(c, e.type), 0, 0);
+    Ex a = rvalue(c, expr_cond(c));
+    int slot = emit(c, OP_NOP, K_VOID, 0, 0);
+    int jmp = emit(c, OP_JMP, K_VOID, 0, 0);
+    c->pg->depth--;
+    expect(c, ':', "':'");
+    land(c, jz);
+    Ex b = rvalue(c, expr_cond(c));
+
+    Kind ka = kind_of(c, a.type), kb = kind_of(c, b.type);
+    Ex r = a;
+    if (is_arith(ka) && is_arith(kb)) {
+        Kind k = usual(ka, kb);
+        convert_at(c, slot, ka, k);
+        convert(c, kb, k);
+        r = (Ex){ (uint16_t)k, false };
+    } else if (ka == K_PTR && kb == K_PTR && same_pointee(c, a.type, b.type)) {
+        r = a;
+    } else if (ka == K_PTR && is_int(kb)) {
+        convert(c, kb, K_PTR);
+    } else if (is_int(ka) && kb == K_PTR) {
+        convert_at(c, slot, ka, K_PTR);
+        r = b;
+    } else {
+        fail(c, "the branches of '?:' have incompatible types");
+    }
+    land(c, jmp);
+    return r;
+}
+
+/* Drops the unused conversion slots and retargets jumps. */
+static void compact(Prog *pg) {
+    int map[CEXPR_CODE + 1];
+    int n = 0;
+    for (int i = 0; i < pg->ncode; ++i) {
+        map[i] = n;
+        if (pg->code[i].op != OP_NOP) n++;
+    }
+    map[pg->ncode] = n;
+    n = 0;
+    for (int i = 0; i < pg->ncode; ++i) {
+        Insn in = pg->code[i];
+        if (in.op == OP_NOP) continue;
+        if (in.op == OP_JMP || in.op == OP_JZ || in.op == OP_JNZ) in.arg = map[in.arg];
+        pg->code[n++] = in;
+    }
+    pg->ncode = n;
+}
+
+/* ===== VM ===== */
+typedef struct {
+    const CexprEnv *env;
+    const Prog *pg;
+    const char *error;
+} Vm;
+
+/* The object holding [addr, addr + n); n == 0 also accepts one past the end. */
+static const Obj *obj_at(const Vm *vm, uint64_t addr, uint32_t n) {
+    const Obj *lists[2] = { vm->env->objs, vm->pg->strs };
+    int counts[2] = { vm->env->nobjs, vm->pg->nstrs };
+    for (int l = 0; l < 2; ++l) {
+        for (int i = 0; i < counts[l]; ++i) {
+            const Obj *o = &lists[l][i];
+            if (addr >= o->addr && addr + n <= (uint64_t)o->addr + o->size) return o;
+        }
+    }
+    return NULL;
+}
+
+static const unsigned char *bytes_at(const Vm *vm, uint64_t addr) {
+    return addr >= RODATA_BASE ? vm->pg->rodata + (addr - RODATA_BASE)
+                               : vm->env->mem + (addr - MEM_BASE);
+}
+
+/* Sign- or zero-extends the low bytes of an integer of kind k. */
+static CexprValue narrow(Kind k, CexprValue v) {
+    switch (k) {
+        case K_BOOL:   v.u = v.u != 0; break;
+        case K_CHAR:
+        case K_SCHAR:  v.i = (int8_t)v.u; break;
+        case K_UCHAR:  v.u = (uint8_t)v.u; break;
+        case K_SHORT:  v.i = (int16_t)v.u; break;
+        case K_USHORT: v.u = (uint16_t)v.u; break;
+        case K_INT:    v.i = (int32_t)v.u; break;
+        case K_UINT:   v.u = (uint32_t)v.u; break;
+        case K_FLOAT:  v.f = (float)v.f; break;
+        default: break;
+    }
+    return v;
+}
+
+static CexprValue load(Kind k, const unsigned char *p) {
+    CexprValue v = { .u = 0 };
+    if (k == K_FLOAT) {
+        float f;
+        memcpy(&f, p, sizeof(f));
+        v.f = f;
+    } else if (is_float(k)) {
+        memcpy(&v.f, p, sizeof(v.f));       /* long double is stored as double */
+    } else {
+        memcpy(&v.u, p, ABI[k].size);       /* little-endian */
+        v = narrow(k, v);
+    }
+    return v;
+}
+
+static void store(Kind k, unsigned char *p, CexprValue v) {
+    if (k == K_FLOAT) {
+        float f = (float)v.f;
+        memcpy(p, &f, sizeof(f));
+    } else if (is_float(k)) {
+        memcpy(p, &v.f, sizeof(v.f));
+    } else {
+        memcpy(p, &v.u, ABI[k].size);
+    }
+}
+
+static bool conv(Vm *vm, Kind from, Kind to, CexprValue *v) {
+    if (is_float(from)) {
+        if (is_float(to)) { *v = narrow(to, *v); return true; }
+        if (to == K_BOOL) { v->u = v->f != 0; return true; }
+        double f = trunc(v->f);
+        bool s = ABI[to].is_signed;
+        double lo = s ? -ldexp(1, ABI[to].size * 8 - 1) : 0;
+        double hi = ldexp(1, ABI[to].size * 8 - (s ? 1 : 0));
+        if (!(f >= lo && f < hi)) {
+            vm->error = "floating value out of range for the integer type";
+            return false;
+        }
+        if (s) v->i = (int64_t)f;
+        else v->u = (uint64_t)f;
+        *v = narrow(to, *v);
+        return true;
+    }
+    if (is_float(to)) {
+        v->f = ABI[from].is_signed ? (double)v->i : (double)v->u;
+        *v = narrow(to, *v);
+        return true;
+    }
+    *v = narrow(to, *v);        /* integer <-> integer / pointer */
+    return true;
+}
+
+static bool overflows(Kind k, int64_t v) {
+    return ABI[k].size == 4 && (v < INT32_MIN || v > INT32_MAX);
+}
+
+static bool arith(Vm *vm, Op op, Kind k, CexprValue a, CexprValue b, CexprValue *out) {
+    if (is_float(k)) {
+        switch (op) {
+            case OP_ADD: a.f += b.f; break;
+            case OP_SUB: a.f -= b.f; break;
+            case OP_MUL: a.f *= b.f; break;
+            case OP_DIV: a.f /= b.f; break;     /* IEEE: x/0 is inf or nan */
+            default: break;
+        }
+        *out = narrow(k, a);
+        return true;
+    }
+    if ((op == OP_DIV || op == OP_MOD) && b.u == 0) {
+        vm->error = "division by zero";
+        return false;
+    }
+    if (!ABI[k].is_signed) {
+        switch (op) {
+            case OP_ADD: a.u += b.u; break;
+            case OP_SUB: a.u -= b.u; break;
+            case OP_MUL: a.u *= b.u; break;
+            case OP_DIV: a.u /= b.u; break;
+            case OP_MOD: a.u %= b.u; break;
+            case OP_AND: a.u &= b.u; break;
+            case OP_OR:  a.u |= b.u; break;
+            default:     a.u ^= b.u; break;
+        }
+        *out = narrow(k, a);
+        return true;
+    }
+    int64_t r;
+    bool ovf = false;
+    switch (op) {
+        case OP_ADD: ovf = __builtin_add_overflow(a.i, b.i, &r); break;
+        case OP_SUB: ovf = __builtin_sub_overflow(a.i, b.i, &r); break;
+        case OP_MUL: ovf = __builtin_mul_overflow(a.i, b.i, &r); break;
+        case OP_DIV:
+        case OP_MOD:
+            ovf = b.i == -1 && a.i == (ABI[k].size == 4 ? INT32_MIN : INT64_MIN);
+            r = ovf ? 0 : op == OP_DIV ? a.i / b.i : a.i % b.i;
+            break;
+        case OP_AND: r = a.i & b.i; break;
+        case OP_OR:  r = a.i | b.i; break;
+        default:     r = a.i ^ b.i; break;
+    }
+    if (ovf || overflows(k, r)) {
+        vm->error = "signed integer overflow";
+        return false;
+    }
+    out->i = r;
+    return true;
+}
+
+static bool shift(Vm *vm, Op op, Kind k, Kind ck, CexprValue a, CexprValue n, CexprValue *out) {
+    unsigned bits = ABI[k].size * 8u;
+    if ((ABI[ck].is_signed && n.i < 0) || n.u >= bits) {
+        vm->error = "shift count negative or not less than the width of the type";
+        return false;
+    }
+    if (op == OP_SHR) {
+        if (ABI[k].is_signed) out->i = a.i >> n.u;      /* arithmetic, as gcc/clang */
+        else out->u = a.u >> n.u;
+        return true;
+    }
+    if (ABI[k].is_signed) {
+        if (a.i < 0 || (n.u > 0 && (uint64_t)a.i >> (bits - 1 - n.u)) != 0) {
+            vm->error = a.i < 0 ? "left shift of a negative value" : "left shift overflows the signed type";
+            return false;
+        }
+        out->i = (int64_t)((uint64_t)a.i << n.u);
+        return true;
+    }
+    CexprValue r = { .u = a.u << n.u };
+    *out = narrow(k, r);
+    return true;
+}
+
+static int compare(Kind k, CexprValue a, CexprValue b) {
+    if (is_float(k)) return (a.f > b.f) - (a.f < b.f);
+    if (ABI[k].is_signed) return (a.i > b.i) - (a.i < b.i);
+    return (a.u > b.u) - (a.u < b.u);
+}
+
+static bool truthy(Kind k, CexprValue v) {
+    return is_float(k) ? v.f != 0 : v.u != 0;
+}
+
+static bool run(Vm *vm, CexprValue *result) {
+    const Prog *pg = vm->pg;
+    CexprValue st[CEXPR_STACK];
+    int sp = 0;
+
+    for (int pc = 0; pc < pg->ncode; ) {
+        const Insn *in = &pg->code[pc++];
+        Kind k = (Kind)in->kind;
+        switch ((Op)in->op) {
+            case OP_NOP:
+                break;
+            case OP_PUSH:
+                st[sp++] = pg->consts[in->arg];
+                break;
+            case OP_LOAD: {
+                uint64_t addr = st[sp - 1].u;
+                if (!obj_at(vm, addr, ABI[k].size)) {
+                    vm->error = addr == 0 ? "null pointer dereference" : "read outside any object";
+                    return false;
+                }
+                st[sp - 1] = load(k, bytes_at(vm, addr));
+                break;
+            }
+            case OP_CONV:
+                if (!conv(vm, (Kind)in->aux, k, &st[sp - 1])) return false;
+                break;
+            case OP_NEG:
+                if (is_float(k)) st[sp - 1].f = -st[sp - 1].f;
+                else if (!ABI[k].is_signed) st[sp - 1] = narrow(k, (CexprValue){ .u = -st[sp - 1].u });
+                else if (st[sp - 1].i == (ABI[k].size == 4 ? INT32_MIN : INT64_MIN)) {
+                    vm->error = "signed integer overflow";
+                    return false;
+                } else st[sp - 1].i = -st[sp - 1].i;
+                break;
+            case OP_BNOT:
+                st[sp - 1] = narrow(k, (CexprValue){ .u = ~st[sp - 1].u });
+                break;
+            case OP_LNOT:
+                st[sp - 1].i = !truthy(k, st[sp - 1]);
+                break;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+            case OP_AND: case OP_OR: case OP_XOR:
+                sp--;
+                if (!arith(vm, (Op)in->op, k, st[sp - 1], st[sp], &st[sp - 1])) return false;
+                break;
+            case OP_SHL: case OP_SHR:
+                sp--;
+                if (!shift(vm, (Op)in->op, k, (Kind)in->aux, st[sp - 1], st[sp], &st[sp - 1])) return false;
+                break;
+            case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE: {
+                sp--;
+                int r = compare(k, st[sp - 1], st[sp]);
+                bool t = in->op == OP_LT ? r < 0 : in->op == OP_LE ? r <= 0 : in->op == OP_GT ? r > 0 :
+                         in->op == OP_GE ? r >= 0 : in->op == OP_EQ ? r == 0 : r != 0;
+                if (is_float(k) && (isnan(st[sp - 1].f) || isnan(st[sp].f))) t = in->op == OP_NE;
+                st[sp - 1].i = t;
+                break;
+            }
+            case OP_PADD: {
+                sp--;
+                uint64_t p = st[sp - 1].u;
+                int64_t n = in->aux ? -st[sp].i : st[sp].i;
+                const Obj *o = obj_at(vm, p, 0);
+                int64_t bytes;
+                if (n == 0) break;
+                bool wild = __builtin_mul_overflow(n, (int64_t)in->arg, &bytes);
+                uint64_t q = p + (uint64_t)bytes;
+                if (!o || wild || q < o->addr || q > (uint64_t)o->addr + o->size) {
+                    vm->error = o ? "pointer arithmetic leaves the array" : "arithmetic on a pointer to no object";
+                    return false;
+                }
+                st[sp - 1].u = q;
+                break;
+            }
+            case OP_PDIFF: {
+                sp--;
+                uint64_t p = st[sp - 1].u, q = st[sp].u;
+                const Obj *o = obj_at(vm, p, 0);
+                if (!o || o != obj_at(vm, q, 0)) {
+                    vm->error = "subtracting pointers into different objects";
+                    return false;
+                }
+                st[sp - 1].i = ((int64_t)p - (int64_t)q) / in->arg;
+                break;
+            }
+            case OP_SWAP: {
+                CexprValue t = st[sp - 1];
+                st[sp - 1] = st[sp - 2];
+                st[sp - 2] = t;
+                break;
+            }
+            case OP_JMP:
+                pc = in->arg;
+                break;
+            case OP_JZ:
+                sp--;
+                if (!truthy(k, st[sp])) pc = in->arg;
+                break;
+            case OP_JNZ:
+                sp--;
+                if (truthy(k, st[sp])) pc = in->arg;
+                break;
+        }
+    }
+    *result = st[sp - 1];
+    return true;
+}
+
+/* ===== public ===== */
+static void comp_init(Comp *c, const CexprEnv *env, const char *src) {
+    memset(c, 0, sizeof(*c));
+    c->lx.src = src;
+    c->lx.p = src;
+    c->env = env;
+}
+
+static void prog_init(Prog *pg, const TypeTab *tt) {
+    pg->tt.n = tt->n;
+    memcpy(pg->tt.t, tt->t, (size_t)tt->n * sizeof(CType));
+    pg->ncode = pg->nconsts = pg->nstrs = 0;
+    pg->rolen = 0;
+    pg->depth = pg->max_depth = 0;
+    pg->vars = 0;
+}
+
+/* One scalar initializer or expression, compiled into a fresh program. */
+static Ex compile_expr(Comp *c, Prog *pg) {
+    prog_init(pg, c->tt);
+    TypeTab *outer = c->tt;
+    c->pg = pg;
+    c->tt = &pg->tt;
+    Ex e = rvalue(c, expr_cond(c));
+    if (!c->failed && kind_of(c, e.type) == K_VOID) fail(c, "void value not ignored");
+    c->tt = outer;
+    compact(pg);
+    return e;
+}
+
+bool cexpr_eval(const CexprEnv *env, const char *src, CexprResult *r) {
+    Comp c;
+    Prog pg;
+    memset(r, 0, sizeof(*r));
+    comp_init(&c, env, src);
+    lex_next(&c);
+    prog_init(&pg, &env->tt);
+    c.pg = &pg;
+    c.tt = &pg.tt;
+    Ex e = rvalue(&c, expr_cond(&c));
+    accept(&c, ';');
+    if (!c.failed && c.lx.kind != TK_END) {
+        if (at(&c, '=') || at(&c, P_ASSIGN_OP)) fail(&c, "assignment changes a variable; write an expression");
+        else if (at(&c, ',')) fail(&c, "one expression only");
+        else fail(&c, "unexpected '%.*s'", (int)c.lx.len, c.lx.start);
+    }
+    if (!c.failed && kind_of(&c, e.type) == K_VOID) fail(&c, "void value not ignored");
+    if (c.failed) {
+        r->syntax = true;
+        r->column = c.errcol;
+        snprintf(r->error, sizeof(r->error), "%s", c.err);
+        return false;
+    }
+    compact(&pg);
+
+    const CType *t = &pg.tt.t[e.type];
+    Kind k = (Kind)t->kind;
+    r->vars = pg.vars;
+    r->size = t->size;
+    r->cls = k == K_PTR ? CEXPR_POINTER : is_float(k) ? CEXPR_FLOAT :
+             ABI[k].is_signed ? CEXPR_SIGNED : CEXPR_UNSIGNED;
+    r->pointee = k == K_PTR ? pg.tt.t[t->base].size : 0;
+    type_name(&pg.tt, e.type, r->type, sizeof(r->type));
+
+    Vm vm = { env, &pg, NULL };
+    if (!run(&vm, &r->v)) {
+        snprintf(r->error, sizeof(r->error), "%s", vm.error);
+        return false;
+    }
+    r->ok = true;
+    return true;
+}
+
+/* ===== environments ===== */
+static bool has_room(Comp *c, uint32_t end) {
+    if (end > c->build->top) {
+        fail(c, "variables exceed %d bytes", CEXPR_MEM);
+        return false;
+    }
+    return true;
+}
+
+static void init_object(Comp *c, uint16_t t, uint32_t off, uint32_t *count);
+
+/* Elements of array type t from off; *count is the length when t is
+ * open ([]) and grows with the initializer. */
+static void init_array(Comp *c, uint16_t t, uint32_t off, bool braced, uint32_t *count) {
+    const CType *a = &c->build->tt.t[t];
+    uint16_t elem = a->base;
+    uint32_t esz = c->build->tt.t[elem].size, limit = a->count;
+    Kind ek = (Kind)c->build->tt.t[elem].kind;
+
+    if (c->lx.kind == TK_STR && (ek == K_CHAR || ek == K_SCHAR || ek == K_UCHAR)) {
+        uint32_t n = c->lx.slen + 1;
+        if (limit && n - 1 > limit) fail(c, "initializer string longer than the array");
+        if (limit && n > limit) n = limit;          /* char s[3] = "abc": no NUL */
+        if (!has_room(c, off + n)) return;
+        memcpy(c->build->mem + off, c->lx.str, n);
+        if (count) *count = c->lx.slen + 1;
+        lex_next(c);
+        return;
+    }
+    uint32_t i = 0;
+    for (; !at(c, '}') && c->lx.kind != TK_END; ++i) {
+        if (limit && i >= limit) {
+            if (braced) fail(c, "too many initializers");
+            break;
+        }
+        if (!has_room(c, off + (i + 1) * esz)) return;
+        if (ek == K_ARRAY && !at(c, '{') && c->lx.kind != TK_STR) {
+            init_array(c, elem, off + i * esz, false, NULL);     /* brace elision */
+        } else {
+            init_object(c, elem, off + i * esz, NULL);
+        }
+        if (!braced && limit && i + 1 == limit) { i++; break; }
+        if (!at(c, ',')) { i++; break; }
+        Lex save = c->lx;
+        lex_next(c);
+        if (!braced && at(c, '}')) { c->lx = save; i++; break; }
+    }
+    if (count) *count = i;
+}
+
+static void init_object(Comp *c, uint16_t t, uint32_t off, uint32_t *count) {
+    CexprEnv *env = c->build;
+    Kind k = (Kind)env->tt.t[t].kind;
+    if (k == K_ARRAY) {
+        if (accept(c, '{')) {
+            init_array(c, t, off, true, count);
+            expect(c, '}', "'}'");
+        } else if (c->lx.kind == TK_STR) {
+            init_array(c, t, off, false, count);
+        } else {
+            fail(c, "an array is initialized with { ... }");
+        }
+        return;
+    }
+    bool braced = accept(c, '{');
+    Prog pg;
+    Ex e = compile_expr(c, &pg);
+    Kind from = (Kind)pg.tt.t[e.type].kind;
+    if (!c->failed && (from == K_PTR ? !(k == K_PTR || is_int(k)) : k == K_PTR ? !is_int(from) : !is_arith(from))) {
+        char a[48], b[48];
+        type_name(&pg.tt, e.type, a, sizeof(a));
+        type_name(&env->tt, t, b, sizeof(b));
+        fail(c, "cannot initialize %s with %s", b, a);
+    }
+    if (!c->failed && from == K_PTR && k == K_PTR &&
+        pg.tt.t[e.type].base != env->tt.t[t].base &&
+        pg.tt.t[pg.tt.t[e.type].base].kind != K_VOID && env->tt.t[env->tt.t[t].base].kind != K_VOID) {
+        char a[48], b[48];
+        type_name(&pg.tt, e.type, a, sizeof(a));
+        type_name(&env->tt, t, b, sizeof(b));
+        fail(c, "cannot initialize %s with %s", b, a);
+    }
+    if (braced) expect(c, '}', "'}'");
+    if (c->failed) return;
+
+    Vm vm = { env, &pg, NULL };
+    CexprValue v;
+    if (!run(&vm, &v) || !conv(&vm, from, k, &v)) {
+        fail(c, "%s", vm.error);
+        return;
+    }
+    store(k, env->mem + off, v);
+}
+
+static bool declare(CexprEnv *env, const char *decl, char *err, size_t errcap) {
+    Comp c;
+    comp_init(&c, env, decl);
+    c.build = env;
+    c.tt = &env->tt;
+    lex_next(&c);
+
+    char name[CEXPR_NAME] = "";
+    if (!is_type_start(&c)) fail(&c, "a declaration starts with a type");
+    uint16_t t = specifiers(&c);
+    t = declarator(&c, t, name, true);
+    CType ct = env->tt.t[t];
+
+    if (!c.failed && find_obj(env, name, strlen(name))) fail(&c, "'%s' declared twice", name);
+    if (!c.failed && (ct.kind == K_VOID || env->nobjs == CEXPR_OBJS)) {
+        fail(&c, ct.kind == K_VOID ? "variable of type void" : "too many variables");
+    }
+    uint32_t start = env->nobjs ? env->used + GUARD : 0;
+    uint32_t off = (start + ct.align - 1) & ~(uint32_t)(ct.align - 1);
+    uint32_t count = ct.count;
+    bool open = ct.kind == K_ARRAY && ct.count == 0;
+    if (!c.failed && !open) has_room(&c, off + ct.size);
+
+    if (accept(&c, '=')) {
+        init_object(&c, t, off, open ? &count : NULL);
+    } else if (open) {
+        fail(&c, "an array declared with [] needs an initializer");
+    }
+    accept(&c, ';');
+    if (!c.failed && c.lx.kind != TK_END) fail(&c, "unexpected '%.*s'", (int)c.lx.len, c.lx.start);
+
+    if (!c.failed && env->nobjs == CEXPR_OBJS) fail(&c, "too many variables");
+    if (!c.failed && open) {
+        if (count == 0) fail(&c, "empty initializer");
+        else t = array_of(&c, ct.base, count);
+    }
+    if (c.failed) {
+        snprintf(err, errcap, "'%s': %s (column %d)", decl, c.err, c.errcol);
+        return false;
+    }
+    ct = env->tt.t[t];
+    Obj *o = &env->objs[env->nobjs++];
+    snprintf(o->name, sizeof(o->name), "%s", name);
+    o->type = t;
+    o->addr = MEM_BASE + off;
+    o->size = ct.size;
+    env->used = off + ct.size;
+    return true;
+}
+
+CexprEnv *cexpr_env_new(const char *const *decls, char *err, size_t errcap) {
+    CexprEnv *env = tracked_calloc(1, sizeof(*env));
+    if (!env) {
+        snprintf(err, errcap, "out of memory");
+        return NULL;
+    }
+    types_init(&env->tt);
+    env->top = CEXPR_MEM;
+    for (int i = 0; decls && decls[i]; ++i) {
+        if (!declare(env, decls[i], err, errcap)) {
+            tracked_free(env);
+            return NULL;
+        }
+    }
+    return env;
+}
+
+void cexpr_env_free(CexprEnv *env) {
+    tracked_free(env);
+}
+
+/* ===== grading ===== */
+static double as_double(const CexprResult *r) {
+    switch (r->cls) {
+        case CEXPR_FLOAT:    return r->v.f;
+        case CEXPR_SIGNED:   return (double)r->v.i;
+        default:             return (double)r->v.u;
+    }
+}
+
+bool cexpr_match(const CexprResult *ref, const CexprResult *got, int flags) {
+    if (!ref->ok || !got->ok) return false;
+    if ((flags & EXPR_SAME_TYPE) && strcmp(ref->type, got->type) != 0) return false;
+    if ((ref->cls == CEXPR_POINTER) != (got->cls == CEXPR_POINTER)) return false;
+    if (ref->cls == CEXPR_POINTER) return ref->v.u == got->v.u;
+
+    if (ref->cls == CEXPR_FLOAT || got->cls == CEXPR_FLOAT) {
+        double a = as_double(ref), b = as_double(got);
+        if (ref->cls == CEXPR_FLOAT && ref->size == 4) b = (float)b;    /* compare at float precision */
+        if (flags & EXPR_APPROX) return fabs(a - b) <= 1e-6 * fmax(1.0, fabs(a));
+        return a == b;
+    }
+    /* integers: the mathematical values, whatever the signedness */
+    if (ref->cls == got->cls) return ref->v.u == got->v.u;
+    const CexprResult *s = ref->cls == CEXPR_SIGNED ? ref : got;
+    const CexprResult *u = ref->cls == CEXPR_SIGNED ? got : ref;
+    return s->v.i >= 0 && (uint64_t)s->v.i == u->v.u;
+}
+
+/* Shortest text that reads back as the same value; no exponent for
+ * ordinary magnitudes. */
+static void format_float(double f, bool single, char *buf, size_t cap) {
+    bool plain = fabs(f) >= 1e-4 && fabs(f) < 1e15;
+    for (int prec = 1; prec <= 17; ++prec) {
+        snprintf(buf, cap, "%.*g", prec, f);
+        double back = strtod(buf, NULL);
+        if ((single ? (float)back == (float)f : back == f) && !(plain && strchr(buf, 'e'))) break;
+    }
+    if (!strpbrk(buf, ".eEn") && strlen(buf) + 3 < cap) strcat(buf, ".0");
+}
+
+/* &a[2], &m[1][0], &x; raw address otherwise */
+static bool format_pointer(const CexprEnv *env, const CexprResult *r, char *buf, size_t cap) {
+    uint64_t addr = r->v.u;
+    for (int i = 0; i < env->nobjs; ++i) {
+        const Obj *o = &env->objs[i];
+        if (!o->name[0] || addr < o->addr || addr > (uint64_t)o->addr + o->size) continue;
+        uint32_t off = (uint32_t)(addr - o->addr);
+        uint16_t t = o->type;
+        size_t n = (size_t)snprintf(buf, cap, "&%s", o->name);
+        while (env->tt.t[t].kind == K_ARRAY && !(off == 0 && env->tt.t[t].size == r->pointee)) {
+            const CType *a = &env->tt.t[t];
+            uint32_t esz = env->tt.t[a->base].size;
+            if (n < cap) n += (size_t)snprintf(buf + n, cap - n, "[%u]", off / esz);
+            off %= esz;
+            t = a->base;
+        }
+        if (off == 0) return true;
+    }
+    return false;
+}
+
+void cexpr_format(const CexprEnv *env, const CexprResult *r, char *buf, size_t cap) {
+    switch (r->cls) {
+        case CEXPR_SIGNED:
+            if (r->size == 1 && strstr(r->type, "char") && isprint((int)r->v.i)) {
+                snprintf(buf, cap, "%lld ('%c')", (long long)r->v.i, (char)r->v.i);
+            } else {
+                snprintf(buf, cap, "%lld", (long long)r->v.i);
+            }
+            break;
+        case CEXPR_UNSIGNED:
+            if (r->size == 1 && strstr(r->type, "char") && isprint((int)r->v.u)) {
+                snprintf(buf, cap, "%llu ('%c')", (unsigned long long)r->v.u, (char)r->v.u);
+            } else {
+                snprintf(buf, cap, "%llu", (unsigned long long)r->v.u);
+            }
+            break;
+        case CEXPR_FLOAT:
+            format_float(r->v.f, r->size == 4, buf, cap);
+            break;
+        case CEXPR_POINTER:
+            if (r->v.u == 0) snprintf(buf, cap, "NULL");
+            else if (!format_pointer(env, r, buf, cap)) snprintf(buf, cap, "0x%llx", (unsigned long long)r->v.u);
+            break;
+    }
+}
+
+void cexpr_var_names(const CexprEnv *env, uint32_t vars, char *buf, size_t cap) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < env->nobjs && len < cap; ++i) {
+        if (!(vars & (1u << i))) continue;
+        vars &= ~(1u << i);
+        const char *sep = len == 0 ? "" : vars ? ", " : " and ";
+        int n = snprintf(buf + len, cap - len, "%s%s", sep, env->objs[i].name);
+        if (n < 0) break;
+        len += (size_t)n;
+    }
+}
+
+/* ===== per-bank table ===== */
+struct CexprTable {
+    int count;
+    CexprTask **tasks;
+};
+
+static CexprTask *task_build(const Task *t) {
+    CexprTask *x = tracked_calloc(1, sizeof(*x));
+    if (!x) return NULL;
+    x->env = cexpr_env_new(t->options, x->error, sizeof(x->error));
+    if (!x->env) {
+        return x;
+    }
+    if (!t->answers || !t->answers[0]) {
+        snprintf(x->error, sizeof(x->error), "no reference expression");
+    } else if (!cexpr_eval(x->env, t->answers[0], &x->ref)) {
+        snprintf(x->error, sizeof(x->error), "reference '%s': %s", t->answers[0], x->ref.error);
+    }
+    return x;
+}
+
+CexprTable *cexpr_table_build(const Task *tasks, int count) {
+    CexprTable *tab = tracked_calloc(1, sizeof(*tab));
+    if (!tab) return NULL;
+    tab->count = count;
+    tab->tasks = tracked_calloc(count > 0 ? (size_t)count : 1, sizeof(CexprTask *));
+    if (!tab->tasks) {
+        cexpr_table_free(tab);
+        return NULL;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (tasks[i].type != TASK_EXPR) continue;
+        tab->tasks[i] = task_build(&tasks[i]);
+        if (!tab->tasks[i]) {
+            cexpr_table_free(tab);
+            return NULL;
+        }
+    }
+    return tab;
+}
+
+void cexpr_table_free(CexprTable *tab) {
+    if (!tab) return;
+    for (int i = 0; tab->tasks && i < tab->count; ++i) {
+        if (tab->tasks[i]) cexpr_env_free(tab->tasks[i]->env);
+        tracked_free(tab->tasks[i]);
+    }
+    tracked_free(tab->tasks);
+    tracked_free(tab);
+}
+
+const CexprTask *cexpr_table_task(const CexprTable *tab, int task) {
+    if (!tab || task < 0 || task >= tab->count) return NULL;
+    return tab->tasks[task];
+}
@@ -0,0 +1,405 @@
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cohort.h"
+#include "tracker.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COH_X86 1
+#include <immintrin.h>
+#else
+#define COH_X86 0
+#endif
+
+#define COH_CAT2(a, b) a##_##b
+#define COH_CAT(a, b) COH_CAT2(a, b)
+
+#define HIST_WAYS 4     /* sub-histograms, so repeats of one bin don't serialize */
+
+/* ===== scalar ===== */
+static void score_stats_scalar(const int32_t *x, size_t n, CohortScoreStats *st) {
+    CohortScoreStats r = { 0, n ? INT32_MAX : 0, n ? INT32_MIN : 0, 0 };
+    for (size_t i = 0; i < n; ++i) {
+        r.sum += x[i];
+        r.nonzero += x[i] != 0;
+        if (x[i] < r.min) r.min = x[i];
+        if (x[i] > r.max) r.max = x[i];
+    }
+    *st = r;
+}
+
+static uint32_t stuck_scalar(const uint16_t *a, const uint64_t *done, size_t words, uint16_t min,
+                             uint64_t *out) {
+    uint32_t count = 0;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t m = 0;
+        for (int j = 0; j < 64; ++j) m |= (uint64_t)(a[w * 64 + (size_t)j] >= min) << j;
+        m &= ~done[w];
+        if (out) out[w] = m;
+        count += (uint32_t)__builtin_popcountll(m);
+    }
+    return count;
+}
+
+static uint32_t filter_scalar(const uint64_t *const *have, int nh, const uint64_t *const *lack,
+                              int nl, size_t words, uint64_t *out) {
+    uint32_t count = 0;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t m = ~(uint64_t)0;
+        for (int k = 0; k < nh; ++k) m &= have[k][w];
+        for (int k = 0; k < nl; ++k) m &= ~lack[k][w];
+        if (out) out[w] = m;
+        count += (uint32_t)__builtin_popcountll(m);
+    }
+    return count;
+}
+
+/* ===== SIMD: cohort_simd.inc once per instruction set ===== */
+#if COH_X86
+#define COH_SUFFIX sse2
+#define COH_TARGET __attribute__((target("sse2")))
+#define COH_W      4
+#define ivec       __m128i
+#define V_LOAD(p)         _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define V_STORE(p, v)     _mm_storeu_si128((__m128i *)(void *)(p), (v))
+#define V_ZERO            _mm_setzero_si128()
+#define V_SET32(x)        _mm_set1_epi32(x)
+#define V_SET16(x)        _mm_set1_epi16(x)
+#define V_ADD32(a, b)     _mm_add_epi32((a), (b))
+#define V_SUB32(a, b)     _mm_sub_epi32((a), (b))
+#define V_SRAI32(a, n)    _mm_srai_epi32((a), (n))
+#define V_EQ32(a, b)      _mm_cmpeq_epi32((a), (b))
+#define V_GT32(a, b)      _mm_cmpgt_epi32((a), (b))
+#define V_EQ16(a, b)      _mm_cmpeq_epi16((a), (b))
+#define V_SUBS_U16(a, b)  _mm_subs_epu16((a), (b))
+#define V_AND(a, b)       _mm_and_si128((a), (b))
+#define V_OR(a, b)        _mm_or_si128((a), (b))
+#define V_ANDNOT(a, b)    _mm_andnot_si128((a), (b))
+#define V_MASK16X2(a, b)  ((uint32_t)_mm_movemask_epi8(_mm_packs_epi16((a), (b))))
+#include "cohort_simd.inc"
+#undef COH_SUFFIX
+#undef COH_TARGET
+#undef COH_W
+#undef ivec
+#undef V_LOAD
+#undef V_STORE
+#undef V_ZERO
+#undef V_SET32
+#undef V_SET16
+#undef V_ADD32
+#undef V_SUB32
+#undef V_SRAI32
+#undef V_EQ32
+#undef V_GT32
+#undef V_EQ16
+#undef V_SUBS_U16
+#undef V_AND
+#undef V_OR
+#undef V_ANDNOT
+#undef V_MASK16X2
+
+/* packs works per 128-bit lane; the permute puts a's bytes before b's */
+#define COH_SUFFIX avx2
+#define COH_TARGET __attribute__((target("avx2,popcnt")))
+#define COH_W      8
+#define ivec       __m256i
+#define V_LOAD(p)         _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define V_STORE(p, v)     _mm256_storeu_si256((__m256i *)(void *)(p), (v))
+#define V_ZERO            _mm256_setzero_si256()
+#define V_SET32(x)        _mm256_set1_epi32(x)
+#define V_SET16(x)        _mm256_set1_epi16(x)
+#define V_ADD32(a, b)     _mm256_add_epi32((a), (b))
+#define V_SUB32(a, b)     _mm256_sub_epi32((a), (b))
+#define V_SRAI32(a, n)    _mm256_srai_epi32((a), (n))
+#define V_EQ32(a, b)      _mm256_cmpeq_epi32((a), (b))
+#define V_GT32(a, b)      _mm256_cmpgt_epi32((a), (b))
+#define V_EQ16(a, b)      _mm256_cmpeq_epi16((a), (b))
+#define V_SUBS_U16(a, b)  _mm256_subs_epu16((a), (b))
+#define V_AND(a, b)       _mm256_and_si256((a), (b))
+#define V_OR(a, b)        _mm256_or_si256((a), (b))
+#define V_ANDNOT(a, b)    _mm256_andnot_si256((a), (b))
+#define V_MASK16X2(a, b)  ((uint32_t)_mm256_movemask_epi8( \
+                               _mm256_permute4x64_epi64(_mm256_packs_epi16((a), (b)), 0xD8)))
+#include "cohort_simd.inc"
+#undef COH_SUFFIX
+#undef COH_TARGET
+#undef COH_W
+#undef ivec
+#undef V_LOAD
+#undef V_STORE
+#undef V_ZERO
+#undef V_SET32
+#undef V_SET16
+#undef V_ADD32
+#undef V_SUB32
+#undef V_SRAI32
+#undef V_EQ32
+#undef V_GT32
+#undef V_EQ16
+#undef V_SUBS_U16
+#undef V_AND
+#undef V_OR
+#undef V_ANDNOT
+#undef V_MASK16X2
+#endif /* COH_X86 */
+
+/* ===== dispatch ===== */
+static const CohortKernels KERNELS[FPK_ISAS] = {
+    [FPK_SCALAR] = { score_stats_scalar, stuck_scalar, filter_scalar },
+#if COH_X86
+    [FPK_SSE2] = { score_stats_sse2, stuck_sse2, filter_sse2 },
+    [FPK_AVX2] = { score_stats_avx2, stuck_avx2, filter_avx2 },
+#endif
+};
+
+const CohortKernels *cohort_kernels(FpkIsa isa) {
+    if ((unsigned)isa >= FPK_ISAS || isa > fpk_detect_isa() || !KERNELS[isa].score_stats) {
+        return NULL;
+    }
+    return &KERNELS[isa];
+}
+
+static FpkIsa best_isa(void) {
+    FpkIsa isa = fpk_detect_isa();
+    while (isa > FPK_SCALAR && !KERNELS[isa].score_stats) isa--;
+    return isa;
+}
+
+/* Picked on first use; every thread computes the same pointer. */
+static _Atomic(const CohortKernels *) g_active;
+
+static const CohortKernels *active(void) {
+    const CohortKernels *k = atomic_load_explicit(&g_active, memory_order_relaxed);
+    if (!k) {
+        k = &KERNELS[best_isa()];
+        atomic_store_explicit(&g_active, k, memory_order_relaxed);
+    }
+    return k;
+}
+
+bool cohort_use_isa(FpkIsa isa) {
+    const CohortKernels *k = cohort_kernels(isa);
+    if (!k) return false;
+    atomic_store_explicit(&g_active, k, memory_order_relaxed);
+    return true;
+}
+
+FpkIsa cohort_active_isa(void) {
+    return (FpkIsa)(active() - KERNELS);
+}
+
+/* ===== file ===== */
+static size_t file_size(uint32_t capacity) {
+    return sizeof(CohortHeader) +
+           (size_t)STATION_COUNT * capacity * (sizeof(int32_t) + sizeof(uint16_t)) +
+           (size_t)STATION_COUNT * (capacity / 64) * sizeof(uint64_t);
+}
+
+static void bind_columns(Cohort *c) {
+    uint32_t cap = c->hdr->capacity;
+    unsigned char *p = (unsigned char *)c->map + sizeof(CohortHeader);
+    for (int s = 0; s < STATION_COUNT; ++s, p += (size_t)cap * sizeof(int32_t)) {
+        c->score[s] = (int32_t *)(void *)p;
+    }
+    for (int s = 0; s < STATION_COUNT; ++s, p += (size_t)cap * sizeof(uint16_t)) {
+        c->attempts[s] = (uint16_t *)(void *)p;
+    }
+    for (int s = 0; s < STATION_COUNT; ++s, p += (size_t)(cap / 64) * sizeof(uint64_t)) {
+        c->completed[s] = (uint64_t *)(void *)p;
+    }
+}
+
+static Status map_cohort(Cohort *c, int fd, const char *path, bool writable) {
+    int prot = PROT_READ | (writable ? PROT_WRITE : 0);
+    c->map = mmap(NULL, c->map_len, prot, MAP_SHARED, fd, 0);
+    close(fd);
+    if (c->map == MAP_FAILED) {
+        c->map = NULL;
+        perror(path);
+        return ERR;
+    }
+    c->hdr = c->map;
+    c->writable = writable;
+    return OK;
+}
+
+Status cohort_create(Cohort *c, const char *path, uint32_t capacity) {
+    memset(c, 0, sizeof(*c));
+    if (!capacity || capacity > UINT32_MAX - COHORT_ROWS) {
+        fprintf(stderr, "%s: bad capacity %u\n", path, capacity);
+        return ERR;
+    }
+    capacity = (capacity + COHORT_ROWS - 1) / COHORT_ROWS * COHORT_ROWS;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return ERR;
+    }
+    c->map_len = file_size(capacity);
+    /* sparse: untouched columns read as zero and cost no disk */
+    if (ftruncate(fd, (off_t)c->map_len) < 0) {
+        perror(path);
+        close(fd);
+        return ERR;
+    }
+    if (map_cohort(c, fd, path, true) != OK) {
+        return ERR;
+    }
+    memcpy(c->hdr->magic, COHORT_MAGIC, sizeof(c->hdr->magic));
+    c->hdr->version = COHORT_VERSION;
+    c->hdr->stations = STATION_COUNT;
+    c->hdr->capacity = capacity;
+    c->hdr->learners = 0;
+    bind_columns(c);
+    return OK;
+}
+
+Status cohort_open(Cohort *c, const char *path, bool writable) {
+    memset(c, 0, sizeof(*c));
+    int fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return ERR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(CohortHeader)) {
+        close(fd);
+        fprintf(stderr, "%s: not a cohort store\n", path);
+        return ERR;
+    }
+    c->map_len = (size_t)st.st_size;
+    if (map_cohort(c, fd, path, writable) != OK) {
+        return ERR;
+    }
+
+    const CohortHeader *h = c->hdr;
+    const char *why = NULL;
+    if (memcmp(h->magic, COHORT_MAGIC, sizeof(h->magic)) != 0) {
+        why = "bad magic";
+    } else if (h->version != COHORT_VERSION || h->stations != STATION_COUNT) {
+        why = "unsupported cohort version";
+    } else if (!h->capacity || h->capacity % COHORT_ROWS || h->learners > h->capacity ||
+               file_size(h->capacity) != c->map_len) {
+        why = "truncated or oversized";
+    }
+    if (why) {
+        fprintf(stderr, "%s: %s\n", path, why);
+        cohort_close(c);
+        return ERR;
+    }
+    bind_columns(c);
+    return OK;
+}
+
+void cohort_close(Cohort *c) {
+    if (c->map) munmap(c->map, c->map_len);
+    memset(c, 0, sizeof(*c));
+}
+
+uint32_t cohort_learners(const Cohort *c) {
+    return c->hdr->learners;
+}
+
+void cohort_put(Cohort *c, uint32_t learner, const GameState *g) {
+    uint64_t bit = (uint64_t)1 << (learner % 64);
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        int a = g->attempted[s];
+        c->score[s][learner] = g->station_scores[s];
+        c->attempts[s][learner] = (uint16_t)(a < 0 ? 0 : a > UINT16_MAX ? UINT16_MAX : a);
+        if (g->completed[s]) {
+            c->completed[s][learner / 64] |= bit;
+        } else {
+            c->completed[s][learner / 64] &= ~bit;
+        }
+    }
+}
+
+int64_t cohort_append(Cohort *c, const GameState *g) {
+    if (!c->writable || c->hdr->learners >= c->hdr->capacity) {
+        return -1;
+    }
+    uint32_t learner = c->hdr->learners;
+    cohort_put(c, learner, g);
+    c->hdr->learners = learner + 1;
+    return learner;
+}
+
+void cohort_get(const Cohort *c, uint32_t learner, GameState *g) {
+    memset(g, 0, sizeof(*g));
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        g->station_scores[s] = c->score[s][learner];
+        g->attempted[s] = c->attempts[s][learner];
+        g->completed[s] = (c->completed[s][learner / 64] >> (learner % 64)) & 1;
+        g->total_score += g->station_scores[s];
+    }
+}
+
+/* ===== queries ===== */
+CohortScoreStats cohort_score_stats(const Cohort *c, int station) {
+    CohortScoreStats st;
+    active()->score_stats(c->score[station], c->hdr->learners, &st);
+    return st;
+}
+
+uint32_t cohort_completed(const Cohort *c, int station) {
+    return cohort_filter(c, 1u << station, 0, NULL);
+}
+
+void cohort_histogram(const Cohort *c, int station, int32_t width, uint32_t *bins, int nbins) {
+    memset(bins, 0, (size_t)nbins * sizeof(*bins));
+    if (width < 1 || nbins < 1) return;
+    uint32_t *sub = tracked_calloc((size_t)HIST_WAYS * (size_t)nbins, sizeof(*sub));
+    if (!sub) return;
+
+    const int32_t *x = c->score[station];
+    uint32_t n = c->hdr->learners, i = 0;
+    for (; i < n; ++i) {
+        int32_t b = x[i] < 0 ? 0 : x[i] / width;
+        sub[(i % HIST_WAYS) * (uint32_t)nbins + (uint32_t)(b < nbins ? b : nbins - 1)]++;
+    }
+    for (int w = 0; w < HIST_WAYS; ++w) {
+        for (int b = 0; b < nbins; ++b) bins[b] += sub[w * nbins + b];
+    }
+    tracked_free(sub);
+}
+
+uint32_t cohort_filter(const Cohort *c, uint32_t have, uint32_t lack, uint64_t *out) {
+    const uint64_t *hv[STATION_COUNT], *lk[STATION_COUNT];
+    int nh = 0, nl = 0;
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        if (have >> s & 1) hv[nh++] = c->completed[s];
+        else if (lack >> s & 1) lk[nl++] = c->completed[s];
+    }
+    if (have & lack) {
+        if (out) memset(out, 0, (c->hdr->capacity / 64) * sizeof(*out));
+        return 0;
+    }
+
+    /* whole words through the kernel; the last, partial word is masked
+     * here, since "not completed" is also true of the unused rows */
+    uint32_t n = c->hdr->learners;
+    size_t full = n / 64;
+    uint32_t count = active()->filter(hv, nh, lk, nl, full, out);
+    if (n % 64) {
+        uint64_t m = ((uint64_t)1 << (n % 64)) - 1;
+        for (int k = 0; k < nh; ++k) m &= hv[k][full];
+        for (int k = 0; k < nl; ++k) m &= ~lk[k][full];
+        if (out) out[full] = m;
+        count += (uint32_t)__builtin_popcountll(m);
+        full++;
+    }
+    if (out) memset(out + full, 0, (c->hdr->capacity / 64 - full) * sizeof(*out));
+    return count;
+}
+
+uint32_t cohort_stuck(const Cohort *c, int station, uint16_t min_attempts, uint64_t *out) {
+    size_t words = (c->hdr->learners + 63) / 64;
+    uint32_t count = active()->stuck(c->attempts[station], c->completed[station], words,
+                                     min_attempts ? min_attempts : 1, out);
+    if (out) memset(out + words, 0, (c->hdr->capacity / 64 - words) * sizeof(*out));
+    return count;
+}
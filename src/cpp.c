@@ -0,0 +1,1704 @@
+#include <pthread.h>
+#include <stdarg.h>
+
+#include "common.h"
+#include "cpp.h"
+#include "tracker.h"
+
+/* ===== tokens ===== */
+typedef enum { T_EOF, T_IDENT, T_NUMBER, T_CHAR, T_STRING, T_PUNCT, T_OTHER } TokKind;
+
+#define TF_BOL      1u      /* first on its line */
+#define TF_SPACE    2u      /* whitespace before it */
+#define TF_NOTED    4u      /* painted blue, and the trace has said so */
+
+typedef struct Tok {
+    struct Tok *next;
+    const char *s;
+    uint64_t hide;          /* macros it may not invoke: bit i = Macro i */
+    uint32_t len;
+    uint8_t kind;
+    uint8_t flags;
+    int16_t file;           /* T_EOF: the header ending here, -1 = the source */
+} Tok;
+
+#define CHUNK       256     /* tokens per allocation */
+#define BODY_POOL   1024    /* parameter and replacement tokens per run */
+#define CHARS       4096    /* pasted and stringized spellings per run */
+#define BUCKETS     64
+
+static const char *const PUNCT3[] = { "<<=", ">>=", "...", NULL };
+static const char *const PUNCT2[] = {
+    "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##", NULL
+};
+static const char PUNCT1[] = "[](){}.&*+-~!/%<>^|?:;=,#";
+
+static bool ident_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+/* Length and kind of the preprocessing token at p (not whitespace or NUL). */
+static size_t lex_one(const char *p, uint8_t *kind) {
+    size_t pre = 0;
+    if (p[0] == 'u' && p[1] == '8' && (p[2] == '"' || p[2] == '\'')) pre = 2;
+    else if ((p[0] == 'L' || p[0] == 'u' || p[0] == 'U') && (p[1] == '"' || p[1] == '\'')) pre = 1;
+    if (p[pre] == '"' || p[pre] == '\'') {
+        char quote = p[pre];
+        const char *q = p + pre + 1;
+        while (*q && *q != quote && *q != '\n') {
+            if (*q == '\\' && q[1] && q[1] != '\n') q++;
+            q++;
+        }
+        if (*q == quote) {
+            *kind = quote == '"' ? T_STRING : T_CHAR;
+            return (size_t)(q + 1 - p);
+        }
+        if (!pre) {             /* a stray quote, as cc -E keeps it */
+            *kind = T_OTHER;
+            return 1;
+        }
+    }
+    if (isalpha((unsigned char)p[0]) || p[0] == '_' || p[0] == '$') {
+        const char *q = p + 1;
+        while (ident_char(*q)) q++;
+        *kind = T_IDENT;
+        return (size_t)(q - p);
+    }
+    if (isdigit((unsigned char)p[0]) || (p[0] == '.' && isdigit((unsigned char)p[1]))) {
+        const char *q = p + 1;
+        for (;;) {
+            if (*q && strchr("eEpP", *q) && (q[1] == '+' || q[1] == '-')) q += 2;
+            else if (ident_char(*q) || *q == '.') q++;
+            else break;
+        }
+        *kind = T_NUMBER;
+        return (size_t)(q - p);
+    }
+    *kind = T_PUNCT;
+    for (int i = 0; PUNCT3[i]; ++i) {
+        if (strncmp(p, PUNCT3[i], 3) == 0) return 3;
+    }
+    for (int i = 0; PUNCT2[i]; ++i) {
+        if (p[0] == PUNCT2[i][0] && p[1] == PUNCT2[i][1]) return 2;
+    }
+    if (!strchr(PUNCT1, p[0])) *kind = T_OTHER;
+    return 1;
+}
+
+static bool is(const Tok *t, const char *s) {
+    size_t n = strlen(s);
+    return t && t->kind != T_EOF && t->len == n && memcmp(t->s, s, n) == 0;
+}
+
+static bool at_eol(const Tok *t) {
+    return !t || t->kind == T_EOF || (t->flags & TF_BOL);
+}
+
+/* Would printing b right after a make them lex differently? */
+static bool needs_space(const Tok *a, const Tok *b) {
+    if (a->kind == T_STRING || a->kind == T_CHAR) return false;
+    if (a->s[a->len - 1] == '/' && (b->s[0] == '/' || b->s[0] == '*')) return true;
+    char buf[80];
+    if (a->len > 64) return true;
+    size_t bl = b->len < 8 ? b->len : 8;
+    memcpy(buf, a->s, a->len);
+    memcpy(buf + a->len, b->s, bl);
+    buf[a->len + bl] = '\0';
+    uint8_t kind;
+    return lex_one(buf, &kind) != a->len;
+}
+
+/* Appends s[0..len) to buf (NUL-terminated); "..." marks a cut. */
+static void put(char *buf, size_t cap, size_t *n, const char *s, size_t len) {
+    if (*n + 4 > cap) return;
+    if (*n + len + 4 > cap) {
+        memcpy(buf + *n, "...", 4);
+        *n = cap;
+        return;
+    }
+    memcpy(buf + *n, s, len);
+    *n += len;
+    buf[*n] = '\0';
+}
+
+/* Tokens from t up to `stop` (or the end of the line's list), spaced as
+ * they were written. */
+static void spell(char *buf, size_t cap, const Tok *t, const Tok *stop) {
+    size_t n = 0;
+    const Tok *prev = NULL;
+    buf[0] = '\0';
+    for (; t && t != stop && t->kind != T_EOF; t = t->next) {
+        if (prev && ((t->flags & (TF_SPACE | TF_BOL)) || needs_space(prev, t))) put(buf, cap, &n, " ", 1);
+        put(buf, cap, &n, t->s, t->len);
+        prev = t;
+    }
+}
+
+/* ===== macro table ===== */
+typedef struct {
+    const char *s;
+    uint32_t len;
+    uint8_t kind;
+    bool space;             /* whitespace before it */
+    int8_t param;           /* the parameter it names, or -1 */
+} BodyTok;
+
+typedef struct {
+    const char *name;
+    uint32_t nlen;
+    int8_t nparams;         /* -1 = object-like */
+    bool variadic;          /* the last parameter is __VA_ARGS__ */
+    bool dead;              /* #undef'd or redefined */
+    int8_t next;            /* hash chain */
+    uint16_t nbody;
+    const BodyTok *params;  /* their names, for the trace */
+    const BodyTok *body;
+} Macro;
+
+typedef struct {
+    Macro m[CPP_MACROS];
+    int n;
+    int8_t bucket[BUCKETS];
+} MacroTab;
+
+typedef struct {
+    char name[CPP_NAME];
+    char *text;             /* spliced, comments removed */
+    char guard[CPP_NAME];   /* "" = not wrapped in #ifndef X ... #endif */
+} CppFile;
+
+struct CppMacros {
+    MacroTab tab;
+    uint64_t once;          /* headers that said #pragma once: bit = file */
+    int nfiles;
+    CppFile files[CPP_FILES];
+    char *source;           /* what the replacement lists point into ... */
+    BodyTok *bodies;        /* ... and the lists themselves */
+    uint64_t hash;
+};
+
+static uint32_t name_hash(const char *s, size_t n) {
+    uint32_t h = 2166136261u;
+    while (n--) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int find_macro(const MacroTab *tab, const char *s, size_t n) {
+    for (int i = tab->bucket[name_hash(s, n) % BUCKETS]; i >= 0; i = tab->m[i].next) {
+        const Macro *m = &tab->m[i];
+        if (!m->dead && m->nlen == n && memcmp(m->name, s, n) == 0) return i;
+    }
+    return -1;
+}
+
+/* ===== a run ===== */
+typedef struct {
+    bool taken;             /* some group of this #if has been kept */
+    bool in_else;
+} Cond;
+
+typedef struct {
+    MacroTab tab;
+    uint64_t once;
+    const CppFile *files;
+    int nfiles;
+    CppMacros *build;       /* set while building a macro set */
+
+    Tok *chunks[CPP_TOKENS / CHUNK];
+    int nchunks, chunk_used;
+    Tok *free;
+    BodyTok *bodies;        /* parameters and replacement lists defined here */
+    int nbodies;
+    char *source;
+    char chars[CHARS];
+    size_t nchars;
+
+    Cond cond[CPP_NEST];
+    int ncond;
+    int inc_cond[CPP_INCLUDE];  /* ncond when each open header began */
+    int inc_file[CPP_INCLUDE];
+    int ninc;
+    int depth;              /* argument nesting, for the trace */
+
+    CppResult *res;
+    size_t out_len, trace_len;
+    Tok prev;               /* last token written */
+    bool failed;
+} Run;
+
+static void fail(Run *r, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void trace(Run *r, int depth, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+static void fail(Run *r, const char *fmt, ...) {
+    if (r->failed) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(r->res->error, sizeof(r->res->error), fmt, ap);
+    va_end(ap);
+    r->failed = true;
+}
+
+static void trace(Run *r, int depth, const char *fmt, ...) {
+    CppResult *res = r->res;
+    res->steps++;
+    if (r->build || res->truncated) return;
+    char line[192];
+    int n = snprintf(line, sizeof(line), "%*s", 2 * depth, "");
+    va_list ap;
+    va_start(ap, fmt);
+    int m = vsnprintf(line + n, sizeof(line) - (size_t)n, fmt, ap);
+    va_end(ap);
+    size_t len = strlen(line);
+    if (n + m >= (int)sizeof(line)) memcpy(line + len - 3, "...", 3);
+    if (r->trace_len + len + 2 > sizeof(res->trace)) {
+        res->truncated = true;
+        return;
+    }
+    memcpy(res->trace + r->trace_len, line, len);
+    r->trace_len += len;
+    res->trace[r->trace_len++] = '\n';
+    res->trace[r->trace_len] = '\0';
+}
+
+static Tok *tok_new(Run *r) {
+    Tok *t = r->free;
+    if (t) {
+        r->free = t->next;
+    } else {
+        if (r->nchunks == 0 || r->chunk_used == CHUNK) {
+            if (r->nchunks == CPP_TOKENS / CHUNK) {
+                fail(r, "the expansion needs more than %d tokens", CPP_TOKENS);
+                return NULL;
+            }
+            r->chunks[r->nchunks] = tracked_malloc(CHUNK * sizeof(Tok));
+            if (!r->chunks[r->nchunks]) {
+                fail(r, "out of memory");
+                return NULL;
+            }
+            r->nchunks++;
+            r->chunk_used = 0;
+        }
+        t = &r->chunks[r->nchunks - 1][r->chunk_used++];
+    }
+    memset(t, 0, sizeof(*t));
+    return t;
+}
+
+static void tok_free(Run *r, Tok *t) {
+    t->next = r->free;
+    r->free = t;
+}
+
+static void list_free(Run *r, Tok *t) {
+    while (t) {
+        Tok *next = t->next;
+        tok_free(r, t);
+        t = next;
+    }
+}
+
+/* Frees from..end (exclusive) and returns end. */
+static Tok *drop(Run *r, Tok *from, Tok *end) {
+    while (from && from != end) {
+        Tok *next = from->next;
+        tok_free(r, from);
+        from = next;
+    }
+    return end;
+}
+
+static Tok *list_dup(Run *r, const Tok *src) {
+    Tok *head = NULL, **tail = &head;
+    for (; src; src = src->next) {
+        Tok *t = tok_new(r);
+        if (!t) break;
+        *t = *src;
+        t->next = NULL;
+        *tail = t;
+        tail = &t->next;
+    }
+    return head;
+}
+
+static char *chars_dup(Run *r, const char *s, size_t n) {
+    if (r->nchars + n > sizeof(r->chars)) {
+        fail(r, "pasted and stringized tokens need more than %d bytes", CHARS);
+        return NULL;
+    }
+    char *p = memcpy(r->chars + r->nchars, s, n);
+    r->nchars += n;
+    return p;
+}
+
+static Run *run_new(CppResult *res) {
+    Run *r = tracked_calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    memset(r->tab.bucket, -1, sizeof(r->tab.bucket));
+    r->res = res;
+    res->ok = false;
+    res->text[0] = res->trace[0] = res->error[0] = '\0';
+    res->steps = 0;
+    res->truncated = false;
+    return r;
+}
+
+static void run_free(Run *r) {
+    for (int i = 0; i < r->nchunks; ++i) tracked_free(r->chunks[i]);
+    tracked_free(r->bodies);
+    tracked_free(r->source);
+    tracked_free(r);
+}
+
+/* ===== phases 2-3: splices and comments ===== */
+static char *clean(Run *r, const char *src) {
+    size_t n = strlen(src), len = 0;
+    char *buf = tracked_malloc(n + 1);
+    if (!buf) {
+        fail(r, "out of memory");
+        return NULL;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (src[i] == '\\' && src[i + 1] == '\n') { i++; continue; }
+        if (src[i] == '\\' && src[i + 1] == '\r' && src[i + 2] == '\n') { i += 2; continue; }
+        if (src[i] == '\r') continue;
+        buf[len++] = src[i];
+    }
+    buf[len] = '\0';
+
+    char *w = buf;
+    const char *p = buf;
+    while (*p) {
+        if (*p == '"' || *p == '\'') {
+            char quote = *p;
+            *w++ = *p++;
+            while (*p && *p != quote && *p != '\n') {
+                if (*p == '\\' && p[1] && p[1] != '\n') *w++ = *p++;
+                *w++ = *p++;
+            }
+            if (*p == quote) *w++ = *p++;
+        } else if (p[0] == '/' && p[1] == '*') {
+            const char *end = strstr(p + 2, "*/");
+            if (!end) {
+                fail(r, "unterminated comment");
+                tracked_free(buf);
+                return NULL;
+            }
+            *w++ = ' ';
+            p = end + 2;
+        } else if (p[0] == '/' && p[1] == '/') {
+            while (*p && *p != '\n') p++;
+            *w++ = ' ';
+        } else {
+            *w++ = *p++;
+        }
+    }
+    *w = '\0';
+    return buf;
+}
+
+/* The text's tokens, ending in a T_EOF for `file`. */
+static Tok *tokenize(Run *r, const char *text, int file) {
+    Tok *head = NULL, **tail = &head;
+    bool bol = true, space = false;
+    for (const char *p = text;;) {
+        if (*p == '\n') {
+            bol = true;
+            space = false;
+            p++;
+            continue;
+        }
+        if (*p == ' ' || *p == '\t' || *p == '\v' || *p == '\f') {
+            space = true;
+            p++;
+            continue;
+        }
+        Tok *t = tok_new(r);
+        if (!t) {
+            list_free(r, head);
+            return NULL;
+        }
+        *tail = t;
+        tail = &t->next;
+        if (!*p) {
+            t->kind = T_EOF;
+            t->flags = TF_BOL;
+            t->file = (int16_t)file;
+            return head;
+        }
+        t->s = p;
+        t->len = (uint32_t)lex_one(p, &t->kind);
+        t->flags = (uint8_t)((bol ? TF_BOL : 0) | (space ? TF_SPACE : 0));
+        p += t->len;
+        bol = space = false;
+    }
+}
+
+/* ===== output ===== */
+static void emit(Run *r, const Tok *t) {
+    if (r->build) {
+        fail(r, "the definitions may only hold directives, not \"%.*s\"", (int)t->len, t->s);
+        return;
+    }
+    CppResult *res = r->res;
+    char sep = 0;
+    if (r->out_len > 0) {
+        if (t->flags & TF_BOL) sep = '\n';
+        else if ((t->flags & TF_SPACE) || needs_space(&r->prev, t)) sep = ' ';
+    }
+    if (r->out_len + (sep != 0) + t->len >= sizeof(res->text)) {
+        fail(r, "the output is longer than %d bytes", CPP_OUT - 1);
+        return;
+    }
+    if (sep) res->text[r->out_len++] = sep;
+    memcpy(res->text + r->out_len, t->s, t->len);
+    r->out_len += t->len;
+    res->text[r->out_len] = '\0';
+    r->prev = *t;
+}
+
+/* ===== expansion ===== */
+static bool body_is(const BodyTok *b, const char *s) {
+    size_t n = strlen(s);
+    return b->kind == T_PUNCT && b->len == n && memcmp(b->s, s, n) == 0;
+}
+
+static Tok *body_tok(Run *r, const BodyTok *b) {
+    Tok *t = tok_new(r);
+    if (t) {
+        t->s = b->s;
+        t->len = b->len;
+        t->kind = b->kind;
+        t->flags = b->space ? TF_SPACE : 0;
+    }
+    return t;
+}
+
+/* #param: the argument's spelling as a string literal. */
+static Tok *stringize(Run *r, const Tok *arg) {
+    char buf[CPP_OUT];
+    size_t n = 0;
+    buf[n++] = '"';
+    for (const Tok *t = arg; t; t = t->next) {
+        if (t != arg && (t->flags & (TF_SPACE | TF_BOL))) buf[n++] = ' ';
+        bool literal = t->kind == T_STRING || t->kind == T_CHAR;
+        for (uint32_t i = 0; i < t->len; ++i) {
+            if (n + 4 > sizeof(buf)) {
+                fail(r, "a stringized argument is longer than %d bytes", CPP_OUT - 4);
+                return NULL;
+            }
+            if (literal && (t->s[i] == '"' || t->s[i] == '\\')) buf[n++] = '\\';
+            buf[n++] = t->s[i];
+        }
+    }
+    buf[n++] = '"';
+    char *s = chars_dup(r, buf, n);
+    Tok *t = s ? tok_new(r) : NULL;
+    if (t) {
+        t->s = s;
+        t->len = (uint32_t)n;
+        t->kind = T_STRING;
+    }
+    return t;
+}
+
+/* lhs ## rhs, into lhs. */
+static void paste(Run *r, Tok *lhs, const Tok *rhs) {
+    char buf[256];
+    size_t n = (size_t)lhs->len + rhs->len;
+    if (n >= sizeof(buf)) {
+        fail(r, "a pasted token is longer than %zu bytes", sizeof(buf) - 1);
+        return;
+    }
+    memcpy(buf, lhs->s, lhs->len);
+    memcpy(buf + lhs->len, rhs->s, rhs->len);
+    buf[n] = '\0';
+    uint8_t kind;
+    if (lex_one(buf, &kind) != n) {
+        fail(r, "pasting \"%.*s\" and \"%.*s\" does not give a valid preprocessing token",
+             (int)lhs->len, lhs->s, (int)rhs->len, rhs->s);
+        return;
+    }
+    trace(r, r->depth + 1, "%.*s ## %.*s -> %s", (int)lhs->len, lhs->s, (int)rhs->len, rhs->s, buf);
+    char *s = chars_dup(r, buf, n);
+    if (s) {
+        lhs->s = s;
+        lhs->len = (uint32_t)n;
+        lhs->kind = kind;
+        lhs->hide |= rhs->hide;
+    }
+}
+
+static Tok *expand_list(Run *r, Tok *list);
+
+/* The replacement list with # and ## applied and the arguments in place:
+ * fully expanded, except next to # or ##. */
+static Tok *subst(Run *r, const Macro *m, Tok *const *args) {
+    Tok *head = NULL, **tail = &head, *last = NULL;
+    Tok *expanded[CPP_PARAMS];
+    bool have[CPP_PARAMS] = { false };
+    bool placemarker = false;   /* the last thing added was an empty argument */
+
+    for (int i = 0; i < m->nbody && !r->failed; ++i) {
+        const BodyTok *b = &m->body[i];
+        Tok *add;
+        if (m->nparams >= 0 && body_is(b, "#")) {
+            int p = m->body[++i].param;
+            add = stringize(r, args[p]);
+            if (add) {
+                trace(r, r->depth + 1, "#%.*s -> %.*s", (int)m->params[p].len, m->params[p].s,
+                      (int)add->len, add->s);
+            }
+            placemarker = false;
+        } else if (body_is(b, "##")) {
+            const BodyTok *rb = &m->body[++i];
+            Tok *rhs = rb->param >= 0 ? list_dup(r, args[rb->param]) : body_tok(r, rb);
+            if (!rhs) continue;     /* an empty argument: nothing to paste */
+            if (placemarker || !last) {
+                add = rhs;
+                placemarker = false;
+            } else {
+                paste(r, last, rhs);
+                add = rhs->next;
+                tok_free(r, rhs);
+            }
+        } else if (b->param >= 0) {
+            int p = b->param;
+            if (i + 1 < m->nbody && body_is(&m->body[i + 1], "##")) {
+                add = list_dup(r, args[p]);
+                placemarker = !add;
+            } else {
+                if (!have[p]) {
+                    r->depth++;
+                    expanded[p] = expand_list(r, list_dup(r, args[p]));
+                    r->depth--;
+                    have[p] = true;
+                }
+                add = list_dup(r, expanded[p]);
+                placemarker = false;
+            }
+            if (add) add->flags = (uint8_t)((add->flags & ~(TF_SPACE | TF_BOL)) | (b->space ? TF_SPACE : 0));
+        } else {
+            add = body_tok(r, b);
+            placemarker = false;
+        }
+        if (!add) continue;
+        *tail = add;
+        while (add->next) add = add->next;
+        last = add;
+        tail = &add->next;
+    }
+    for (int p = 0; p < CPP_PARAMS; ++p) {
+        if (have[p]) list_free(r, expanded[p]);
+    }
+    return head;
+}
+
+/* Splits the arguments after `lp` into args[]; the ')' or NULL. */
+static Tok *read_args(Run *r, const Macro *m, Tok *lp, Tok **args) {
+    int want = m->nparams > 0 ? m->nparams : 1, n = 0, depth = 0;
+    Tok **tail = &args[0];
+    Tok *t = lp->next;
+    for (;;) {
+        if (!t || t->kind == T_EOF) {
+            fail(r, "unterminated argument list invoking %.*s", (int)m->nlen, m->name);
+            return NULL;
+        }
+        Tok *next = t->next;
+        if (depth == 0 && is(t, ")")) break;
+        if (depth == 0 && is(t, ",") && !(m->variadic && n == m->nparams - 1)) {
+            if (++n == want) {
+                fail(r, "%.*s takes %d argument%s, but was given more", (int)m->nlen, m->name,
+                     m->nparams, m->nparams == 1 ? "" : "s");
+                return NULL;
+            }
+            tail = &args[n];
+            tok_free(r, t);
+            t = next;
+            continue;
+        }
+        if (is(t, "(")) depth++;
+        else if (is(t, ")")) depth--;
+        t->next = NULL;
+        *tail = t;
+        tail = &t->next;
+        t = next;
+    }
+    if (m->nparams == 0 && args[0]) {
+        fail(r, "%.*s takes no arguments", (int)m->nlen, m->name);
+    } else if (n + 1 < m->nparams && !(m->variadic && n + 1 == m->nparams - 1)) {
+        fail(r, "%.*s takes %d arguments, but was given %d", (int)m->nlen, m->name, m->nparams, n + 1);
+    }
+    return r->failed ? NULL : t;
+}
+
+/* If *pt names a macro that may expand here, splices its replacement in
+ * at *pt for the caller to rescan. */
+static bool expand_macro(Run *r, Tok **pt) {
+    Tok *t = *pt;
+    int mi = find_macro(&r->tab, t->s, t->len);
+    if (mi < 0) return false;
+    const Macro *m = &r->tab.m[mi];
+    uint64_t bit = 1ull << mi;
+    if (t->hide & bit) {
+        if (!(t->flags & TF_NOTED)) {
+            t->flags |= TF_NOTED;
+            trace(r, r->depth, "%.*s stays: it came out of its own expansion", (int)t->len, t->s);
+        }
+        return false;
+    }
+
+    char call[160];
+    size_t n = 0;
+    Tok *args[CPP_PARAMS] = { NULL };
+    Tok *rest, *body;
+    uint64_t hide;
+    call[0] = '\0';
+    put(call, sizeof(call), &n, t->s, t->len);
+    if (m->nparams < 0) {
+        rest = t->next;
+        hide = t->hide | bit;
+        body = subst(r, m, args);
+    } else {
+        Tok *lp = t->next;
+        if (!lp || !is(lp, "(")) return false;      /* just the name */
+        Tok *rp = read_args(r, m, lp, args);
+        if (!rp) return false;
+        rest = rp->next;
+        hide = (t->hide & rp->hide) | bit;
+        put(call, sizeof(call), &n, "(", 1);
+        for (int i = 0; i < (m->nparams > 0 ? m->nparams : 1); ++i) {
+            char arg[96];
+            spell(arg, sizeof(arg), args[i], NULL);
+            if (i > 0) put(call, sizeof(call), &n, ",", 1);
+            if (i > 0 && args[i] && (args[i]->flags & (TF_SPACE | TF_BOL))) put(call, sizeof(call), &n, " ", 1);
+            put(call, sizeof(call), &n, arg, strlen(arg));
+        }
+        put(call, sizeof(call), &n, ")", 1);
+        body = subst(r, m, args);
+        for (int i = 0; i < CPP_PARAMS; ++i) list_free(r, args[i]);
+        tok_free(r, lp);
+        tok_free(r, rp);
+    }
+    if (r->failed) return false;
+
+    Tok *tail = NULL;
+    for (Tok *b = body; b; b = b->next) {
+        b->hide |= hide;
+        b->flags &= (uint8_t)~TF_BOL;
+        tail = b;
+    }
+    char shown[160];
+    spell(shown, sizeof(shown), body, NULL);
+    trace(r, r->depth, "%s -> %s", call, body ? shown : "(nothing)");
+
+    uint8_t lead = t->flags & (TF_SPACE | TF_BOL);
+    if (body) {
+        body->flags = (uint8_t)((body->flags & ~TF_SPACE) | lead);
+        tail->next = rest;
+        *pt = body;
+    } else {
+        *pt = rest;
+        if (rest && rest->kind != T_EOF && !(rest->flags & TF_BOL)) rest->flags |= lead;
+    }
+    tok_free(r, t);
+    return true;
+}
+
+/* Expands a detached list completely (an argument, an #if line). */
+static Tok *expand_list(Run *r, Tok *list) {
+    Tok **pt = &list;
+    while (*pt && !r->failed) {
+        if ((*pt)->kind == T_IDENT && expand_macro(r, pt)) continue;
+        pt = &(*pt)->next;
+    }
+    return list;
+}
+
+/* ===== #if expressions (intmax_t / uintmax_t) ===== */
+typedef struct {
+    uint64_t v;
+    bool u;                 /* unsigned */
+} PVal;
+
+typedef struct {
+    Run *r;
+    Tok *t;
+    int skip;               /* inside an unevaluated operand */
+} Pp;
+
+static PVal pp_comma(Pp *p);
+static PVal pp_cond(Pp *p);
+
+static int pp_escape(const char **pp) {
+    const char *p = *pp;
+    int v;
+    switch (*p) {
+        case 'n': v = '\n'; p++; break;
+        case 't': v = '\t'; p++; break;
+        case 'r': v = '\r'; p++; break;
+        case 'a': v = '\a'; p++; break;
+        case 'b': v = '\b'; p++; break;
+        case 'f': v = '\f'; p++; break;
+        case 'v': v = '\v'; p++; break;
+        case 'x':
+            for (v = 0, p++; isxdigit((unsigned char)*p); ++p) {
+                v = v * 16 + (isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10);
+            }
+            break;
+        default:
+            if (*p >= '0' && *p <= '7') {
+                v = 0;
+                for (int i = 0; i < 3 && *p >= '0' && *p <= '7'; ++i) v = v * 8 + (*p++ - '0');
+            } else {
+                v = (unsigned char)*p++;
+            }
+    }
+    *pp = p;
+    return v;
+}
+
+static PVal pp_char(Pp *p, const Tok *t) {
+    const char *s = t->s, *end = t->s + t->len - 1;
+    bool plain = *s == '\'';
+    while (*s != '\'') s++;
+    s++;
+    int64_t v = 0;
+    int n = 0;
+    while (s < end) {
+        int c = (unsigned char)*s++;
+        if (c == '\\') c = pp_escape(&s);
+        v = plain ? (v << 8) | (c & 0xff) : c;
+        n++;
+    }
+    if (n == 0) fail(p->r, "empty character constant in #if");
+    if (plain) v = n == 1 ? (signed char)v : (int32_t)v;
+    return (PVal){ (uint64_t)v, false };
+}
+
+static PVal pp_number(Pp *p, const Tok *t) {
+    PVal v = { 0, false };
+    const char *s = t->s, *end = t->s + t->len;
+    for (const char *q = s; q < end; ++q) {
+        bool hex = t->len > 1 && (s[1] == 'x' || s[1] == 'X');
+        if (*q == '.' || (!hex && (*q == 'e' || *q == 'E')) || (hex && (*q == 'p' || *q == 'P'))) {
+            fail(p->r, "floating constant \"%.*s\" in #if", (int)t->len, t->s);
+            return v;
+        }
+    }
+    int base = 10;
+    if (t->len > 1 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) base = 16, s += 2;
+    else if (t->len > 1 && s[0] == '0' && (s[1] == 'b' || s[1] == 'B')) base = 2, s += 2;
+    else if (s[0] == '0') base = 8;
+    const char *digits = s;
+    bool overflow = false;
+    for (; s < end; ++s) {
+        int d;
+        if (isdigit((unsigned char)*s)) d = *s - '0';
+        else if (base == 16 && isxdigit((unsigned char)*s)) d = tolower((unsigned char)*s) - 'a' + 10;
+        else break;
+        if (d >= base) {
+            fail(p->r, "invalid digit \"%c\" in %s constant", *s, base == 8 ? "octal" : "binary");
+            return v;
+        }
+        if (v.v > (UINT64_MAX - (uint64_t)d) / (uint64_t)base) overflow = true;
+        v.v = v.v * (uint64_t)base + (uint64_t)d;
+    }
+    int us = 0, ls = 0;
+    const char *suffix = s;
+    while (s < end) {
+        if (*s == 'u' || *s == 'U') us++, s++;
+        else if ((*s == 'l' || *s == 'L') && s + 1 < end && s[1] == *s) ls += 2, s += 2;
+        else if (*s == 'l' || *s == 'L') ls++, s++;
+        else break;
+    }
+    if (s == digits || s < end || us > 1 || ls > 2) {
+        fail(p->r, "invalid integer constant \"%.*s\" (suffix \"%.*s\")", (int)t->len, t->s,
+             (int)(end - suffix), suffix);
+    } else if (overflow) {
+        fail(p->r, "integer constant \"%.*s\" is too large", (int)t->len, t->s);
+    }
+    v.u = us > 0 || v.v > (uint64_t)INT64_MAX;
+    return v;
+}
+
+static PVal pp_unary(Pp *p) {
+    PVal v = { 0, false };
+    Tok *t = p->t;
+    if (!t) {
+        fail(p->r, "#if expression ends too soon");
+        return v;
+    }
+    p->t = t->next;
+    if (is(t, "(")) {
+        v = pp_comma(p);
+        if (!p->t || !is(p->t, ")")) fail(p->r, "missing ')' in #if expression");
+        else p->t = p->t->next;
+        return v;
+    }
+    if (is(t, "+")) return pp_unary(p);
+    if (is(t, "-")) {
+        v = pp_unary(p);
+        v.v = 0 - v.v;
+        return v;
+    }
+    if (is(t, "~")) {
+        v = pp_unary(p);
+        v.v = ~v.v;
+        return v;
+    }
+    if (is(t, "!")) {
+        v = pp_unary(p);
+        return (PVal){ v.v == 0, false };
+    }
+    if (t->kind == T_NUMBER) return pp_number(p, t);
+    if (t->kind == T_CHAR) return pp_char(p, t);
+    if (t->kind == T_IDENT) return v;       /* names left after expansion are 0 */
+    fail(p->r, "\"%.*s\" is not valid in #if", (int)t->len, t->s);
+    return v;
+}
+
+static int pp_prec(const Tok *t) {
+    static const struct { const char *op; int prec; } OPS[] = {
+        { "*", 10 }, { "/", 10 }, { "%", 10 }, { "+", 9 }, { "-", 9 }, { "<<", 8 }, { ">>", 8 },
+        { "<", 7 }, { ">", 7 }, { "<=", 7 }, { ">=", 7 }, { "==", 6 }, { "!=", 6 },
+        { "&", 5 }, { "^", 4 }, { "|", 3 }, { "&&", 2 }, { "||", 1 },
+    };
+    if (!t || t->kind != T_PUNCT) return 0;
+    for (size_t i = 0; i < sizeof(OPS) / sizeof(OPS[0]); ++i) {
+        if (is(t, OPS[i].op)) return OPS[i].prec;
+    }
+    return 0;
+}
+
+/* Shifts as cc does them: a negative count shifts the other way, and
+ * shifting out every bit leaves 0 (or -1 for a negative signed value). */
+static PVal pp_shift(PVal a, PVal b, bool left) {
+    uint64_t n = b.v;
+    if (!b.u && (int64_t)b.v < 0) {
+        left = !left;
+        n = 0 - b.v;
+    }
+    bool negative = !a.u && (int64_t)a.v < 0;
+    PVal r = { 0, a.u };
+    if (left) r.v = n >= 64 ? 0 : a.v << n;
+    else if (!negative) r.v = n >= 64 ? 0 : a.v >> n;
+    else r.v = n >= 64 ? UINT64_MAX : ~(~a.v >> n);
+    return r;
+}
+
+static PVal pp_apply(Pp *p, const Tok *op, PVal a, PVal b) {
+    bool u = a.u || b.u;
+    int64_t x = (int64_t)a.v, y = (int64_t)b.v;
+    PVal r = { 0, u };
+    if (is(op, "<<") || is(op, ">>")) return pp_shift(a, b, is(op, "<<"));
+    if (is(op, "*")) r.v = a.v * b.v;
+    else if (is(op, "/") || is(op, "%")) {
+        bool div = is(op, "/");
+        if (b.v == 0) {
+            if (!p->skip) fail(p->r, "division by zero in #if");
+        } else if (u) {
+            r.v = div ? a.v / b.v : a.v % b.v;
+        } else if (x == INT64_MIN && y == -1) {
+            r.v = div ? a.v : 0;            /* wraps, as cc's does */
+        } else {
+            r.v = (uint64_t)(div ? x / y : x % y);
+        }
+    }
+    else if (is(op, "+")) r.v = a.v + b.v;
+    else if (is(op, "-")) r.v = a.v - b.v;
+    else if (is(op, "&")) r.v = a.v & b.v;
+    else if (is(op, "^")) r.v = a.v ^ b.v;
+    else if (is(op, "|")) r.v = a.v | b.v;
+    else {
+        r.u = false;
+        if (is(op, "==")) r.v = a.v == b.v;
+        else if (is(op, "!=")) r.v = a.v != b.v;
+        else if (is(op, "<")) r.v = u ? a.v < b.v : x < y;
+        else if (is(op, ">")) r.v = u ? a.v > b.v : x > y;
+        else if (is(op, "<=")) r.v = u ? a.v <= b.v : x <= y;
+        else r.v = u ? a.v >= b.v : x >= y;
+    }
+    return r;
+}
+
+static PVal pp_binary(Pp *p, int min) {
+    PVal l = pp_unary(p);
+    for (;;) {
+        Tok *op = p->t;
+        int prec = pp_prec(op);
+        if (prec == 0 || prec < min || p->r->failed) return l;
+        p->t = op->next;
+        if (is(op, "&&") || is(op, "||")) {
+            bool and = is(op, "&&");
+            int decided = and ? l.v == 0 : l.v != 0;
+            p->skip += decided;
+            PVal rv = pp_binary(p, prec + 1);
+            p->skip -= decided;
+            l = (PVal){ and ? (l.v && rv.v) : (l.v || rv.v), false };
+        } else {
+            l = pp_apply(p, op, l, pp_binary(p, prec + 1));
+        }
+    }
+}
+
+static PVal pp_cond(Pp *p) {
+    PVal c = pp_binary(p, 1);
+    if (!p->t || !is(p->t, "?")) return c;
+    p->t = p->t->next;
+    p->skip += c.v == 0;
+    PVal a = pp_comma(p);
+    p->skip -= c.v == 0;
+    if (!p->t || !is(p->t, ":")) {
+        fail(p->r, "'?' without ':' in #if");
+        return c;
+    }
+    p->t = p->t->next;
+    p->skip += c.v != 0;
+    PVal b = pp_cond(p);
+    p->skip -= c.v != 0;
+    PVal v = c.v ? a : b;
+    v.u = a.u || b.u;
+    return v;
+}
+
+static PVal pp_comma(Pp *p) {
+    PVal v = pp_cond(p);
+    while (p->t && is(p->t, ",") && !p->r->failed) {
+        p->t = p->t->next;
+        v = pp_cond(p);
+    }
+    return v;
+}
+
+/* #if / #elif: `defined` first, then macros, then the arithmetic. */
+static bool eval_if(Run *r, const Tok *name, Tok *args, Tok *end) {
+    char before[96], after[96];
+    spell(before, sizeof(before), args, end);
+    Tok *head = NULL, **tail = &head;
+    for (Tok *t = args; t != end && !r->failed; t = t->next) {
+        Tok *c = tok_new(r);
+        if (!c) break;
+        if (is(t, "defined")) {
+            Tok *x = t->next;
+            bool paren = x != end && is(x, "(");
+            if (paren) x = x->next;
+            if (x == end || x->kind != T_IDENT) {
+                fail(r, "\"defined\" needs a macro name");
+                tok_free(r, c);
+                break;
+            }
+            if (paren && (x->next == end || !is(x->next, ")"))) {
+                fail(r, "missing ')' after \"defined\"");
+                tok_free(r, c);
+                break;
+            }
+            c->s = find_macro(&r->tab, x->s, x->len) >= 0 ? "1" : "0";
+            c->len = 1;
+            c->kind = T_NUMBER;
+            c->flags = t->flags;
+            t = paren ? x->next : x;
+        } else {
+            *c = *t;
+            c->next = NULL;
+        }
+        *tail = c;
+        tail = &c->next;
+    }
+    r->depth++;
+    head = expand_list(r, head);
+    r->depth--;
+    spell(after, sizeof(after), head, NULL);
+
+    Pp p = { r, head, 0 };
+    PVal v = { 0, false };
+    if (!r->failed && !head) {
+        fail(r, "#%.*s with no expression", (int)name->len, name->s);
+    } else if (!r->failed) {
+        v = pp_comma(&p);
+        if (!r->failed && p.t) {
+            fail(r, "missing binary operator before \"%.*s\" in #%.*s", (int)p.t->len, p.t->s,
+                 (int)name->len, name->s);
+        }
+    }
+    list_free(r, head);
+    if (!r->failed) {
+        char value[32];
+        if (v.u) snprintf(value, sizeof(value), "%lluu", (unsigned long long)v.v);
+        else snprintf(value, sizeof(value), "%lld", (long long)v.v);
+        if (strcmp(before, after) == 0) {
+            trace(r, 0, "#%.*s %s -> %s: group %s", (int)name->len, name->s, before, value,
+                  v.v ? "kept" : "skipped");
+        } else {
+            trace(r, 0, "#%.*s %s -> %s -> %s: group %s", (int)name->len, name->s, before, after,
+                  value, v.v ? "kept" : "skipped");
+        }
+    }
+    return v.v != 0;
+}
+
+/* ===== directives ===== */
+static Tok *line_end(Tok *t) {
+    while (!at_eol(t)) t = t->next;
+    return t;
+}
+
+/* The name of the directive t starts, or NULL. */
+static Tok *directive_name(Tok *t) {
+    if (!t || !(t->flags & TF_BOL) || t->hide || !is(t, "#")) return NULL;
+    Tok *n = t->next;
+    return !at_eol(n) && n->kind == T_IDENT ? n : NULL;
+}
+
+static bool same_definition(const Macro *a, const Macro *b, const BodyTok *toks) {
+    if (a->nparams != b->nparams || a->variadic != b->variadic || a->nbody != b->nbody) return false;
+    for (int i = 0; i < (a->nparams > 0 ? a->nparams : 0); ++i) {
+        const BodyTok *x = &a->params[i], *y = &toks[i];
+        if (x->len != y->len || memcmp(x->s, y->s, x->len) != 0) return false;
+    }
+    const BodyTok *body = toks + (b->nparams > 0 ? b->nparams : 0);
+    for (int i = 0; i < a->nbody; ++i) {
+        const BodyTok *x = &a->body[i], *y = &body[i];
+        if (x->len != y->len || x->space != y->space || memcmp(x->s, y->s, x->len) != 0) return false;
+    }
+    return true;
+}
+
+static void do_define(Run *r, Tok *t, Tok *end) {
+    if (t == end || t->kind != T_IDENT) {
+        fail(r, "#define needs a macro name");
+        return;
+    }
+    if (is(t, "defined")) {
+        fail(r, "\"defined\" cannot be a macro name");
+        return;
+    }
+    Macro m = { .name = t->s, .nlen = t->len, .nparams = -1 };
+    BodyTok toks[CPP_PARAMS + CPP_BODY];
+    int np = 0, nb = 0;
+    Tok *p = t->next;
+    if (p != end && is(p, "(") && !(p->flags & TF_SPACE)) {
+        p = p->next;
+        if (p != end && is(p, ")")) {
+            p = p->next;
+        } else {
+            for (;;) {
+                if (p == end) {
+                    fail(r, "missing ')' in the parameters of %.*s", (int)m.nlen, m.name);
+                    return;
+                }
+                if (np == CPP_PARAMS) {
+                    fail(r, "%.*s has more than %d parameters", (int)m.nlen, m.name, CPP_PARAMS);
+                    return;
+                }
+                if (is(p, "...")) {
+                    toks[np++] = (BodyTok){ "__VA_ARGS__", 11, T_IDENT, false, -1 };
+                    m.variadic = true;
+                    p = p->next;
+                    if (p == end || !is(p, ")")) {
+                        fail(r, "'...' must be the last parameter of %.*s", (int)m.nlen, m.name);
+                        return;
+                    }
+                    p = p->next;
+                    break;
+                }
+                if (p->kind != T_IDENT || is(p, "__VA_ARGS__")) {
+                    fail(r, "expected a parameter name in %.*s(...), not \"%.*s\"", (int)m.nlen, m.name,
+                         (int)p->len, p->s);
+                    return;
+                }
+                for (int i = 0; i < np; ++i) {
+                    if (toks[i].len == p->len && memcmp(toks[i].s, p->s, p->len) == 0) {
+                        fail(r, "duplicate parameter %.*s in %.*s", (int)p->len, p->s, (int)m.nlen, m.name);
+                        return;
+                    }
+                }
+                toks[np++] = (BodyTok){ p->s, p->len, T_IDENT, false, -1 };
+                p = p->next;
+                if (p != end && is(p, ",")) {
+                    p = p->next;
+                } else if (p != end && is(p, ")")) {
+                    p = p->next;
+                    break;
+                } else {
+                    fail(r, "expected ',' or ')' in the parameters of %.*s", (int)m.nlen, m.name);
+                    return;
+                }
+            }
+        }
+        m.nparams = (int8_t)np;
+    }
+
+    for (; p != end; p = p->next) {
+        if (nb == CPP_BODY) {
+            fail(r, "%.*s is longer than %d tokens", (int)m.nlen, m.name, CPP_BODY);
+            return;
+        }
+        BodyTok *b = &toks[np + nb];
+        *b = (BodyTok){ p->s, p->len, p->kind, nb > 0 && (p->flags & TF_SPACE), -1 };
+        nb++;
+        if (p->kind != T_IDENT) continue;
+        for (int i = 0; i < np; ++i) {
+            if (toks[i].len == p->len && memcmp(toks[i].s, p->s, p->len) == 0) b->param = (int8_t)i;
+        }
+    }
+    BodyTok *body = toks + np;
+    if (nb > 0 && (body_is(&body[0], "##") || body_is(&body[nb - 1], "##"))) {
+        fail(r, "'##' cannot be at either end of %.*s", (int)m.nlen, m.name);
+        return;
+    }
+    for (int i = 0; m.nparams >= 0 && i < nb; ++i) {
+        if (body_is(&body[i], "#") && (i + 1 == nb || body[i + 1].param < 0)) {
+            fail(r, "'#' is not followed by a parameter in %.*s", (int)m.nlen, m.name);
+            return;
+        }
+    }
+    m.nbody = (uint16_t)nb;
+
+    int old = find_macro(&r->tab, m.name, m.nlen);
+    if (old >= 0) {
+        if (same_definition(&r->tab.m[old], &m, toks)) return;
+        r->tab.m[old].dead = true;
+        trace(r, 0, "%.*s redefined", (int)m.nlen, m.name);
+    }
+    if (r->tab.n == CPP_MACROS) {
+        fail(r, "more than %d macro definitions", CPP_MACROS);
+        return;
+    }
+    if (!r->bodies) r->bodies = tracked_malloc(BODY_POOL * sizeof(BodyTok));
+    if (!r->bodies || r->nbodies + np + nb > BODY_POOL) {
+        fail(r, r->bodies ? "the macros are longer than %d tokens in all" : "out of memory", BODY_POOL);
+        return;
+    }
+    BodyTok *store = memcpy(r->bodies + r->nbodies, toks, (size_t)(np + nb) * sizeof(BodyTok));
+    r->nbodies += np + nb;
+    m.params = store;
+    m.body = store + np;
+    uint32_t h = name_hash(m.name, m.nlen) % BUCKETS;
+    m.next = r->tab.bucket[h];
+    r->tab.bucket[h] = (int8_t)r->tab.n;
+    r->tab.m[r->tab.n++] = m;
+}
+
+/* The header's tokens, spliced in front of `end`; NULL when it is not read. */
+static Tok *do_include(Run *r, Tok *args, Tok *end) {
+    char name[CPP_NAME];
+    size_t n = 0;
+    if (args != end && args->kind == T_STRING && args->s[0] == '"') {
+        n = args->len - 2;
+        if (n >= sizeof(name)) {
+            fail(r, "header name %.*s is too long", (int)args->len, args->s);
+            return NULL;
+        }
+        memcpy(name, args->s + 1, n);
+    } else if (args != end && is(args, "<")) {
+        for (Tok *t = args->next;; t = t->next) {
+            if (t == end) {
+                fail(r, "missing '>' in #include");
+                return NULL;
+            }
+            if (is(t, ">")) break;
+            if (n + t->len >= sizeof(name)) {
+                fail(r, "header name in #include <...> is too long");
+                return NULL;
+            }
+            memcpy(name + n, t->s, t->len);
+            n += t->len;
+        }
+    } else {
+        fail(r, "#include expects \"FILENAME\" or <FILENAME>");
+        return NULL;
+    }
+    name[n] = '\0';
+
+    int f = r->nfiles - 1;
+    while (f >= 0 && strcmp(r->files[f].name, name) != 0) f--;
+    if (f < 0) {
+        fail(r, "no header \"%s\" in this task", name);
+        return NULL;
+    }
+    const CppFile *file = &r->files[f];
+    if (r->once & (1ull << f)) {
+        trace(r, 0, "#include \"%s\": skipped, it said #pragma once", name);
+        return NULL;
+    }
+    if (file->guard[0] && find_macro(&r->tab, file->guard, strlen(file->guard)) >= 0) {
+        trace(r, 0, "#include \"%s\": skipped, its guard %s is defined", name, file->guard);
+        return NULL;
+    }
+    if (r->ninc == CPP_INCLUDE) {
+        fail(r, "#include nested more than %d deep", CPP_INCLUDE);
+        return NULL;
+    }
+    Tok *list = tokenize(r, file->text, f);
+    if (!list) return NULL;
+    r->inc_cond[r->ninc] = r->ncond;
+    r->inc_file[r->ninc++] = f;
+    trace(r, 0, "#include \"%s\"", name);
+    Tok *eof = list;
+    while (eof->kind != T_EOF) eof = eof->next;
+    eof->next = end;
+    return list;
+}
+
+/* Drops tokens up to the next #elif / #else / #endif of this #if (its
+ * '#' is returned) or the end of the file. */
+static Tok *skip_group(Run *r, Tok *t) {
+    int depth = 0;
+    while (t && t->kind != T_EOF) {
+        Tok *d = directive_name(t);
+        if (d && (is(d, "if") || is(d, "ifdef") || is(d, "ifndef"))) {
+            depth++;
+        } else if (d && is(d, "endif")) {
+            if (depth-- == 0) return t;
+        } else if (d && depth == 0 && (is(d, "elif") || is(d, "else"))) {
+            return t;
+        }
+        Tok *next = t->next;
+        tok_free(r, t);
+        t = next;
+    }
+    return t;
+}
+
+static Tok *conditional(Run *r, Tok *name, Tok *args, Tok *end) {
+    bool ifdef = is(name, "ifdef"), ifndef = is(name, "ifndef");
+    if (is(name, "if") || ifdef || ifndef) {
+        bool keep;
+        if (ifdef || ifndef) {
+            if (args == end || args->kind != T_IDENT) {
+                fail(r, "#%.*s needs a macro name", (int)name->len, name->s);
+                return drop(r, name, end);
+            }
+            bool defined = find_macro(&r->tab, args->s, args->len) >= 0;
+            keep = defined == ifdef;
+            trace(r, 0, "#%.*s %.*s: %s, group %s", (int)name->len, name->s, (int)args->len, args->s,
+                  defined ? "defined" : "not defined", keep ? "kept" : "skipped");
+        } else {
+            keep = eval_if(r, name, args, end);
+        }
+        if (r->ncond == CPP_NEST) {
+            fail(r, "#if nested more than %d deep", CPP_NEST);
+            return drop(r, name, end);
+        }
+        r->cond[r->ncond++] = (Cond){ keep, false };
+        drop(r, name, end);
+        return keep ? end : skip_group(r, end);
+    }
+
+    int base = r->ninc ? r->inc_cond[r->ninc - 1] : 0;
+    if (r->ncond == base) {
+        fail(r, "#%.*s without #if", (int)name->len, name->s);
+        return drop(r, name, end);
+    }
+    Cond *c = &r->cond[r->ncond - 1];
+    if (is(name, "endif")) {
+        r->ncond--;
+        return drop(r, name, end);
+    }
+    if (c->in_else) {
+        fail(r, "#%.*s after #else", (int)name->len, name->s);
+        return drop(r, name, end);
+    }
+    bool keep = false;
+    if (is(name, "else")) {
+        c->in_else = true;
+        keep = !c->taken;
+    } else if (!c->taken) {
+        keep = eval_if(r, name, args, end);
+    }
+    c->taken = c->taken || keep;
+    drop(r, name, end);
+    return keep ? end : skip_group(r, end);
+}
+
+/* One directive line starting at `hash`; where processing goes on. */
+static Tok *directive(Run *r, Tok *hash) {
+    Tok *name = hash->next;
+    tok_free(r, hash);
+    if (at_eol(name)) return name;                  /* the null directive */
+    Tok *args = name->next, *end = line_end(args);
+
+    if (is(name, "define")) {
+        do_define(r, args, end);
+    } else if (is(name, "undef")) {
+        if (args == end || args->kind != T_IDENT) fail(r, "#undef needs a macro name");
+        int i = r->failed ? -1 : find_macro(&r->tab, args->s, args->len);
+        if (i >= 0) r->tab.m[i].dead = true;
+    } else if (is(name, "include")) {
+        Tok *header = do_include(r, args, end);
+        drop(r, name, end);
+        return header ? header : end;
+    } else if (is(name, "if") || is(name, "ifdef") || is(name, "ifndef") || is(name, "elif") ||
+               is(name, "else") || is(name, "endif")) {
+        return conditional(r, name, args, end);
+    } else if (is(name, "error")) {
+        char text[96];
+        spell(text, sizeof(text), args, end);
+        fail(r, "#error %s", text);
+    } else if (is(name, "pragma")) {
+        if (args != end && is(args, "once") && r->ninc > 0) r->once |= 1ull << r->inc_file[r->ninc - 1];
+    } else if (!is(name, "line") && !is(name, "warning")) {
+        fail(r, "unknown directive #%.*s", (int)name->len, name->s);
+    }
+    return drop(r, name, end);
+}
+
+static Tok *end_of_file(Run *r, Tok *eof) {
+    int base = 0;
+    const char *name = "";
+    if (eof->file >= 0 && r->ninc > 0) {
+        base = r->inc_cond[--r->ninc];
+        name = r->files[eof->file].name;
+    }
+    if (r->ncond > base) fail(r, "unterminated #if%s%s", *name ? " in " : "", name);
+    Tok *next = eof->next;
+    tok_free(r, eof);
+    return next;
+}
+
+static void process(Run *r, Tok *t) {
+    while (t && !r->failed) {
+        if (t->kind == T_EOF) {
+            t = end_of_file(r, t);
+        } else if ((t->flags & TF_BOL) && !t->hide && is(t, "#")) {
+            t = directive(r, t);
+        } else if (t->kind != T_IDENT || !expand_macro(r, &t)) {
+            emit(r, t);
+            Tok *next = t->next;
+            tok_free(r, t);
+            t = next;
+        }
+    }
+}
+
+/* ===== macro sets ===== */
+#define FNV64_INIT 14695981039346656037ull
+
+static uint64_t fnv64(uint64_t h, const void *p, size_t n) {
+    const unsigned char *s = p;
+    while (n--) {
+        h ^= *s++;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* Order-independent: a sum over the live macros and the headers. */
+static uint64_t set_hash(const CppMacros *m) {
+    uint64_t h = mix64(m ? m->once ^ 0x6f6e6365u : 0x6f6e6365u);
+    for (int i = 0; m && i < m->tab.n; ++i) {
+        const Macro *mac = &m->tab.m[i];
+        if (mac->dead) continue;
+        uint64_t x = fnv64(FNV64_INIT, mac->name, mac->nlen);
+        x = fnv64(x, &mac->nparams, 1);
+        x = fnv64(x, &mac->variadic, 1);
+        for (int k = 0; k < mac->nbody; ++k) {
+            const BodyTok *b = &mac->body[k];
+            x = fnv64(x, b->s, b->len);
+            x = fnv64(x, &b->space, 1);
+            x = fnv64(x, &b->param, 1);
+        }
+        h += mix64(x);
+    }
+    for (int f = 0; m && f < m->nfiles; ++f) {
+        uint64_t x = fnv64(FNV64_INIT, m->files[f].name, strlen(m->files[f].name) + 1);
+        h += mix64(fnv64(x, m->files[f].text, strlen(m->files[f].text)) + 1);
+    }
+    return h;
+}
+
+bool cpp_is_header(const char *entry) {
+    return entry && entry[0] == '/' && entry[1] == '/' && strchr(entry, '\n');
+}
+
+static void detect_guard(Run *r, CppFile *file, int f) {
+    Tok *list = tokenize(r, file->text, f);
+    Tok *d = directive_name(list);
+    Tok *x = d && is(d, "ifndef") ? d->next : NULL;
+    if (!at_eol(x) && x->kind == T_IDENT && at_eol(x->next) && x->len < CPP_NAME) {
+        int depth = 0;
+        for (Tok *t = x->next; t && t->kind != T_EOF; t = t->next) {
+            Tok *dn = directive_name(t);
+            if (!dn) continue;
+            if (is(dn, "if") || is(dn, "ifdef") || is(dn, "ifndef")) {
+                depth++;
+            } else if (depth == 0 && (is(dn, "else") || is(dn, "elif"))) {
+                break;
+            } else if (is(dn, "endif") && depth-- == 0) {
+                if (line_end(dn->next)->kind == T_EOF) {
+                    memcpy(file->guard, x->s, x->len);
+                    file->guard[x->len] = '\0';
+                }
+                break;
+            }
+        }
+    }
+    list_free(r, list);
+}
+
+static void add_header(Run *r, CppMacros *m, const char *entry) {
+    const char *name = entry + 2, *nl = strchr(entry, '\n');
+    while (name < nl && isspace((unsigned char)*name)) name++;
+    size_t len = (size_t)(nl - name);
+    while (len > 0 && isspace((unsigned char)name[len - 1])) len--;
+    if (len == 0 || len >= CPP_NAME) {
+        fail(r, "a header needs a name of 1 to %d characters after \"//\"", CPP_NAME - 1);
+        return;
+    }
+    if (m->nfiles == CPP_FILES) {
+        fail(r, "more than %d headers", CPP_FILES);
+        return;
+    }
+    CppFile *file = &m->files[m->nfiles];
+    memcpy(file->name, name, len);
+    file->name[len] = '\0';
+    file->text = clean(r, nl + 1);
+    if (file->text) detect_guard(r, file, m->nfiles++);
+}
+
+CppMacros *cpp_macros_new(const char *const *lines, char *err, size_t errcap) {
+    CppMacros *m = tracked_calloc(1, sizeof(*m));
+    CppResult *res = tracked_malloc(sizeof(*res));
+    Run *r = res ? run_new(res) : NULL;
+    char *src = NULL;
+    if (!m || !r) {
+        snprintf(err, errcap, "out of memory");
+        tracked_free(m);
+        tracked_free(res);
+        if (r) run_free(r);
+        return NULL;
+    }
+    r->build = m;
+    r->files = m->files;
+
+    size_t total = 1;
+    for (int i = 0; lines && lines[i]; ++i) {
+        if (cpp_is_header(lines[i])) add_header(r, m, lines[i]);
+        else total += strlen(lines[i]) + 1;
+    }
+    r->nfiles = m->nfiles;
+    if (!r->failed && (src = tracked_malloc(total)) == NULL) fail(r, "out of memory");
+    if (!r->failed) {
+        size_t n = 0;
+        for (int i = 0; lines && lines[i]; ++i) {
+            if (cpp_is_header(lines[i])) continue;
+            size_t len = strlen(lines[i]);
+            memcpy(src + n, lines[i], len);
+            n += len;
+            src[n++] = '\n';
+        }
+        src[n] = '\0';
+        r->source = clean(r, src);
+    }
+    tracked_free(src);
+    if (r->source) {
+        Tok *list = tokenize(r, r->source, -1);
+        if (list) process(r, list);
+    }
+
+    if (r->failed) {
+        snprintf(err, errcap, "%s", res->error);
+        cpp_macros_free(m);
+        m = NULL;
+    } else {
+        m->tab = r->tab;
+        m->once = r->once;
+        m->source = r->source;
+        m->bodies = r->bodies;
+        r->source = NULL;
+        r->bodies = NULL;
+        m->hash = set_hash(m);
+    }
+    run_free(r);
+    tracked_free(res);
+    return m;
+}
+
+void cpp_macros_free(CppMacros *m) {
+    if (!m) return;
+    for (int f = 0; f < m->nfiles; ++f) tracked_free(m->files[f].text);
+    tracked_free(m->source);
+    tracked_free(m->bodies);
+    tracked_free(m);
+}
+
+uint64_t cpp_macros_hash(const CppMacros *m) {
+    return m ? m->hash : set_hash(NULL);
+}
+
+bool cpp_run(const CppMacros *m, const char *src, CppResult *res) {
+    Run *r = run_new(res);
+    if (!r) {
+        snprintf(res->error, sizeof(res->error), "out of memory");
+        return false;
+    }
+    if (m) {
+        r->tab.n = m->tab.n;
+        memcpy(r->tab.m, m->tab.m, (size_t)m->tab.n * sizeof(Macro));
+        memcpy(r->tab.bucket, m->tab.bucket, sizeof(r->tab.bucket));
+        r->once = m->once;
+        r->files = m->files;
+        r->nfiles = m->nfiles;
+    }
+    r->source = clean(r, src);
+    Tok *list = r->source ? tokenize(r, r->source, -1) : NULL;
+    if (list) process(r, list);
+    res->ok = !r->failed;
+    if (!res->ok) res->text[0] = '\0';
+    run_free(r);
+    return res->ok;
+}
+
+/* ===== memo ===== */
+typedef struct {
+    uint64_t set, key;
+    char *src;
+    CppResult res;
+} MemoEntry;
+
+static struct {
+    pthread_mutex_t lock;
+    MemoEntry *slot[CPP_MEMO_SLOTS];
+    uint64_t hits, misses;
+    uint32_t entries;
+} MEMO = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+bool cpp_expand(const CppMacros *m, const char *src, CppResult *r) {
+    size_t len = strlen(src);
+    uint64_t set = cpp_macros_hash(m), key = fnv64(FNV64_INIT, src, len);
+    size_t i = (size_t)(mix64(set ^ key) % CPP_MEMO_SLOTS);
+
+    pthread_mutex_lock(&MEMO.lock);
+    MemoEntry *e = MEMO.slot[i];
+    if (e && e->set == set && e->key == key && strcmp(e->src, src) == 0) {
+        memcpy(r, &e->res, sizeof(*r));
+        MEMO.hits++;
+        pthread_mutex_unlock(&MEMO.lock);
+        return r->ok;
+    }
+    MEMO.misses++;
+    pthread_mutex_unlock(&MEMO.lock);
+
+    cpp_run(m, src, r);
+    e = tracked_malloc(sizeof(*e) + len + 1);
+    if (!e) return r->ok;                   /* just not remembered */
+    e->set = set;
+    e->key = key;
+    e->src = memcpy((char *)(e + 1), src, len + 1);
+    memcpy(&e->res, r, sizeof(*r));
+
+    pthread_mutex_lock(&MEMO.lock);
+    MemoEntry *old = MEMO.slot[i];
+    MEMO.slot[i] = e;
+    if (!old) MEMO.entries++;
+    pthread_mutex_unlock(&MEMO.lock);
+    tracked_free(old);
+    return r->ok;
+}
+
+CppMemoStats cpp_memo_stats(void) {
+    pthread_mutex_lock(&MEMO.lock);
+    CppMemoStats st = { MEMO.hits, MEMO.misses, MEMO.entries };
+    pthread_mutex_unlock(&MEMO.lock);
+    return st;
+}
+
+void cpp_memo_clear(void) {
+    pthread_mutex_lock(&MEMO.lock);
+    for (size_t i = 0; i < CPP_MEMO_SLOTS; ++i) {
+        tracked_free(MEMO.slot[i]);
+        MEMO.slot[i] = NULL;
+    }
+    MEMO.entries = 0;
+    pthread_mutex_unlock(&MEMO.lock);
+}
+
+bool cpp_same_tokens(const char *a, const char *b, int *same) {
+    static const char WS[] = " \t\r\n\v\f";
+    int n = 0;
+    for (;;) {
+        a += strspn(a, WS);
+        b += strspn(b, WS);
+        if (!*a || !*b) {
+            if (same) *same = n;
+            return !*a && !*b;
+        }
+        uint8_t ka, kb;
+        size_t la = lex_one(a, &ka), lb = lex_one(b, &kb);
+        if (la != lb || memcmp(a, b, la) != 0) {
+            if (same) *same = n;
+            return false;
+        }
+        a += la;
+        b += lb;
+        n++;
+    }
+}
+
+/* ===== per-bank table ===== */
+struct CppTable {
+    int count;
+    CppTask **tasks;
+};
+
+static CppTask *task_build(const Task *t) {
+    CppTask *x = tracked_calloc(1, sizeof(*x));
+    if (!x) return NULL;
+    char err[CPP_ERR];
+    x->macros = cpp_macros_new(t->options, err, sizeof(err));
+    if (!x->macros) {
+        snprintf(x->error, sizeof(x->error), "%s", err);
+    } else if (!t->answers || !t->answers[0]) {
+        snprintf(x->error, sizeof(x->error), "no line to expand");
+    } else if (!cpp_expand(x->macros, t->answers[0], &x->ref)) {
+        snprintf(x->error, sizeof(x->error), "the task's line: %s", x->ref.error);
+    }
+    return x;
+}
+
+CppTable *cpp_table_build(const Task *tasks, int count) {
+    CppTable *tab = tracked_calloc(1, sizeof(*tab));
+    if (!tab) return NULL;
+    tab->count = count;
+    tab->tasks = tracked_calloc(count > 0 ? (size_t)count : 1, sizeof(CppTask *));
+    if (!tab->tasks) {
+        cpp_table_free(tab);
+        return NULL;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (tasks[i].type != TASK_MACRO) continue;
+        tab->tasks[i] = task_build(&tasks[i]);
+        if (!tab->tasks[i]) {
+            cpp_table_free(tab);
+            return NULL;
+        }
+    }
+    return tab;
+}
+
+void cpp_table_free(CppTable *tab) {
+    if (!tab) return;
+    for (int i = 0; tab->tasks && i < tab->count; ++i) {
+        if (tab->tasks[i]) cpp_macros_free(tab->tasks[i]->macros);
+        tracked_free(tab->tasks[i]);
+    }
+    tracked_free(tab->tasks);
+    tracked_free(tab);
+}
+
+const CppTask *cpp_table_task(const CppTable *tab, int task) {
+    if (!tab || task < 0 || task >= tab->count) return NULL;
+    return tab->tasks[task];
+}
@@ -1,293 +1,753 @@
+#include <stdarg.h>
+
 #include "common.h"
 #include "engine.h"
+#include "answers.h"
+#include "cexpr.h"
+#include "cpp.h"
+#include "sandbox.h"
+#include "stats.h"
+#include "ui.h"
+#include "tracker.h"
+
+#define EXPECTED_SHOWN 5     /* answers listed after the second miss */
+
+struct EngineSession {
+    int station_id;
+    const Task *tasks;
+    int task_count;
+    const AnswerIndex *answers;
+    AnswerIndex *owned_index;   /* set when not borrowed from a TaskBank */
+    const CexprTable *exprs;
+    CexprTable *owned_exprs;
+    const CppTable *macros;
+    CppTable *owned_macros;
+
+    /* current task */
+    int first;                  /* where engine_start() begins */
+    bool single;                /* stop after that one task (review mode) */
+    int index;
+    int attempts;
+    int hints;                  /* hint requests, for stats */
+    bool hint_used;
+    bool format_hint_shown;
+    char *code;                 /* TASK_CODE lines so far (SANDBOX_CODE_MAX) */
+    size_t code_len;
+    bool code_overflow;         /* past SANDBOX_CODE_MAX: swallow until "." */
+    bool code_midline;          /* the last chunk stopped short of its EOL */
+    void *grade_ctx;            /* engine_grade_async(); NULL = grade inline */
+    SandboxJob *job;            /* submission out for grading */
+
+    bool aborted;
+    bool done;
+    uint64_t shown_ns;          /* when the last reply was built */
+    EngineGrade last_grade;     /* of the last fed line */
+    int last_task;
+    StationResult result;
+};
+
+static EngineStatus begin_task(EngineSession *s, EngineOut *out);
+static EngineStatus finish_task(EngineSession *s, EngineOut *out);
+static EngineStatus finish_station(EngineSession *s, EngineOut *out);
+static EngineStatus feed_line(EngineSession *s, const char *line, EngineOut *out);
+static EngineStatus code_line(EngineSession *s, const Task *t, const char *line, EngineOut *out);
+static EngineStatus code_verdict(EngineSession *s, const Task *t, const SandboxResult *r,
+                                 EngineOut *out);
+static EngineStatus expr_line(EngineSession *s, const Task *t, const char *line, EngineOut *out);
+static EngineStatus macro_line(EngineSession *s, const Task *t, const char *line, EngineOut *out);
+static EngineStatus judge(EngineSession *s, const Task *t, bool correct, EngineOut *out);
+static void show_prompt(const Task *t, EngineOut *out);
+static void explain(const EngineSession *s, const Task *t, EngineOut *out);
+static void print_why(const char *why, EngineOut *out);
+static int option_count(const Task *t);
 
-#define MAX_OPTIONS 5
+/* ===== output buffer ===== */
+void engine_out_init(EngineOut *out, char *storage, size_t cap) {
+    out->data = storage;
+    out->cap = cap;
+    out->spill = NULL;
+    out->ctx = NULL;
+    engine_out_reset(out);
+}
 
-static bool g_abort_station = false;
+void engine_out_reset(EngineOut *out) {
+    out->len = 0;
+    out->truncated = false;
+    if (out->cap > 0) {
+        out->data[0] = '\0';
+    }
+}
 
-static void run_task(const Task *t, StationResult *res);
-static void read_input(char *buf, size_t size);
-static bool match_answer(const Task *t, const char *input);
-static void print_why(const char *why);
-static bool equals_ignore_case(const char *a, const char *b);
-static int option_count(const Task *t);
+void engine_out_vprintf(EngineOut *out, const char *fmt, va_list ap) {
+    if (!out || out->cap == 0) {
+        return;
+    }
+    for (int pass = 0; pass < 2; ++pass) {
+        size_t room = out->cap - out->len;
+        va_list aq;
+        va_copy(aq, ap);
+        int n = vsnprintf(out->data + out->len, room, fmt, aq);
+        va_end(aq);
+
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < room) {
+            out->len += (size_t)n;
+            return;
+        }
+        /* did not fit: cut the partial write, ship the rest, retry once */
+        out->data[out->len] = '\0';
+        if (pass == 0 && out->len > 0 && out->spill && out->spill(out)) {
+            out->len = 0;
+            out->data[0] = '\0';
+        } else {
+            out->len = out->cap - 1;
+            out->truncated = true;
+            return;
+        }
+    }
+}
+
+void engine_out_printf(EngineOut *out, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    engine_out_vprintf(out, fmt, ap);
+    va_end(ap);
+}
+
+void engine_out_puts(EngineOut *out, const char *s) {
+    engine_out_printf(out, "%s\n", s);
+}
 
+/* ===== stdin front end ===== */
 StationResult run_station(int station_id, const Task *tasks, int task_count) {
     StationResult result = {station_id, 0, 0, 0, 0};
+    char line[MAX_INPUT];
+    EngineOut *out = ui_frame();
 
-    if (!tasks || task_count <= 0) {
-        puts("No tasks configured for this station yet.");
+    EngineSession *s = engine_begin(station_id, tasks, task_count);
+    if (!s) {
+        ui_puts("Out of memory; cannot start station.");
         return result;
     }
 
-    g_abort_station = false;
-
-    for (int i = 0; i < task_count; ++i) {
-        if (g_abort_station) {
+    EngineStatus st = engine_start(s, out);
+    for (;;) {
+        ui_flush();
+        if (st == ENGINE_STATION_DONE) {
             break;
         }
+        if (fgets(line, sizeof(line), stdin)) {
+            st = engine_feed(s, line, out);
+        } else {
+            st = engine_close(s, out);
+        }
+    }
 
-        printf("\n" C_BOLD "Task %d/%d" C_RESET "\n", i + 1, task_count);
-        run_task(&tasks[i], &result);
+    result = engine_result(s);
+    engine_end(s);
+    return result;
+}
 
-        if (!g_abort_station) {
-            result.total_tasks++;
-        }
+/* ===== session API ===== */
+bool task_bank_prepare(TaskBank *bank) {
+    if (!bank->tasks || bank->count <= 0) {
+        return true;
+    }
+    if (!bank->index) {
+        bank->index = answer_index_build(bank->tasks, bank->count);
+    }
+    if (!bank->exprs) {
+        bank->exprs = cexpr_table_build(bank->tasks, bank->count);
     }
+    if (!bank->macros) {
+        bank->macros = cpp_table_build(bank->tasks, bank->count);
+    }
+    return bank->index && bank->exprs && bank->macros;
+}
 
-    int max_points = result.total_tasks * 2;
-    int total_correct = result.correct_first_try + result.correct_with_hint;
+void task_bank_release(TaskBank *bank) {
+    answer_index_free(bank->index);
+    bank->index = NULL;
+    cexpr_table_free(bank->exprs);
+    bank->exprs = NULL;
+    cpp_table_free(bank->macros);
+    bank->macros = NULL;
+}
 
-    printf("\nStation %02d Summary:\n", station_id);
-    printf("Tasks: %d | Correct: %d | With Hint: %d | Points: %d/%d\n",
-           result.total_tasks, total_correct, result.correct_with_hint,
-           result.total_points, max_points);
+static EngineSession *session_new(int station_id, const Task *tasks, int task_count) {
+    EngineSession *s = tracked_calloc(1, sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    s->station_id = station_id;
+    s->tasks = tasks;
+    s->task_count = tasks ? task_count : 0;
+    s->result.station_id = station_id;
+    return s;
+}
 
-    if (g_abort_station) {
-        puts(C_DIM "Station exited early; progress saved." C_RESET);
+EngineSession *engine_begin(int station_id, const Task *tasks, int task_count) {
+    EngineSession *s = session_new(station_id, tasks, task_count);
+    if (s && s->task_count > 0) {
+        s->owned_index = answer_index_build(tasks, task_count);
+        s->owned_exprs = cexpr_table_build(tasks, task_count);
+        s->owned_macros = cpp_table_build(tasks, task_count);
+        if (!s->owned_index || !s->owned_exprs || !s->owned_macros) {
+            engine_end(s);
+            return NULL;
+        }
+        s->answers = s->owned_index;
+        s->exprs = s->owned_exprs;
+        s->macros = s->owned_macros;
     }
+    return s;
+}
 
-    return result;
+EngineSession *engine_begin_bank(int station_id, TaskBank *bank) {
+    if (!task_bank_prepare(bank)) {
+        return NULL;
+    }
+    EngineSession *s = session_new(station_id, bank->tasks, bank->count);
+    if (s) {
+        s->answers = bank->index;
+        s->exprs = bank->exprs;
+        s->macros = bank->macros;
+    }
+    return s;
 }
 
-static void run_task(const Task *t, StationResult *res) {
-    if (!t || !res) {
-        return;
+EngineSession *engine_begin_task(int station_id, TaskBank *bank, int task) {
+    if (task < 0 || task >= bank->count) {
+        return NULL;
+    }
+    EngineSession *s = engine_begin_bank(station_id, bank);
+    if (s) {
+        s->first = task;
+        s->single = true;
     }
+    return s;
+}
 
-    bool hint_used = false;
-    bool format_hint_shown = false;
-    int attempts = 0;
-    bool need_prompt = true;
-    char input[MAX_INPUT];
+void engine_end(EngineSession *s) {
+    if (s) {
+        answer_index_free(s->owned_index);
+        cexpr_table_free(s->owned_exprs);
+        cpp_table_free(s->owned_macros);
+        tracked_free(s->code);
+        sandbox_cancel(s->job);
+    }
+    tracked_free(s);
+}
 
-    while (!g_abort_station) {
-        if (need_prompt) {
-            printf("%s\n", t->prompt ? t->prompt : "(no prompt)");
-            if (t->type == TASK_QUIZ) {
-                int count = option_count(t);
-                for (int i = 0; i < count; ++i) {
-                    if (t->options[i]) {
-                        printf("  %d) %s\n", i + 1, t->options[i]);
-                    }
-                }
-            }
-            need_prompt = false;
-        }
+bool engine_done(const EngineSession *s) {
+    return !s || s->done;
+}
 
-        printf("> ");
-        fflush(stdout);
-        read_input(input, sizeof(input));
+EngineGrade engine_last_grade(const EngineSession *s, int *task) {
+    *task = s->last_task;
+    return s->last_grade;
+}
 
-        if (g_abort_station) {
-            return;
-        }
+StationResult engine_result(const EngineSession *s) {
+    return s->result;
+}
 
-        if (input[0] == '\0') {
-            puts("Please enter a response or type 'hint', 'skip', or 'exit'.");
-            need_prompt = true;
-            continue;
-        }
+EngineStatus engine_start(EngineSession *s, EngineOut *out) {
+    if (s->task_count <= 0) {
+        engine_out_puts(out, "No tasks configured for this station yet.");
+        s->done = true;
+        return ENGINE_STATION_DONE;
+    }
+    s->index = s->first;
+    EngineStatus st = begin_task(s, out);
+    s->shown_ns = stats_now_ns();
+    return st;
+}
 
-        if (strcmp(input, "hint") == 0) {
-            if (t->hint && t->hint[0] != '\0') {
-                puts(t->hint);
-                hint_used = true;
-            } else {
-                puts("No hint available for this task.");
-            }
-            need_prompt = true;
-            continue;
-        }
+EngineStatus engine_close(EngineSession *s, EngineOut *out) {
+    if (s->done) {
+        return ENGINE_STATION_DONE;
+    }
+    sandbox_cancel(s->job);
+    s->job = NULL;
+    engine_out_puts(out, "Input closed. Exiting station...");
+    s->aborted = true;
+    return finish_station(s, out);
+}
 
-        if (strcmp(input, "why") == 0) {
-            puts("Answer or skip first, then I'll explain why.");
-            need_prompt = true;
-            continue;
-        }
+/* Times the learner (since the last reply) and the engine (this line). */
+EngineStatus engine_feed(EngineSession *s, const char *line, EngineOut *out) {
+    if (s->done) {
+        return ENGINE_STATION_DONE;
+    }
+    if (s->job) {
+        return ENGINE_GRADING;
+    }
+    const int task = s->index;
+    s->last_grade = GRADE_NONE;
+    s->last_task = task;
+    uint64_t t0 = stats_now_ns();
+    stats_record(s->station_id, task, STAT_THINK_US, (t0 - s->shown_ns) / 1000);
 
-        if (strcmp(input, "skip") == 0) {
-            puts("Task skipped.");
-            print_why(t->why);
-            return;
-        }
+    EngineStatus st = feed_line(s, line, out);
 
-        if (strcmp(input, "exit") == 0) {
-            g_abort_station = true;
-            puts("Exiting station...");
-            return;
-        }
+    s->shown_ns = stats_now_ns();
+    stats_record(s->station_id, task, STAT_ENGINE_NS, s->shown_ns - t0);
+    return st;
+}
 
-        bool valid_answer = true;
-        bool correct = false;
+void engine_grade_async(EngineSession *s, void *ctx) {
+    s->grade_ctx = ctx;
+}
 
-        if (t->type == TASK_QUIZ) {
-            int count = option_count(t);
-            if (count == 0) {
-                valid_answer = false;
-            } else {
-                bool numeric = true;
-                for (size_t i = 0; input[i]; ++i) {
-                    if (!isdigit((unsigned char)input[i])) {
-                        numeric = false;
-                        break;
-                    }
-                }
+EngineStatus engine_resume(EngineSession *s, const SandboxResult *r, EngineOut *out) {
+    if (s->done) {
+        return ENGINE_STATION_DONE;
+    }
+    s->job = NULL;
+    s->last_grade = GRADE_NONE;
+    s->last_task = s->index;
+    EngineStatus st = code_verdict(s, &s->tasks[s->index], r, out);
+    s->shown_ns = stats_now_ns();
+    return st;
+}
 
-                if (numeric) {
-                    long value = strtol(input, NULL, 10);
-                    if (value < 1 || value > count) {
-                        valid_answer = false;
-                    } else {
-                        correct = ((int)value - 1) == t->correct_index;
-                    }
-                } else {
-                    int selected = -1;
-                    for (int i = 0; i < count; ++i) {
-                        if (t->options[i] && equals_ignore_case(t->options[i], input)) {
-                            selected = i;
-                            break;
-                        }
-                    }
-                    if (selected == -1) {
-                        valid_answer = false;
-                    } else {
-                        correct = selected == t->correct_index;
-                    }
-                }
-            }
+static EngineStatus feed_line(EngineSession *s, const char *line, EngineOut *out) {
+    const Task *t = &s->tasks[s->index];
+    if (t->type == TASK_CODE && (s->code_len > 0 || s->code_overflow)) {
+        return code_line(s, t, line, out);     /* mid-submission: no commands */
+    }
+    char input[MAX_INPUT];
+    size_t len = answer_normalize(input, sizeof(input), line);
+
+    if (input[0] == '\0') {
+        engine_out_puts(out, "Please enter a response or type 'hint', 'skip', or 'exit'.");
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
+    }
+
+    if (strcmp(input, "hint") == 0) {
+        s->hints++;
+        if (t->hint && t->hint[0] != '\0') {
+            engine_out_puts(out, t->hint);
+            s->hint_used = true;
         } else {
-            correct = match_answer(t, input);
-            valid_answer = true;
+            engine_out_puts(out, "No hint available for this task.");
         }
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
+    }
 
-        if (!valid_answer) {
-            puts("Please choose one of the listed options or enter a command.");
-            need_prompt = true;
-            continue;
-        }
+    if (strcmp(input, "why") == 0) {
+        engine_out_puts(out, "Answer or skip first, then I'll explain why.");
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
+    }
+
+    if (strcmp(input, "skip") == 0) {
+        s->last_grade = GRADE_SKIPPED;
+        engine_out_puts(out, "Task skipped.");
+        explain(s, t, out);
+        return finish_task(s, out);
+    }
 
-        attempts++;
+    if (strcmp(input, "exit") == 0) {
+        s->aborted = true;
+        engine_out_puts(out, "Exiting station...");
+        return finish_station(s, out);
+    }
 
-        if (correct) {
-            if (!hint_used && attempts == 1) {
-                res->correct_first_try++;
-                res->total_points += 2;
-                puts(C_GREEN "Correct!" C_RESET);
-            } else {
-                res->correct_with_hint++;
-                res->total_points += 1;
-                puts(C_GREEN "Correct (partial credit)." C_RESET);
+    if (t->type == TASK_CODE) {
+        return code_line(s, t, line, out);
+    }
+    if (t->type == TASK_EXPR) {
+        return expr_line(s, t, line, out);
+    }
+    if (t->type == TASK_MACRO) {
+        return macro_line(s, t, line, out);
+    }
+
+    bool valid_answer = true;
+    bool correct = false;
+
+    if (t->type == TASK_QUIZ) {
+        int count = option_count(t);
+        if (count == 0) {
+            valid_answer = false;
+        } else {
+            bool numeric = true;
+            for (size_t i = 0; input[i]; ++i) {
+                if (!isdigit((unsigned char)input[i])) {
+                    numeric = false;
+                    break;
+                }
             }
-            print_why(t->why);
-            return;
-        }
 
-        puts("Not quite. Try again, or type 'hint', 'skip', or 'exit'.");
-
-        if (t->type == TASK_ASK) {
-            if (attempts >= 2 && !format_hint_shown) {
-                if (t->answers[0]) {
-                    printf("Expected answers include: ");
-                    for (int i = 0; i < MAX_OPTIONS && t->answers[i]; ++i) {
-                        if (i > 0) {
-                            printf(", ");
-                        }
-                        printf("%s", t->answers[i]);
-                    }
-                    printf("\n");
+            int selected = -1;
+            if (numeric) {
+                long value = strtol(input, NULL, 10);
+                if (value >= 1 && value <= count) {
+                    selected = (int)value - 1;
                 }
-                hint_used = true;
-                format_hint_shown = true;
+            } else {
+                selected = answer_index_lookup(s->answers, s->index, input, len);
             }
+            if (selected == -1) {
+                valid_answer = false;
+            } else {
+                correct = selected == t->correct_index;
+            }
+        }
+    } else {
+        correct = answer_index_lookup(s->answers, s->index, input, len) >= 0;
+        int edits;
+        int near = correct ? -1 : answer_index_fuzzy(s->answers, s->index, input, len,
+                                                     t->typos, &edits);
+        if (near >= 0) {
+            engine_out_printf(out, C_DIM "(Reading that as \"%s\"; %d typo%s.)" C_RESET "\n",
+                              t->answers[near], edits, edits == 1 ? "" : "s");
+            correct = true;
         }
+    }
 
-        need_prompt = true;
+    if (!valid_answer) {
+        engine_out_puts(out, "Please choose one of the listed options or enter a command.");
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
     }
+
+    return judge(s, t, correct, out);
 }
 
-static void read_input(char *buf, size_t size) {
-    if (!buf || size == 0) {
-        return;
+/* TASK_CODE: raw lines pile up until a lone "."; then the sandbox grades.
+ * Front ends hand over long lines in MAX_INPUT-1 byte chunks, so a chunk
+ * without an EOL runs on into the next one: it gets no newline, and a "."
+ * only ends the submission at the start of a line. */
+static EngineStatus code_line(EngineSession *s, const Task *t, const char *line, EngineOut *out) {
+    size_t n = strcspn(line, "\r\n");
+    bool line_start = !s->code_midline;
+    s->code_midline = line[n] == '\0';
+    if (!line_start || n != 1 || line[0] != '.') {
+        if (!s->code) {
+            s->code = tracked_malloc(SANDBOX_CODE_MAX);
+        }
+        if (!s->code || s->code_overflow || s->code_len + n + 2 > SANDBOX_CODE_MAX) {
+            /* the rest of the paste is still code, not commands */
+            s->code_len = 0;
+            s->code_overflow = true;
+            return ENGINE_NEED_INPUT;
+        }
+        memcpy(s->code + s->code_len, line, n);
+        s->code_len += n;
+        if (!s->code_midline) s->code[s->code_len++] = '\n';
+        s->code[s->code_len] = '\0';
+        return ENGINE_NEED_INPUT;
+    }
+    s->code_midline = false;
+
+    if (s->code_overflow) {
+        /* not an answer: no attempt counted */
+        engine_out_printf(out, "Submission longer than %d bytes; start again.\n", SANDBOX_CODE_MAX);
+        s->code_overflow = false;
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
     }
+    SandboxResult r;
+    if (s->grade_ctx) {
+        s->job = sandbox_submit(t, s->code, s->grade_ctx, &r);
+    } else {
+        sandbox_grade(t, s->code, &r);
+    }
+    s->code_len = 0;
+    return s->job ? ENGINE_GRADING : code_verdict(s, t, &r, out);
+}
 
-    if (!fgets(buf, (int)size, stdin)) {
-        buf[0] = '\0';
-        g_abort_station = true;
-        puts("Input closed. Exiting station...");
-        return;
+static EngineStatus code_verdict(EngineSession *s, const Task *t, const SandboxResult *r,
+                                 EngineOut *out) {
+    switch (r->verdict) {
+        case SB_PASS:
+            engine_out_printf(out, "All %d tests passed%s.\n", r->total,
+                              r->cached ? " (cached build)" : "");
+            break;
+        case SB_COMPILE_ERROR:
+            engine_out_puts(out, C_YELLOW "Compile error:" C_RESET);
+            engine_out_puts(out, r->detail);
+            break;
+        case SB_FAIL:
+        case SB_RUNTIME_ERROR:
+        case SB_TIMEOUT:
+            engine_out_printf(out, "Passed %d/%d tests.\n%s\n", r->passed, r->total, r->detail);
+            break;
+        case SB_UNAVAILABLE:
+            /* not the learner's fault: no attempt counted */
+            engine_out_puts(out, r->detail);
+            show_prompt(t, out);
+            return ENGINE_NEED_INPUT;
     }
+    return judge(s, t, r->verdict == SB_PASS, out);
+}
 
-    size_t len = strcspn(buf, "\r\n");
-    buf[len] = '\0';
+/* TASK_EXPR: the raw line is compiled and run against the task's variables. */
+static EngineStatus expr_line(EngineSession *s, const Task *t, const char *line, EngineOut *out) {
+    const CexprTask *x = cexpr_table_task(s->exprs, s->index);
+    if (!x || x->error[0]) {
+        engine_out_printf(out, "This task cannot be graded (%s); type 'skip'.\n",
+                          x ? x->error : "no expression table");
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
+    }
 
-    size_t start = 0;
-    while (buf[start] && isspace((unsigned char)buf[start])) {
-        start++;
+    CexprResult r;
+    if (!cexpr_eval(x->env, line, &r)) {
+        if (r.syntax) {
+            /* not an answer yet: no attempt counted */
+            engine_out_printf(out, "Can't read that as a C expression: %s (column %d).\n",
+                              r.error, r.column);
+            show_prompt(t, out);
+            return ENGINE_NEED_INPUT;
+        }
+        engine_out_printf(out, "Undefined behavior: %s.\n", r.error);
+        return judge(s, t, false, out);
     }
-    size_t end = strlen(buf);
-    while (end > start && isspace((unsigned char)buf[end - 1])) {
-        end--;
+    if ((t->expr_flags & EXPR_CONSTANT) && r.vars) {
+        engine_out_puts(out, "Answer with a value; don't name the task's variables.");
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
+    }
+    if ((t->expr_flags & EXPR_SAME_VARS) && (x->ref.vars & ~r.vars)) {
+        char names[64];
+        cexpr_var_names(x->env, x->ref.vars & ~r.vars, names, sizeof(names));
+        engine_out_printf(out, "Write it in terms of %s.\n", names);
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
     }
 
-    size_t final_len = end - start;
-    if (start > 0 && final_len > 0) {
-        memmove(buf, buf + start, final_len);
+    bool correct = cexpr_match(&x->ref, &r, t->expr_flags);
+    if (!correct) {
+        char value[64];
+        cexpr_format(x->env, &r, value, sizeof(value));
+        engine_out_printf(out, "That is %s (%s).\n", value, r.type);
     }
-    buf[final_len] = '\0';
+    return judge(s, t, correct, out);
+}
 
-    lower_inplace(buf);
+/* Each line of `text` indented, in dim if asked. */
+static void print_lines(const char *text, bool dim, EngineOut *out) {
+    while (*text) {
+        int n = (int)strcspn(text, "\n");
+        engine_out_printf(out, "%s    %.*s%s\n", dim ? C_DIM : "", n, text, dim ? C_RESET : "");
+        text += n + (text[n] == '\n');
+    }
 }
 
-static bool match_answer(const Task *t, const char *input) {
-    if (!t || !input || input[0] == '\0') {
-        return false;
+static void print_expansion(const CppResult *r, EngineOut *out) {
+    print_lines(r->text[0] ? r->text : "(nothing)", false, out);
+    if (r->trace[0]) {
+        engine_out_puts(out, "Steps:");
+        print_lines(r->trace, true, out);
     }
+    if (r->truncated) {
+        engine_out_printf(out, C_DIM "    (%d steps in all)" C_RESET "\n", r->steps);
+    }
+}
 
-    for (int i = 0; i < MAX_OPTIONS; ++i) {
-        const char *ans = t->answers[i];
-        if (!ans) {
-            continue;
+/* TASK_MACRO: the line must hold the preprocessed source's tokens, spaced
+ * any way.  `expand <text>` preprocesses anything against the task's
+ * macros instead, at the price of partial credit. */
+static EngineStatus macro_line(EngineSession *s, const Task *t, const char *line, EngineOut *out) {
+    const CppTask *x = cpp_table_task(s->macros, s->index);
+    if (!x || x->error[0]) {
+        engine_out_printf(out, "This task cannot be graded (%s); type 'skip'.\n",
+                          x ? x->error : "no macro table");
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
+    }
+
+    char text[MAX_INPUT];
+    size_t n = strcspn(line, "\r\n");
+    if (n >= sizeof(text)) {
+        n = sizeof(text) - 1;
+    }
+    memcpy(text, line, n);
+    text[n] = '\0';
+    const char *p = text + strspn(text, " \t");
+    if (strncmp(p, "expand", 6) == 0 && (p[6] == ' ' || p[6] == '\t')) {
+        CppResult r;
+        s->hints++;
+        s->hint_used = true;
+        if (cpp_expand(x->macros, p + 7, &r)) {
+            engine_out_puts(out, "That becomes:");
+            print_expansion(&r, out);
+        } else {
+            engine_out_printf(out, "Preprocessor error: %s.\n", r.error);
         }
-        if (equals_ignore_case(ans, input)) {
-            return true;
+        show_prompt(t, out);
+        return ENGINE_NEED_INPUT;
+    }
+
+    int same;
+    bool correct = cpp_same_tokens(p, x->ref.text, &same);
+    if (!correct && same > 0) {
+        engine_out_printf(out, "The first %d token%s right.\n", same, same == 1 ? " is" : "s are");
+    }
+    return judge(s, t, correct, out);
+}
+
+/* One graded attempt at the current task. */
+static EngineStatus judge(EngineSession *s, const Task *t, bool correct, EngineOut *out) {
+    s->attempts++;
+
+    if (correct) {
+        if (!s->hint_used && s->attempts == 1) {
+            s->last_grade = GRADE_CORRECT;
+            s->result.correct_first_try++;
+            s->result.total_points += 2;
+            engine_out_puts(out, C_GREEN "Correct!" C_RESET);
+        } else {
+            s->last_grade = GRADE_PARTIAL;
+            s->result.correct_with_hint++;
+            s->result.total_points += 1;
+            engine_out_puts(out, C_GREEN "Correct (partial credit)." C_RESET);
         }
+        explain(s, t, out);
+        return finish_task(s, out);
     }
 
-    return false;
+    s->last_grade = GRADE_WRONG;
+    engine_out_puts(out, "Not quite. Try again, or type 'hint', 'skip', or 'exit'.");
+
+    if (t->type == TASK_ASK && s->attempts >= 2 && !s->format_hint_shown) {
+        if (t->answers && t->answers[0]) {
+            engine_out_printf(out, "Expected answers include: ");
+            for (int i = 0; i < EXPECTED_SHOWN && t->answers[i]; ++i) {
+                engine_out_printf(out, "%s%s", i > 0 ? ", " : "", t->answers[i]);
+            }
+            engine_out_printf(out, "\n");
+        }
+        s->hint_used = true;
+        s->format_hint_shown = true;
+    }
+
+    show_prompt(t, out);
+    return ENGINE_NEED_INPUT;
 }
 
-static void print_why(const char *why) {
-    if (why && why[0] != '\0') {
-        puts(why);
-    } else {
-        puts("WHY: We'll add an explanation soon.");
+/* ===== state transitions ===== */
+static EngineStatus begin_task(EngineSession *s, EngineOut *out) {
+    s->attempts = 0;
+    s->hints = 0;
+    s->code_len = 0;
+    s->code_overflow = false;
+    s->code_midline = false;
+    s->hint_used = false;
+    s->format_hint_shown = false;
+
+    engine_out_printf(out, "\n" C_BOLD "Task %d/%d" C_RESET "\n", s->index + 1, s->task_count);
+    show_prompt(&s->tasks[s->index], out);
+    return ENGINE_NEED_INPUT;
+}
+
+static EngineStatus finish_task(EngineSession *s, EngineOut *out) {
+    stats_record(s->station_id, s->index, STAT_ATTEMPTS, (uint64_t)s->attempts);
+    stats_record(s->station_id, s->index, STAT_HINTS, (uint64_t)s->hints);
+    s->result.total_tasks++;
+    if (s->single || ++s->index >= s->task_count) {
+        return finish_station(s, out);
     }
+    begin_task(s, out);
+    return ENGINE_TASK_DONE;
 }
 
-static bool equals_ignore_case(const char *a, const char *b) {
-    if (!a || !b) {
-        return false;
+static EngineStatus finish_station(EngineSession *s, EngineOut *out) {
+    const StationResult *r = &s->result;
+    int max_points = r->total_tasks * 2;
+    int total_correct = r->correct_first_try + r->correct_with_hint;
+
+    if (s->single) {
+        s->done = true;
+        return ENGINE_STATION_DONE;
     }
-    while (*a && *b) {
-        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) {
-            return false;
+    engine_out_printf(out, "\nStation %02d Summary:\n", s->station_id);
+    engine_out_printf(out, "Tasks: %d | Correct: %d | With Hint: %d | Points: %d/%d\n",
+                      r->total_tasks, total_correct, r->correct_with_hint,
+                      r->total_points, max_points);
+
+    if (s->aborted) {
+        engine_out_puts(out, C_DIM "Station exited early; progress saved." C_RESET);
+    }
+
+    s->done = true;
+    return ENGINE_STATION_DONE;
+}
+
+/* ===== helpers ===== */
+static void show_prompt(const Task *t, EngineOut *out) {
+    engine_out_puts(out, t->prompt ? t->prompt : "(no prompt)");
+    if (t->type == TASK_QUIZ) {
+        int count = option_count(t);
+        for (int i = 0; i < count; ++i) {
+            engine_out_printf(out, "  %d) %s\n", i + 1, t->options[i]);
+        }
+    } else if (t->type == TASK_EXPR) {
+        for (int i = 0; t->options && t->options[i]; ++i) {
+            engine_out_printf(out, "    %s;\n", t->options[i]);
+        }
+        engine_out_puts(out, C_DIM "(a C expression or value; x86-64, LP64)" C_RESET);
+    } else if (t->type == TASK_MACRO) {
+        bool headers = false;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int i = 0; t->options && t->options[i]; ++i) {
+                if (cpp_is_header(t->options[i]) != (pass == 0)) {
+                    continue;
+                }
+                headers = headers || pass == 0;
+                print_lines(t->options[i], false, out);
+            }
+            if (pass == 0 && headers) {
+                engine_out_puts(out, "    // main.c");
+            }
         }
-        ++a;
-        ++b;
+        if (t->answers && t->answers[0]) {
+            print_lines(t->answers[0], false, out);
+        }
+        engine_out_puts(out, C_DIM "(the tokens it becomes, spaced any way; 'expand <text>' shows "
+                        "what any text becomes, for partial credit)" C_RESET);
+    } else if (t->type == TASK_CODE) {
+        int tests = 0;
+        while (t->answers && t->answers[tests]) tests++;
+        engine_out_printf(out, C_DIM "(C code, %d tests; finish with a line holding only '.')"
+                          C_RESET "\n", tests);
+    }
+    engine_out_printf(out, "> ");
+}
+
+/* The task's explanation; for TASK_MACRO, what the source became first. */
+static void explain(const EngineSession *s, const Task *t, EngineOut *out) {
+    const CppTask *x = t->type == TASK_MACRO ? cpp_table_task(s->macros, s->index) : NULL;
+    if (x && !x->error[0]) {
+        engine_out_puts(out, "It becomes:");
+        print_expansion(&x->ref, out);
+    }
+    print_why(t->why, out);
+}
+
+static void print_why(const char *why, EngineOut *out) {
+    if (why && why[0] != '\0') {
+        engine_out_puts(out, why);
+    } else {
+        engine_out_puts(out, "WHY: We'll add an explanation soon.");
     }
-    return *a == '\0' && *b == '\0';
 }
 
 static int option_count(const Task *t) {
     int count = 0;
-    if (!t) {
+    if (!t || !t->options) {
         return 0;
     }
-    for (int i = 0; i < MAX_OPTIONS; ++i) {
-        if (t->options[i]) {
-            count++;
-        }
+    while (t->options[count]) {
+        count++;
     }
     return count;
 }
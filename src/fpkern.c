@@ -0,0 +1,334 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "fpkern.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FPK_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define FPK_X86 0
+#endif
+
+#define FPK_CAT2(a, b) a##_##b
+#define FPK_CAT(a, b) FPK_CAT2(a, b)
+
+/* Neumaier running sum: the value is s + c. */
+typedef struct {
+    double s, c;
+} Acc;
+
+static inline void acc_add(Acc *a, double v) {
+    double t = a->s + v;
+    if (fabs(a->s) >= fabs(v)) a->c += (a->s - t) + v;
+    else a->c += (v - t) + a->s;
+    a->s = t;
+}
+
+static inline void acc_add_all(Acc *a, const double *v, int n) {
+    for (int i = 0; i < n; ++i) acc_add(a, v[i]);
+}
+
+/* ===== scalar ===== */
+static double sum_naive_scalar(const double *x, size_t n) {
+    double s = 0.0;
+    for (size_t i = 0; i < n; ++i) s += x[i];
+    return s;
+}
+
+static double sum_kahan_scalar(const double *x, size_t n) {
+    double s = 0.0, c = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double y = x[i] - c;
+        double t = s + y;
+        c = (t - s) - y;
+        s = t;
+    }
+    return s - c;
+}
+
+static double sum_neumaier_scalar(const double *x, size_t n) {
+    Acc a = { 0.0, 0.0 };
+    for (size_t i = 0; i < n; ++i) acc_add(&a, x[i]);
+    return a.s + a.c;
+}
+
+static double sum_pairwise_scalar(const double *x, size_t n) {
+    if (n <= FPK_PAIRWISE_BLOCK) {
+        return sum_naive_scalar(x, n);
+    }
+    size_t h = (n / 2) & ~(size_t)7;
+    return sum_pairwise_scalar(x, h) + sum_pairwise_scalar(x + h, n - h);
+}
+
+static double dot_naive_scalar(const double *x, const double *y, size_t n) {
+    double s = 0.0;
+    for (size_t i = 0; i < n; ++i) s += x[i] * y[i];
+    return s;
+}
+
+static double dot_kahan_scalar(const double *x, const double *y, size_t n) {
+    double s = 0.0, c = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double v = x[i] * y[i] - c;
+        double t = s + v;
+        c = (t - s) - v;
+        s = t;
+    }
+    return s - c;
+}
+
+static double dot_neumaier_scalar(const double *x, const double *y, size_t n) {
+    Acc a = { 0.0, 0.0 };
+    for (size_t i = 0; i < n; ++i) acc_add(&a, x[i] * y[i]);
+    return a.s + a.c;
+}
+
+static double dot_pairwise_scalar(const double *x, const double *y, size_t n) {
+    if (n <= FPK_PAIRWISE_BLOCK) {
+        return dot_naive_scalar(x, y, n);
+    }
+    size_t h = (n / 2) & ~(size_t)7;
+    return dot_pairwise_scalar(x, y, h) + dot_pairwise_scalar(x + h, y + h, n - h);
+}
+
+/* ===== SIMD: fpkern_simd.inc once per (instruction set, operation) ===== */
+#if FPK_X86
+#define FPK_SUM_PARAMS          (const double *x, size_t n)
+#define FPK_SUM_LEFT(h)         (x, (h))
+#define FPK_SUM_RIGHT(h)        (x + (h), n - (h))
+#define FPK_DOT_PARAMS          (const double *x, const double *y, size_t n)
+#define FPK_DOT_LEFT(h)         (x, y, (h))
+#define FPK_DOT_RIGHT(h)        (x + (h), y + (h), n - (h))
+
+#define FPK_SUFFIX  sse2
+#define FPK_TARGET  __attribute__((target("sse2")))
+#define FPK_W       2
+#define fvec        __m128d
+#define V_ZERO()            _mm_setzero_pd()
+#define V_LOAD(p)           _mm_loadu_pd(p)
+#define V_STORE(p, v)       _mm_storeu_pd((p), (v))
+#define V_ADD(a, b)         _mm_add_pd((a), (b))
+#define V_SUB(a, b)         _mm_sub_pd((a), (b))
+#define V_MUL(a, b)         _mm_mul_pd((a), (b))
+#define V_ABS(a)            _mm_andnot_pd(_mm_set1_pd(-0.0), (a))
+#define V_SEL_GE(a, b, x, y) sel_ge_sse2((a), (b), (x), (y))
+
+static FPK_TARGET inline __m128d sel_ge_sse2(__m128d a, __m128d b, __m128d x, __m128d y) {
+    __m128d m = _mm_cmpge_pd(a, b);
+    return _mm_or_pd(_mm_and_pd(m, x), _mm_andnot_pd(m, y));
+}
+
+#define FPK_OP          sum
+#define FPK_PARAMS      FPK_SUM_PARAMS
+#define FPK_TERM_V(i)   V_LOAD(x + (i))
+#define FPK_TERM_S(i)   x[i]
+#define FPK_LEFT        FPK_SUM_LEFT
+#define FPK_RIGHT       FPK_SUM_RIGHT
+#include "fpkern_simd.inc"
+#undef FPK_OP
+#undef FPK_PARAMS
+#undef FPK_TERM_V
+#undef FPK_TERM_S
+#undef FPK_LEFT
+#undef FPK_RIGHT
+
+#define FPK_OP          dot
+#define FPK_PARAMS      FPK_DOT_PARAMS
+#define FPK_TERM_V(i)   V_MUL(V_LOAD(x + (i)), V_LOAD(y + (i)))
+#define FPK_TERM_S(i)   (x[i] * y[i])
+#define FPK_LEFT        FPK_DOT_LEFT
+#define FPK_RIGHT       FPK_DOT_RIGHT
+#include "fpkern_simd.inc"
+#undef FPK_OP
+#undef FPK_PARAMS
+#undef FPK_TERM_V
+#undef FPK_TERM_S
+#undef FPK_LEFT
+#undef FPK_RIGHT
+
+#undef FPK_SUFFIX
+#undef FPK_TARGET
+#undef FPK_W
+#undef fvec
+#undef V_ZERO
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_ABS
+#undef V_SEL_GE
+
+#define FPK_SUFFIX  avx2
+#define FPK_TARGET  __attribute__((target("avx2")))
+#define FPK_W       4
+#define fvec        __m256d
+#define V_ZERO()            _mm256_setzero_pd()
+#define V_LOAD(p)           _mm256_loadu_pd(p)
+#define V_STORE(p, v)       _mm256_storeu_pd((p), (v))
+#define V_ADD(a, b)         _mm256_add_pd((a), (b))
+#define V_SUB(a, b)         _mm256_sub_pd((a), (b))
+#define V_MUL(a, b)         _mm256_mul_pd((a), (b))
+#define V_ABS(a)            _mm256_andnot_pd(_mm256_set1_pd(-0.0), (a))
+#define V_SEL_GE(a, b, x, y) _mm256_blendv_pd((y), (x), _mm256_cmp_pd((a), (b), _CMP_GE_OQ))
+
+#define FPK_OP          sum
+#define FPK_PARAMS      FPK_SUM_PARAMS
+#define FPK_TERM_V(i)   V_LOAD(x + (i))
+#define FPK_TERM_S(i)   x[i]
+#define FPK_LEFT        FPK_SUM_LEFT
+#define FPK_RIGHT       FPK_SUM_RIGHT
+#include "fpkern_simd.inc"
+#undef FPK_OP
+#undef FPK_PARAMS
+#undef FPK_TERM_V
+#undef FPK_TERM_S
+#undef FPK_LEFT
+#undef FPK_RIGHT
+
+#define FPK_OP          dot
+#define FPK_PARAMS      FPK_DOT_PARAMS
+#define FPK_TERM_V(i)   V_MUL(V_LOAD(x + (i)), V_LOAD(y + (i)))
+#define FPK_TERM_S(i)   (x[i] * y[i])
+#define FPK_LEFT        FPK_DOT_LEFT
+#define FPK_RIGHT       FPK_DOT_RIGHT
+#include "fpkern_simd.inc"
+#endif /* FPK_X86 */
+
+/* ===== dispatch ===== */
+static const struct {
+    FpkSumFn sum[FPK_ALGOS];
+    FpkDotFn dot[FPK_ALGOS];
+} KERNELS[FPK_ISAS] = {
+    [FPK_SCALAR] = {
+        { sum_naive_scalar, sum_kahan_scalar, sum_neumaier_scalar, sum_pairwise_scalar },
+        { dot_naive_scalar, dot_kahan_scalar, dot_neumaier_scalar, dot_pairwise_scalar },
+    },
+#if FPK_X86
+    [FPK_SSE2] = {
+        { sum_naive_sse2, sum_kahan_sse2, sum_neumaier_sse2, sum_pairwise_sse2 },
+        { dot_naive_sse2, dot_kahan_sse2, dot_neumaier_sse2, dot_pairwise_sse2 },
+    },
+    [FPK_AVX2] = {
+        { sum_naive_avx2, sum_kahan_avx2, sum_neumaier_avx2, sum_pairwise_avx2 },
+        { dot_naive_avx2, dot_kahan_avx2, dot_neumaier_avx2, dot_pairwise_avx2 },
+    },
+#endif
+};
+
+static const char *const ALGO_NAMES[FPK_ALGOS] = { "naive", "kahan", "neumaier", "pairwise" };
+static const char *const ISA_NAMES[FPK_ISAS] = { "scalar", "sse2", "avx2" };
+
+/* -1 until detected; both only ever move to one value each, so relaxed
+ * loads are enough */
+static atomic_int g_detected = -1;
+static atomic_int g_cap = FPK_ISAS - 1;
+
+const char *fpk_algo_name(FpkAlgo algo) {
+    return (unsigned)algo < FPK_ALGOS ? ALGO_NAMES[algo] : "?";
+}
+
+const char *fpk_isa_name(FpkIsa isa) {
+    return (unsigned)isa < FPK_ISAS ? ISA_NAMES[isa] : "?";
+}
+
+static FpkIsa detect(void) {
+    FpkIsa best = FPK_SCALAR;
+#if FPK_X86
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return best;
+    }
+    if (d & bit_SSE2) {
+        best = FPK_SSE2;
+    }
+    /* AVX needs the OS to save the upper register halves too (XCR0 bits 1-2) */
+    if ((c & bit_OSXSAVE) && (c & bit_AVX)) {
+        uint32_t lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        (void)hi;
+        if ((lo & 6) == 6 && __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX2)) {
+            best = FPK_AVX2;
+        }
+    }
+#endif
+    return best;
+}
+
+FpkIsa fpk_detect_isa(void) {
+    int isa = atomic_load_explicit(&g_detected, memory_order_relaxed);
+    if (isa < 0) {
+        isa = (int)detect();
+        atomic_store_explicit(&g_detected, isa, memory_order_relaxed);
+    }
+    return (FpkIsa)isa;
+}
+
+bool fpk_isa_supported(FpkIsa isa) {
+    return (unsigned)isa < FPK_ISAS && isa <= fpk_detect_isa() && KERNELS[isa].sum[0] != NULL;
+}
+
+void fpk_set_isa(FpkIsa isa) {
+    atomic_store_explicit(&g_cap, (unsigned)isa < FPK_ISAS ? (int)isa : FPK_ISAS - 1,
+                          memory_order_relaxed);
+}
+
+FpkIsa fpk_active_isa(void) {
+    FpkIsa best = fpk_detect_isa();
+    FpkIsa cap = (FpkIsa)atomic_load_explicit(&g_cap, memory_order_relaxed);
+    return cap < best ? cap : best;
+}
+
+FpkSumFn fpk_sum_fn(FpkAlgo algo, FpkIsa isa) {
+    if ((unsigned)algo >= FPK_ALGOS || !fpk_isa_supported(isa)) return NULL;
+    return KERNELS[isa].sum[algo];
+}
+
+FpkDotFn fpk_dot_fn(FpkAlgo algo, FpkIsa isa) {
+    if ((unsigned)algo >= FPK_ALGOS || !fpk_isa_supported(isa)) return NULL;
+    return KERNELS[isa].dot[algo];
+}
+
+double fpk_sum(FpkAlgo algo, const double *x, size_t n) {
+    FpkSumFn fn = fpk_sum_fn(algo, fpk_active_isa());
+    return fn ? fn(x, n) : NAN;
+}
+
+double fpk_dot(FpkAlgo algo, const double *x, const double *y, size_t n) {
+    FpkDotFn fn = fpk_dot_fn(algo, fpk_active_isa());
+    return fn ? fn(x, y, n) : NAN;
+}
+
+/* ===== reference ===== */
+typedef struct {
+    long double s, c;
+} AccL;
+
+static void accl_add(AccL *a, long double v) {
+    long double t = a->s + v;
+    if (fabsl(a->s) >= fabsl(v)) a->c += (a->s - t) + v;
+    else a->c += (v - t) + a->s;
+    a->s = t;
+}
+
+long double fpk_sum_ref(const double *x, size_t n) {
+    AccL a = { 0.0L, 0.0L };
+    for (size_t i = 0; i < n; ++i) accl_add(&a, x[i]);
+    return a.s + a.c;
+}
+
+/* a double product is exact in long double's 64-bit mantissa only to
+ * 64 bits; good enough as a yardstick for double kernels */
+long double fpk_dot_ref(const double *x, const double *y, size_t n) {
+    AccL a = { 0.0L, 0.0L };
+    for (size_t i = 0; i < n; ++i) accl_add(&a, (long double)x[i] * y[i]);
+    return a.s + a.c;
+}
+
+double fpk_rel_error(double got, long double ref) {
+    long double err = fabsl((long double)got - ref);
+    return (double)(ref != 0.0L ? err / fabsl(ref) : err);
+}
@@ -0,0 +1,360 @@
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* <dirent.h> pulls in the kernel's MAX_INPUT; ours is the line limit */
+#undef MAX_INPUT
+
+#include "grade.h"
+#include "shell.h"
+#include "stats.h"
+#include "tracker.h"
+
+#define GRADE_OUT_CAP 16384     /* one command's reply; discarded */
+
+typedef struct {
+    char *name;
+    bool failed;                /* could not be opened or read */
+    int lines;
+    GameState g;                /* learner state after the last line */
+} GradeRow;
+
+typedef struct Grader Grader;
+
+/* Each worker is its own heap block, so tallies and ranges of different
+ * workers never share a cache line. */
+typedef struct {
+    _Atomic uint64_t range;     /* [lo, hi) as hi << 32 | lo */
+    Grader *gr;
+    int id;
+    uint64_t steals;
+    StationTally tally[STATION_COUNT];
+    char out[GRADE_OUT_CAP];
+} Worker;
+
+struct Grader {
+    const char *dir;
+    GradeRow *rows;
+    size_t count;
+    Worker **workers;
+    int nworkers;
+};
+
+/* ===== work stealing =====
+ * The owner takes from the bottom of its range, a thief takes the top half
+ * of someone else's.  Both are one CAS on the packed pair, and the pair is
+ * the whole ownership state, so a stale snapshot that compares equal is
+ * still correct.  No work is ever added, so a worker that finds every
+ * range empty can stop. */
+static uint64_t pack(uint32_t lo, uint32_t hi) {
+    return (uint64_t)hi << 32 | lo;
+}
+
+static bool take(Worker *w, size_t *idx) {
+    uint64_t r = atomic_load_explicit(&w->range, memory_order_acquire);
+    for (;;) {
+        uint32_t lo = (uint32_t)r, hi = (uint32_t)(r >> 32);
+        if (lo >= hi) return false;
+        if (atomic_compare_exchange_weak_explicit(&w->range, &r, pack(lo + 1, hi),
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *idx = lo;
+            return true;
+        }
+    }
+}
+
+static bool steal(Worker *w) {
+    const Grader *gr = w->gr;
+    for (int k = 1; k < gr->nworkers; ++k) {
+        Worker *v = gr->workers[(w->id + k) % gr->nworkers];
+        uint64_t r = atomic_load_explicit(&v->range, memory_order_acquire);
+        for (;;) {
+            uint32_t lo = (uint32_t)r, hi = (uint32_t)(r >> 32);
+            if (lo >= hi) break;
+            uint32_t mid = hi - (hi - lo + 1) / 2;
+            if (atomic_compare_exchange_weak_explicit(&v->range, &r, pack(lo, mid),
+                                                      memory_order_acq_rel, memory_order_acquire)) {
+                atomic_store_explicit(&w->range, pack(mid, hi), memory_order_release);
+                w->steals++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* ===== replay ===== */
+/* Read the way shell_loop() reads stdin: fgets() into MAX_INPUT, so an
+ * over-long line arrives as several. */
+static void grade_one(Worker *w, EngineOut *out, size_t i) {
+    GradeRow *row = &w->gr->rows[i];
+    char path[4096], line[MAX_INPUT];
+    snprintf(path, sizeof(path), "%s/%s", w->gr->dir, row->name);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        row->failed = true;
+        return;
+    }
+
+    Shell sh;
+    shell_session_init(&sh, false);
+    sh.grading = true;
+    sh.tally = w->tally;
+    while (!sh.quit && fgets(line, sizeof(line), f)) {
+        engine_out_reset(out);
+        shell_session_feed(&sh, line, out);
+        row->lines++;
+    }
+    if (!sh.quit) {
+        engine_out_reset(out);
+        shell_session_close(&sh, out);
+    }
+    row->failed = ferror(f) != 0;
+    fclose(f);
+    row->g = sh.g;
+    shell_session_free(&sh);
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    EngineOut out;
+    engine_out_init(&out, w->out, sizeof(w->out));
+    for (;;) {
+        size_t i;
+        if (take(w, &i)) {
+            grade_one(w, &out, i);
+        } else if (!steal(w)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* ===== directory ===== */
+static int by_name(const void *a, const void *b) {
+    return strcmp(((const GradeRow *)a)->name, ((const GradeRow *)b)->name);
+}
+
+static Status scan(Grader *gr) {
+    DIR *d = opendir(gr->dir);
+    if (!d) {
+        perror(gr->dir);
+        return ERR;
+    }
+    size_t cap = 0;
+    Status rc = OK;
+    struct dirent *e;
+    while (rc == OK && (e = readdir(d))) {
+        struct stat st;
+        if (e->d_name[0] == '.' || fstatat(dirfd(d), e->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        if (gr->count == cap) {
+            size_t ncap = cap ? cap * 2 : 256;
+            GradeRow *nr = ncap < UINT32_MAX ? tracked_realloc(gr->rows, ncap * sizeof(*nr)) : NULL;
+            if (!nr) { rc = ERR; break; }
+            gr->rows = nr;
+            cap = ncap;
+        }
+        GradeRow *row = &gr->rows[gr->count];
+        memset(row, 0, sizeof(*row));
+        size_t n = strlen(e->d_name) + 1;
+        row->name = tracked_malloc(n);
+        if (!row->name) { rc = ERR; break; }
+        memcpy(row->name, e->d_name, n);
+        gr->count++;
+    }
+    closedir(d);
+    if (rc != OK) {
+        fprintf(stderr, "%s: too many transcripts or out of memory\n", gr->dir);
+        return ERR;
+    }
+    if (gr->count) qsort(gr->rows, gr->count, sizeof(*gr->rows), by_name);
+    return OK;
+}
+
+/* ===== report ===== */
+static void csv_field(FILE *f, const char *s) {
+    if (!strpbrk(s, ",\"\r\n")) {
+        fputs(s, f);
+        return;
+    }
+    fputc('"', f);
+    for (; *s; ++s) {
+        if (*s == '"') fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void json_str(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void write_csv(FILE *f, const Grader *gr) {
+    fputs("transcript,lines,status,score", f);
+    for (int s = 0; s < STATION_COUNT; ++s) fprintf(f, ",s%02d", s + 2);
+    fputc('\n', f);
+    for (size_t i = 0; i < gr->count; ++i) {
+        const GradeRow *row = &gr->rows[i];
+        csv_field(f, row->name);
+        fprintf(f, ",%d,%s,%d", row->lines, row->failed ? "unreadable" : "ok", row->g.total_score);
+        for (int s = 0; s < STATION_COUNT; ++s) fprintf(f, ",%d", row->g.station_scores[s]);
+        fputc('\n', f);
+    }
+}
+
+static void write_json(FILE *f, const Grader *gr, const StationTally *tally) {
+    fputs("{\n  \"dir\": ", f);
+    json_str(f, gr->dir);
+    fprintf(f, ",\n  \"workers\": %d,\n  \"transcripts\": [", gr->nworkers);
+    for (size_t i = 0; i < gr->count; ++i) {
+        const GradeRow *row = &gr->rows[i];
+        fputs(i ? ",\n    {\"name\": " : "\n    {\"name\": ", f);
+        json_str(f, row->name);
+        fprintf(f, ", \"lines\": %d, \"ok\": %s, \"score\": %d, \"stations\": {",
+                row->lines, row->failed ? "false" : "true", row->g.total_score);
+        int printed = 0;
+        for (int s = 0; s < STATION_COUNT; ++s) {
+            if (!row->g.attempted[s]) continue;
+            fprintf(f, "%s\"%02d\": %d", printed++ ? ", " : "", s + 2, row->g.station_scores[s]);
+        }
+        fputs("}}", f);
+    }
+    fputs("\n  ],\n  \"stations\": [", f);
+    int printed = 0;
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        const StationTally *t = &tally[s];
+        if (!t->sessions) continue;
+        fprintf(f, "%s\n    {\"id\": %d, \"sessions\": %d, \"tasks\": %d, \"first_try\": %d, "
+                   "\"with_hint\": %d, \"points\": %d}",
+                printed++ ? "," : "", s + 2, t->sessions, t->sum.total_tasks,
+                t->sum.correct_first_try, t->sum.correct_with_hint, t->sum.total_points);
+    }
+    fputs("\n  ]\n}\n", f);
+}
+
+static Status write_report(const char *path, const Grader *gr, const StationTally *tally) {
+    FILE *f = path ? fopen(path, "w") : stdout;
+    if (!f) {
+        perror(path);
+        return ERR;
+    }
+    size_t n = path ? strlen(path) : 0;
+    if (n >= 5 && strcmp(path + n - 5, ".json") == 0) write_json(f, gr, tally);
+    else write_csv(f, gr);
+    bool ok = fflush(f) == 0 && !ferror(f);
+    if (path) ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        perror(path ? path : "stdout");
+        return ERR;
+    }
+    return OK;
+}
+
+/* ===== public ===== */
+int grade_run(const GradeOptions *opt) {
+    Grader gr = { .dir = opt->dir };
+    StationTally tally[STATION_COUNT];
+    memset(tally, 0, sizeof(tally));
+    int rc = 1;
+
+    if (scan(&gr) != OK) goto done;
+    if (shell_prepare_banks() != OK) {
+        fprintf(stderr, "grade: out of memory\n");
+        goto done;
+    }
+    stats_set_enabled(false);
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int n = opt->workers > 0 ? opt->workers : ncpu > 0 ? (int)ncpu : 1;
+    if (n > GRADE_WORKERS_MAX) n = GRADE_WORKERS_MAX;
+    if ((size_t)n > gr.count) n = gr.count ? (int)gr.count : 1;
+
+    gr.workers = tracked_calloc((size_t)n, sizeof(*gr.workers));
+    if (!gr.workers) goto oom;
+    for (int k = 0; k < n; ++k) {
+        Worker *w = tracked_calloc(1, sizeof(*w));
+        if (!w) goto oom;
+        w->gr = &gr;
+        w->id = k;
+        atomic_init(&w->range, pack((uint32_t)(gr.count * (size_t)k / (size_t)n),
+                                    (uint32_t)(gr.count * (size_t)(k + 1) / (size_t)n)));
+        gr.workers[k] = w;
+        gr.nworkers++;
+    }
+
+    /* Worker 0 is this thread.  If a thread fails to start, the others
+     * steal its range. */
+    pthread_t threads[GRADE_WORKERS_MAX];
+    bool started[GRADE_WORKERS_MAX] = { false };
+    uint64_t t0 = stats_now_ns();
+    for (int k = 1; k < n; ++k) {
+        started[k] = pthread_create(&threads[k], NULL, worker_main, gr.workers[k]) == 0;
+    }
+    worker_main(gr.workers[0]);
+    for (int k = 1; k < n; ++k) {
+        if (started[k]) pthread_join(threads[k], NULL);
+    }
+    uint64_t ns = stats_now_ns() - t0;
+
+    /* merge: every worker has stopped, so its tallies are plain reads */
+    uint64_t steals = 0;
+    for (int k = 0; k < n; ++k) {
+        const Worker *w = gr.workers[k];
+        steals += w->steals;
+        for (int s = 0; s < STATION_COUNT; ++s) {
+            const StationTally *t = &w->tally[s];
+            tally[s].sessions += t->sessions;
+            tally[s].sum.station_id = s + 2;
+            tally[s].sum.total_tasks += t->sum.total_tasks;
+            tally[s].sum.correct_first_try += t->sum.correct_first_try;
+            tally[s].sum.correct_with_hint += t->sum.correct_with_hint;
+            tally[s].sum.total_points += t->sum.total_points;
+        }
+    }
+
+    uint64_t lines = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < gr.count; ++i) {
+        lines += (uint64_t)gr.rows[i].lines;
+        if (gr.rows[i].failed) {
+            fprintf(stderr, "%s/%s: cannot read\n", gr.dir, gr.rows[i].name);
+            failed++;
+        }
+    }
+    rc = write_report(opt->report, &gr, tally) == OK && failed == 0 ? 0 : 1;
+
+    double secs = (double)ns / 1e9;
+    fprintf(stderr, "graded %zu transcripts (%llu lines, %zu unreadable) in %.3f s on %d workers: "
+                    "%.0f transcripts/s, %.0f lines/s, %llu steals\n",
+            gr.count, (unsigned long long)lines, failed, secs, n,
+            secs > 0 ? (double)gr.count / secs : 0.0, secs > 0 ? (double)lines / secs : 0.0,
+            (unsigned long long)steals);
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        const StationTally *t = &tally[s];
+        if (!t->sessions) continue;
+        fprintf(stderr, "  [%02d] sessions %d  tasks %d  first try %d  with hint %d  points %d\n",
+                s + 2, t->sessions, t->sum.total_tasks, t->sum.correct_first_try,
+                t->sum.correct_with_hint, t->sum.total_points);
+    }
+    goto done;
+
+oom:
+    fprintf(stderr, "grade: out of memory\n");
+done:
+    for (int k = 0; k < gr.nworkers; ++k) tracked_free(gr.workers[k]);
+    tracked_free(gr.workers);
+    for (size_t i = 0; i < gr.count; ++i) tracked_free(gr.rows[i].name);
+    tracked_free(gr.rows);
+    return rc;
+}
@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+/* <dirent.h> pulls in the kernel's MAX_INPUT; ours is the line limit */
+#undef MAX_INPUT
+
+#include "hotbank.h"
+#include "tracker.h"
+
+struct HotBank {
+    BankFile file;
+    atomic_uint refs;           /* the slot's reference + one per pin */
+    uint32_t version;
+    char name[NAME_MAX + 1];    /* file it came from, for unloads */
+};
+
+typedef struct {
+    _Atomic(HotBank *) current;
+    atomic_uint readers;        /* threads inside hotbank_acquire() */
+    uint32_t versions;          /* loads so far; writer only */
+} Slot;
+
+/* Written only at startup and by the watcher thread. */
+static Slot SLOTS[HOTBANK_IDS];
+static char DIR_PATH[PATH_MAX];
+static pthread_t WATCHER;
+static bool WATCHING;
+static int STOP_FD = -1;
+
+static bool is_bank_name(const char *name) {
+    size_t n = strlen(name);
+    return name[0] != '.' && n > 5 && strcmp(name + n - 5, ".bank") == 0;
+}
+
+/* ===== readers ===== */
+HotBank *hotbank_acquire(int station_id) {
+    if (station_id < 0 || station_id >= HOTBANK_IDS) return NULL;
+    Slot *s = &SLOTS[station_id];
+    /* seq_cst pairs with publish(): either the writer sees us in here and
+     * waits, or we see its new pointer */
+    atomic_fetch_add(&s->readers, 1);
+    HotBank *v = atomic_load(&s->current);
+    if (v) atomic_fetch_add_explicit(&v->refs, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&s->readers, 1, memory_order_release);
+    return v;
+}
+
+void hotbank_release(HotBank *v) {
+    if (v && atomic_fetch_sub_explicit(&v->refs, 1, memory_order_acq_rel) == 1) {
+        bank_close(&v->file);
+        tracked_free(v);
+    }
+}
+
+TaskBank *hotbank_bank(HotBank *v) {
+    return &v->file.bank;
+}
+
+uint32_t hotbank_version(const HotBank *v) {
+    return v->version;
+}
+
+/* ===== writer ===== */
+
+/* Swap in `v` (or nothing), wait out acquirers that may have read the old
+ * pointer without pinning it yet, then drop the slot's reference. */
+static void publish(int station_id, HotBank *v) {
+    Slot *s = &SLOTS[station_id];
+    HotBank *old = atomic_exchange(&s->current, v);
+    while (atomic_load(&s->readers)) sched_yield();
+    hotbank_release(old);
+}
+
+static int slot_of_name(const char *name) {
+    for (int id = 0; id < HOTBANK_IDS; ++id) {
+        const HotBank *v = atomic_load_explicit(&SLOTS[id].current, memory_order_relaxed);
+        if (v && strcmp(v->name, name) == 0) return id;
+    }
+    return -1;
+}
+
+/* Maps and prepares DIR_PATH/name; NULL (reason on stderr) when it does not load. */
+static HotBank *load(const char *name) {
+    char path[PATH_MAX + NAME_MAX + 2];
+    snprintf(path, sizeof(path), "%s/%s", DIR_PATH, name);
+    HotBank *v = tracked_calloc(1, sizeof(*v));
+    if (!v) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return NULL;
+    }
+    if (bank_load(&v->file, path) != OK) {
+        tracked_free(v);
+        return NULL;
+    }
+    const char *why = NULL;
+    if (v->file.station_id < 0 || v->file.station_id >= HOTBANK_IDS) {
+        why = "station id out of range";
+    } else if (!task_bank_prepare(&v->file.bank)) {
+        why = "out of memory";
+    }
+    if (why) {
+        fprintf(stderr, "%s: %s\n", path, why);
+        bank_close(&v->file);
+        tracked_free(v);
+        return NULL;
+    }
+    atomic_init(&v->refs, 1);
+    snprintf(v->name, sizeof(v->name), "%s", name);
+    return v;
+}
+
+/* A file was written or renamed into the directory. */
+static void reload(const char *name) {
+    HotBank *v = load(name);
+    if (!v) {
+        fprintf(stderr, "%s: keeping the loaded version\n", name);
+        return;
+    }
+    int id = v->file.station_id;
+    int was = slot_of_name(name);
+    if (was >= 0 && was != id) publish(was, NULL);     /* file now serves another station */
+    v->version = ++SLOTS[id].versions;
+    publish(id, v);
+    fprintf(stderr, "%s: station %02d now at v%u (%d tasks)\n", name, id, v->version,
+            v->file.bank.count);
+}
+
+static void unload(const char *name) {
+    int id = slot_of_name(name);
+    if (id < 0) return;
+    publish(id, NULL);
+    fprintf(stderr, "%s: removed; station %02d is back to its built-in tasks\n", name, id);
+}
+
+static void *watch_main(void *arg) {
+    int ifd = (int)(intptr_t)arg;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2] = { { ifd, POLLIN, 0 }, { STOP_FD, POLLIN, 0 } };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        ssize_t n = read(ifd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            break;
+        }
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(*ev) + ev->len;
+            if (!ev->len || !is_bank_name(ev->name)) continue;
+            if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) reload(ev->name);
+            else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) unload(ev->name);
+        }
+    }
+    close(ifd);
+    return NULL;
+}
+
+/* The inotify descriptor for DIR_PATH, or -1. */
+static int watch_dir(void) {
+    int ifd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (ifd < 0) {
+        perror("inotify_init1");
+        return -1;
+    }
+    if (inotify_add_watch(ifd, DIR_PATH, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) < 0) {
+        perror(DIR_PATH);
+        close(ifd);
+        return -1;
+    }
+    return ifd;
+}
+
+/* The thread becomes the only writer; it owns ifd from here on. */
+static Status start_watcher(int ifd) {
+    STOP_FD = eventfd(0, EFD_CLOEXEC);
+    if (STOP_FD < 0 || pthread_create(&WATCHER, NULL, watch_main, (void *)(intptr_t)ifd) != 0) {
+        fprintf(stderr, "%s: cannot start the bank watcher\n", DIR_PATH);
+        if (STOP_FD >= 0) close(STOP_FD);
+        STOP_FD = -1;
+        close(ifd);
+        return ERR;
+    }
+    WATCHING = true;
+    return OK;
+}
+
+Status hotbank_open(const char *dir, bool watch) {
+    if (strlen(dir) >= sizeof(DIR_PATH)) {
+        fprintf(stderr, "%s: path too long\n", dir);
+        return ERR;
+    }
+    strcpy(DIR_PATH, dir);
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return ERR;
+    }
+    /* watch before loading, so a file replaced meanwhile is not missed; its
+     * events wait in the queue until the watcher starts */
+    int ifd = watch ? watch_dir() : -1;
+    Status st = watch && ifd < 0 ? ERR : OK;
+    struct dirent *e;
+    while (st == OK && (e = readdir(d)) != NULL) {
+        if (!is_bank_name(e->d_name)) continue;
+        HotBank *v = load(e->d_name);
+        if (!v) {
+            st = ERR;
+            break;
+        }
+        int id = v->file.station_id;
+        HotBank *other = atomic_load(&SLOTS[id].current);
+        if (other) {
+            fprintf(stderr, "%s/%s: station %02d is also in %s\n", dir, e->d_name, id, other->name);
+            hotbank_release(v);
+            st = ERR;
+            break;
+        }
+        v->version = ++SLOTS[id].versions;
+        publish(id, v);
+    }
+    closedir(d);
+    if (st == OK && watch) {
+        st = start_watcher(ifd);
+    } else if (ifd >= 0) {
+        close(ifd);
+    }
+    if (st != OK) hotbank_close();
+    return st;
+}
+
+void hotbank_close(void) {
+    if (WATCHING) {
+        uint64_t one = 1;
+        if (write(STOP_FD, &one, sizeof(one)) < 0) perror("eventfd");
+        pthread_join(WATCHER, NULL);
+        close(STOP_FD);
+        STOP_FD = -1;
+        WATCHING = false;
+    }
+    for (int id = 0; id < HOTBANK_IDS; ++id) {
+        publish(id, NULL);
+        SLOTS[id].versions = 0;
+    }
+}
@@ -0,0 +1,276 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal.h"
+#include "tracker.h"
+
+#define SNAP_MAGIC   0x50414e53u    /* "SNAP" */
+#define REC_MAGIC    0x4c4e524au    /* "JRNL" */
+#define STATE_PATH   512
+
+/* coalesce() relies on a full batch repeating some (kind, station) */
+#if 3 * STATION_COUNT >= JOURNAL_BATCH
+#  error "JOURNAL_BATCH must exceed the number of (kind, station) pairs"
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t seq;                   /* last record folded into state */
+    GameState state;
+    uint32_t crc;                   /* over everything above */
+} Snapshot;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t kind;
+    uint16_t station;
+    uint64_t seq;
+    int32_t value;
+    uint32_t crc;                   /* over everything above */
+} Record;
+
+struct Journal {
+    int fd;
+    char dir[STATE_PATH];
+    GameState state;                /* mirror of what is durable + pending */
+    uint64_t seq;                   /* last sequence number handed out */
+    uint64_t snap_seq;
+    uint32_t on_disk;               /* records currently in the journal file */
+    Record pending[JOURNAL_BATCH];
+    int npending;
+};
+
+/* ===== CRC-32 (IEEE) ===== */
+static uint32_t crc_table[256];
+
+static void crc_init(void) {
+    if (crc_table[1]) return;
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32_of(const void *data, size_t n) {
+    const unsigned char *p = data;
+    uint32_t c = 0xffffffffu;
+    for (size_t i = 0; i < n; ++i) c = crc_table[(c ^ p[i]) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffffu;
+}
+
+/* ===== helpers ===== */
+static void state_path(const Journal *j, char *buf, size_t n, const char *name) {
+    snprintf(buf, n, "%s/%s", j->dir, name);
+}
+
+static void apply(GameState *g, int kind, int station, int value) {
+    if (station < 0 || station >= STATION_COUNT) return;
+    switch (kind) {
+        case JR_SCORE:
+            g->total_score += value - g->station_scores[station];
+            g->station_scores[station] = value;
+            break;
+        case JR_ATTEMPTED: g->attempted[station] = value; break;
+        case JR_COMPLETED: g->completed[station] = value != 0; break;
+        default: break;
+    }
+}
+
+static bool write_all(int fd, const void *data, size_t n) {
+    const char *p = data;
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+static void fsync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/* tmp + fsync + rename: the old snapshot stays valid until the new one is */
+static Status write_snapshot(Journal *j) {
+    char path[STATE_PATH + 32], tmp[STATE_PATH + 32];
+    state_path(j, path, sizeof(path), "progress.snap");
+    state_path(j, tmp, sizeof(tmp), "progress.snap.tmp");
+
+    Snapshot s;
+    memset(&s, 0, sizeof(s));
+    s.magic = SNAP_MAGIC;
+    s.version = 1;
+    s.seq = j->seq;
+    s.state = j->state;
+    s.crc = crc32_of(&s, offsetof(Snapshot, crc));
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return ERR;
+    bool ok = write_all(fd, &s, sizeof(s)) && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return ERR;
+    }
+    fsync_dir(j->dir);
+    j->snap_seq = s.seq;
+    return OK;
+}
+
+static Status compact(Journal *j) {
+    if (write_snapshot(j) != OK) return ERR;
+    /* records up to snap_seq are in the snapshot now; drop them */
+    if (ftruncate(j->fd, 0) != 0 || lseek(j->fd, 0, SEEK_SET) < 0) return ERR;
+    fdatasync(j->fd);
+    j->on_disk = 0;
+    return OK;
+}
+
+static void load_snapshot(Journal *j) {
+    char path[STATE_PATH + 32];
+    state_path(j, path, sizeof(path), "progress.snap");
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == sizeof(Snapshot)) {
+        const Snapshot *s = mmap(NULL, sizeof(Snapshot), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (s != MAP_FAILED) {
+            if (s->magic == SNAP_MAGIC && s->version == 1 &&
+                s->crc == crc32_of(s, offsetof(Snapshot, crc))) {
+                j->state = s->state;
+                j->seq = j->snap_seq = s->seq;
+            } else {
+                fprintf(stderr, "%s: corrupt snapshot ignored\n", path);
+            }
+            munmap((void *)s, sizeof(Snapshot));
+        }
+    }
+    close(fd);
+}
+
+/* Replays valid records past the snapshot; cuts the file at the first
+ * torn or corrupt one. */
+static void replay(Journal *j) {
+    Record r;
+    off_t good = 0;
+    for (;;) {
+        ssize_t n = pread(j->fd, &r, sizeof(r), good);
+        if (n != (ssize_t)sizeof(r)) break;
+        if (r.magic != REC_MAGIC || r.crc != crc32_of(&r, offsetof(Record, crc))) break;
+        if (r.seq > j->seq) {
+            apply(&j->state, r.kind, r.station, r.value);
+            j->seq = r.seq;
+        }
+        good += (off_t)sizeof(r);
+        j->on_disk++;
+    }
+    struct stat st;
+    if (fstat(j->fd, &st) == 0 && st.st_size != good) {
+        fprintf(stderr, "journal: dropped %ld bytes of torn tail\n", (long)(st.st_size - good));
+        if (ftruncate(j->fd, good) == 0) fdatasync(j->fd);
+    }
+    lseek(j->fd, good, SEEK_SET);
+}
+
+/* After a failed commit: keeps only the newest pending record per (kind,
+ * station).  Records carry absolute values, so the older ones add nothing,
+ * and the survivors keep their order and sequence numbers. */
+static void coalesce(Journal *j) {
+    int w = 0;
+    for (int i = 0; i < j->npending; ++i) {
+        const Record *r = &j->pending[i];
+        bool superseded = false;
+        for (int k = i + 1; k < j->npending && !superseded; ++k) {
+            superseded = j->pending[k].kind == r->kind && j->pending[k].station == r->station;
+        }
+        if (!superseded) j->pending[w++] = *r;
+    }
+    j->npending = w;
+}
+
+/* ===== public ===== */
+Journal *journal_open(const char *dir, GameState *state) {
+    crc_init();
+    if (strlen(dir) >= STATE_PATH) {
+        fprintf(stderr, "%s: state path too long\n", dir);
+        return NULL;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror(dir);
+        return NULL;
+    }
+
+    Journal *j = tracked_calloc(1, sizeof(*j));
+    if (!j) return NULL;
+    strcpy(j->dir, dir);
+
+    char path[STATE_PATH + 32];
+    state_path(j, path, sizeof(path), "progress.journal");
+    j->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (j->fd < 0) {
+        perror(path);
+        tracked_free(j);
+        return NULL;
+    }
+
+    load_snapshot(j);
+    replay(j);
+    if (j->on_disk >= JOURNAL_COMPACT_AT) compact(j);
+
+    *state = j->state;
+    return j;
+}
+
+void journal_append(Journal *j, JournalKind kind, int station, int value) {
+    if (!j) return;
+    /* a full batch that cannot be written shrinks instead (disk full, EIO) */
+    if (j->npending == JOURNAL_BATCH && journal_commit(j) != OK) coalesce(j);
+
+    Record *r = &j->pending[j->npending++];
+    memset(r, 0, sizeof(*r));
+    r->magic = REC_MAGIC;
+    r->kind = (uint16_t)kind;
+    r->station = (uint16_t)station;
+    r->seq = ++j->seq;
+    r->value = value;
+    r->crc = crc32_of(r, offsetof(Record, crc));
+    apply(&j->state, kind, station, value);
+}
+
+Status journal_commit(Journal *j) {
+    if (!j || j->npending == 0) return OK;
+
+    size_t bytes = (size_t)j->npending * sizeof(Record);
+    if (!write_all(j->fd, j->pending, bytes) || fdatasync(j->fd) != 0) {
+        perror("journal");
+        /* drop any partial batch so the next commit stays record-aligned */
+        off_t good = (off_t)j->on_disk * (off_t)sizeof(Record);
+        if (ftruncate(j->fd, good) == 0) lseek(j->fd, good, SEEK_SET);
+        return ERR;
+    }
+    j->on_disk += (uint32_t)j->npending;
+    j->npending = 0;
+
+    if (j->on_disk >= JOURNAL_COMPACT_AT) return compact(j);
+    return OK;
+}
+
+void journal_close(Journal *j) {
+    if (!j) return;
+    if (journal_commit(j) == OK && j->on_disk > 0) compact(j);
+    close(j->fd);
+    tracked_free(j);
+}
@@ -0,0 +1,324 @@
+#include "leaderboard.h"
+#include "tracker.h"
+
+#define LB_LEVELS   12          /* 4^12 = 16M entries before levels saturate */
+#define NIL         0u          /* offset 0 is the head, never a successor */
+
+/* Node layout in Board.w, in 32-bit words:
+ *   [0] score  [1] learner (free list: next free node)  [2] levels
+ *   [3 + 2l] next at level l  [4 + 2l] positions that link skips */
+#define N_SCORE(b, n)    ((int32_t)(b)->w[(n)])
+#define N_LEARNER(b, n)  ((b)->w[(n) + 1])
+#define N_LEVELS(b, n)   ((b)->w[(n) + 2])
+#define NEXT(b, n, l)    ((b)->w[(n) + 3 + 2 * (l)])
+#define WIDTH(b, n, l)   ((b)->w[(n) + 4 + 2 * (l)])
+#define NODE_WORDS(lv)   (3u + 2u * (lv))
+
+typedef struct {
+    uint32_t *w;
+    size_t used, cap;               /* words */
+    uint32_t size;                  /* nodes, head excluded */
+    uint32_t free[LB_LEVELS + 1];   /* unlinked nodes by level */
+    uint64_t rng;
+} Board;
+
+typedef struct {
+    uint32_t name;                  /* offset into names */
+    int32_t total;
+    uint16_t station[STATION_COUNT];
+} Learner;
+
+struct Leaderboard {
+    Board boards[LB_BOARDS];
+    Learner *learners;
+    uint32_t count, cap;
+    char *names;
+    size_t names_used, names_cap;
+};
+
+/* ===== one skip list ===== */
+static bool before(int32_t score_a, uint32_t learner_a, int32_t score_b, uint32_t learner_b) {
+    return score_a > score_b || (score_a == score_b && learner_a < learner_b);
+}
+
+static Status board_init(Board *b, uint64_t seed) {
+    memset(b, 0, sizeof(*b));
+    b->cap = 1024;
+    b->w = tracked_malloc(b->cap * sizeof(*b->w));
+    if (!b->w) return ERR;
+    b->used = NODE_WORDS(LB_LEVELS);
+    N_LEVELS(b, 0) = LB_LEVELS;
+    /* empty list: every head link ends at position 1, past the end */
+    for (uint32_t l = 0; l < LB_LEVELS; ++l) {
+        NEXT(b, 0, l) = NIL;
+        WIDTH(b, 0, l) = 1;
+    }
+    b->rng = seed | 1;
+    return OK;
+}
+
+static uint32_t random_levels(Board *b) {
+    uint64_t x = b->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    b->rng = x;
+    uint32_t lv = 1;
+    while ((x & 3) == 0 && lv < LB_LEVELS) {
+        lv++;
+        x >>= 2;
+    }
+    return lv;
+}
+
+/* An unlinked node; NIL when out of memory. */
+static uint32_t node_alloc(Board *b) {
+    uint32_t lv = random_levels(b);
+    uint32_t n = b->free[lv];
+    if (n != NIL) {
+        b->free[lv] = N_LEARNER(b, n);
+        return n;
+    }
+    if (b->used + NODE_WORDS(lv) > b->cap) {
+        size_t cap = b->cap + b->cap / 2;     /* the big arenas: spare at most a third */
+        if (cap > UINT32_MAX) return NIL;
+        uint32_t *w = tracked_realloc(b->w, cap * sizeof(*w));
+        if (!w) return NIL;
+        b->w = w;
+        b->cap = cap;
+    }
+    n = (uint32_t)b->used;
+    b->used += NODE_WORDS(lv);
+    N_LEVELS(b, n) = lv;
+    return n;
+}
+
+static void node_free(Board *b, uint32_t n) {
+    uint32_t lv = N_LEVELS(b, n);
+    N_LEARNER(b, n) = b->free[lv];
+    b->free[lv] = n;
+}
+
+/* Last node before (score, learner) on every level, and its position. */
+static void locate(const Board *b, int32_t score, uint32_t learner,
+                   uint32_t upd[LB_LEVELS], uint32_t pos[LB_LEVELS]) {
+    uint32_t x = 0, p = 0;
+    for (int l = LB_LEVELS - 1; l >= 0; --l) {
+        for (uint32_t nx; (nx = NEXT(b, x, l)) != NIL &&
+                          before(N_SCORE(b, nx), N_LEARNER(b, nx), score, learner);) {
+            p += WIDTH(b, x, l);
+            x = nx;
+        }
+        upd[l] = x;
+        pos[l] = p;
+    }
+}
+
+static void link_node(Board *b, uint32_t n, int32_t score, uint32_t learner) {
+    uint32_t upd[LB_LEVELS], pos[LB_LEVELS];
+    locate(b, score, learner, upd, pos);
+    b->w[n] = (uint32_t)score;
+    N_LEARNER(b, n) = learner;
+    uint32_t r = pos[0] + 1, lv = N_LEVELS(b, n);
+    for (uint32_t l = 0; l < LB_LEVELS; ++l) {
+        if (l < lv) {
+            /* the old successor moves one place down */
+            uint32_t end = pos[l] + WIDTH(b, upd[l], l) + 1;
+            NEXT(b, n, l) = NEXT(b, upd[l], l);
+            NEXT(b, upd[l], l) = n;
+            WIDTH(b, n, l) = end - r;
+            WIDTH(b, upd[l], l) = r - pos[l];
+        } else {
+            WIDTH(b, upd[l], l)++;
+        }
+    }
+    b->size++;
+}
+
+/* Unlinks the node holding (score, learner) and returns it. */
+static uint32_t unlink_node(Board *b, int32_t score, uint32_t learner) {
+    uint32_t upd[LB_LEVELS], pos[LB_LEVELS];
+    locate(b, score, learner, upd, pos);
+    uint32_t n = NEXT(b, upd[0], 0), lv = N_LEVELS(b, n);
+    for (uint32_t l = 0; l < LB_LEVELS; ++l) {
+        if (l < lv) {
+            WIDTH(b, upd[l], l) += WIDTH(b, n, l) - 1;
+            NEXT(b, upd[l], l) = NEXT(b, n, l);
+        } else {
+            WIDTH(b, upd[l], l)--;
+        }
+    }
+    b->size--;
+    return n;
+}
+
+/* Moves a learner from (old) to (now); `was`/`is` say whether it is on
+ * the board before and after. */
+static Status board_move(Board *b, uint32_t learner, bool was, int32_t old, bool is, int32_t now) {
+    uint32_t n;
+    if (was) {
+        n = unlink_node(b, old, learner);
+        if (!is) {
+            node_free(b, n);
+            return OK;
+        }
+    } else {
+        if (!is) return OK;
+        n = node_alloc(b);
+        if (n == NIL) return ERR;
+    }
+    link_node(b, n, now, learner);
+    return OK;
+}
+
+/* 1-based position of (score, learner), or 0. */
+static uint32_t position(const Board *b, int32_t score, uint32_t learner) {
+    uint32_t upd[LB_LEVELS], pos[LB_LEVELS];
+    locate(b, score, learner, upd, pos);
+    uint32_t n = NEXT(b, upd[0], 0);
+    return n != NIL && N_LEARNER(b, n) == learner && N_SCORE(b, n) == score ? pos[0] + 1 : 0;
+}
+
+/* Learner ids start at 0, so (score, 0) sorts first among equal scores. */
+static uint32_t rank_of_score(const Board *b, int32_t score) {
+    uint32_t upd[LB_LEVELS], pos[LB_LEVELS];
+    locate(b, score, 0, upd, pos);
+    return pos[0] + 1;
+}
+
+/* Node at 1-based position k, or NIL. */
+static uint32_t select_pos(const Board *b, uint32_t k) {
+    uint32_t x = 0, p = 0;
+    for (int l = LB_LEVELS - 1; l >= 0; --l) {
+        for (uint32_t nx; (nx = NEXT(b, x, l)) != NIL && p + WIDTH(b, x, l) <= k;) {
+            p += WIDTH(b, x, l);
+            x = nx;
+        }
+    }
+    return p == k && x != 0 ? x : NIL;
+}
+
+/* ===== public ===== */
+Leaderboard *lb_new(void) {
+    Leaderboard *lb = tracked_calloc(1, sizeof(*lb));
+    if (!lb) return NULL;
+    for (int i = 0; i < LB_BOARDS; ++i) {
+        if (board_init(&lb->boards[i], 0x9e3779b97f4a7c15ull * (uint64_t)(i + 1)) != OK) {
+            lb_free(lb);
+            return NULL;
+        }
+    }
+    return lb;
+}
+
+void lb_free(Leaderboard *lb) {
+    if (!lb) return;
+    for (int i = 0; i < LB_BOARDS; ++i) tracked_free(lb->boards[i].w);
+    tracked_free(lb->learners);
+    tracked_free(lb->names);
+    tracked_free(lb);
+}
+
+int32_t lb_join(Leaderboard *lb, const char *name) {
+    if (lb->count == INT32_MAX) return -1;
+    if (lb->count == lb->cap) {
+        uint32_t cap = lb->cap ? lb->cap * 2 : 64;
+        Learner *l = tracked_realloc(lb->learners, cap * sizeof(*l));
+        if (!l) return -1;
+        lb->learners = l;
+        lb->cap = cap;
+    }
+    size_t len = strnlen(name, LB_NAME_MAX - 1);
+    if (lb->names_used + len + 1 > lb->names_cap) {
+        size_t cap = lb->names_cap ? lb->names_cap * 2 : 1024;
+        char *names = tracked_realloc(lb->names, cap);
+        if (!names) return -1;
+        lb->names = names;
+        lb->names_cap = cap;
+    }
+    uint32_t id = lb->count;
+    if (board_move(&lb->boards[LB_OVERALL], id, false, 0, true, 0) != OK) return -1;
+
+    Learner *l = &lb->learners[id];
+    memset(l, 0, sizeof(*l));
+    l->name = (uint32_t)lb->names_used;
+    memcpy(lb->names + lb->names_used, name, len);
+    lb->names[lb->names_used + len] = '\0';
+    lb->names_used += len + 1;
+    lb->count++;
+    return (int32_t)id;
+}
+
+Status lb_set(Leaderboard *lb, uint32_t learner, int station, int score) {
+    if (learner >= lb->count || station < 0 || station >= STATION_COUNT) return ERR;
+    if (score < 0) score = 0;
+    if (score > UINT16_MAX) score = UINT16_MAX;
+    Learner *l = &lb->learners[learner];
+    int old = l->station[station];
+    if (old == score) return OK;
+    if (board_move(&lb->boards[1 + station], learner, old > 0, old, score > 0, score) != OK) {
+        return ERR;
+    }
+    int32_t total = l->total + score - old;
+    board_move(&lb->boards[LB_OVERALL], learner, true, l->total, true, total);  /* no alloc */
+    l->station[station] = (uint16_t)score;
+    l->total = total;
+    return OK;
+}
+
+uint32_t lb_learners(const Leaderboard *lb) {
+    return lb->count;
+}
+
+uint32_t lb_size(const Leaderboard *lb, int board) {
+    return board >= 0 && board < LB_BOARDS ? lb->boards[board].size : 0;
+}
+
+const char *lb_name(const Leaderboard *lb, uint32_t learner) {
+    return learner < lb->count ? lb->names + lb->learners[learner].name : "?";
+}
+
+int32_t lb_score(const Leaderboard *lb, int board, uint32_t learner) {
+    if (learner >= lb->count || board < 0 || board >= LB_BOARDS) return 0;
+    const Learner *l = &lb->learners[learner];
+    return board == LB_OVERALL ? l->total : l->station[board - 1];
+}
+
+uint32_t lb_rank(const Leaderboard *lb, int board, uint32_t learner) {
+    if (learner >= lb->count || board < 0 || board >= LB_BOARDS) return 0;
+    int32_t score = lb_score(lb, board, learner);
+    if (board != LB_OVERALL && score == 0) return 0;
+    return rank_of_score(&lb->boards[board], score);
+}
+
+size_t lb_top(const Leaderboard *lb, int board, uint32_t first, LbEntry *out, size_t max) {
+    if (board < 0 || board >= LB_BOARDS || max == 0) return 0;
+    const Board *b = &lb->boards[board];
+    uint32_t n = select_pos(b, first ? first : 1);
+    size_t k = 0;
+    for (uint32_t p = first ? first : 1; n != NIL && k < max; n = NEXT(b, n, 0), ++p, ++k) {
+        int32_t score = N_SCORE(b, n);
+        out[k].learner = N_LEARNER(b, n);
+        out[k].score = score;
+        if (k == 0) out[k].rank = rank_of_score(b, score);
+        else out[k].rank = score == out[k - 1].score ? out[k - 1].rank : p;
+    }
+    return k;
+}
+
+size_t lb_around(const Leaderboard *lb, int board, uint32_t learner, uint32_t radius,
+                 LbEntry *out, size_t max) {
+    int32_t score = lb_score(lb, board, learner);
+    if (learner >= lb->count || (board != LB_OVERALL && score == 0)) return 0;
+    uint32_t p = position(&lb->boards[board], score, learner);
+    if (!p) return 0;
+    uint32_t first = p > radius ? p - radius : 1;
+    size_t want = (size_t)(p - first) + radius + 1;
+    return lb_top(lb, board, first, out, want < max ? want : max);
+}
+
+size_t lb_bytes(const Leaderboard *lb) {
+    size_t bytes = sizeof(*lb) + (size_t)lb->cap * sizeof(Learner) + lb->names_cap;
+    for (int i = 0; i < LB_BOARDS; ++i) bytes += lb->boards[i].cap * sizeof(uint32_t);
+    return bytes;
+}
@@ -1,8 +1,128 @@
 #include "shell.h"
+#include "serve.h"
+#include "grade.h"
+#include "bank.h"
+#include "cachelab.h"
+#include "hotbank.h"
+#include "reclog.h"
+#include "replay.h"
+#include "sandbox.h"
+#include "tracker.h"
+
+#define MAX_BANKS STATION_COUNT
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--bank <file.bank>]... [--bank-dir <dir>] [--stats <file.prom>] [--lab-max <MiB>]\n"
+                    "       [--sandbox-workers <n>] [--sandbox-cache <dir>] [--sandbox-unjailed]\n"
+                    "       [--state <dir> | --serve <socket>]\n"
+                    "       [--record <file.rec|off>]\n"
+                    "       [--bank <file.bank>]... --grade <dir> [--grade-workers <n>] [--report <file.csv|.json>]\n"
+                    "       [--bank <file.bank>]... --replay <file.rec> [--pace <x>]\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    static BankFile banks[MAX_BANKS];
+    int nbanks = 0;
+    const char *serve_path = NULL;
+    const char *state_dir = NULL;
+    const char *bank_dir = NULL;
+    const char *sandbox_cache = NULL;
+    const char *record = NULL;
+    const char *replay = NULL;
+    double pace = 0;
+    int sandbox_workers = -1;
+    bool sandbox_unjailed = false;
+    GradeOptions grade = { NULL, NULL, 0 };
+
+    tracker_install_exit_report();
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (strcmp(argv[i], "--grade") == 0 && i + 1 < argc) {
+            grade.dir = argv[++i];
+        } else if (strcmp(argv[i], "--grade-workers") == 0 && i + 1 < argc) {
+            grade.workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            grade.report = argv[++i];
+        } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+            state_dir = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+        } else if (strcmp(argv[i], "--pace") == 0 && i + 1 < argc) {
+            pace = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--sandbox-workers") == 0 && i + 1 < argc) {
+            sandbox_workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sandbox-cache") == 0 && i + 1 < argc) {
+            sandbox_cache = argv[++i];
+        } else if (strcmp(argv[i], "--sandbox-unjailed") == 0) {
+            sandbox_unjailed = true;
+        } else if (strcmp(argv[i], "--lab-max") == 0 && i + 1 < argc) {
+            cachelab_set_max_bytes((size_t)strtoull(argv[++i], NULL, 10) << 20);
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            shell_set_stats_file(argv[++i]);
+        } else if (strcmp(argv[i], "--bank-dir") == 0 && i + 1 < argc) {
+            bank_dir = argv[++i];
+        } else if (strcmp(argv[i], "--bank") == 0 && i + 1 < argc && nbanks < MAX_BANKS) {
+            BankFile *bf = &banks[nbanks];
+            if (bank_open(bf, argv[++i]) != OK) return 1;
+            if (shell_use_bank(bf->station_id, &bf->bank) != OK) {
+                fprintf(stderr, "%s: no station %02d\n", argv[i], bf->station_id);
+                return 1;
+            }
+            nbanks++;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    /* a batch grade sees one snapshot of the directory */
+    if (bank_dir && hotbank_open(bank_dir, !grade.dir) != OK) return 1;
+
+    /* workers fork lazily on the first code submission */
+    sandbox_configure(sandbox_workers, sandbox_cache, sandbox_unjailed);
+
+    int rc = 0;
+    if (grade.dir) {
+        /* no REPL: the report is the only thing on stdout */
+        rc = grade_run(&grade);
+        sandbox_stop();
+        shell_release_banks();
+        hotbank_close();
+        for (int i = 0; i < nbanks; ++i) bank_close(&banks[i]);
+        return rc;
+    }
+
+    /* always on unless turned off; a replay records nothing */
+    char rec_path[512];
+    if (!replay && !(record && strcmp(record, "off") == 0)) {
+        if (!record && state_dir) {
+            snprintf(rec_path, sizeof(rec_path), "%s/session.rec", state_dir);
+            record = rec_path;
+        }
+        if (!record) record = "c_arcade.rec";
+        if (reclog_open(record) != OK) fprintf(stderr, "%s: not recording this run\n", record);
+    }
 
-int main(void) {
     shell_init();
-    shell_loop();
+    if (replay) {
+        rc = replay_run(replay, pace);
+    } else if (serve_path) {
+        rc = serve_run(serve_path);
+    } else if (state_dir && shell_open_state(state_dir) != OK) {
+        rc = 1;
+    } else {
+        shell_loop();
+    }
     shell_teardown();
-    return 0;
+    reclog_close();
+    sandbox_stop();
+    hotbank_close();
+
+    for (int i = 0; i < nbanks; ++i) bank_close(&banks[i]);
+    return rc;
 }
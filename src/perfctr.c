@@ -0,0 +1,47 @@
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include "perfctr.h"
+
+bool perf_counter_open(PerfCounter *c, uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    c->fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    return c->fd >= 0;
+}
+
+void perf_counter_start(PerfCounter *c) {
+    if (c->fd < 0) return;
+    ioctl(c->fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(c->fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+bool perf_counter_stop(PerfCounter *c, uint64_t *count) {
+    if (c->fd < 0) return false;
+    ioctl(c->fd, PERF_EVENT_IOC_DISABLE, 0);
+    return read(c->fd, count, sizeof(*count)) == (ssize_t)sizeof(*count);
+}
+
+void perf_counter_close(PerfCounter *c) {
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+}
+
+const char *perf_counter_why(int err) {
+    switch (err) {
+        case EACCES:
+        case EPERM:      return "not permitted (see kernel.perf_event_paranoid)";
+        case ENOENT:
+        case EOPNOTSUPP: return "no hardware PMU visible to this system";
+        case ENOSYS:     return "perf_event_open is not available";
+        default:         return strerror(err);
+    }
+}
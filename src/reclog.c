@@ -0,0 +1,320 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "reclog.h"
+
+#define REC_MAX (MAX_INPUT + 32 + STATION_COUNT * 12)     /* one encoded record */
+
+/* ===== writer ===== */
+static struct {
+    int fd;                         /* -1 = off */
+    uint64_t head, tail;            /* bytes appended / bytes written */
+    uint64_t last_us;               /* previous record */
+    uint64_t oldest_us;             /* first record not yet written */
+    uint32_t streams;
+    unsigned char ring[RECLOG_RING];
+} W = { .fd = -1 };
+
+static uint64_t mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static size_t put_varint(unsigned char *p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char)v;
+    return n;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static size_t put_str(unsigned char *p, const char *s, size_t max) {
+    size_t len = strnlen(s, max);
+    size_t n = put_varint(p, len);
+    memcpy(p + n, s, len);
+    return n + len;
+}
+
+/* Writes everything pending.  A failed write turns recording off. */
+static void flush(void) {
+    while (W.fd >= 0 && W.tail < W.head) {
+        size_t off = (size_t)(W.tail % RECLOG_RING), len = (size_t)(W.head - W.tail);
+        struct iovec iov[2] = { { W.ring + off, len } };
+        int cnt = 1;
+        if (off + len > RECLOG_RING) {
+            iov[0].iov_len = RECLOG_RING - off;
+            iov[1] = (struct iovec){ W.ring, len - iov[0].iov_len };
+            cnt = 2;
+        }
+        ssize_t n = writev(W.fd, iov, cnt);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            perror("reclog: write");
+            close(W.fd);
+            W.fd = -1;
+            return;
+        }
+        W.tail += (uint64_t)n;
+    }
+}
+
+/* Header (kind, dt, stream) in front of `payload`, into the ring. */
+static void emit(RecKind kind, uint32_t stream, const unsigned char *payload, size_t len) {
+    unsigned char head[1 + 10 + 5];
+    uint64_t now = mono_us();
+    size_t h = 0;
+    head[h++] = (unsigned char)kind;
+    h += put_varint(head + h, now - W.last_us);
+    h += put_varint(head + h, stream);
+    W.last_us = now;
+
+    if (W.head - W.tail + h + len > RECLOG_RING) flush();
+    if (W.fd < 0) return;
+    if (W.head == W.tail) W.oldest_us = now;
+    const unsigned char *parts[2] = { head, payload };
+    size_t lens[2] = { h, len };
+    for (int k = 0; k < 2 && lens[k]; ++k) {
+        size_t off = (size_t)(W.head % RECLOG_RING), first = RECLOG_RING - off;
+        if (first > lens[k]) first = lens[k];
+        memcpy(W.ring + off, parts[k], first);
+        memcpy(W.ring, parts[k] + first, lens[k] - first);
+        W.head += lens[k];
+    }
+    if (W.head - W.tail >= RECLOG_BATCH || now - W.oldest_us >= RECLOG_MAX_AGE_MS * 1000u) {
+        flush();
+    }
+}
+
+Status reclog_open(const char *path) {
+    reclog_close();
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return ERR;
+    }
+    if (st.st_size == 0 && write(fd, RECLOG_MAGIC, 8) != 8) {
+        perror(path);
+        close(fd);
+        return ERR;
+    }
+    W.fd = fd;
+    W.head = W.tail = 0;
+    W.streams = 0;
+    W.last_us = mono_us();
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    unsigned char p[10];
+    emit(REC_BEGIN, 0, p,
+         put_varint(p, (uint64_t)wall.tv_sec * 1000000000u + (uint64_t)wall.tv_nsec));
+    return OK;
+}
+
+void reclog_close(void) {
+    if (W.fd < 0) return;
+    flush();
+    if (W.fd >= 0) close(W.fd);
+    W.fd = -1;
+}
+
+bool reclog_active(void) {
+    return W.fd >= 0;
+}
+
+int reclog_due_ms(void) {
+    if (W.fd < 0 || W.head == W.tail) return -1;
+    uint64_t age = mono_us() - W.oldest_us, max = RECLOG_MAX_AGE_MS * 1000u;
+    return age >= max ? 0 : (int)((max - age + 999) / 1000);
+}
+
+void reclog_tick(void) {
+    if (reclog_due_ms() == 0) flush();
+}
+
+uint32_t reclog_stream_open(const char *name, uint32_t flags, uint64_t salt, const GameState *g) {
+    if (W.fd < 0) return 0;
+    unsigned char p[REC_MAX];
+    size_t n = put_varint(p, flags);
+    n += put_varint(p + n, salt);
+    n += put_str(p + n, name, RECLOG_NAME_MAX);
+    n += put_varint(p + n, STATION_COUNT);
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        n += put_varint(p + n, zigzag(g->station_scores[s]));
+        n += put_varint(p + n, zigzag(g->attempted[s]));
+        p[n++] = g->completed[s];
+    }
+    uint32_t id = ++W.streams;
+    emit(REC_OPEN, id, p, n);
+    return id;
+}
+
+void reclog_stream_close(uint32_t stream) {
+    if (!stream || W.fd < 0) return;
+    emit(REC_CLOSE, stream, NULL, 0);
+    flush();
+}
+
+void reclog_input(uint32_t stream, const char *line) {
+    if (!stream || W.fd < 0) return;
+    unsigned char p[MAX_INPUT + 8];
+    size_t len = strk_eol(line, strnlen(line, MAX_INPUT - 1));
+    size_t n = put_varint(p, len);
+    memcpy(p + n, line, len);
+    emit(REC_INPUT, stream, p, n + len);
+}
+
+void reclog_dispatch(uint32_t stream, const char *target) {
+    if (!stream || W.fd < 0) return;
+    unsigned char p[RECLOG_NAME_MAX + 8];
+    emit(REC_DISPATCH, stream, p, put_str(p, target, RECLOG_NAME_MAX));
+}
+
+void reclog_grade(uint32_t stream, int station_id, int task, EngineGrade grade) {
+    if (!stream || W.fd < 0) return;
+    unsigned char p[24];
+    size_t n = put_varint(p, (uint64_t)station_id);
+    n += put_varint(p + n, (uint64_t)task);
+    p[n++] = (unsigned char)grade;
+    emit(REC_GRADE, stream, p, n);
+}
+
+/* ===== reader ===== */
+static bool get_varint(RecReader *r, uint64_t *v) {
+    uint64_t x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->p >= r->end) return false;
+        unsigned char b = *r->p++;
+        x |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = x;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool get_int(RecReader *r, int *v) {
+    uint64_t z;
+    if (!get_varint(r, &z)) return false;
+    *v = (int)((int64_t)(z >> 1) ^ -(int64_t)(z & 1));
+    return true;
+}
+
+static bool get_str(RecReader *r, char *dst, size_t cap) {
+    uint64_t len;
+    if (!get_varint(r, &len) || len >= cap || len > (uint64_t)(r->end - r->p)) return false;
+    memcpy(dst, r->p, (size_t)len);
+    dst[len] = '\0';
+    r->p += len;
+    return true;
+}
+
+Status reclog_reader_open(RecReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return ERR;
+    }
+    r->map_len = (size_t)st.st_size;
+    r->map = r->map_len ? mmap(NULL, r->map_len, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (r->map == MAP_FAILED || r->map_len < 8 || memcmp(r->map, RECLOG_MAGIC, 8) != 0) {
+        if (r->map != MAP_FAILED) munmap(r->map, r->map_len);
+        r->map = NULL;
+        fprintf(stderr, "%s: not a session log\n", path);
+        return ERR;
+    }
+    r->p = (const unsigned char *)r->map + 8;
+    r->end = (const unsigned char *)r->map + r->map_len;
+    return OK;
+}
+
+bool reclog_next(RecReader *r, RecEvent *ev) {
+    uint64_t dt, stream, v;
+    if (r->p >= r->end) return false;
+    ev->kind = (RecKind)*r->p++;
+    if (!get_varint(r, &dt) || !get_varint(r, &stream)) return false;
+    ev->stream = (uint32_t)stream;
+    ev->text[0] = '\0';
+    r->t_us += dt;
+
+    switch (ev->kind) {
+        case REC_BEGIN:
+            if (!get_varint(r, &ev->wall_ns)) return false;
+            r->t_us = 0;
+            break;
+        case REC_OPEN: {
+            uint64_t stations, flags;
+            if (!get_varint(r, &flags) || !get_varint(r, &ev->salt) ||
+                !get_str(r, ev->text, RECLOG_NAME_MAX + 1) || !get_varint(r, &stations)) {
+                return false;
+            }
+            ev->flags = (uint32_t)flags;
+            memset(&ev->g, 0, sizeof(ev->g));
+            for (uint64_t s = 0; s < stations; ++s) {
+                int score, attempted;
+                if (!get_int(r, &score) || !get_int(r, &attempted) || r->p >= r->end) return false;
+                bool done = *r->p++ != 0;
+                if (s >= STATION_COUNT) continue;       /* logged by a build with more */
+                ev->g.station_scores[s] = score;
+                ev->g.attempted[s] = attempted;
+                ev->g.completed[s] = done;
+                ev->g.total_score += score;
+            }
+            break;
+        }
+        case REC_INPUT:
+            if (!get_str(r, ev->text, sizeof(ev->text))) return false;
+            break;
+        case REC_DISPATCH:
+            if (!get_str(r, ev->text, RECLOG_NAME_MAX + 1)) return false;
+            break;
+        case REC_GRADE:
+            if (!get_varint(r, &v)) return false;
+            ev->station_id = (int)v;
+            if (!get_varint(r, &v)) return false;
+            ev->task = (int)v;
+            if (r->p >= r->end) return false;
+            ev->grade = (EngineGrade)*r->p++;
+            break;
+        case REC_CLOSE:
+            break;
+        default:
+            return false;
+    }
+    ev->t_us = r->t_us;
+    return true;
+}
+
+void reclog_reader_close(RecReader *r) {
+    if (r->map) munmap(r->map, r->map_len);
+    memset(r, 0, sizeof(*r));
+}
+
+const char *reclog_grade_name(EngineGrade grade) {
+    switch (grade) {
+        case GRADE_NONE: return "-";
+        case GRADE_WRONG: return "wrong";
+        case GRADE_CORRECT: return "correct";
+        case GRADE_PARTIAL: return "partial";
+        case GRADE_SKIPPED: return "skipped";
+    }
+    return "?";
+}
@@ -0,0 +1,214 @@
+#include <time.h>
+
+#include "replay.h"
+#include "reclog.h"
+#include "shell.h"
+#include "tracker.h"
+
+#define REPLAY_OUT_CAP 16384
+
+typedef struct {
+    Shell sh;
+    char name[RECLOG_NAME_MAX + 1];
+    bool open;
+    bool grade_checked;         /* the last line's recorded grade was seen */
+} Stream;
+
+typedef struct {
+    Stream **streams;           /* by stream id; reset by each REC_BEGIN */
+    uint32_t cap;
+    uint32_t current;           /* stream whose output was printed last */
+    uint64_t inputs, grades, diffs;
+    EngineOut out;
+    char buf[REPLAY_OUT_CAP];
+} Replay;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void sleep_until_us(uint64_t t) {
+    uint64_t now = now_us();
+    if (t <= now) return;
+    struct timespec d = { (time_t)((t - now) / 1000000u), (long)((t - now) % 1000000u) * 1000 };
+    while (nanosleep(&d, &d) != 0) {}
+}
+
+/* Stream output to stdout, with a banner when the speaker changes. */
+static void emit(Replay *rp, uint32_t id) {
+    if (rp->out.len == 0) return;
+    if (id != rp->current) {
+        printf(C_DIM "--- %s (stream %u) ---" C_RESET "\n", rp->streams[id]->name, id);
+        rp->current = id;
+    }
+    fwrite(rp->out.data, 1, rp->out.len, stdout);
+    engine_out_reset(&rp->out);
+}
+
+static Stream *stream_at(Replay *rp, uint32_t id) {
+    return id < rp->cap && rp->streams[id] && rp->streams[id]->open ? rp->streams[id] : NULL;
+}
+
+static void differ(Replay *rp, uint32_t id, const char *what, const char *was, const char *now) {
+    rp->diffs++;
+    fprintf(stderr, "replay: %s (stream %u): %s was %s, now %s\n", rp->streams[id]->name, id,
+            what, was, now);
+}
+
+/* The previous line graded in replay but not in the recording. */
+static void check_unrecorded_grade(Replay *rp, uint32_t id) {
+    Stream *s = rp->streams[id];
+    if (!s->grade_checked && s->sh.last_grade != GRADE_NONE) {
+        char now[48];
+        snprintf(now, sizeof(now), "%s (%02d task %d)", reclog_grade_name(s->sh.last_grade),
+                 s->sh.last_station, s->sh.last_task + 1);
+        differ(rp, id, "grade", "none", now);
+    }
+    s->grade_checked = true;
+}
+
+static void close_stream(Replay *rp, uint32_t id) {
+    Stream *s = rp->streams[id];
+    check_unrecorded_grade(rp, id);
+    s->open = false;
+    if (!s->sh.quit) shell_session_close(&s->sh, &rp->out);
+    emit(rp, id);
+    shell_session_free(&s->sh);
+}
+
+static void close_all(Replay *rp) {
+    for (uint32_t i = 0; i < rp->cap; ++i) {
+        if (rp->streams[i] && rp->streams[i]->open) {
+            check_unrecorded_grade(rp, i);
+            rp->streams[i]->open = false;
+            shell_session_free(&rp->streams[i]->sh);
+        }
+        tracked_free(rp->streams[i]);
+        rp->streams[i] = NULL;
+    }
+    rp->current = 0;
+}
+
+static Status open_stream(Replay *rp, const RecEvent *ev) {
+    if (ev->stream >= rp->cap) {
+        uint32_t cap = rp->cap ? rp->cap * 2 : 16;
+        while (cap <= ev->stream) cap *= 2;
+        Stream **grown = tracked_realloc(rp->streams, cap * sizeof(*grown));
+        if (!grown) return ERR;
+        memset(grown + rp->cap, 0, (cap - rp->cap) * sizeof(*grown));
+        rp->streams = grown;
+        rp->cap = cap;
+    }
+    Stream *s = rp->streams[ev->stream];
+    if (!s && !(s = rp->streams[ev->stream] = tracked_calloc(1, sizeof(*s)))) return ERR;
+    if (s->open) shell_session_free(&s->sh);
+
+    shell_session_init(&s->sh, false);
+    s->sh.g = ev->g;
+    s->sh.salt = ev->salt;
+    memcpy(s->name, ev->text, sizeof(s->name) - 1);    /* the reader stops names there */
+    shell_session_join(&s->sh, s->name);        /* off the board if out of memory */
+    s->open = true;
+    s->grade_checked = true;
+    return OK;
+}
+
+/* The log keeps lines without their EOL.  Front ends only hand over a
+ * line without one when it was cut at MAX_INPUT-1 bytes, and a code task
+ * needs to know which it was (engine.c code_line). */
+static void feed_input(Stream *s, const char *text, EngineOut *out) {
+    char line[MAX_INPUT + 1];
+    size_t len = strnlen(text, MAX_INPUT - 1);
+    memcpy(line, text, len);
+    if (len < MAX_INPUT - 1) line[len++] = '\n';
+    line[len] = '\0';
+    shell_session_feed(&s->sh, line, out);
+}
+
+static void on_grade(Replay *rp, const RecEvent *ev) {
+    Stream *s = rp->streams[ev->stream];
+    const Shell *sh = &s->sh;
+    rp->grades++;
+    s->grade_checked = true;
+    if (sh->last_grade != ev->grade || sh->last_station != ev->station_id ||
+        sh->last_task != ev->task) {
+        char was[48], now[48];
+        snprintf(was, sizeof(was), "%s (%02d task %d)", reclog_grade_name(ev->grade),
+                 ev->station_id, ev->task + 1);
+        snprintf(now, sizeof(now), "%s (%02d task %d)", reclog_grade_name(sh->last_grade),
+                 sh->last_station, sh->last_task + 1);
+        differ(rp, ev->stream, "grade", was, now);
+    }
+}
+
+int replay_run(const char *log_path, double pace) {
+    RecReader rd;
+    if (reclog_reader_open(&rd, log_path) != OK) return 1;
+    Replay *rp = tracked_calloc(1, sizeof(*rp));
+    if (!rp) {
+        reclog_reader_close(&rd);
+        return 1;
+    }
+    engine_out_init(&rp->out, rp->buf, sizeof(rp->buf));
+
+    RecEvent ev;
+    uint64_t t0 = now_us(), run_start = t0, runs = 0, streams = 0;
+    bool oom = false;
+    while (!oom && reclog_next(&rd, &ev)) {
+        if (ev.kind == REC_BEGIN) {
+            close_all(rp);
+            run_start = now_us();
+            runs++;
+            continue;
+        }
+        if (ev.kind == REC_OPEN) {
+            oom = open_stream(rp, &ev) != OK;
+            streams++;
+            continue;
+        }
+        Stream *s = stream_at(rp, ev.stream);
+        if (!s) continue;                       /* opened before a torn tail */
+        switch (ev.kind) {
+            case REC_INPUT:
+                check_unrecorded_grade(rp, ev.stream);
+                if (pace > 0) sleep_until_us(run_start + (uint64_t)((double)ev.t_us / pace));
+                feed_input(s, ev.text, &rp->out);
+                s->grade_checked = false;
+                rp->inputs++;
+                emit(rp, ev.stream);
+                fflush(stdout);
+                break;
+            case REC_DISPATCH:
+                if (strcmp(s->sh.last_target, ev.text) != 0) {
+                    differ(rp, ev.stream, "dispatch", ev.text[0] ? ev.text : "session",
+                           s->sh.last_target[0] ? s->sh.last_target : "session");
+                }
+                break;
+            case REC_GRADE:
+                on_grade(rp, &ev);
+                break;
+            case REC_CLOSE:
+                close_stream(rp, ev.stream);
+                break;
+            default:
+                break;
+        }
+    }
+    bool torn = rd.p < rd.end;
+    close_all(rp);
+    fflush(stdout);
+
+    fprintf(stderr, "replay: %llu run%s, %llu stream%s, %llu inputs, %llu grades; %llu differ "
+            "(%.1f ms)%s\n", (unsigned long long)runs, runs == 1 ? "" : "s",
+            (unsigned long long)streams, streams == 1 ? "" : "s",
+            (unsigned long long)rp->inputs, (unsigned long long)rp->grades,
+            (unsigned long long)rp->diffs, (double)(now_us() - t0) / 1000.0,
+            torn ? "; log ends in a torn record" : "");
+    int rc = oom ? 1 : rp->diffs ? 1 : 0;
+    tracked_free(rp->streams);
+    tracked_free(rp);
+    reclog_reader_close(&rd);
+    return rc;
+}
@@ -0,0 +1,200 @@
+#include <unistd.h>
+
+#include "review.h"
+#include "tracker.h"
+
+#define REVIEW_MAGIC   0x57564552u  /* "REVW" */
+#define REVIEW_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t station_tasks[STATION_COUNT];  /* layout the cards were saved with */
+} ReviewHeader;
+
+struct ReviewDeck {
+    ReviewCard *cards;
+    uint32_t *heap;             /* card ids, min-heap on (due, id) */
+    uint32_t *pos;              /* card id -> heap slot */
+    uint32_t count, cap;
+    uint32_t station_base[STATION_COUNT];
+    uint32_t station_tasks[STATION_COUNT];
+};
+
+/* ===== heap ===== */
+static bool before(const ReviewDeck *d, uint32_t a, uint32_t b) {
+    uint32_t da = d->cards[a].due, db = d->cards[b].due;
+    return da < db || (da == db && a < b);
+}
+
+static void heap_set(ReviewDeck *d, uint32_t slot, uint32_t id) {
+    d->heap[slot] = id;
+    d->pos[id] = slot;
+}
+
+static void sift_up(ReviewDeck *d, uint32_t slot) {
+    uint32_t id = d->heap[slot];
+    while (slot > 0) {
+        uint32_t parent = (slot - 1) / 2;
+        if (!before(d, id, d->heap[parent])) break;
+        heap_set(d, slot, d->heap[parent]);
+        slot = parent;
+    }
+    heap_set(d, slot, id);
+}
+
+static void sift_down(ReviewDeck *d, uint32_t slot) {
+    uint32_t id = d->heap[slot];
+    for (;;) {
+        uint32_t child = 2 * slot + 1;
+        if (child >= d->count) break;
+        if (child + 1 < d->count && before(d, d->heap[child + 1], d->heap[child])) child++;
+        if (!before(d, d->heap[child], id)) break;
+        heap_set(d, slot, d->heap[child]);
+        slot = child;
+    }
+    heap_set(d, slot, id);
+}
+
+static void heapify(ReviewDeck *d) {
+    for (uint32_t i = 0; i < d->count; ++i) heap_set(d, i, i);
+    for (uint32_t i = d->count / 2; i-- > 0;) sift_down(d, i);
+}
+
+/* ===== deck ===== */
+ReviewDeck *review_deck_new(void) {
+    return tracked_calloc(1, sizeof(ReviewDeck));
+}
+
+void review_deck_free(ReviewDeck *d) {
+    if (!d) return;
+    tracked_free(d->cards);
+    tracked_free(d->heap);
+    tracked_free(d->pos);
+    tracked_free(d);
+}
+
+uint32_t review_deck_size(const ReviewDeck *d) {
+    return d->count;
+}
+
+static bool reserve(ReviewDeck *d, uint32_t need) {
+    if (need <= d->cap) return true;
+    uint32_t cap = d->cap ? d->cap : 64;
+    while (cap < need) cap *= 2;
+    ReviewCard *cards = tracked_realloc(d->cards, cap * sizeof(*cards));
+    if (!cards) return false;
+    d->cards = cards;
+    uint32_t *heap = tracked_realloc(d->heap, cap * sizeof(*heap));
+    if (!heap) return false;
+    d->heap = heap;
+    uint32_t *pos = tracked_realloc(d->pos, cap * sizeof(*pos));
+    if (!pos) return false;
+    d->pos = pos;
+    d->cap = cap;
+    return true;
+}
+
+Status review_deck_add(ReviewDeck *d, int station, uint32_t task_count) {
+    if (station < 0 || station >= STATION_COUNT || d->station_tasks[station]) return ERR;
+    if (task_count == 0) return OK;
+    if (task_count > UINT32_MAX - d->count || !reserve(d, d->count + task_count)) return ERR;
+
+    d->station_base[station] = d->count;
+    d->station_tasks[station] = task_count;
+    for (uint32_t t = 0; t < task_count; ++t) {
+        uint32_t id = d->count++;
+        d->cards[id] = (ReviewCard){ 0, t, 0, REVIEW_EASE_INIT, (uint8_t)station, 0, 0 };
+        /* due 0 and ascending ids: appending keeps the heap valid */
+        heap_set(d, id, id);
+    }
+    return OK;
+}
+
+int32_t review_next(const ReviewDeck *d) {
+    return d->count ? (int32_t)d->heap[0] : -1;
+}
+
+const ReviewCard *review_card(const ReviewDeck *d, uint32_t id) {
+    return id < d->count ? &d->cards[id] : NULL;
+}
+
+void review_grade(ReviewDeck *d, uint32_t id, int quality, uint32_t now) {
+    if (id >= d->count) return;
+    ReviewCard *c = &d->cards[id];
+    if (quality < 0) quality = 0;
+    if (quality > 5) quality = 5;
+
+    /* SM-2: EF' = EF + 0.1 - (5-q)(0.08 + (5-q)0.02), floored at 1.3 */
+    int miss = 5 - quality;
+    int ease = (int)c->ease + 10 - miss * (8 + miss * 2);
+    c->ease = (uint16_t)(ease < REVIEW_EASE_MIN ? REVIEW_EASE_MIN : ease);
+
+    uint32_t delay;
+    if (quality < 3) {
+        if (c->reps) c->lapses++;
+        c->reps = 0;
+        c->interval = 1;
+        delay = REVIEW_RELEARN_SECS;
+    } else {
+        uint32_t days = c->reps == 0 ? 1
+                      : c->reps == 1 ? 6
+                      : (c->interval * c->ease + 50) / 100;
+        c->interval = (uint16_t)(days > UINT16_MAX ? UINT16_MAX : days);
+        if (c->reps < UINT8_MAX) c->reps++;
+        delay = c->interval * REVIEW_DAY;
+    }
+    c->due = now > UINT32_MAX - delay ? UINT32_MAX : now + delay;
+
+    /* due only moves forward from the past, but a card can also be graded
+     * while not yet due; fix the heap both ways */
+    sift_up(d, d->pos[id]);
+    sift_down(d, d->pos[id]);
+}
+
+/* ===== persistence ===== */
+Status review_save(const ReviewDeck *d, const char *path) {
+    char tmp[512];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return ERR;
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return ERR;
+
+    ReviewHeader h = { REVIEW_MAGIC, REVIEW_VERSION, d->count, {0} };
+    memcpy(h.station_tasks, d->station_tasks, sizeof(h.station_tasks));
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if (ok && d->count) ok = fwrite(d->cards, sizeof(*d->cards), d->count, f) == d->count;
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return ERR;
+    }
+    return OK;
+}
+
+Status review_load(ReviewDeck *d, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return ERR;
+
+    ReviewHeader h;
+    Status st = ERR;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != REVIEW_MAGIC ||
+        h.version != REVIEW_VERSION) {
+        goto out;
+    }
+    ReviewCard c;
+    for (uint32_t i = 0; i < h.count; ++i) {
+        if (fread(&c, sizeof(c), 1, f) != 1) goto out;
+        if (c.station >= STATION_COUNT) continue;
+        uint32_t n = d->station_tasks[c.station];
+        if (n == 0 || n != h.station_tasks[c.station] || c.task >= n) continue;
+        d->cards[d->station_base[c.station] + c.task] = c;
+    }
+    st = OK;
+out:
+    fclose(f);
+    heapify(d);
+    return st;
+}
@@ -0,0 +1,162 @@
+#include "router.h"
+
+/* Build-time key list: explicit names first, then the unique prefixes. */
+typedef struct {
+    char key[ROUTER_KEY_MAX];
+    uint8_t len;
+    bool prefix;
+    int16_t value;
+    uint64_t hash;
+} Key;
+
+static inline unsigned char fold(unsigned char c) {
+    return (unsigned char)(c - 'A') < 26 ? (unsigned char)(c | 0x20) : c;
+}
+
+/* FNV-1a over the case-folded bytes, then an avalanche. */
+static uint64_t key_hash(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= fold((unsigned char)s[i]);
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+/* Displacement d re-mixes the whole hash, so two keys that collide for
+ * one d are independent for the next. */
+static inline uint32_t slot_of(uint64_t h, uint32_t d, uint32_t mask) {
+    uint64_t x = h ^ (d * 0x9e3779b97f4a7c15ull);
+    x ^= x >> 29;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 32;
+    return (uint32_t)x & mask;
+}
+
+static int find_key(const Key *keys, size_t n, const char *s, size_t len) {
+    for (size_t i = 0; i < n; ++i) {
+        if (keys[i].len == len && memcmp(keys[i].key, s, len) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/* Adds every prefix of an explicit key that no other value shares and
+ * that is not itself an explicit key. */
+static Status add_prefixes(Key *keys, size_t *n, size_t explicit) {
+    for (size_t k = 0; k < explicit; ++k) {
+        for (uint8_t len = 1; len < keys[k].len; ++len) {
+            bool unique = true;
+            for (size_t o = 0; o < explicit && unique; ++o) {
+                unique = keys[o].value == keys[k].value || keys[o].len < len ||
+                         memcmp(keys[o].key, keys[k].key, len) != 0;
+            }
+            if (!unique || find_key(keys, *n, keys[k].key, len) >= 0) continue;
+            if (*n == ROUTER_SLOTS) return ERR;
+            Key *p = &keys[(*n)++];
+            memcpy(p->key, keys[k].key, len);
+            p->key[len] = '\0';
+            p->len = len;
+            p->prefix = true;
+            p->value = keys[k].value;
+        }
+    }
+    return OK;
+}
+
+Status router_build(Router *r, const RouteName *names, size_t n) {
+    Key keys[ROUTER_SLOTS];
+    size_t count = 0;
+
+    memset(r, 0, sizeof(*r));
+    for (size_t i = 0; i < n; ++i) {
+        size_t len = strlen(names[i].name);
+        if (len == 0 || len >= ROUTER_KEY_MAX || count == ROUTER_SLOTS || names[i].value < 0 ||
+            names[i].value > INT16_MAX) {
+            return ERR;
+        }
+        Key *k = &keys[count];
+        for (size_t j = 0; j < len; ++j) k->key[j] = (char)fold((unsigned char)names[i].name[j]);
+        k->key[len] = '\0';
+        int dup = find_key(keys, count, k->key, len);
+        if (dup >= 0) {
+            if (keys[dup].value != names[i].value) return ERR;
+            continue;
+        }
+        k->len = (uint8_t)len;
+        k->prefix = false;
+        k->value = (int16_t)names[i].value;
+        count++;
+    }
+    size_t explicit = count;
+    if (add_prefixes(keys, &count, explicit) != OK) return ERR;
+
+    uint32_t slots = 8;
+    while (slots < count) slots <<= 1;
+    r->mask = slots - 1;
+    r->buckets = (uint32_t)(count / 4 + 1);
+    r->keys = (uint32_t)count;
+    r->prefixes = (uint32_t)(count - explicit);
+
+    /* buckets of key indices, largest first: they are hardest to place */
+    uint16_t members[ROUTER_SLOTS], order[ROUTER_SLOTS];
+    uint16_t first[ROUTER_SLOTS + 1], size[ROUTER_SLOTS];
+    memset(size, 0, sizeof(size));
+    for (size_t i = 0; i < count; ++i) {
+        keys[i].hash = key_hash(keys[i].key, keys[i].len);
+        size[keys[i].hash % r->buckets]++;
+    }
+    first[0] = 0;
+    for (uint32_t b = 0; b < r->buckets; ++b) first[b + 1] = (uint16_t)(first[b] + size[b]);
+    memset(size, 0, sizeof(size));
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t b = (uint32_t)(keys[i].hash % r->buckets);
+        members[first[b] + size[b]++] = (uint16_t)i;
+    }
+    for (uint32_t b = 0; b < r->buckets; ++b) order[b] = (uint16_t)b;
+    for (uint32_t i = 1; i < r->buckets; ++i) {
+        uint16_t b = order[i];
+        uint32_t j = i;
+        for (; j > 0 && size[order[j - 1]] < size[b]; --j) order[j] = order[j - 1];
+        order[j] = b;
+    }
+
+    for (uint32_t o = 0; o < r->buckets; ++o) {
+        uint32_t b = order[o];
+        if (!size[b]) break;
+        uint32_t d = 0;
+        for (;; ++d) {
+            if (d > UINT16_MAX) return ERR;     /* two keys with one 64-bit hash */
+            bool fits = true;
+            for (uint32_t m = 0; m < size[b] && fits; ++m) {
+                uint32_t s = slot_of(keys[members[first[b] + m]].hash, d, r->mask);
+                fits = r->slot[s].len == 0;
+                for (uint32_t e = 0; e < m && fits; ++e) {
+                    fits = slot_of(keys[members[first[b] + e]].hash, d, r->mask) != s;
+                }
+            }
+            if (fits) break;
+        }
+        r->disp[b] = (uint16_t)d;
+        for (uint32_t m = 0; m < size[b]; ++m) {
+            const Key *k = &keys[members[first[b] + m]];
+            RouteSlot *s = &r->slot[slot_of(k->hash, d, r->mask)];
+            memcpy(s->key, k->key, sizeof(s->key));
+            s->len = k->len;
+            s->prefix = k->prefix;
+            s->value = k->value;
+        }
+    }
+    return OK;
+}
+
+int router_lookup(const Router *r, const char *key, size_t len) {
+    if (len == 0 || len >= ROUTER_KEY_MAX || !r->buckets) {
+        return -1;
+    }
+    uint64_t h = key_hash(key, len);
+    const RouteSlot *s = &r->slot[slot_of(h, r->disp[h % r->buckets], r->mask)];
+    return s->len == len && strk_casecmp(s->key, key, len) == 0 ? s->value : -1;
+}
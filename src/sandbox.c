@@ -0,0 +1,1123 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#include "sandbox.h"
+#include "tracker.h"
+
+#define REQ_MAGIC 0x58424e53u       /* "SNBX" */
+#define KEY_LEN   64                    /* SHA-256 in hex */
+#define DIR_MAX   1024                  /* cache directory */
+#define PATH_CAP  (DIR_MAX + 96)        /* a file in it */
+
+/* The compiler command line; also part of every cache key. */
+static const char *const CC_ARGV[] = {
+    SANDBOX_CC, SANDBOX_CFLAGS, "-o", "a.out", "submission.c", "-lm", NULL
+};
+
+/* Request: ReqHeader, source[src_len], then per vector
+ * uint32 in_len, uint32 want_len, in[in_len], want[want_len]. */
+typedef struct {
+    uint32_t magic;
+    uint32_t src_len;
+    uint32_t nvec;
+    char key[KEY_LEN + 1];          /* cache file name */
+} ReqHeader;
+
+typedef struct {
+    pid_t pid;
+    int fd;                         /* SOCK_SEQPACKET to the worker */
+    bool busy;
+} Worker;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    int workers;                    /* -1 = not configured */
+    bool unjailed;                  /* run without namespaces if need be */
+    bool started, failed;
+    Worker w[SANDBOX_WORKERS_MAX];
+    char cache[DIR_MAX];
+} P = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, -1, false, false, false, {{0}}, "" };
+
+/* sandbox_submit() jobs; one thread only */
+typedef enum { JOB_QUEUED, JOB_RUNNING, JOB_DONE } JobState;
+
+struct SandboxJob {
+    SandboxJob *next;               /* A.jobs, in submission order */
+    JobState state;
+    void *ctx;                      /* NULL once cancelled */
+    Worker *w;                      /* JOB_RUNNING */
+    uint64_t deadline;              /* now_ms(), JOB_RUNNING */
+    SandboxResult r;                /* total until JOB_DONE, then the verdict */
+    size_t len;
+    char req[];
+};
+
+static struct {
+    int ep;                         /* channels of running jobs; -1 = none yet */
+    SandboxJob *jobs;
+} A = { -1, NULL };
+
+/* Worker side: user namespaces work here, so children run in jail(). */
+static bool jailed;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/* ===================================================================== */
+/* worker side                                                           */
+/* ===================================================================== */
+
+static void set_limit(int res, rlim_t soft, rlim_t hard) {
+    struct rlimit rl = { soft, hard };
+    setrlimit(res, &rl);
+}
+
+static bool write_file(const char *path, const char *data, size_t len, mode_t mode) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd < 0) return false;
+    bool ok = true;
+    while (ok && len) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if (ok) { data += n; len -= (size_t)n; }
+    }
+    return (close(fd) == 0) && ok;
+}
+
+/* What a graded program may do, and nothing else: compute, allocate, read
+ * and write the descriptors it has, open files read-only, check the time,
+ * signal itself (raise, abort) and exit.  It may execve only `exe`,
+ * matched by address, so the caller must pass this very pointer to
+ * execve.  Everything else -- sockets, fork/clone, ptrace, io_uring,
+ * pidfds, signals to other processes, anything that creates, changes or
+ * removes a file -- fails with EPERM.  `self` is the caller's pid.  false
+ * when the filter cannot be installed, including on architectures other
+ * than x86-64, which it does not describe. */
+static bool seccomp_confine(const char *exe, pid_t self) {
+#if defined(__x86_64__)
+#  ifndef SECCOMP_RET_KILL_PROCESS
+#    define SECCOMP_RET_KILL_PROCESS SECCOMP_RET_KILL
+#  endif
+#  define ARG(i, hi) (offsetof(struct seccomp_data, args) + (i) * 8 + (hi) * 4)
+#  define ALLOW(nr) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (nr), 0, 1), \
+                    BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW)
+    /* nr(arg0 == v, ...) only; arg0 is an int, its high half ignored */
+#  define ARG0_IS(nr, v) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (nr), 0, 4),                 \
+                         BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ARG(0, 0)),                 \
+                         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)(v), 0, 1),      \
+                         BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),                  \
+                         BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM)
+    uint64_t at = (uint64_t)(uintptr_t)exe;
+    const uint32_t writes = O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_APPEND;
+    struct sock_filter f[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 0x40000000u, 0, 1),     /* x32 ABI */
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM),
+
+        /* execve(exe, ...) once; the image it loads cannot name that address */
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_execve, 0, 6),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ARG(0, 0)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)at, 0, 3),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ARG(0, 1)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)(at >> 32), 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM),
+
+        /* open and openat: read-only only */
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_open, 0, 2),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ARG(1, 0)),
+        BPF_STMT(BPF_JMP | BPF_JA | BPF_K, 2),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_openat, 0, 4),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ARG(2, 0)),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, writes, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+
+        /* signals and limits: this process only */
+        ARG0_IS(__NR_kill, self), ARG0_IS(__NR_tkill, self), ARG0_IS(__NR_tgkill, self),
+        ARG0_IS(__NR_prlimit64, 0),
+
+        ALLOW(__NR_read), ALLOW(__NR_write), ALLOW(__NR_readv), ALLOW(__NR_writev),
+        ALLOW(__NR_pread64), ALLOW(__NR_pwrite64), ALLOW(__NR_lseek), ALLOW(__NR_close),
+        ALLOW(__NR_fstat), ALLOW(__NR_stat), ALLOW(__NR_lstat), ALLOW(__NR_newfstatat),
+        ALLOW(__NR_statx), ALLOW(__NR_access), ALLOW(__NR_faccessat),
+#  ifdef __NR_faccessat2
+        ALLOW(__NR_faccessat2),
+#  endif
+        ALLOW(__NR_readlink), ALLOW(__NR_readlinkat), ALLOW(__NR_getcwd),
+        ALLOW(__NR_getdents64), ALLOW(__NR_fcntl), ALLOW(__NR_ioctl), ALLOW(__NR_dup),
+        ALLOW(__NR_dup2), ALLOW(__NR_dup3), ALLOW(__NR_poll), ALLOW(__NR_ppoll),
+        ALLOW(__NR_select), ALLOW(__NR_pselect6),
+        ALLOW(__NR_brk), ALLOW(__NR_mmap), ALLOW(__NR_munmap), ALLOW(__NR_mprotect),
+        ALLOW(__NR_mremap), ALLOW(__NR_madvise),
+        ALLOW(__NR_rt_sigaction), ALLOW(__NR_rt_sigprocmask), ALLOW(__NR_rt_sigreturn),
+        ALLOW(__NR_sigaltstack),
+        ALLOW(__NR_nanosleep), ALLOW(__NR_clock_nanosleep), ALLOW(__NR_clock_gettime),
+        ALLOW(__NR_clock_getres), ALLOW(__NR_gettimeofday), ALLOW(__NR_time),
+        ALLOW(__NR_times), ALLOW(__NR_getrusage), ALLOW(__NR_getrlimit), ALLOW(__NR_sysinfo),
+        ALLOW(__NR_uname), ALLOW(__NR_getrandom),
+        ALLOW(__NR_getpid), ALLOW(__NR_gettid), ALLOW(__NR_getppid), ALLOW(__NR_getuid),
+        ALLOW(__NR_geteuid), ALLOW(__NR_getgid), ALLOW(__NR_getegid),
+        ALLOW(__NR_arch_prctl), ALLOW(__NR_set_tid_address), ALLOW(__NR_set_robust_list),
+#  ifdef __NR_rseq
+        ALLOW(__NR_rseq),
+#  endif
+        ALLOW(__NR_futex), ALLOW(__NR_sched_yield), ALLOW(__NR_sched_getaffinity),
+        ALLOW(__NR_exit), ALLOW(__NR_exit_group),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM),
+    };
+#  undef ARG0_IS
+#  undef ALLOW
+#  undef ARG
+    struct sock_fprog prog = { (unsigned short)(sizeof(f) / sizeof(f[0])), f };
+    return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == 0;
+#else
+    (void)exe;
+    (void)self;
+    return false;
+#endif
+}
+
+static bool put(const char *path, const char *text) {
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = write(fd, text, strlen(text)) == (ssize_t)strlen(text);
+    return (close(fd) == 0) && ok;
+}
+
+/* Read-only bind of src at dst.  A remount may not clear the flags the
+ * source mount already has, so those are carried over. */
+static bool bind_ro(const char *src, const char *dst) {
+    struct statvfs sv;
+    if (mount(src, dst, NULL, MS_BIND | MS_REC, NULL) != 0 || statvfs(dst, &sv) != 0) return false;
+    unsigned long fl = MS_REMOUNT | MS_BIND | MS_RDONLY | MS_NOSUID;
+    if (sv.f_flag & ST_NODEV) fl |= MS_NODEV;
+    if (sv.f_flag & ST_NOEXEC) fl |= MS_NOEXEC;
+    if (sv.f_flag & ST_NOATIME) fl |= MS_NOATIME;
+    if (sv.f_flag & ST_NODIRATIME) fl |= MS_NODIRATIME;
+    if (sv.f_flag & ST_RELATIME) fl |= MS_RELATIME;
+    return mount(NULL, dst, NULL, fl, NULL) == 0;
+}
+
+/* After unshare(CLONE_NEWPID): the caller goes on as pid 2 of the new
+ * namespace.  This process forks the namespace's init, which forks the
+ * continuation and waits for it; the wait status comes back up a pipe and
+ * is reproduced here, so the worker reaps the status of the continuation
+ * itself.  If this process is killed (a timeout), init follows it through
+ * PDEATHSIG and the kernel takes the namespace down with it.  Returns
+ * only in the continuation. */
+static void pid_ns_enter(void) {
+    int st[2];
+    if (pipe2(st, O_CLOEXEC) != 0) _exit(126);
+    pid_t init = fork();
+    if (init < 0) _exit(126);
+    if (init > 0) {
+        close(st[1]);
+        int status;
+        ssize_t n;
+        do n = read(st[0], &status, sizeof(status)); while (n < 0 && errno == EINTR);
+        if (n != (ssize_t)sizeof(status)) _exit(126);
+        if (WIFSIGNALED(status)) {
+            sigset_t all;
+            sigfillset(&all);
+            sigprocmask(SIG_UNBLOCK, &all, NULL);
+            signal(WTERMSIG(status), SIG_DFL);
+            kill(getpid(), WTERMSIG(status));
+        }
+        _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 126);
+    }
+
+    close(st[0]);
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    pid_t child = fork();
+    if (child < 0) _exit(126);
+    if (child == 0) {
+        close(st[1]);
+        return;
+    }
+    int status;
+    while (waitpid(child, &status, 0) < 0) {
+        if (errno != EINTR) _exit(126);
+    }
+    _exit(write(st[1], &status, sizeof(status)) == (ssize_t)sizeof(status) ? 0 : 126);
+}
+
+/* Gives a compile or test child its own view of the filesystem: a
+ * read-only tmpfs root (mounted on `root`) holding /usr, the /bin and
+ * /lib links, the loader cache, /etc/alternatives, /dev/null and `work`
+ * at /work, which is the new cwd.  The build cache, home directories and
+ * everything else are simply not there.  It also gets its own pid
+ * namespace (see pid_ns_enter()), so no other process can be named, let
+ * alone signalled.  false when user namespaces are unavailable. */
+static bool jail(const char *root, const char *work, bool writable) {
+    uid_t uid = getuid();
+    gid_t gid = getgid();
+    if (unshare(CLONE_NEWUSER | CLONE_NEWNS | CLONE_NEWPID) != 0) return false;
+    char map[64], src[32];
+    put("/proc/self/setgroups", "deny");            /* absent before 3.19 */
+    snprintf(map, sizeof(map), "%u %u 1\n", (unsigned)uid, (unsigned)uid);
+    if (!put("/proc/self/uid_map", map)) return false;
+    snprintf(map, sizeof(map), "%u %u 1\n", (unsigned)gid, (unsigned)gid);
+    if (!put("/proc/self/gid_map", map)) return false;
+
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) return false;
+    /* work as seen from this namespace, still reachable once root is cwd */
+    int wfd = open(work, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (wfd < 0) return false;
+    snprintf(src, sizeof(src), "/proc/self/fd/%d", wfd);
+    if (mount("tmpfs", root, "tmpfs", MS_NOSUID | MS_NODEV, "size=64k,mode=0755") != 0) return false;
+    if (chdir(root) != 0) return false;
+
+    static const char *const TOP[] = { "bin", "sbin", "lib", "lib32", "lib64", "libx32" };
+    bool ok = mkdir("usr", 0755) == 0 && bind_ro("/usr", "usr");
+    for (size_t i = 0; ok && i < sizeof(TOP) / sizeof(TOP[0]); ++i) {
+        char host[16], link[256];
+        struct stat st;
+        snprintf(host, sizeof(host), "/%s", TOP[i]);
+        if (lstat(host, &st) != 0) continue;
+        if (S_ISLNK(st.st_mode)) {
+            ssize_t n = readlink(host, link, sizeof(link) - 1);
+            ok = n > 0 && (link[n] = '\0', symlink(link, TOP[i]) == 0);
+        } else if (S_ISDIR(st.st_mode)) {
+            ok = mkdir(TOP[i], 0755) == 0 && bind_ro(host, TOP[i]);
+        }
+    }
+    ok = ok && mkdir("etc", 0755) == 0 && mkdir("dev", 0755) == 0 && mkdir("work", 0755) == 0;
+    if (ok && access("/etc/ld.so.cache", R_OK) == 0) {
+        ok = write_file("etc/ld.so.cache", "", 0, 0644) && bind_ro("/etc/ld.so.cache", "etc/ld.so.cache");
+    }
+    if (ok && access("/etc/alternatives", X_OK) == 0) {
+        ok = mkdir("etc/alternatives", 0755) == 0 && bind_ro("/etc/alternatives", "etc/alternatives");
+    }
+    ok = ok && write_file("dev/null", "", 0, 0666) &&
+         mount("/dev/null", "dev/null", NULL, MS_BIND, NULL) == 0;
+    if (ok && writable) ok = mount(src, "work", NULL, MS_BIND, NULL) == 0;
+    else if (ok) ok = bind_ro(src, "work");
+    ok = ok && mount(NULL, ".", NULL, MS_REMOUNT | MS_RDONLY | MS_NOSUID | MS_NODEV, NULL) == 0;
+
+    /* the old root goes away entirely: stack the new one on it, detach it */
+    ok = ok && syscall(SYS_pivot_root, ".", ".") == 0 && umount2(".", MNT_DETACH) == 0;
+    if (!ok || chdir("/work") != 0) return false;
+    pid_ns_enter();
+    return true;
+}
+
+/* Drains `fd` into buf (at most cap bytes kept, *over set past that) until
+ * EOF, then reaps `pid`.  Kills it at the deadline.  Returns the wait
+ * status, or -1 on timeout. */
+static int collect(pid_t pid, int fd, char *buf, size_t cap, size_t *len, bool *over, int ms) {
+    uint64_t deadline = now_ms() + (uint64_t)ms;
+    char sink[512];
+    *len = 0;
+    *over = false;
+    for (bool eof = false; !eof;) {
+        uint64_t now = now_ms();
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (now >= deadline || poll(&pfd, 1, (int)(deadline - now)) == 0) goto timeout;
+        char *dst = *len < cap ? buf + *len : sink;
+        size_t room = *len < cap ? cap - *len : sizeof(sink);
+        ssize_t n = read(fd, dst, room);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) eof = true;
+        else if (dst == sink) *over = true;
+        else *len += (size_t)n;
+    }
+    for (;;) {
+        int status;
+        pid_t r = waitpid(pid, &status, WNOHANG);
+        if (r == pid) return status;
+        if (r < 0 && errno != EINTR) return status;
+        if (now_ms() >= deadline) goto timeout;
+        poll(NULL, 0, 1);
+    }
+timeout:
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+static void fit(char *dst, size_t cap, const char *src, size_t len) {
+    if (len >= cap) len = cap - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+/* Without a jail, absolute #includes can pull in any readable file; only
+ * diagnostics located in the submission or the harness are kept. */
+static size_t own_diagnostics(char *d, size_t len) {
+    size_t w = 0;
+    bool keep = true;
+    for (size_t i = 0; i < len;) {
+        const char *line = d + i, *nl = memchr(line, '\n', len - i);
+        size_t n = nl ? (size_t)(nl - line) + 1 : len - i;
+        if (line[0] != ' ') {
+            size_t f = strcspn(line, ":\n");
+            bool located = f < n && line[f] == ':' && isdigit((unsigned char)line[f + 1]);
+            keep = strncmp(line, "In file included from", 21) != 0 &&
+                   (!located || (f == 12 && memcmp(line, "submission.c", 12) == 0) ||
+                                (f == 9 && memcmp(line, "harness.c", 9) == 0));
+        }
+        if (keep) {
+            memmove(d + w, line, n);
+            w += n;
+        }
+        i += n;
+    }
+    return w;
+}
+
+/* Builds <cache>/<key> from cc/submission.c unless it (or <key>.err) exists. */
+static SandboxVerdict compile(const char *key, const char *src, size_t src_len,
+                              SandboxResult *r, char *bin, size_t bin_cap) {
+    char err[PATH_CAP];
+    snprintf(bin, bin_cap, "%s/%s", P.cache, key);
+    snprintf(err, sizeof(err), "%s/%s.err", P.cache, key);
+
+    if (access(bin, X_OK) == 0) {
+        r->cached = true;
+        return SB_PASS;
+    }
+    int efd = open(err, O_RDONLY | O_CLOEXEC);
+    if (efd >= 0) {
+        ssize_t n = read(efd, r->detail, sizeof(r->detail) - 1);
+        r->detail[n > 0 ? n : 0] = '\0';
+        close(efd);
+        r->cached = true;
+        return SB_COMPILE_ERROR;
+    }
+
+    if (!write_file("cc/submission.c", src, src_len, 0600)) return SB_UNAVAILABLE;
+    int p[2];
+    if (pipe2(p, O_CLOEXEC) != 0) return SB_UNAVAILABLE;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(p[0]);
+        close(p[1]);
+        return SB_UNAVAILABLE;
+    }
+    if (pid == 0) {
+        dup2(p[1], STDOUT_FILENO);
+        dup2(p[1], STDERR_FILENO);
+        if (jailed ? !jail("root", "cc", true) : chdir("cc") != 0) _exit(126);
+        if (jailed) setenv("TMPDIR", "/work", 1);       /* the jail's root is read-only */
+        set_limit(RLIMIT_CPU, SANDBOX_COMPILE_MS / 1000, SANDBOX_COMPILE_MS / 1000 + 1);
+        set_limit(RLIMIT_FSIZE, 64ul << 20, 64ul << 20);
+        set_limit(RLIMIT_CORE, 0, 0);
+        execvp(CC_ARGV[0], (char *const *)CC_ARGV);
+        _exit(127);
+    }
+    close(p[1]);
+    char diag[2048];
+    size_t len;
+    bool over;
+    int status = collect(pid, p[0], diag, sizeof(diag), &len, &over, SANDBOX_COMPILE_MS);
+    close(p[0]);
+    unlink("cc/submission.c");
+
+    if (status == -1) {
+        unlink("cc/a.out");
+        snprintf(r->detail, sizeof(r->detail), "compiler timed out");
+        return SB_TIMEOUT;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        if (rename("cc/a.out", bin) != 0) return SB_UNAVAILABLE;
+        return SB_PASS;
+    }
+    unlink("cc/a.out");
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        snprintf(r->detail, sizeof(r->detail), "cannot run '%s'", SANDBOX_CC);
+        return SB_UNAVAILABLE;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 126) {
+        snprintf(r->detail, sizeof(r->detail), "cannot set up the build sandbox");
+        return SB_UNAVAILABLE;
+    }
+    if (!jailed) len = own_diagnostics(diag, len);
+    if (len == 0) {
+        snprintf(r->detail, sizeof(r->detail), "error in an included file");
+    } else {
+        fit(r->detail, sizeof(r->detail), diag, len);
+    }
+    /* cache the failure too: same source, same diagnostics */
+    if (write_file("err.tmp", r->detail, strlen(r->detail), 0644)) rename("err.tmp", err);
+    return SB_COMPILE_ERROR;
+}
+
+/* In place: blanks before each newline and at the very end removed. */
+static size_t tidy(char *s, size_t n) {
+    size_t w = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (s[i] == '\n') {
+            while (w && (s[w - 1] == ' ' || s[w - 1] == '\t' || s[w - 1] == '\r')) w--;
+        }
+        s[w++] = s[i];
+    }
+    while (w && isspace((unsigned char)s[w - 1])) w--;
+    return w;
+}
+
+/* Quoted, one-line rendering of test data for the mismatch report. */
+static void show(char *dst, size_t cap, const char *s, size_t n) {
+    size_t w = 0;
+    for (size_t i = 0; i < n && w + 6 < cap; ++i) {
+        if (s[i] == '\n') { dst[w++] = '\\'; dst[w++] = 'n'; }
+        else dst[w++] = isprint((unsigned char)s[i]) ? s[i] : '?';
+    }
+    if (w + 6 >= cap) { memcpy(dst + w, "...", 3); w += 3; }
+    dst[w] = '\0';
+}
+
+/* run/submission: a read-only copy of the cached binary, the only file
+ * in the test children's working directory. */
+static bool stage(const char *bin) {
+    static char buf[65536];
+    unlink("run/submission");
+    int in = open(bin, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    int out = open("run/submission", O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0500);
+    bool ok = out >= 0;
+    for (ssize_t n; ok && (n = read(in, buf, sizeof(buf))) != 0;) {
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0 && write(out, buf, (size_t)n) == n;
+    }
+    close(in);
+    return (out < 0 || close(out) == 0) && ok;
+}
+
+static SandboxVerdict run_vector(int k, const char *in, size_t in_len,
+                                 char *want, size_t want_len, SandboxResult *r) {
+    static char got[SANDBOX_OUTPUT_MAX];
+    int mfd = memfd_create("stdin", MFD_CLOEXEC);
+    if (mfd < 0) return SB_UNAVAILABLE;
+    if (in_len && write(mfd, in, in_len) != (ssize_t)in_len) {
+        close(mfd);
+        return SB_UNAVAILABLE;
+    }
+    lseek(mfd, 0, SEEK_SET);
+
+    int p[2];
+    if (pipe2(p, O_CLOEXEC) != 0) {
+        close(mfd);
+        return SB_UNAVAILABLE;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(mfd, STDIN_FILENO);
+        dup2(p[1], STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        char exe[] = "/work/submission";
+        if (jailed ? !jail("root", "run", false) : chdir("run") != 0) _exit(126);
+        if (!jailed) memcpy(exe, "./submission", sizeof("./submission"));
+        set_limit(RLIMIT_CPU, SANDBOX_CPU_SECS, SANDBOX_CPU_SECS + 1);
+        set_limit(RLIMIT_AS, SANDBOX_MEM_BYTES, SANDBOX_MEM_BYTES);
+        set_limit(RLIMIT_FSIZE, 1ul << 20, 1ul << 20);
+        set_limit(RLIMIT_NOFILE, 16, 16);
+        set_limit(RLIMIT_CORE, 0, 0);
+        /* no filter, no run */
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0 || !seccomp_confine(exe, getpid())) {
+            _exit(126);
+        }
+        char *const argv[] = { "submission", NULL };
+        char *const envp[] = { "PATH=/usr/bin:/bin", "LC_ALL=C", NULL };
+        execve(exe, argv, envp);
+        _exit(127);
+    }
+    close(p[1]);
+    close(mfd);
+    if (pid < 0) {
+        close(p[0]);
+        return SB_UNAVAILABLE;
+    }
+    size_t len;
+    bool over;
+    int status = collect(pid, p[0], got, sizeof(got), &len, &over, SANDBOX_WALL_MS);
+    close(p[0]);
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 126) {
+        snprintf(r->detail, sizeof(r->detail), "cannot set up the test sandbox");
+        return SB_UNAVAILABLE;
+    }
+    if (status == -1 || (WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU)) {
+        snprintf(r->detail, sizeof(r->detail), "test %d: time limit exceeded", k + 1);
+        return SB_TIMEOUT;
+    }
+    if (WIFSIGNALED(status)) {
+        snprintf(r->detail, sizeof(r->detail), "test %d: killed by signal %d (%s)", k + 1,
+                 WTERMSIG(status), strsignal(WTERMSIG(status)));
+        return SB_RUNTIME_ERROR;
+    }
+    if (WEXITSTATUS(status) != 0) {
+        snprintf(r->detail, sizeof(r->detail), "test %d: exit status %d", k + 1,
+                 WEXITSTATUS(status));
+        return SB_RUNTIME_ERROR;
+    }
+    if (over) {
+        snprintf(r->detail, sizeof(r->detail), "test %d: more than %d bytes of output", k + 1,
+                 SANDBOX_OUTPUT_MAX);
+        return SB_FAIL;
+    }
+    len = tidy(got, len);
+    want_len = tidy(want, want_len);
+    if (len == want_len && memcmp(got, want, len) == 0) return SB_PASS;
+
+    char a[120], b[120], c[120];
+    show(a, sizeof(a), in, in_len);
+    show(b, sizeof(b), want, want_len);
+    show(c, sizeof(c), got, len);
+    snprintf(r->detail, sizeof(r->detail), "test %d: input \"%s\"\n  expected \"%s\"\n  got      \"%s\"",
+             k + 1, a, b, c);
+    return SB_FAIL;
+}
+
+static void worker_job(char *req, size_t n, SandboxResult *r) {
+    ReqHeader h;
+    r->verdict = SB_UNAVAILABLE;
+    if (n < sizeof(h)) return;
+    memcpy(&h, req, sizeof(h));
+    if (h.magic != REQ_MAGIC || h.src_len > n - sizeof(h) || h.key[KEY_LEN] != '\0') return;
+    r->total = (int)h.nvec;
+    if (!jailed && !P.unjailed) {
+        snprintf(r->detail, sizeof(r->detail),
+                 "code grading needs user namespaces, which this system does not allow");
+        return;
+    }
+
+    char bin[PATH_CAP];
+    r->verdict = compile(h.key, req + sizeof(h), h.src_len, r, bin, sizeof(bin));
+    if (r->verdict != SB_PASS) return;
+    if (!stage(bin)) {
+        r->verdict = SB_UNAVAILABLE;
+        return;
+    }
+
+    size_t off = sizeof(h) + h.src_len;
+    SandboxVerdict first_fail = SB_PASS;
+    for (uint32_t k = 0; k < h.nvec; ++k) {
+        uint32_t lens[2];
+        if (n - off < sizeof(lens)) { r->verdict = SB_UNAVAILABLE; return; }
+        memcpy(lens, req + off, sizeof(lens));
+        off += sizeof(lens);
+        if (lens[0] > n - off || lens[1] > n - off - lens[0]) { r->verdict = SB_UNAVAILABLE; return; }
+        char *in = req + off, *want = in + lens[0];
+        off += (size_t)lens[0] + lens[1];
+
+        char keep[sizeof(r->detail)];
+        memcpy(keep, r->detail, sizeof(keep));
+        SandboxVerdict v = run_vector((int)k, in, lens[0], want, lens[1], r);
+        if (v == SB_PASS) {
+            r->passed++;
+            continue;
+        }
+        if (first_fail != SB_PASS) memcpy(r->detail, keep, sizeof(keep));  /* report the first */
+        else first_fail = v;
+        if (v != SB_FAIL) break;    /* crash/timeout: the rest would go the same way */
+    }
+    unlink("run/submission");
+    r->verdict = first_fail;
+}
+
+static void worker_main(int fd) {
+    static char req[SANDBOX_REQ_MAX];
+    char scratch[PATH_CAP];
+    snprintf(scratch, sizeof(scratch), "%s/w%d", P.cache, (int)getpid());
+    if (mkdir(scratch, 0700) != 0 && errno != EEXIST) _exit(1);
+    if (chdir(scratch) != 0) _exit(1);
+    /* cc: the compiler's cwd; run: the test binary alone; root: jail mounts */
+    static const char *const DIRS[] = { "cc", "run", "root" };
+    for (int i = 0; i < 3; ++i) {
+        if (mkdir(DIRS[i], 0700) != 0 && errno != EEXIST) _exit(1);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t probe = fork();
+    if (probe == 0) _exit(jail("root", "run", false) ? 0 : 1);
+    int status;
+    jailed = probe > 0 && waitpid(probe, &status, 0) == probe && WIFEXITED(status) &&
+             WEXITSTATUS(status) == 0;
+
+    for (;;) {
+        ssize_t n = recv(fd, req, sizeof(req), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        SandboxResult r;
+        memset(&r, 0, sizeof(r));
+        worker_job(req, (size_t)n, &r);
+        if (send(fd, &r, sizeof(r), MSG_NOSIGNAL) != (ssize_t)sizeof(r)) break;
+    }
+    for (int i = 0; i < 3; ++i) rmdir(DIRS[i]);
+    if (chdir(P.cache) == 0) rmdir(scratch);
+    _exit(0);
+}
+
+/* ===================================================================== */
+/* pool side                                                             */
+/* ===================================================================== */
+
+static bool spawn(Worker *w) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        /* keep only stdio and our end: no learner connections, no listen
+         * socket, no other workers' channels */
+        if (sv[1] != 3) {
+            dup2(sv[1], 3);
+        }
+        close_range(4, ~0u, 0);
+        worker_main(3);
+    }
+    close(sv[1]);
+    w->pid = pid;
+    w->fd = sv[0];
+    w->busy = false;
+    return true;
+}
+
+/* Closing the channel asks an idle worker to clean up and exit; a stuck
+ * or misbehaving one is killed. */
+static void retire(Worker *w, bool graceful) {
+    if (w->fd >= 0) close(w->fd);
+    if (w->pid > 0) {
+        for (int ms = 0; graceful && ms < 200; ++ms) {
+            if (waitpid(w->pid, NULL, WNOHANG) == w->pid) {
+                w->pid = 0;
+                break;
+            }
+            poll(NULL, 0, 1);
+        }
+    }
+    if (w->pid > 0) {
+        kill(w->pid, SIGKILL);
+        waitpid(w->pid, NULL, 0);
+    }
+    w->fd = -1;
+    w->pid = 0;
+}
+
+static bool mkdir_p(char *path) {
+    for (char *p = path + 1; *p; ++p) {
+        if (*p != '/') continue;
+        *p = '\0';
+        bool ok = mkdir(path, 0700) == 0 || errno == EEXIST;
+        *p = '/';
+        if (!ok) return false;
+    }
+    return mkdir(path, 0700) == 0 || errno == EEXIST;
+}
+
+void sandbox_configure(int workers, const char *cache_dir, bool unjailed) {
+    pthread_mutex_lock(&P.lock);
+    P.unjailed = unjailed;
+    P.workers = workers < 0 ? SANDBOX_WORKERS_DEFAULT
+              : workers > SANDBOX_WORKERS_MAX ? SANDBOX_WORKERS_MAX : workers;
+    if (cache_dir) snprintf(P.cache, sizeof(P.cache), "%s", cache_dir);
+    pthread_mutex_unlock(&P.lock);
+}
+
+Status sandbox_start(void) {
+    pthread_mutex_lock(&P.lock);
+    if (P.started || P.failed) {
+        Status st = P.started ? OK : ERR;
+        pthread_mutex_unlock(&P.lock);
+        return st;
+    }
+    if (P.workers < 0) P.workers = SANDBOX_WORKERS_DEFAULT;
+    if (!P.cache[0]) {
+        const char *xdg = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+        if (xdg && *xdg) snprintf(P.cache, sizeof(P.cache), "%s/c_arcade/cc", xdg);
+        else if (home && *home) snprintf(P.cache, sizeof(P.cache), "%s/.cache/c_arcade/cc", home);
+        else snprintf(P.cache, sizeof(P.cache), "/tmp/c_arcade-cc-%u", (unsigned)getuid());
+    }
+    char *abs = NULL;
+    bool ok = P.workers > 0 && mkdir_p(P.cache) && (abs = realpath(P.cache, NULL)) &&
+              strlen(abs) < sizeof(P.cache);
+    if (ok) memcpy(P.cache, abs, strlen(abs) + 1);
+    free(abs);
+    for (int i = 0; i < SANDBOX_WORKERS_MAX; ++i) P.w[i].fd = -1;
+    for (int i = 0; ok && i < P.workers; ++i) ok = spawn(&P.w[i]);
+    if (!ok) {
+        for (int i = 0; i < P.workers; ++i) retire(&P.w[i], false);
+        P.failed = true;
+    }
+    P.started = ok;
+    pthread_mutex_unlock(&P.lock);
+    return ok ? OK : ERR;
+}
+
+void sandbox_stop(void) {
+    while (A.jobs) {
+        SandboxJob *j = A.jobs;
+        A.jobs = j->next;
+        tracked_free(j);
+    }
+    if (A.ep >= 0) close(A.ep);
+    A.ep = -1;
+    pthread_mutex_lock(&P.lock);
+    if (P.started) {
+        for (int i = 0; i < P.workers; ++i) retire(&P.w[i], true);
+    }
+    P.started = false;
+    pthread_mutex_unlock(&P.lock);
+}
+
+/* An idle worker, now busy, or NULL.  Caller holds P.lock. */
+static Worker *take_idle(void) {
+    for (int i = 0; i < P.workers; ++i) {
+        if (!P.w[i].busy) {
+            P.w[i].busy = true;
+            return &P.w[i];
+        }
+    }
+    return NULL;
+}
+
+static Worker *acquire(void) {
+    pthread_mutex_lock(&P.lock);
+    Worker *w;
+    while (!(w = take_idle())) pthread_cond_wait(&P.idle, &P.lock);
+    pthread_mutex_unlock(&P.lock);
+    return w;
+}
+
+static void release(Worker *w, bool healthy) {
+    pthread_mutex_lock(&P.lock);
+    if (!healthy) {
+        retire(w, false);
+        spawn(w);           /* on failure the slot stays dead: fd -1 */
+    }
+    w->busy = false;
+    pthread_cond_signal(&P.idle);
+    pthread_mutex_unlock(&P.lock);
+}
+
+/* ===== SHA-256 (FIPS 180-4), for build-cache keys ===== */
+typedef struct {
+    uint32_t h[8];
+    uint8_t block[64];
+    size_t used;                    /* bytes in block */
+    uint64_t bytes;                 /* total hashed */
+} Sha256;
+
+static const uint32_t SHA_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t ror32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_block(Sha256 *c, const uint8_t *p) {
+    uint32_t w[64], v[8];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = ror32(w[i - 15], 7) ^ ror32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror32(w[i - 2], 17) ^ ror32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    memcpy(v, c->h, sizeof(v));
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = v[7] + (ror32(v[4], 6) ^ ror32(v[4], 11) ^ ror32(v[4], 25)) +
+                      ((v[4] & v[5]) ^ (~v[4] & v[6])) + SHA_K[i] + w[i];
+        uint32_t t2 = (ror32(v[0], 2) ^ ror32(v[0], 13) ^ ror32(v[0], 22)) +
+                      ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v + 1, v, 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; ++i) c->h[i] += v[i];
+}
+
+static void sha256_init(Sha256 *c) {
+    static const uint32_t H0[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(c->h, H0, sizeof(H0));
+    c->used = 0;
+    c->bytes = 0;
+}
+
+static void sha256_update(Sha256 *c, const void *data, size_t n) {
+    const uint8_t *p = data;
+    c->bytes += n;
+    while (n) {
+        size_t take = 64 - c->used < n ? 64 - c->used : n;
+        memcpy(c->block + c->used, p, take);
+        c->used += take;
+        p += take;
+        n -= take;
+        if (c->used == 64) {
+            sha256_block(c, c->block);
+            c->used = 0;
+        }
+    }
+}
+
+static void sha256_final(Sha256 *c, uint8_t out[32]) {
+    uint64_t bits = c->bytes * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t n = (c->used < 56 ? 56 : 120) - c->used;
+    for (int i = 0; i < 8; ++i) pad[n + i] = (uint8_t)(bits >> (56 - 8 * i));
+    sha256_update(c, pad, n + 8);
+    for (int i = 0; i < 8; ++i) {
+        for (int k = 0; k < 4; ++k) out[4 * i + k] = (uint8_t)(c->h[i] >> (24 - 8 * k));
+    }
+}
+
+/* Normalized snippet, then the harness (with its own line numbering). */
+static size_t build_source(const Task *t, const char *code, char *dst, size_t cap) {
+    size_t w = 0, keep = 0;
+    bool started = false;
+    for (const char *p = code; *p;) {
+        const char *eol = strchr(p, '\n');
+        size_t n = eol ? (size_t)(eol - p) : strlen(p);
+        size_t m = n;
+        while (m && isspace((unsigned char)p[m - 1])) m--;
+        if (m || started) {
+            if (w + m + 1 >= cap) return 0;
+            memcpy(dst + w, p, m);
+            w += m;
+            dst[w++] = '\n';
+            if (m) keep = w;
+            started = true;
+        }
+        p += n + (eol != NULL);
+    }
+    w = keep;
+    if (t->harness) {
+        int n = snprintf(dst + w, cap - w, "#line 1 \"harness.c\"\n%s\n", t->harness);
+        if (n < 0 || (size_t)n >= cap - w) return 0;
+        w += (size_t)n;
+    }
+    return w;
+}
+
+static size_t build_request(const Task *t, const char *code, char *req, size_t cap, int *nvec) {
+    ReqHeader h = { REQ_MAGIC, 0, 0, "" };
+    size_t src_len = build_source(t, code, req + sizeof(h), cap - sizeof(h));
+    if (!src_len) return 0;
+
+    /* a build is reused on the key alone, so no two inputs may share one */
+    Sha256 sha;
+    sha256_init(&sha);
+    for (const char *const *a = CC_ARGV; *a; ++a) sha256_update(&sha, *a, strlen(*a) + 1);
+    sha256_update(&sha, req + sizeof(h), src_len);
+    uint8_t digest[32];
+    sha256_final(&sha, digest);
+    for (int i = 0; i < 32; ++i) snprintf(h.key + 2 * i, 3, "%02x", digest[i]);
+
+    size_t off = sizeof(h) + src_len;
+    uint32_t k = 0;
+    for (; t->answers && t->answers[k]; ++k) {
+        const char *in = "";
+        for (uint32_t i = 0; t->options && t->options[i]; ++i) {
+            if (i == k) { in = t->options[i]; break; }
+        }
+        uint32_t lens[2] = { (uint32_t)strlen(in), (uint32_t)strlen(t->answers[k]) };
+        if ((size_t)lens[0] + lens[1] + sizeof(lens) > cap - off) return 0;
+        memcpy(req + off, lens, sizeof(lens));
+        off += sizeof(lens);
+        memcpy(req + off, in, lens[0]);
+        off += lens[0];
+        memcpy(req + off, t->answers[k], lens[1]);
+        off += lens[1];
+    }
+    h.src_len = (uint32_t)src_len;
+    h.nvec = k;
+    memcpy(req, &h, sizeof(h));
+    *nvec = (int)k;
+    return off;
+}
+
+/* Starts the pool and builds the request for `code`.  0 with r filled
+ * in when it cannot be graded. */
+static size_t prepare(const Task *t, const char *code, char *req, size_t cap, SandboxResult *r) {
+    memset(r, 0, sizeof(*r));
+    r->verdict = SB_UNAVAILABLE;
+    if (sandbox_start() != OK) {
+        snprintf(r->detail, sizeof(r->detail), "code grading is not available here");
+        return 0;
+    }
+    size_t n = build_request(t, code, req, cap, &r->total);
+    if (!n) snprintf(r->detail, sizeof(r->detail), "submission is too large");
+    return n;
+}
+
+static int budget_ms(int total) {
+    return SANDBOX_COMPILE_MS + (total + 1) * SANDBOX_WALL_MS;
+}
+
+static void worker_failed(SandboxResult *r) {
+    memset(r, 0, sizeof(*r));
+    r->verdict = SB_UNAVAILABLE;
+    snprintf(r->detail, sizeof(r->detail), "sandbox worker failed; try again");
+}
+
+void sandbox_grade(const Task *t, const char *code, SandboxResult *r) {
+    static _Thread_local char req[SANDBOX_REQ_MAX];
+    size_t n = prepare(t, code, req, sizeof(req), r);
+    if (!n) return;
+
+    Worker *w = acquire();
+    bool healthy = w->fd >= 0 && send(w->fd, req, n, MSG_NOSIGNAL) == (ssize_t)n;
+    if (healthy) {
+        struct pollfd pfd = { w->fd, POLLIN, 0 };
+        int ready;
+        do ready = poll(&pfd, 1, budget_ms(r->total)); while (ready < 0 && errno == EINTR);
+        healthy = ready == 1 && recv(w->fd, r, sizeof(*r), 0) == (ssize_t)sizeof(*r);
+    }
+    release(w, healthy);
+    if (!healthy) worker_failed(r);
+}
+
+/* ===== asynchronous grading ===== */
+
+static void job_unlink(SandboxJob *j) {
+    SandboxJob **p = &A.jobs;
+    while (*p != j) p = &(*p)->next;
+    *p = j->next;
+}
+
+/* The job's worker is done with it, one way or the other. */
+static void job_settle(SandboxJob *j, bool healthy) {
+    epoll_ctl(A.ep, EPOLL_CTL_DEL, j->w->fd, NULL);
+    release(j->w, healthy);
+    j->w = NULL;
+    if (!healthy) worker_failed(&j->r);
+    j->state = JOB_DONE;
+}
+
+/* Hands queued jobs, oldest first, to idle workers. */
+static void job_dispatch(void) {
+    for (SandboxJob *j = A.jobs; j; j = j->next) {
+        if (j->state != JOB_QUEUED) continue;
+        pthread_mutex_lock(&P.lock);
+        Worker *w = take_idle();
+        pthread_mutex_unlock(&P.lock);
+        if (!w) return;
+        j->w = w;
+        j->state = JOB_RUNNING;
+        j->deadline = now_ms() + (uint64_t)budget_ms(j->r.total);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = j };
+        if (w->fd < 0 || send(w->fd, j->req, j->len, MSG_NOSIGNAL) != (ssize_t)j->len ||
+            epoll_ctl(A.ep, EPOLL_CTL_ADD, w->fd, &ev) != 0) {
+            job_settle(j, false);
+        }
+    }
+}
+
+int sandbox_fd(void) {
+    if (A.ep < 0) A.ep = epoll_create1(EPOLL_CLOEXEC);
+    return A.ep;
+}
+
+SandboxJob *sandbox_submit(const Task *t, const char *code, void *ctx, SandboxResult *r) {
+    static char req[SANDBOX_REQ_MAX];
+    size_t n = prepare(t, code, req, sizeof(req), r);
+    if (!n) return NULL;
+    SandboxJob *j = sandbox_fd() >= 0 ? tracked_malloc(sizeof(*j) + n) : NULL;
+    if (!j) {
+        snprintf(r->detail, sizeof(r->detail), "out of memory");
+        return NULL;
+    }
+    *j = (SandboxJob){ .state = JOB_QUEUED, .ctx = ctx, .r = *r, .len = n };
+    memcpy(j->req, req, n);
+    SandboxJob **p = &A.jobs;
+    while (*p) p = &(*p)->next;
+    *p = j;
+    job_dispatch();
+    return j;
+}
+
+void sandbox_cancel(SandboxJob *j) {
+    if (!j) return;
+    if (j->state == JOB_QUEUED) {
+        job_unlink(j);
+        tracked_free(j);
+    } else {
+        j->ctx = NULL;              /* reaped quietly; the worker is reused */
+    }
+}
+
+int sandbox_due_ms(void) {
+    int64_t due = -1;
+    uint64_t now = now_ms();
+    for (SandboxJob *j = A.jobs; j; j = j->next) {
+        if (j->state == JOB_DONE) return 0;
+        if (j->state != JOB_RUNNING) continue;
+        int64_t left = j->deadline > now ? (int64_t)(j->deadline - now) : 0;
+        if (due < 0 || left < due) due = left;
+    }
+    return (int)due;
+}
+
+void *sandbox_reap(SandboxResult *r) {
+    struct epoll_event evs[SANDBOX_WORKERS_MAX];
+    int n = A.ep >= 0 ? epoll_wait(A.ep, evs, SANDBOX_WORKERS_MAX, 0) : 0;
+    for (int i = 0; i < n; ++i) {
+        SandboxJob *j = evs[i].data.ptr;
+        SandboxResult got;
+        bool healthy = recv(j->w->fd, &got, sizeof(got), 0) == (ssize_t)sizeof(got);
+        if (healthy) j->r = got;
+        job_settle(j, healthy);
+    }
+    uint64_t now = now_ms();
+    for (SandboxJob *j = A.jobs; j; j = j->next) {
+        if (j->state == JOB_RUNNING && now >= j->deadline) job_settle(j, false);
+    }
+    job_dispatch();
+
+    for (SandboxJob *j = A.jobs, *next; j; j = next) {
+        next = j->next;
+        if (j->state != JOB_DONE) continue;
+        void *ctx = j->ctx;
+        if (ctx) *r = j->r;
+        job_unlink(j);
+        tracked_free(j);
+        if (ctx) return ctx;
+    }
+    return NULL;
+}
@@ -0,0 +1,433 @@
+#include <math.h>
+
+#include "search.h"
+#include "tracker.h"
+
+#define BM25_K1  1.2f
+#define BM25_B   0.75f
+/* Queries reading more postings than docs / this scan every accumulator
+ * instead of listing the ones they touch. */
+#define SEARCH_DENSE_SHARE  4
+
+struct SearchIndex {
+    /* dictionary: term id -> spelling in chars, and a hash of them */
+    char *chars;
+    size_t chars_used, chars_cap;
+    uint32_t *term_off;
+    uint8_t *term_len;
+    uint32_t terms, terms_cap;
+    uint32_t *slot;                 /* term id + 1; 0 = empty */
+    uint32_t slot_mask;
+
+    /* documents */
+    uint32_t *doc_key, *doc_len;
+    uint32_t docs, docs_cap;
+    uint64_t total_len;
+
+    /* while adding: one (term, doc, count) triple per distinct word */
+    uint32_t *trip_term, *trip_doc;
+    uint16_t *trip_tf;
+    size_t trips, trips_cap;
+    uint32_t *words;                /* term ids of the document being added */
+    size_t words_cap;
+
+    /* after search_finish() */
+    bool finished;
+    uint32_t *post_start;           /* terms + 1: term t is [start[t], start[t+1]) */
+    uint32_t *post_doc;
+    float *post_w;                  /* tf (k1 + 1) / (tf + k1 (1 - b + b len / mean len)) */
+    uint32_t *sorted;               /* term ids in spelling order */
+    float *acc;                     /* per doc query score; 0 = not touched */
+    uint32_t *touched;
+};
+
+/* Capacity for `need` elements: `cap` doubled until it fits. */
+static size_t grown(size_t cap, size_t need) {
+    size_t c = cap ? cap : 64;
+    while (c < need) c *= 2;
+    return c;
+}
+
+/* The next indexable word at *p, folded into tok; 0 at the end. */
+static size_t next_word(const char **p, char tok[SEARCH_TOKEN_MAX]) {
+    const unsigned char *s = (const unsigned char *)*p;
+    for (;;) {
+        while (*s && !(isalnum(*s) || *s == '_')) s++;
+        if (!*s) break;
+        size_t n = 0;
+        for (; isalnum(*s) || *s == '_'; ++s) {
+            if (n < SEARCH_TOKEN_MAX) tok[n++] = (char)tolower(*s);
+        }
+        if (n >= 2) {
+            *p = (const char *)s;
+            return n;
+        }
+    }
+    *p = (const char *)s;
+    return 0;
+}
+
+static uint32_t hash_word(const char *s, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)s[i]) * 0x100000001b3ull;
+    return (uint32_t)(h ^ h >> 32);
+}
+
+static const char *term_text(const SearchIndex *ix, uint32_t t) {
+    return ix->chars + ix->term_off[t];
+}
+
+/* Term id of word s[0..n), or -1. */
+static int64_t term_find(const SearchIndex *ix, const char *s, size_t n) {
+    if (!ix->slot) return -1;
+    for (uint32_t i = hash_word(s, n) & ix->slot_mask;; i = (i + 1) & ix->slot_mask) {
+        uint32_t t = ix->slot[i];
+        if (!t) return -1;
+        if (ix->term_len[t - 1] == n && memcmp(term_text(ix, t - 1), s, n) == 0) return t - 1;
+    }
+}
+
+static Status rehash(SearchIndex *ix, uint32_t slots) {
+    uint32_t *slot = tracked_calloc(slots, sizeof(*slot));
+    if (!slot) return ERR;
+    for (uint32_t t = 0; t < ix->terms; ++t) {
+        uint32_t i = hash_word(term_text(ix, t), ix->term_len[t]) & (slots - 1);
+        while (slot[i]) i = (i + 1) & (slots - 1);
+        slot[i] = t + 1;
+    }
+    tracked_free(ix->slot);
+    ix->slot = slot;
+    ix->slot_mask = slots - 1;
+    return OK;
+}
+
+/* Term id of word s[0..n), added if new; -1 when out of memory. */
+static int64_t term_intern(SearchIndex *ix, const char *s, size_t n) {
+    int64_t t = term_find(ix, s, n);
+    if (t >= 0) return t;
+    if ((ix->terms + 1) * 2 > ix->slot_mask + 1 &&
+        rehash(ix, ix->slot ? (ix->slot_mask + 1) * 2 : 1024) != OK) {
+        return -1;
+    }
+    if (ix->chars_used + n > ix->chars_cap) {
+        size_t cap = grown(ix->chars_cap, ix->chars_used + n);
+        char *chars = tracked_realloc(ix->chars, cap);
+        if (!chars) return -1;
+        ix->chars = chars;
+        ix->chars_cap = cap;
+    }
+    if (ix->terms == ix->terms_cap) {
+        size_t cap = grown(ix->terms_cap, ix->terms + 1);
+        uint32_t *off = tracked_realloc(ix->term_off, cap * sizeof(*off));
+        if (off) ix->term_off = off;
+        uint8_t *len = tracked_realloc(ix->term_len, cap * sizeof(*len));
+        if (len) ix->term_len = len;
+        if (!off || !len) return -1;
+        ix->terms_cap = (uint32_t)cap;
+    }
+
+    memcpy(ix->chars + ix->chars_used, s, n);
+    ix->term_off[ix->terms] = (uint32_t)ix->chars_used;
+    ix->term_len[ix->terms] = (uint8_t)n;
+    ix->chars_used += n;
+    uint32_t i = hash_word(s, n) & ix->slot_mask;
+    while (ix->slot[i]) i = (i + 1) & ix->slot_mask;
+    ix->slot[i] = ++ix->terms;
+    return ix->terms - 1;
+}
+
+SearchIndex *search_new(void) {
+    return tracked_calloc(1, sizeof(SearchIndex));
+}
+
+void search_free(SearchIndex *ix) {
+    if (!ix) return;
+    void *arrays[] = { ix->chars, ix->term_off, ix->term_len, ix->slot, ix->doc_key,
+                       ix->doc_len, ix->trip_term, ix->trip_doc, ix->trip_tf, ix->words,
+                       ix->post_start, ix->post_doc, ix->post_w, ix->sorted,
+                       ix->acc, ix->touched };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); ++i) tracked_free(arrays[i]);
+    tracked_free(ix);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+Status search_add(SearchIndex *ix, uint32_t key, const char *const *texts, size_t n) {
+    if (ix->finished) return ERR;
+    if (ix->docs == ix->docs_cap) {
+        size_t cap = grown(ix->docs_cap, ix->docs + 1);
+        uint32_t *keys = tracked_realloc(ix->doc_key, cap * sizeof(*keys));
+        if (keys) ix->doc_key = keys;
+        uint32_t *lens = tracked_realloc(ix->doc_len, cap * sizeof(*lens));
+        if (lens) ix->doc_len = lens;
+        if (!keys || !lens) return ERR;
+        ix->docs_cap = (uint32_t)cap;
+    }
+
+    size_t words = 0;
+    char tok[SEARCH_TOKEN_MAX];
+    for (size_t i = 0; i < n; ++i) {
+        const char *p = texts[i];
+        if (!p) continue;
+        for (size_t len; (len = next_word(&p, tok)) != 0;) {
+            int64_t t = term_intern(ix, tok, len);
+            if (t < 0) return ERR;
+            if (words == ix->words_cap) {
+                size_t cap = grown(ix->words_cap, words + 1);
+                uint32_t *w = tracked_realloc(ix->words, cap * sizeof(*w));
+                if (!w) return ERR;
+                ix->words = w;
+                ix->words_cap = cap;
+            }
+            ix->words[words++] = (uint32_t)t;
+        }
+    }
+
+    /* one triple per distinct term, counted */
+    qsort(ix->words, words, sizeof(*ix->words), cmp_u32);
+    uint32_t doc = ix->docs;
+    for (size_t i = 0; i < words;) {
+        size_t j = i + 1;
+        while (j < words && ix->words[j] == ix->words[i]) j++;
+        if (ix->trips == ix->trips_cap) {
+            size_t cap = grown(ix->trips_cap, ix->trips + 1);
+            uint32_t *term = tracked_realloc(ix->trip_term, cap * sizeof(*term));
+            if (term) ix->trip_term = term;
+            uint32_t *in = tracked_realloc(ix->trip_doc, cap * sizeof(*in));
+            if (in) ix->trip_doc = in;
+            uint16_t *tf = tracked_realloc(ix->trip_tf, cap * sizeof(*tf));
+            if (tf) ix->trip_tf = tf;
+            if (!term || !in || !tf) return ERR;
+            ix->trips_cap = cap;
+        }
+        ix->trip_term[ix->trips] = ix->words[i];
+        ix->trip_doc[ix->trips] = doc;
+        ix->trip_tf[ix->trips] = (uint16_t)(j - i < UINT16_MAX ? j - i : UINT16_MAX);
+        ix->trips++;
+        i = j;
+    }
+    ix->doc_key[doc] = key;
+    ix->doc_len[doc] = (uint32_t)words;
+    ix->total_len += words;
+    ix->docs++;
+    return OK;
+}
+
+typedef struct {
+    const char *s;
+    uint32_t len, id;
+} SortTerm;
+
+static int cmp_spelling(const void *a, const void *b) {
+    const SortTerm *x = a, *y = b;
+    int c = memcmp(x->s, y->s, x->len < y->len ? x->len : y->len);
+    return c ? c : (x->len > y->len) - (x->len < y->len);
+}
+
+typedef struct {
+    float w;
+    uint32_t doc;
+} Posting;
+
+static int cmp_impact(const void *a, const void *b) {
+    const Posting *x = a, *y = b;
+    if (x->w != y->w) return x->w < y->w ? 1 : -1;
+    return (x->doc > y->doc) - (x->doc < y->doc);
+}
+
+Status search_finish(SearchIndex *ix) {
+    if (ix->finished) return OK;
+    size_t docs = ix->docs ? ix->docs : 1, terms = ix->terms ? ix->terms : 1;
+    size_t trips = ix->trips ? ix->trips : 1;
+    ix->post_start = tracked_calloc(ix->terms + 1, sizeof(*ix->post_start));
+    ix->post_doc = tracked_malloc(trips * sizeof(*ix->post_doc));
+    ix->post_w = tracked_malloc(trips * sizeof(*ix->post_w));
+    ix->sorted = tracked_malloc(terms * sizeof(*ix->sorted));
+    ix->acc = tracked_calloc(docs, sizeof(*ix->acc));
+    ix->touched = tracked_malloc(docs * sizeof(*ix->touched));
+    uint32_t *fill = tracked_malloc(terms * sizeof(*fill));
+    float *norm = tracked_malloc(docs * sizeof(*norm));
+    /* also holds one term's postings while they are sorted */
+    size_t scratch = terms * sizeof(SortTerm) > docs * sizeof(Posting) ? terms * sizeof(SortTerm)
+                                                                       : docs * sizeof(Posting);
+    SortTerm *by_name = tracked_malloc(scratch);
+    if (!ix->post_start || !ix->post_doc || !ix->post_w || !ix->sorted || !ix->acc ||
+        !ix->touched || !fill || !norm || !by_name) {
+        tracked_free(fill);
+        tracked_free(norm);
+        tracked_free(by_name);
+        return ERR;
+    }
+
+    float mean = ix->docs ? (float)ix->total_len / (float)ix->docs : 1.0f;
+    if (mean <= 0) mean = 1.0f;
+    for (uint32_t d = 0; d < ix->docs; ++d) {
+        norm[d] = BM25_K1 * (1.0f - BM25_B + BM25_B * (float)ix->doc_len[d] / mean);
+    }
+
+    /* counting sort of the triples by term.  The document side of BM25 is
+     * fixed now, so each posting keeps it and a query only multiplies by the
+     * term's idf; within a term postings go best first (ties by document),
+     * so a one-term query reads its answer off the front. */
+    for (size_t i = 0; i < ix->trips; ++i) ix->post_start[ix->trip_term[i] + 1]++;
+    for (uint32_t t = 0; t < ix->terms; ++t) {
+        ix->post_start[t + 1] += ix->post_start[t];
+        fill[t] = ix->post_start[t];
+    }
+    for (size_t i = 0; i < ix->trips; ++i) {
+        uint32_t at = fill[ix->trip_term[i]]++;
+        ix->post_doc[at] = ix->trip_doc[i];
+        float tf = ix->trip_tf[i];
+        ix->post_w[at] = tf * (BM25_K1 + 1) / (tf + norm[ix->trip_doc[i]]);
+    }
+    Posting *run = (Posting *)by_name;         /* free until the dictionary sort */
+    for (uint32_t t = 0; t < ix->terms; ++t) {
+        uint32_t from = ix->post_start[t], n = ix->post_start[t + 1] - from;
+        if (n < 2) continue;
+        for (uint32_t i = 0; i < n; ++i) run[i] = (Posting){ ix->post_w[from + i], ix->post_doc[from + i] };
+        qsort(run, n, sizeof(*run), cmp_impact);
+        for (uint32_t i = 0; i < n; ++i) {
+            ix->post_w[from + i] = run[i].w;
+            ix->post_doc[from + i] = run[i].doc;
+        }
+    }
+
+    for (uint32_t t = 0; t < ix->terms; ++t) {
+        by_name[t] = (SortTerm){ term_text(ix, t), ix->term_len[t], t };
+    }
+    qsort(by_name, ix->terms, sizeof(*by_name), cmp_spelling);
+    for (uint32_t t = 0; t < ix->terms; ++t) ix->sorted[t] = by_name[t].id;
+    tracked_free(fill);
+    tracked_free(norm);
+    tracked_free(by_name);
+
+    /* build-only arrays */
+    tracked_free(ix->trip_term);
+    tracked_free(ix->trip_doc);
+    tracked_free(ix->trip_tf);
+    tracked_free(ix->words);
+    tracked_free(ix->doc_len);
+    ix->trip_term = ix->trip_doc = ix->words = ix->doc_len = NULL;
+    ix->trip_tf = NULL;
+    ix->trips = ix->trips_cap = ix->words_cap = 0;
+    ix->finished = true;
+    return OK;
+}
+
+/* First position in `sorted` whose term is not less than s[0..n). */
+static uint32_t lower_bound(const SearchIndex *ix, const char *s, size_t n) {
+    uint32_t lo = 0, hi = ix->terms;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2, t = ix->sorted[mid];
+        size_t len = ix->term_len[t];
+        int c = memcmp(term_text(ix, t), s, len < n ? len : n);
+        if (c < 0 || (c == 0 && len < n)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+typedef struct {
+    uint32_t term;
+    float idf;                      /* times the prefix weight */
+} QueryTerm;
+
+/* Adds each term's BM25 contribution to every document it is in.  With
+ * `list`, the documents touched are listed in ix->touched; how many. */
+static uint32_t accumulate(SearchIndex *ix, const QueryTerm *q, size_t nq, bool list) {
+    uint32_t touched = 0;
+    for (size_t k = 0; k < nq; ++k) {
+        uint32_t from = ix->post_start[q[k].term], to = ix->post_start[q[k].term + 1];
+        for (uint32_t i = from; i < to; ++i) {
+            uint32_t d = ix->post_doc[i];
+            if (list && ix->acc[d] == 0) ix->touched[touched++] = d;
+            ix->acc[d] += q[k].idf * ix->post_w[i];
+        }
+    }
+    return touched;
+}
+
+/* Inserts (doc, score) into hits[0..*found), best `max` by (score desc,
+ * doc asc).  hits[].key holds doc ids until the end. */
+static void keep_best(SearchHit *hits, size_t *found, size_t max, uint32_t d, float s) {
+    size_t at = *found;
+    while (at > 0 && (hits[at - 1].score < s || (hits[at - 1].score == s && hits[at - 1].key > d))) {
+        at--;
+    }
+    if (at >= max) return;
+    if (*found < max) (*found)++;
+    memmove(hits + at + 1, hits + at, (*found - 1 - at) * sizeof(*hits));
+    hits[at] = (SearchHit){ d, s };
+}
+
+size_t search_query(SearchIndex *ix, const char *query, SearchHit *hits, size_t max) {
+    if (!ix->finished || !ix->docs || !max) return 0;
+    QueryTerm q[SEARCH_QUERY_TERMS * (1 + SEARCH_EXPAND_MAX)];
+    size_t nq = 0;
+    char tok[SEARCH_TOKEN_MAX];
+    const char *p = query;
+    size_t len;
+    for (int words = 0; words < SEARCH_QUERY_TERMS && (len = next_word(&p, tok)) != 0; ++words) {
+        int64_t exact = term_find(ix, tok, len);
+        if (exact >= 0) q[nq++] = (QueryTerm){ (uint32_t)exact, 1.0f };
+        if (len < SEARCH_PREFIX_MIN) continue;
+        uint32_t i = lower_bound(ix, tok, len);
+        for (int n = 0; i < ix->terms && n < SEARCH_EXPAND_MAX; ++i, ++n) {
+            uint32_t t = ix->sorted[i];
+            if (ix->term_len[t] < len || memcmp(term_text(ix, t), tok, len) != 0) break;
+            if (t != exact) q[nq++] = (QueryTerm){ t, SEARCH_PREFIX_WEIGHT };
+        }
+    }
+    size_t postings = 0;
+    for (size_t k = 0; k < nq; ++k) {
+        uint32_t df = ix->post_start[q[k].term + 1] - ix->post_start[q[k].term];
+        q[k].idf *= logf(1.0f + ((float)ix->docs - (float)df + 0.5f) / ((float)df + 0.5f));
+        postings += df;
+    }
+
+    size_t found = 0;
+    if (nq == 1) {
+        /* postings are in score order: the first ones are the answer */
+        uint32_t from = ix->post_start[q[0].term], to = ix->post_start[q[0].term + 1];
+        for (uint32_t i = from; i < to && found < max; ++i) {
+            hits[found++] = (SearchHit){ ix->post_doc[i], q[0].idf * ix->post_w[i] };
+        }
+    } else if (postings > ix->docs / SEARCH_DENSE_SHARE) {
+        /* a large share of documents match: skip the list, scan them all */
+        accumulate(ix, q, nq, false);
+        float least = 0;            /* hits[max - 1] once full; ties go to earlier docs */
+        for (uint32_t d = 0; d < ix->docs; ++d) {
+            if (ix->acc[d] <= least) continue;
+            keep_best(hits, &found, max, d, ix->acc[d]);
+            if (found == max) least = hits[max - 1].score;
+        }
+        memset(ix->acc, 0, ix->docs * sizeof(*ix->acc));
+    } else {
+        uint32_t touched = accumulate(ix, q, nq, true);
+        for (uint32_t i = 0; i < touched; ++i) {
+            uint32_t d = ix->touched[i];
+            keep_best(hits, &found, max, d, ix->acc[d]);
+            ix->acc[d] = 0;
+        }
+    }
+    for (size_t i = 0; i < found; ++i) hits[i].key = ix->doc_key[hits[i].key];
+    return found;
+}
+
+uint32_t search_docs(const SearchIndex *ix) {
+    return ix->docs;
+}
+
+uint32_t search_terms(const SearchIndex *ix) {
+    return ix->terms;
+}
+
+size_t search_bytes(const SearchIndex *ix) {
+    size_t postings = ix->finished ? ix->post_start[ix->terms] : ix->trips;
+    return sizeof(*ix) + ix->chars_cap + (size_t)ix->terms_cap * 5 + (ix->slot_mask + 1) * 4u +
+           (size_t)ix->docs_cap * 8 + postings * (ix->finished ? 8 : 10) + (size_t)ix->terms * 8 +
+           (size_t)ix->docs * 8;
+}
@@ -0,0 +1,349 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "serve.h"
+#include "leaderboard.h"
+#include "reclog.h"
+#include "sandbox.h"
+#include "shell.h"
+#include "tracker.h"
+
+#define SERVE_MAX_EVENTS 256
+#define SERVE_BACKLOG    512
+#define CONN_IN_CAP      4096
+#define CONN_OUT_HIGH    (64 * 1024)   /* stop reading a client past this */
+#define SERVE_OUT_CAP    8192          /* per chunk; longer replies spill */
+
+typedef struct Conn {
+    struct Conn *prev, *next;   /* g_conns: every live connection */
+    int fd;
+    Shell sh;
+    char in[CONN_IN_CAP];
+    size_t in_len;
+    char *wbuf;                 /* pending output not yet accepted by the kernel */
+    size_t wlen, woff, wcap;
+    bool closing;               /* flush what's pending, then drop */
+    bool eof;                   /* input ended while a verdict was awaited */
+    uint32_t events;            /* currently registered epoll mask */
+} Conn;
+
+static volatile sig_atomic_t g_stop = 0;
+static Conn *g_conns = NULL;
+static int g_sandbox_tag;       /* epoll data of sandbox_fd() */
+static int g_live = 0;
+static unsigned g_guests = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static bool conn_queue(Conn *c, const char *p, size_t n) {
+    if (n == 0) return true;
+    if (c->woff == c->wlen) c->woff = c->wlen = 0;
+    if (c->wlen + n > c->wcap) {
+        size_t cap = c->wcap ? c->wcap : 1024;
+        while (cap < c->wlen + n) cap *= 2;
+        char *nb = tracked_realloc(c->wbuf, cap);
+        if (!nb) return false;
+        c->wbuf = nb;
+        c->wcap = cap;
+    }
+    memcpy(c->wbuf + c->wlen, p, n);
+    c->wlen += n;
+    return true;
+}
+
+/* EngineOut spill hook: a reply longer than SERVE_OUT_CAP is queued in
+ * pieces for the connection in out->ctx. */
+static bool conn_spill(EngineOut *out) {
+    return conn_queue(out->ctx, out->data, out->len);
+}
+
+/* Queues what is left of a reply; says so if a single write was too long. */
+static bool conn_queue_out(Conn *c, EngineOut *out) {
+    static const char cut[] = "\n[output truncated]\n";
+    return conn_queue(c, out->data, out->len) &&
+           (!out->truncated || conn_queue(c, cut, sizeof(cut) - 1));
+}
+
+/* Write as much as the socket takes.  false = connection is dead. */
+static bool conn_flush(Conn *c) {
+    while (c->woff < c->wlen) {
+        ssize_t n = send(c->fd, c->wbuf + c->woff, c->wlen - c->woff, MSG_NOSIGNAL);
+        if (n > 0) { c->woff += (size_t)n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+    return true;
+}
+
+static void conn_free(int ep, Conn *c) {
+    if (c->prev) c->prev->next = c->next;
+    else g_conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    shell_session_free(&c->sh);
+    tracked_free(c->wbuf);
+    tracked_free(c);
+    g_live--;
+}
+
+static void conn_update_events(int ep, Conn *c) {
+    uint32_t want = 0;
+    bool pending = c->woff < c->wlen;
+    if (!c->closing && !c->sh.waiting && c->wlen - c->woff < CONN_OUT_HIGH) want |= EPOLLIN;
+    if (pending) want |= EPOLLOUT;
+    if (want == c->events) return;
+    struct epoll_event ev = { .events = want, .data.ptr = c };
+    epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+    c->events = want;
+}
+
+/* Feed every complete line in the input buffer to the learner's shell.
+ * Over-long lines are cut at MAX_INPUT-1 bytes, the same way fgets would.
+ * Lines after a code submission wait in the buffer for its verdict. */
+static bool conn_process(Conn *c, EngineOut *out) {
+    size_t start = 0;
+    while (!c->sh.quit && !c->sh.waiting && c->wlen - c->woff < CONN_OUT_HIGH) {
+        char *nl = memchr(c->in + start, '\n', c->in_len - start);
+        size_t n;
+        if (nl) {
+            n = (size_t)(nl - (c->in + start)) + 1;
+        } else if (c->in_len - start >= MAX_INPUT - 1) {
+            n = MAX_INPUT - 1;
+        } else {
+            break;
+        }
+        if (n > MAX_INPUT - 1) n = MAX_INPUT - 1;
+
+        char line[MAX_INPUT];
+        memcpy(line, c->in + start, n);
+        line[n] = '\0';
+        start += n;
+
+        engine_out_reset(out);
+        out->ctx = c;
+        shell_session_feed(&c->sh, line, out);
+        if (!conn_queue_out(c, out)) return false;
+    }
+    memmove(c->in, c->in + start, c->in_len - start);
+    c->in_len -= start;
+    if (c->sh.quit) c->closing = true;
+    return true;
+}
+
+static void conn_accept(int ep, int lfd, EngineOut *out) {
+    for (;;) {
+        int fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept4");
+            return;
+        }
+        Conn *c = tracked_calloc(1, sizeof(*c));
+        if (!c) { close(fd); continue; }
+        c->fd = fd;
+        shell_session_init(&c->sh, false);
+        c->sh.grade_ctx = c;
+        char name[LB_NAME_MAX];
+        snprintf(name, sizeof(name), "guest%u", ++g_guests);
+        shell_session_join(&c->sh, name);   /* off the board if out of memory */
+
+        engine_out_reset(out);
+        out->ctx = c;
+        shell_session_welcome(&c->sh, out);
+        c->events = EPOLLIN;
+        struct epoll_event ev = { .events = c->events, .data.ptr = c };
+        if (!conn_queue_out(c, out) ||
+            epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            shell_session_free(&c->sh);
+            tracked_free(c->wbuf);
+            tracked_free(c);
+            continue;
+        }
+        c->next = g_conns;
+        if (g_conns) g_conns->prev = c;
+        g_conns = c;
+        g_live++;
+        if (!conn_flush(c)) { conn_free(ep, c); continue; }
+        conn_update_events(ep, c);
+    }
+}
+
+/* Input ended: finish what was sent, then say goodbye.  With a verdict
+ * still to come, conn_grades() gets back here once it is in. */
+static bool conn_at_eof(Conn *c, EngineOut *out) {
+    c->eof = true;
+    if (!conn_process(c, out)) return false;
+    if (c->sh.waiting) return true;
+    if (c->in_len > 0 && !c->sh.quit) {
+        char line[MAX_INPUT];
+        memcpy(line, c->in, c->in_len);
+        line[c->in_len] = '\0';
+        c->in_len = 0;
+        engine_out_reset(out);
+        out->ctx = c;
+        shell_session_feed(&c->sh, line, out);
+        conn_queue_out(c, out);
+        if (c->sh.waiting) return true;
+    }
+    if (!c->sh.quit) {
+        engine_out_reset(out);
+        out->ctx = c;
+        shell_session_close(&c->sh, out);
+        conn_queue_out(c, out);
+    }
+    c->closing = true;
+    return true;
+}
+
+/* Returns false when the connection should be dropped now. */
+static bool conn_on_readable(Conn *c, EngineOut *out) {
+    for (;;) {
+        if (c->in_len == sizeof(c->in)) {
+            if (!conn_process(c, out)) return false;
+            if (c->in_len == sizeof(c->in) || c->closing) return true;
+        }
+        ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n == 0) return conn_at_eof(c, out);
+        c->closing = true;
+        return true;
+    }
+    return conn_process(c, out);
+}
+
+/* Verdicts are in: finish each learner's submission, then go on with
+ * whatever it sent in the meantime. */
+static void conn_grades(int ep, EngineOut *out) {
+    SandboxResult r;
+    Conn *c;
+    while ((c = sandbox_reap(&r))) {
+        engine_out_reset(out);
+        out->ctx = c;
+        shell_session_resume(&c->sh, &r, out);
+        bool alive = conn_queue_out(c, out) &&
+                     (c->eof ? conn_at_eof(c, out) : conn_process(c, out)) && conn_flush(c);
+        if (!alive || (c->closing && c->woff == c->wlen)) {
+            conn_free(ep, c);
+            continue;
+        }
+        conn_update_events(ep, c);
+    }
+}
+
+/* The nearer of two epoll_wait() timeouts (-1 = none). */
+static int soonest(int a, int b) {
+    return a < 0 ? b : b < 0 || a < b ? a : b;
+}
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* replace a stale socket from an earlier run, never a regular file */
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) { perror("socket"); return -1; }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fd, SERVE_BACKLOG) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int serve_run(const char *socket_path) {
+    int lfd = listen_unix(socket_path);
+    if (lfd < 0) return 1;
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) { perror("epoll_create1"); close(lfd); return 1; }
+    struct epoll_event lev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &lev);
+    struct epoll_event sev = { .events = EPOLLIN, .data.ptr = &g_sandbox_tag };
+    if (sandbox_fd() >= 0) epoll_ctl(ep, EPOLL_CTL_ADD, sandbox_fd(), &sev);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    char text[SERVE_OUT_CAP];
+    EngineOut out;
+    engine_out_init(&out, text, sizeof(text));
+    out.spill = conn_spill;
+    struct epoll_event evs[SERVE_MAX_EVENTS];
+
+    printf("Serving on %s (Ctrl-C to stop)\n", socket_path);
+    fflush(stdout);
+
+    while (!g_stop) {
+        int n = epoll_wait(ep, evs, SERVE_MAX_EVENTS, soonest(reclog_due_ms(), sandbox_due_ms()));
+        reclog_tick();
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        bool graded = false;
+        for (int i = 0; i < n; ++i) {
+            Conn *c = evs[i].data.ptr;
+            if (!c) { conn_accept(ep, lfd, &out); continue; }
+            if (evs[i].data.ptr == &g_sandbox_tag) { graded = true; continue; }
+
+            bool alive = true;
+            if (c->sh.waiting && (evs[i].events & (EPOLLHUP | EPOLLERR))) {
+                alive = false;      /* gone before its verdict came */
+            } else if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                alive = conn_on_readable(c, &out);
+            }
+            if (alive) alive = conn_flush(c);
+            /* output drained: a stalled reader may have more queued lines */
+            if (alive && !c->closing && c->in_len > 0) {
+                alive = conn_process(c, &out) && conn_flush(c);
+            }
+            if (!alive || (c->closing && c->woff == c->wlen)) {
+                conn_free(ep, c);
+                continue;
+            }
+            conn_update_events(ep, c);
+        }
+        /* after the batch, which may still hold events of a connection this frees */
+        if (graded || sandbox_due_ms() == 0) conn_grades(ep, &out);
+    }
+
+    printf("Shutting down (%d live connections)\n", g_live);
+    /* sessions, journals and recording streams end like a hang-up would */
+    while (g_conns) conn_free(ep, g_conns);
+    close(ep);
+    close(lfd);
+    unlink(socket_path);
+    return 0;
+}
@@ -1,38 +1,58 @@
+#include <pthread.h>
+#include <time.h>
+
+#include "cpp.h"
+#include "leaderboard.h"
+#include "reclog.h"
+#include "sandbox.h"
+#include "search.h"
 #include "shell.h"
 #include "stations.h"
+#include "stats.h"
+#include "taskgen.h"
+#include "tracker.h"
+#include "ui.h"
 
-/* ===== Shell-owned state ===== */
-static GameState G;
+/* ===== Shell-owned state (stdin REPL) ===== */
+static Shell S;
 
 /* forward decls for handlers */
-static void cmd_help(const char *arg);
-static void cmd_map(const char *arg);
-static void cmd_play(const char *arg);
-static void cmd_score(const char *arg);
-static void cmd_quit(const char *arg);
+static void cmd_help(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_map(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_play(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_score(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_rank(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_top(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_mem(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_stats(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_review(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_drill(Shell *sh, const char *arg, EngineOut *out);
+static void cmd_find(Shell *sh, const char *arg, EngineOut *out);
+static void find_warm(void);
+static void cmd_quit(Shell *sh, const char *arg, EngineOut *out);
 
 typedef struct {
     const char *name;
-    void (*fn)(const char *);
+    void (*fn)(Shell *, const char *, EngineOut *);
     const char *desc;
 } Command;
 
 /* Station registry (id order 02..15) */
 static const Station REG[STATION_COUNT] = {
-    {  2, "compilation",  "Compilation Runway",           station_compilation },
-    {  3, "fundamentals", "Fundamentals Arena",           station_fundamentals },
-    {  4, "functions",    "Functions Lab",                station_functions },
-    {  5, "precision",    "Precision Casino",             station_precision },
-    {  6, "imperative",   "Imperative Playground",        station_imperative },
-    {  7, "types",        "Type System Bench",            station_types },
-    {  8, "preprocessor", "Preprocessor Studio",          station_preprocessor },
-    {  9, "pointers",     "Pointer Maze",                 station_pointers },
-    { 10, "array1d",      "1D Array Workshop",            station_array1d },
-    { 11, "arrays_ptrs",  "Arrays ↔ Pointers Tower",      station_arrays_ptrs },
-    { 12, "memory",       "Memory-Mgmt Tycoon",           station_memory },
-    { 13, "ptrptr",       "Pointer-to-Pointer Lab",       station_ptrptr },
-    { 14, "funptr",       "Function-Pointer Arcade",      station_funptr },
-    { 15, "strings",      "Chars & Strings Café",         station_strings }
+    {  2, "compilation",  "Compilation Runway",           station_compilation,  &BANK_COMPILATION },
+    {  3, "fundamentals", "Fundamentals Arena",           station_fundamentals, NULL },
+    {  4, "functions",    "Functions Lab",                station_functions,    NULL },
+    {  5, "precision",    "Precision Casino",             station_precision,    NULL },
+    {  6, "imperative",   "Imperative Playground",        station_imperative,   NULL },
+    {  7, "types",        "Type System Bench",            station_types,        NULL },
+    {  8, "preprocessor", "Preprocessor Studio",          station_preprocessor, &BANK_PREPROCESSOR },
+    {  9, "pointers",     "Pointer Maze",                 station_pointers,     &BANK_POINTERS },
+    { 10, "array1d",      "1D Array Workshop",            station_array1d,      NULL },
+    { 11, "arrays_ptrs",  "Arrays ↔ Pointers Tower",      station_arrays_ptrs,  NULL },
+    { 12, "memory",       "Memory-Mgmt Tycoon",           station_memory,       NULL },
+    { 13, "ptrptr",       "Pointer-to-Pointer Lab",       station_ptrptr,       NULL },
+    { 14, "funptr",       "Function-Pointer Arcade",      station_funptr,       NULL },
+    { 15, "strings",      "Chars & Strings Café",         station_strings,      NULL }
 };
 
 /* Commands table */
@@ -41,165 +61,912 @@ static const Command CMDS[] = {
     { "map",   cmd_map,   "Show stations 02..15 with progress" },
     { "play",  cmd_play,  "Start a station: play <02..15|keyword>" },
     { "score", cmd_score, "Show totals" },
+    { "rank",  cmd_rank,  "Your leaderboard place: rank [02..15|keyword]" },
+    { "top",   cmd_top,   "Leaderboard top 10: top [02..15|keyword]" },
+    { "mem",   cmd_mem,   "Show tracked heap: live bytes, peak, top sites" },
+    { "review", cmd_review, "Spaced repetition: due tasks from all stations" },
+    { "drill", cmd_drill, "Fresh generated tasks: drill <02..15|keyword|template> [seed]" },
+    { "stats", cmd_stats, "Response times: stats [02..15|keyword] | stats dump [file]" },
+    { "find",  cmd_find,  "Search every task and play the best match: find <words>" },
     { "quit",  cmd_quit,  "Exit program" },
 };
 static const size_t CMDS_N = sizeof(CMDS)/sizeof(CMDS[0]);
 
+/* Other spellings: { alias, command or station keyword }.  Unique prefixes
+ * of names and aliases work without being listed. */
+static const char *const CMD_ALIASES[][2] = {
+    { "?",    "help" },
+    { "ls",   "map" },
+    { "exit", "quit" },
+};
+static const char *const STATION_ALIASES[][2] = {
+    { "float",     "precision" },
+    { "cpp",       "preprocessor" },
+    { "macros",    "preprocessor" },
+    { "2d",        "arrays_ptrs" },
+    { "heap",      "memory" },
+    { "malloc",    "memory" },
+    { "callbacks", "funptr" },
+};
+
+/* Command word -> CMDS index and station word -> REG index, built once
+ * before the first shell starts (see router.h). */
+static Router CMD_ROUTER, STATION_ROUTER;
+static pthread_once_t ROUTERS_ONCE = PTHREAD_ONCE_INIT;
+
+/* Banks loaded at startup (--bank) take precedence over REG[i].bank */
+static TaskBank *BANKS[STATION_COUNT];
+
+/* Every learner that joined (stdin and server), from the first join on */
+static Leaderboard *BOARD;
+#define TOP_ROWS     10
+#define RANK_RADIUS  2
+
+/* `drill`: DRILL_TASKS generated tasks, all rebuilt from `seed`.  Practice
+ * only: the result is shown but progress is left alone. */
+#define DRILL_TASKS  5
+typedef struct Drill {
+    uint64_t seed;
+    char target[24];                /* what `drill` was given */
+    Task tasks[DRILL_TASKS];
+    TaskgenText text[DRILL_TASKS];
+} Drill;
+
+/* `find`: one index over the tasks of every station bank, key = REG index
+ * and task.  Rebuilt when a bank is replaced (--bank-dir reload); the
+ * lock is for the batch grader's threads. */
+#define FIND_HITS     5
+#define FIND_SNIPPET  56
+#define FIND_TEXTS    32            /* prompt, hint, why and the first options */
+#define FIND_KEY(idx, task)  ((uint32_t)(idx) << 24 | (uint32_t)(task))
+static SearchIndex *FIND;
+static struct {
+    const TaskBank *bank;
+    uint32_t version;               /* hotbank_version(), 0 = not a hot bank */
+} FIND_BUILT[STATION_COUNT];
+static pthread_mutex_t FIND_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+/* Prometheus dump target for `stats dump`; also written at teardown when
+ * set with shell_set_stats_file(). */
+#define STATS_FILE_DEFAULT "c_arcade.prom"
+static const char *STATS_FILE;
+
 /* ===== util ===== */
-static int parse_station_arg(const char *arg) {
-    if (!arg || !*arg) return -1;
-    /* accept two-digit numeric or keyword */
-    if (isdigit((unsigned char)arg[0])) {
-        int v = atoi(arg);
-        if (v >= 2 && v <= 15) return v;
-        return -1;
-    }
-    /* keyword */
-    for (int i = 0; i < STATION_COUNT; ++i) {
-        if (strcmp(arg, REG[i].keyword) == 0) return REG[i].id;
-    }
+static int command_named(const char *name) {
+    for (size_t i = 0; i < CMDS_N; ++i) if (strcmp(CMDS[i].name, name) == 0) return (int)i;
+    return -1;
+}
+
+static int station_named(const char *keyword) {
+    for (int i = 0; i < STATION_COUNT; ++i) if (strcmp(REG[i].keyword, keyword) == 0) return i;
     return -1;
 }
 
-static const Station* find_station(int id) {
-    for (int i = 0; i < STATION_COUNT; ++i) if (REG[i].id == id) return &REG[i];
-    return NULL;
+/* Startup only: the linear scans here resolve alias targets. */
+static void build_routers(void) {
+    RouteName names[STATION_COUNT + 16];
+    size_t n = 0;
+    for (size_t i = 0; i < CMDS_N; ++i) names[n++] = (RouteName){ CMDS[i].name, (int)i };
+    for (size_t i = 0; i < sizeof(CMD_ALIASES) / sizeof(CMD_ALIASES[0]); ++i) {
+        names[n++] = (RouteName){ CMD_ALIASES[i][0], command_named(CMD_ALIASES[i][1]) };
+    }
+    if (router_build(&CMD_ROUTER, names, n) != OK) {
+        fprintf(stderr, "shell: command table does not build\n");
+        abort();
+    }
+
+    n = 0;
+    for (int i = 0; i < STATION_COUNT; ++i) names[n++] = (RouteName){ REG[i].keyword, i };
+    for (size_t i = 0; i < sizeof(STATION_ALIASES) / sizeof(STATION_ALIASES[0]); ++i) {
+        names[n++] = (RouteName){ STATION_ALIASES[i][0], station_named(STATION_ALIASES[i][1]) };
+    }
+    if (router_build(&STATION_ROUTER, names, n) != OK) {
+        fprintf(stderr, "shell: station table does not build\n");
+        abort();
+    }
+}
+
+const Router *shell_command_router(void) {
+    pthread_once(&ROUTERS_ONCE, build_routers);
+    return &CMD_ROUTER;
+}
+
+const Router *shell_station_router(void) {
+    pthread_once(&ROUTERS_ONCE, build_routers);
+    return &STATION_ROUTER;
 }
 
-static void prompt(void) {
-    printf(C_BOLD "c-arcade" C_RESET " (%d pts) > ", G.total_score);
-    fflush(stdout);
+/* REG index for a station word or number (02..15), or -1. */
+static int station_index(const char *arg) {
+    if (!arg) return -1;
+    size_t start, len = strk_trim(arg, strlen(arg), &start);
+    if (!len) return -1;
+    int idx = router_lookup(&STATION_ROUTER, arg + start, len);
+    if (idx < 0 && isdigit((unsigned char)arg[start])) {
+        int v = atoi(arg + start);
+        if (v >= 2 && v <= 15) idx = v - REG[0].id;     /* REG is in id order */
+    }
+    return idx;
+}
+
+static TaskBank *static_bank(int idx) {
+    return BANKS[idx] ? BANKS[idx] : REG[idx].bank;
+}
+
+/* Tasks for REG[idx]: its --bank-dir version, pinned in *held until
+ * hotbank_release(), else static_bank(). */
+static TaskBank *acquire_bank(int idx, HotBank **held) {
+    *held = hotbank_acquire(REG[idx].id);
+    return *held ? hotbank_bank(*held) : static_bank(idx);
+}
+
+/* The session is finished with its tasks; a replaced bank version may go. */
+static void end_session(Shell *sh) {
+    engine_end(sh->session);
+    sh->session = NULL;
+    hotbank_release(sh->held);
+    sh->held = NULL;
+    tracked_free(sh->drill);
+    sh->drill = NULL;
+}
+
+static void prompt(const Shell *sh, EngineOut *out) {
+    engine_out_printf(out, C_BOLD "c-arcade" C_RESET " (%d pts) > ", sh->g.total_score);
+}
+
+/* Every GameState progress change goes through here so it can be journaled. */
+static void set_progress(Shell *sh, JournalKind kind, int idx, int value) {
+    GameState *G = &sh->g;
+    switch (kind) {
+        case JR_SCORE:
+            G->total_score += value - G->station_scores[idx];
+            G->station_scores[idx] = value;
+            if (sh->learner >= 0) lb_set(BOARD, (uint32_t)sh->learner, idx, value);
+            break;
+        case JR_ATTEMPTED: G->attempted[idx] = value; break;
+        case JR_COMPLETED: G->completed[idx] = value != 0; break;
+    }
+    journal_append(sh->journal, kind, idx, value);
+}
+
+/* Station session finished: fold its result into the learner's state. */
+static void end_station(Shell *sh, EngineOut *out) {
+    StationResult res = engine_result(sh->session);
+    end_session(sh);
+
+    int idx = sh->station_idx;
+    if (sh->tally) {
+        StationTally *t = &sh->tally[idx];
+        t->sessions++;
+        t->sum.station_id = res.station_id;
+        t->sum.total_tasks += res.total_tasks;
+        t->sum.correct_first_try += res.correct_first_try;
+        t->sum.correct_with_hint += res.correct_with_hint;
+        t->sum.total_points += res.total_points;
+    }
+    if (res.total_points > sh->g.station_scores[idx]) {
+        set_progress(sh, JR_SCORE, idx, res.total_points);
+    }
+    engine_out_printf(out, "Points earned: %d\n", res.total_points);
+}
+
+/* ===== review mode ===== */
+static void fmt_wait(char *buf, size_t n, uint32_t secs) {
+    unsigned minutes = (secs + 59) / 60;
+    unsigned hours = (secs + 1800) / 3600;
+    unsigned days = (secs + REVIEW_DAY / 2) / REVIEW_DAY;
+    if (minutes < 60) snprintf(buf, n, "%u min", minutes);
+    else if (hours < 24) snprintf(buf, n, "%u h", hours);
+    else snprintf(buf, n, "%u day%s", days, days == 1 ? "" : "s");
+}
+
+static void review_save_deck(const Shell *sh) {
+    char path[512];
+    if (!sh->deck || !sh->state_dir) return;
+    snprintf(path, sizeof(path), "%s/review.bin", sh->state_dir);
+    if (review_save(sh->deck, path) != OK) fprintf(stderr, "%s: cannot save\n", path);
+}
+
+/* Start the earliest due card, or leave review mode if none is due. */
+static void review_next_task(Shell *sh, EngineOut *out) {
+    uint32_t now = (uint32_t)time(NULL);
+    int32_t id = review_next(sh->deck);
+    const ReviewCard *c = id >= 0 ? review_card(sh->deck, (uint32_t)id) : NULL;
+    if (!c || c->due > now) {
+        sh->reviewing = false;
+        review_save_deck(sh);
+        if (c) {
+            char wait[32];
+            fmt_wait(wait, sizeof(wait), c->due - now);
+            engine_out_printf(out, "Nothing due. Next review in %s.\n", wait);
+        } else {
+            engine_out_puts(out, "No graded tasks to review.");
+        }
+        return;
+    }
+
+    const Station *st = &REG[c->station];
+    engine_out_printf(out, C_BOLD "[review] [%02d] %s" C_RESET " — %s\n", st->id, st->keyword,
+                      c->reps ? "due" : "new");
+    TaskBank *bank = acquire_bank(c->station, &sh->held);
+    if (!bank || c->task >= (uint32_t)bank->count) {
+        /* the bank was reloaded with fewer tasks: rebuild the deck */
+        hotbank_release(sh->held);
+        sh->held = NULL;
+        sh->reviewing = false;
+        review_save_deck(sh);
+        review_deck_free(sh->deck);
+        sh->deck = NULL;
+        engine_out_puts(out, "Tasks were updated since the deck was built; type 'review' again.");
+        return;
+    }
+    sh->session = engine_begin_task(st->id, bank, (int)c->task);
+    if (!sh->session) {
+        hotbank_release(sh->held);
+        sh->held = NULL;
+        engine_out_puts(out, "out of memory.");
+        sh->reviewing = false;
+        return;
+    }
+    sh->station_idx = c->station;
+    sh->review_id = (uint32_t)id;
+    engine_start(sh->session, out);
+}
+
+/* Review card answered: first try = 5, with help = 3, skipped = 1. */
+static void review_end_task(Shell *sh, EngineOut *out) {
+    StationResult res = engine_result(sh->session);
+    end_session(sh);
+
+    if (res.total_tasks == 0) {
+        sh->reviewing = false;
+        review_save_deck(sh);
+        engine_out_puts(out, "Review paused.");
+        return;
+    }
+    int quality = res.correct_first_try ? 5 : res.correct_with_hint ? 3 : 1;
+    uint32_t now = (uint32_t)time(NULL);
+    review_grade(sh->deck, sh->review_id, quality, now);
+
+    char wait[32];
+    fmt_wait(wait, sizeof(wait), review_card(sh->deck, sh->review_id)->due - now);
+    engine_out_printf(out, C_DIM "Next review of this task in %s." C_RESET "\n", wait);
+    review_next_task(sh, out);
+}
+
+/* ===== drill mode ===== */
+static void drill_end(Shell *sh, EngineOut *out) {
+    StationResult res = engine_result(sh->session);
+    char again[64];
+    snprintf(again, sizeof(again), "drill %s %llu", sh->drill->target,
+             (unsigned long long)sh->drill->seed);
+    end_session(sh);
+    engine_out_printf(out, "Drill points: %d (practice; progress unchanged)\n", res.total_points);
+    engine_out_printf(out, C_DIM "Same tasks again: %s" C_RESET "\n", again);
+}
+
+static void session_done(Shell *sh, EngineOut *out) {
+    if (sh->reviewing) review_end_task(sh, out);
+    else if (sh->drill) drill_end(sh, out);
+    else end_station(sh, out);
 }
 
 /* ===== public ===== */
 void shell_init(void) {
-    memset(&G, 0, sizeof(G));
+    shell_session_init(&S, true);
+    find_warm();
 #if DEBUG
-    fprintf(stdout, C_DIM "[DEBUG] Shell init complete\n" C_RESET);
+    ui_printf(C_DIM "[DEBUG] Shell init complete\n" C_RESET);
 #endif
 }
 
+Status shell_open_state(const char *dir) {
+    S.journal = journal_open(dir, &S.g);
+    S.state_dir = dir;
+    return S.journal ? OK : ERR;
+}
+
+void shell_set_stats_file(const char *path) {
+    STATS_FILE = path;
+}
+
 void shell_teardown(void) {
+    shell_session_free(&S);
+    if (STATS_FILE && stats_write_prometheus(STATS_FILE) != OK) {
+        fprintf(stderr, "%s: cannot write stats\n", STATS_FILE);
+    }
+    shell_release_banks();
+    lb_free(BOARD);
+    BOARD = NULL;
 #if DEBUG
-    fprintf(stdout, C_DIM "[DEBUG] Shell teardown complete\n" C_RESET);
+    ui_printf(C_DIM "[DEBUG] Shell teardown complete\n" C_RESET);
 #endif
+    ui_flush();
+}
+
+Status shell_prepare_banks(void) {
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        TaskBank *bank = static_bank(i);
+        if (bank && !task_bank_prepare(bank)) return ERR;
+    }
+    return OK;
+}
+
+/* --bank files release their own when closed; the find index and the
+ * preprocessor's memo go too */
+void shell_release_banks(void) {
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        if (REG[i].bank) task_bank_release(REG[i].bank);
+    }
+    cpp_memo_clear();
+    pthread_mutex_lock(&FIND_LOCK);
+    search_free(FIND);
+    FIND = NULL;
+    memset(FIND_BUILT, 0, sizeof(FIND_BUILT));
+    pthread_mutex_unlock(&FIND_LOCK);
+}
+
+Status shell_use_bank(int station_id, TaskBank *bank) {
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        if (REG[i].id == station_id) {
+            BANKS[i] = bank;
+            return OK;
+        }
+    }
+    return ERR;
+}
+
+void shell_session_init(Shell *sh, bool launchers) {
+    pthread_once(&ROUTERS_ONCE, build_routers);
+    memset(sh, 0, sizeof(*sh));
+    sh->launchers = launchers;
+    sh->learner = -1;
+    sh->salt = taskgen_mix(stats_now_ns() ^ (uintptr_t)sh);
+    sh->last_target = "";
+}
+
+Status shell_session_join(Shell *sh, const char *name) {
+    if (!BOARD && !(BOARD = lb_new())) return ERR;
+    int32_t id = lb_join(BOARD, name);
+    if (id < 0) return ERR;
+    /* progress recovered from a journal counts from the start */
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        if (lb_set(BOARD, (uint32_t)id, i, sh->g.station_scores[i]) != OK) return ERR;
+    }
+    sh->learner = id;
+    if (!sh->grading) {
+        sh->rec = reclog_stream_open(name, sh->launchers ? REC_LAUNCHERS : 0, sh->salt, &sh->g);
+    }
+    return OK;
+}
+
+void shell_session_free(Shell *sh) {
+    reclog_stream_close(sh->rec);
+    sh->rec = 0;
+    if (sh->session) end_session(sh);
+    review_save_deck(sh);
+    review_deck_free(sh->deck);
+    sh->deck = NULL;
+    journal_close(sh->journal);
+    sh->journal = NULL;
+}
+
+void shell_session_welcome(Shell *sh, EngineOut *out) {
+    engine_out_puts(out, C_GREEN "Welcome to C Arcade — type 'help' to begin." C_RESET);
+    prompt(sh, out);
+}
+
+static void dispatch(Shell *sh, const char *text, EngineOut *out);
+static void session_step(Shell *sh, EngineStatus st, EngineOut *out);
+
+/* Group commit: whatever one input line changed becomes durable together. */
+void shell_session_feed(Shell *sh, const char *text, EngineOut *out) {
+    if (sh->quit || sh->waiting) return;
+    reclog_input(sh->rec, text);
+    uint64_t t0 = stats_now_ns();
+    dispatch(sh, text, out);
+    stats_record_dispatch(stats_now_ns() - t0);
+    reclog_dispatch(sh->rec, sh->last_target);
+    if (sh->last_grade != GRADE_NONE) {
+        reclog_grade(sh->rec, sh->last_station, sh->last_task, sh->last_grade);
+    }
+    journal_commit(sh->journal);
+}
+
+/* The line's grade is recorded now, after the REC_DISPATCH of its feed. */
+void shell_session_resume(Shell *sh, const SandboxResult *r, EngineOut *out) {
+    if (!sh->waiting) return;
+    sh->waiting = false;
+    session_step(sh, engine_resume(sh->session, r, out), out);
+    if (sh->last_grade != GRADE_NONE) {
+        reclog_grade(sh->rec, sh->last_station, sh->last_task, sh->last_grade);
+    }
+    journal_commit(sh->journal);
+}
+
+/* After the station session took a line (or a verdict). */
+static void session_step(Shell *sh, EngineStatus st, EngineOut *out) {
+    sh->last_station = REG[sh->station_idx].id;
+    sh->last_grade = engine_last_grade(sh->session, &sh->last_task);
+    if (st == ENGINE_GRADING) {
+        sh->waiting = true;
+    } else if (st == ENGINE_STATION_DONE) {
+        session_done(sh, out);
+        /* review mode may have started the next card already */
+        if (!sh->session) prompt(sh, out);
+    }
+}
+
+static void dispatch(Shell *sh, const char *text, EngineOut *out) {
+    sh->last_grade = GRADE_NONE;
+    if (sh->session) {
+        engine_grade_async(sh->session, sh->grade_ctx);
+        EngineStatus st = engine_feed(sh->session, text, out);
+        sh->last_target = "";
+        session_step(sh, st, out);
+        return;
+    }
+
+    char line[MAX_INPUT];
+    strncpy(line, text, sizeof(line)-1); line[sizeof(line)-1] = 0;
+    size_t len = strk_eol(line, sizeof(line) - 1);
+    line[len] = '\0';
+    /* split into command + optional arg */
+    char *cmd = line + strk_span_space(line, len);
+    size_t rest = len - (size_t)(cmd - line);
+    sh->last_target = "?";
+    if (!rest) { prompt(sh, out); return; }
+
+    size_t cmd_len = strk_span_word(cmd, rest);
+    char *arg = NULL;
+    if (cmd_len < rest) {
+        cmd[cmd_len] = '\0';
+        arg = cmd + cmd_len + 1;
+        arg += strk_span_space(arg, rest - cmd_len - 1);
+    }
+
+    int c = router_lookup(&CMD_ROUTER, cmd, cmd_len);
+    if (c >= 0) {
+        sh->last_target = CMDS[c].name;
+        CMDS[c].fn(sh, arg, out);
+    } else {
+        engine_out_puts(out, "unknown command. try 'help'");
+    }
+    /* a station that just started has already written its own "> " */
+    if (!sh->quit && !sh->session) prompt(sh, out);
+}
+
+void shell_session_close(Shell *sh, EngineOut *out) {
+    reclog_stream_close(sh->rec);
+    sh->rec = 0;
+    sh->waiting = false;
+    if (sh->session) {
+        engine_close(sh->session, out);
+        session_done(sh, out);
+        prompt(sh, out);
+        journal_commit(sh->journal);
+    }
+    if (!sh->quit) engine_out_puts(out, "\nEOF");
 }
 
 /* ===== handlers ===== */
-static void cmd_help(const char *arg) {
-    (void)arg;
-    puts(C_CYAN "Commands:" C_RESET);
+static void cmd_help(Shell *sh, const char *arg, EngineOut *out) {
+    (void)sh; (void)arg;
+    engine_out_puts(out, C_CYAN "Commands:" C_RESET);
     for (size_t i = 0; i < CMDS_N; ++i) {
-        printf("  %-6s %s\n", CMDS[i].name, CMDS[i].desc);
+        engine_out_printf(out, "  %-6s %s\n", CMDS[i].name, CMDS[i].desc);
     }
-    printf("\nBuild: DEBUG=%d  |  Stations: %d  |  play <02..15|keyword>\n",
-           DEBUG, STATION_COUNT);
+    engine_out_puts(out, "Any unique prefix works too (rev, st 09, play poi); also ? ls exit.");
+    engine_out_printf(out, "\nBuild: DEBUG=%d  |  Stations: %d  |  play <02..15|keyword>\n",
+                      DEBUG, STATION_COUNT);
 }
 
-static void cmd_map(const char *arg) {
+static void cmd_map(Shell *sh, const char *arg, EngineOut *out) {
     (void)arg;
-    puts(C_CYAN "Stations:" C_RESET);
+    const GameState *G = &sh->g;
+    engine_out_puts(out, C_CYAN "Stations:" C_RESET);
     for (int i = 0; i < STATION_COUNT; ++i) {
-        const char *mark = G.completed[i] ? MARK_OK : MARK_NO;
-        const int id = REG[i].id;
-        const char *kw = REG[i].keyword;
-        const char *title = REG[i].title;
-        printf("  [%02d] %-12s — %s  (%d pts, attempts %d)  %s\n",
-       id, kw, mark, G.station_scores[i], G.attempted[i], title);
-
+        const char *mark = G->completed[i] ? MARK_OK : MARK_NO;
+        engine_out_printf(out, "  [%02d] %-12s — %s  (%d pts, attempts %d)  %s\n",
+                          REG[i].id, REG[i].keyword, mark, G->station_scores[i],
+                          G->attempted[i], REG[i].title);
     }
     /* totals */
     int answered = 0;
-    for (int i = 0; i < STATION_COUNT; ++i) answered += (G.attempted[i] > 0);
-    printf("\nTotals: score=%d  answered=%d/%d\n",
-           G.total_score, answered, STATION_COUNT);
+    for (int i = 0; i < STATION_COUNT; ++i) answered += (G->attempted[i] > 0);
+    engine_out_printf(out, "\nTotals: score=%d  answered=%d/%d\n",
+                      G->total_score, answered, STATION_COUNT);
+}
+
+/* Play REG[idx] on `bank` (pinned in `held`, which the session takes
+ * over): all its tasks, or just task `task` when it is >= 0. */
+static void start_station(Shell *sh, int idx, TaskBank *bank, HotBank *held, int task,
+                          EngineOut *out) {
+    const Station *st = &REG[idx];
+    if (task >= 0) {
+        engine_out_printf(out, C_BOLD "[%02d] %s" C_RESET " — task %d of %d\n", st->id,
+                          st->keyword, task + 1, bank->count);
+    } else {
+        engine_out_printf(out, C_BOLD "[%02d] %s" C_RESET " — %s\n", st->id, st->keyword, st->title);
+    }
+    set_progress(sh, JR_ATTEMPTED, idx, sh->g.attempted[idx] + 1);
+    if (!sh->g.completed[idx]) set_progress(sh, JR_COMPLETED, idx, 1); /* mark tried as completed for now */
+
+    if (bank) {
+        /* graded tasks: the shell steps the engine one input line at a time */
+        sh->session = task >= 0 ? engine_begin_task(st->id, bank, task)
+                                : engine_begin_bank(st->id, bank);
+        if (!sh->session) {
+            hotbank_release(held);
+            engine_out_puts(out, "out of memory.");
+            return;
+        }
+        sh->held = held;
+        sh->station_idx = idx;
+        if (engine_start(sh->session, out) == ENGINE_STATION_DONE) end_station(sh, out);
+    } else if (sh->launchers) {
+        /* launcher renders into the same ui frame as `out` */
+        st->fn();
+    } else {
+        engine_out_puts(out, "No tasks configured for this station yet.");
+    }
+}
+
+static void cmd_play(Shell *sh, const char *arg, EngineOut *out) {
+    if (!arg || !*arg) {
+        engine_out_puts(out, "usage: play <02..15|keyword>");
+        return;
+    }
+    int idx = station_index(arg);
+    if (idx < 0) {
+        engine_out_puts(out, "invalid station. try: play 02  or  play pointers");
+        return;
+    }
+    HotBank *held;
+    TaskBank *bank = acquire_bank(idx, &held);
+    if (!REG[idx].fn && !bank) { engine_out_puts(out, "station not found."); return; }
+    start_station(sh, idx, bank, held, -1, out);
+}
+
+static void cmd_score(Shell *sh, const char *arg, EngineOut *out) {
+    (void)arg;
+    const GameState *G = &sh->g;
+    engine_out_printf(out, "Score: %d pts  | stations attempted: ", G->total_score);
+    int printed = 0;
+    for (int i = 0; i < STATION_COUNT; ++i) if (G->attempted[i]) {
+        engine_out_printf(out, "%s%02d", printed++ ? "," : "", REG[i].id);
+    }
+    if (!printed) engine_out_printf(out, "none");
+    engine_out_puts(out, "");
+}
+
+/* Board for an optional station argument: LB_OVERALL, 1 + REG index, or -1. */
+static int board_index(const char *arg) {
+    if (!arg || !*arg) return LB_OVERALL;
+    int idx = station_index(arg);
+    return idx < 0 ? -1 : 1 + idx;
+}
+
+static void board_title(char *buf, size_t n, int board) {
+    if (board == LB_OVERALL) snprintf(buf, n, "all stations");
+    else snprintf(buf, n, "[%02d] %s", REG[board - 1].id, REG[board - 1].keyword);
+}
+
+static void board_rows(const Shell *sh, EngineOut *out, const LbEntry *e, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        bool me = (int32_t)e[i].learner == sh->learner;
+        engine_out_printf(out, "%s%c %6u  %-16s %6d pts%s\n", me ? C_BOLD : "", me ? '>' : ' ',
+                          e[i].rank, lb_name(BOARD, e[i].learner), e[i].score,
+                          me ? C_RESET : "");
+    }
+}
+
+static void cmd_rank(Shell *sh, const char *arg, EngineOut *out) {
+    int board = board_index(arg);
+    if (board < 0) {
+        engine_out_puts(out, "usage: rank [02..15|keyword]");
+        return;
+    }
+    if (sh->learner < 0) {
+        engine_out_puts(out, "No leaderboard here.");
+        return;
+    }
+    char title[64];
+    board_title(title, sizeof(title), board);
+    uint32_t rank = lb_rank(BOARD, board, (uint32_t)sh->learner);
+    if (!rank) {
+        engine_out_printf(out, "No points on %s yet.\n", title);
+        return;
+    }
+    engine_out_printf(out, C_CYAN "Rank %u of %u" C_RESET " on %s (%d pts):\n", rank,
+                      lb_size(BOARD, board), title, lb_score(BOARD, board, (uint32_t)sh->learner));
+    LbEntry e[2 * RANK_RADIUS + 1];
+    board_rows(sh, out, e, lb_around(BOARD, board, (uint32_t)sh->learner, RANK_RADIUS, e,
+                                     sizeof(e) / sizeof(e[0])));
+}
+
+static void cmd_top(Shell *sh, const char *arg, EngineOut *out) {
+    int board = board_index(arg);
+    if (board < 0) {
+        engine_out_puts(out, "usage: top [02..15|keyword]");
+        return;
+    }
+    if (sh->learner < 0) {
+        engine_out_puts(out, "No leaderboard here.");
+        return;
+    }
+    char title[64];
+    board_title(title, sizeof(title), board);
+    LbEntry e[TOP_ROWS];
+    size_t n = lb_top(BOARD, board, 1, e, TOP_ROWS);
+    engine_out_printf(out, C_CYAN "Top %zu on %s" C_RESET " (%u on the board):\n", n, title,
+                      lb_size(BOARD, board));
+    board_rows(sh, out, e, n);
+}
+
+static void cmd_mem(Shell *sh, const char *arg, EngineOut *out) {
+    (void)sh; (void)arg;
+    TrackerStats t = tracker_stats();
+    TrackerSite sites[5];
+    int n = tracker_sites(sites, 5);
+
+    engine_out_puts(out, C_CYAN "Heap (tracked):" C_RESET);
+    engine_out_printf(out, "  live %zu B in %zu blocks  |  peak %zu B\n",
+                      t.live_bytes, t.live_blocks, t.peak_bytes);
+    engine_out_printf(out, "  allocs %llu  frees %llu  bad frees %llu\n",
+                      (unsigned long long)t.allocs, (unsigned long long)t.frees,
+                      (unsigned long long)t.bad_frees);
+    for (int i = 0; i < n; ++i) {
+        const char *base = strrchr(sites[i].file, '/');
+        engine_out_printf(out, "  %8zu B %4zu blk  %s:%d\n", sites[i].bytes, sites[i].blocks,
+                          base ? base + 1 : sites[i].file, sites[i].line);
+    }
 }
 
-static void cmd_play(const char *arg) {
+static void cmd_review(Shell *sh, const char *arg, EngineOut *out) {
+    (void)arg;
+    if (!sh->deck) {
+        sh->deck = review_deck_new();
+        if (!sh->deck) { engine_out_puts(out, "out of memory."); return; }
+        for (int i = 0; i < STATION_COUNT; ++i) {
+            HotBank *held;
+            TaskBank *bank = acquire_bank(i, &held);
+            int count = bank ? bank->count : 0;
+            hotbank_release(held);
+            if (count > 0 && review_deck_add(sh->deck, i, (uint32_t)count) != OK) {
+                engine_out_puts(out, "out of memory.");
+                review_deck_free(sh->deck);
+                sh->deck = NULL;
+                return;
+            }
+        }
+        if (sh->state_dir) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/review.bin", sh->state_dir);
+            review_load(sh->deck, path);    /* missing file = all cards new */
+        }
+    }
+    engine_out_printf(out, C_CYAN "Review:" C_RESET " %u tasks; 'skip' grades a card as forgotten, "
+                      "'exit' stops.\n", review_deck_size(sh->deck));
+    sh->reviewing = true;
+    review_next_task(sh, out);
+}
+
+static void cmd_drill(Shell *sh, const char *arg, EngineOut *out) {
+    char target[24] = "";
+    unsigned long long seed = 0;
+    int fields = arg ? sscanf(arg, "%23s %llu", target, &seed) : 0;
+    if (fields < 1) {
+        engine_out_puts(out, "usage: drill <02..15|keyword|template> [seed]");
+        engine_out_printf(out, "templates:");
+        for (int t = 0; t < taskgen_count(); ++t) {
+            engine_out_printf(out, " %s (%02d)", taskgen_name(t), taskgen_station(t));
+        }
+        engine_out_printf(out, "\n");
+        return;
+    }
+
+    /* a template name drills that template; a station rotates through its own */
+    int picks[DRILL_TASKS], npicks = 0, tmpl = taskgen_find(target);
+    int idx = tmpl >= 0 ? taskgen_station(tmpl) - REG[0].id : station_index(target);
+    if (tmpl >= 0) {
+        picks[npicks++] = tmpl;
+    } else if (idx >= 0) {
+        for (int t = 0; t < taskgen_count() && npicks < DRILL_TASKS; ++t) {
+            if (taskgen_station(t) == REG[idx].id) picks[npicks++] = t;
+        }
+    }
+    if (!npicks) {
+        engine_out_puts(out, "nothing to generate there. try 'drill' for the list");
+        return;
+    }
+    if (fields < 2) {
+        /* unique per learner and run; the batch grader must not depend on time */
+        seed = taskgen_mix((sh->grading ? 0 : sh->salt) + sh->drills) % 1000000000ull;
+    }
+    sh->drills++;
+
+    Drill *d = tracked_malloc(sizeof(*d));
+    if (!d) {
+        engine_out_puts(out, "out of memory.");
+        return;
+    }
+    d->seed = seed;
+    snprintf(d->target, sizeof(d->target), "%s", target);
+    for (int i = 0; i < DRILL_TASKS; ++i) {
+        taskgen_make(picks[i % npicks], taskgen_mix(seed + (uint64_t)i), &d->tasks[i], &d->text[i]);
+    }
+
+    const Station *st = &REG[idx];
+    sh->session = engine_begin(st->id, d->tasks, DRILL_TASKS);
+    if (!sh->session) {
+        tracked_free(d);
+        engine_out_puts(out, "out of memory.");
+        return;
+    }
+    sh->drill = d;
+    sh->station_idx = idx;
+    engine_out_printf(out, C_BOLD "[%02d] %s drill" C_RESET " — seed %llu\n", st->id, st->keyword,
+                      seed);
+    if (engine_start(sh->session, out) == ENGINE_STATION_DONE) drill_end(sh, out);
+}
+
+static void cmd_stats(Shell *sh, const char *arg, EngineOut *out) {
     if (!arg || !*arg) {
-        puts("usage: play <02..15|keyword>");
+        stats_print(out, 0);
         return;
     }
     char tmp[MAX_INPUT];
     strncpy(tmp, arg, sizeof(tmp)-1); tmp[sizeof(tmp)-1] = 0;
-    trim_eol(tmp); lower_inplace(tmp);
+    trim_eol(tmp, sizeof(tmp));
+
+    /* the subcommand folds case like the command word; the file name does not */
+    size_t word = strk_span_word(tmp, strlen(tmp));
+    if (strk_equals_ignore_case(tmp, word, "dump", 4)) {
+        const char *path = tmp + word;
+        while (*path && isspace((unsigned char)*path)) ++path;
+        if (sh->grading) {
+            engine_out_puts(out, "stats are not recorded while grading.");
+            return;
+        }
+        /* remote learners may not pick files on the server */
+        if (!*path || !sh->launchers) path = STATS_FILE ? STATS_FILE : STATS_FILE_DEFAULT;
+        if (stats_write_prometheus(path) == OK) {
+            engine_out_printf(out, "stats written to %s\n", path);
+        } else {
+            engine_out_printf(out, "cannot write %s\n", path);
+        }
+        return;
+    }
 
-    int id = parse_station_arg(tmp);
-    if (id < 0) {
-        puts("invalid station. try: play 02  or  play pointers");
+    int idx = station_index(tmp);
+    if (idx < 0) {
+        engine_out_puts(out, "usage: stats [02..15|keyword] | stats dump [file]");
         return;
     }
-    const Station *st = find_station(id);
-    if (!st || !st->fn) { puts("station not found."); return; }
+    stats_print(out, REG[idx].id);
+}
 
-    int idx = -1; for (int i = 0; i < STATION_COUNT; ++i) if (REG[i].id == id) { idx = i; break; }
+/* ===== find ===== */
 
-    printf(C_BOLD "[%02d] %s" C_RESET " — %s\n", st->id, st->keyword, st->title);
-    G.attempted[idx] += 1;
+/* Indexes banks[] unless FIND already covers exactly these versions.
+ * Caller holds FIND_LOCK. */
+static Status find_index(TaskBank *const banks[], HotBank *const held[]) {
+    bool current = FIND != NULL;
+    for (int i = 0; i < STATION_COUNT && current; ++i) {
+        current = FIND_BUILT[i].bank == banks[i] &&
+                  FIND_BUILT[i].version == (held[i] ? hotbank_version(held[i]) : 0);
+    }
+    if (current) return OK;
 
-    /* Phase 2 placeholder call */
-    st->fn();
+    search_free(FIND);
+    memset(FIND_BUILT, 0, sizeof(FIND_BUILT));
+    if (!(FIND = search_new())) return ERR;
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        for (int t = 0; banks[i] && t < banks[i]->count; ++t) {
+            const Task *task = &banks[i]->tasks[t];
+            const char *texts[FIND_TEXTS] = { task->prompt, task->hint, task->why };
+            size_t n = 3;
+            for (size_t o = 0; task->options && task->options[o] && n < FIND_TEXTS; ++o) {
+                texts[n++] = task->options[o];
+            }
+            if (search_add(FIND, FIND_KEY(i, t), texts, n) != OK) goto oom;
+        }
+        FIND_BUILT[i].bank = banks[i];
+        FIND_BUILT[i].version = held[i] ? hotbank_version(held[i]) : 0;
+    }
+    if (search_finish(FIND) == OK) return OK;
+oom:
+    search_free(FIND);
+    FIND = NULL;
+    return ERR;
+}
 
-    /* You can simulate awarding a point on attempt in Phase 2 */
-    G.station_scores[idx] += 0;
-    if (!G.completed[idx]) G.completed[idx] = true; /* mark tried as completed for now */
+/* Index the banks at startup rather than on the first `find`. */
+static void find_warm(void) {
+    TaskBank *banks[STATION_COUNT];
+    HotBank *held[STATION_COUNT];
+    for (int i = 0; i < STATION_COUNT; ++i) banks[i] = acquire_bank(i, &held[i]);
+    pthread_mutex_lock(&FIND_LOCK);
+    if (find_index(banks, held) != OK) fprintf(stderr, "find: out of memory\n");
+    pthread_mutex_unlock(&FIND_LOCK);
+    for (int i = 0; i < STATION_COUNT; ++i) hotbank_release(held[i]);
 }
 
-static void cmd_score(const char *arg) {
-    (void)arg;
-    int sum = 0;
-    for (int i = 0; i < STATION_COUNT; ++i) sum += G.station_scores[i];
-    G.total_score = sum;
-    printf("Score: %d pts  | stations attempted: ", G.total_score);
-    int printed = 0;
-    for (int i = 0; i < STATION_COUNT; ++i) if (G.attempted[i]) {
-        printf("%s%02d", printed++ ? "," : "", REG[i].id);
+/* The prompt's first line, cut to fit a result row. */
+static void find_snippet(char *dst, size_t cap, const char *prompt) {
+    if (!prompt) prompt = "(no prompt)";        /* matched on its hint, why or options */
+    size_t n = strcspn(prompt, "\n");
+    if (n >= cap) {
+        n = cap - 4;
+        while (n > 0 && ((unsigned char)prompt[n] & 0xc0) == 0x80) n--;   /* UTF-8 */
+        snprintf(dst, cap, "%.*s...", (int)n, prompt);
+    } else {
+        snprintf(dst, cap, "%.*s", (int)n, prompt);
     }
-    if (!printed) printf("none");
-    puts("");
 }
 
-static bool g_should_quit = false;
-static void cmd_quit(const char *arg) {
+static void cmd_find(Shell *sh, const char *arg, EngineOut *out) {
+    if (!arg || !*arg) {
+        engine_out_puts(out, "usage: find <words>   e.g. find strcspn, find pointer arith");
+        return;
+    }
+    /* pinned until the search is over; the best hit's pin goes to its session */
+    TaskBank *banks[STATION_COUNT];
+    HotBank *held[STATION_COUNT];
+    for (int i = 0; i < STATION_COUNT; ++i) banks[i] = acquire_bank(i, &held[i]);
+
+    SearchHit hits[FIND_HITS];
+    size_t n = 0;
+    pthread_mutex_lock(&FIND_LOCK);
+    Status st = find_index(banks, held);
+    if (st == OK) n = search_query(FIND, arg, hits, FIND_HITS);
+    pthread_mutex_unlock(&FIND_LOCK);
+
+    int best = -1;
+    if (st != OK) {
+        engine_out_puts(out, "out of memory.");
+    } else if (n == 0) {
+        engine_out_puts(out, "No task mentions that. try fewer or shorter words.");
+    } else {
+        engine_out_puts(out, C_CYAN "Best matches:" C_RESET);
+        for (size_t h = 0; h < n; ++h) {
+            int idx = (int)(hits[h].key >> 24), task = (int)(hits[h].key & 0xffffff);
+            char snippet[FIND_SNIPPET + 1];
+            find_snippet(snippet, sizeof(snippet), banks[idx]->tasks[task].prompt);
+            engine_out_printf(out, "  %s [%02d] %-12s #%-5d %s\n", h ? " " : ">", REG[idx].id,
+                              REG[idx].keyword, task + 1, snippet);
+        }
+        best = (int)(hits[0].key >> 24);
+    }
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        if (i != best) hotbank_release(held[i]);
+    }
+    if (best >= 0) {
+        start_station(sh, best, banks[best], held[best], (int)(hits[0].key & 0xffffff), out);
+    }
+}
+
+static void cmd_quit(Shell *sh, const char *arg, EngineOut *out) {
     (void)arg;
-    puts("Goodbye!");
-    g_should_quit = true;
+    engine_out_puts(out, "Goodbye!");
+    sh->quit = true;
 }
 
-/* ===== REPL ===== */
+/* ===== REPL (stdin front end) ===== */
 void shell_loop(void) {
     char line[MAX_INPUT];
+    EngineOut *out = ui_frame();
 
-    puts(C_GREEN "Welcome to C Arcade — type 'help' to begin." C_RESET);
-    while (!g_should_quit) {
-        prompt();
+    if (shell_session_join(&S, "you") != OK) fprintf(stderr, "leaderboard: out of memory\n");
+    shell_session_welcome(&S, out);
+    while (!S.quit) {
+        ui_flush();
         if (!fgets(line, sizeof(line), stdin)) {
-            puts("\nEOF");
+            shell_session_close(&S, out);
             break;
         }
-        trim_eol(line);
-        /* split into command + optional arg */
-        char *cmd = line;
-        while (*cmd && isspace((unsigned char)*cmd)) ++cmd;
-        if (!*cmd) continue;
-
-        char *sp = cmd;
-        while (*sp && !isspace((unsigned char)*sp)) ++sp;
-        char *arg = NULL;
-        if (*sp) { *sp++ = '\0'; while (*sp && isspace((unsigned char)*sp)) ++sp; arg = sp; }
-
-        lower_inplace(cmd);
-
-        bool handled = false;
-        for (size_t i = 0; i < CMDS_N; ++i) {
-            if (strcmp(cmd, CMDS[i].name) == 0) {
-                CMDS[i].fn(arg);
-                handled = true;
-                break;
-            }
-        }
-        if (!handled) {
-            puts("unknown command. try 'help'");
-        }
+        shell_session_feed(&S, line, out);
     }
+    ui_flush();
 }
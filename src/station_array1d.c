@@ -1,4 +1,52 @@
 #include "common.h"
+#include "cachelab.h"
+#include "ui.h"
+
+/* the stride and AoS/SoA runs stay at or below this, to keep them short */
+#define ARRAY1D_BIG ((size_t)16 << 20)
+
+static void run_row(ClKind kind, size_t bytes, size_t stride, const char *label) {
+    ClResult r;
+    if (cachelab_run(kind, bytes, stride, &r) != OK) {
+        ui_printf("  %-16s out of memory\n", label);
+        return;
+    }
+    cachelab_print_row(label, &r);
+}
+
 void station_array1d(void) {
-    puts(C_DIM "(placeholder) 1D Arrays — min/max/mean, decay, a vs &a[0] vs &a." C_RESET);
+    size_t max = cachelab_max_bytes();
+    size_t big = max < ARRAY1D_BIG ? max : ARRAY1D_BIG;
+    char label[32];
+
+    ui_puts(C_BOLD "1D Arrays: the same a[i], very different costs" C_RESET);
+    ui_puts("An array is one contiguous block: a, &a[0] and &a name the same address,");
+    ui_puts("and a[i] is *(a + i).  How fast a[i] is depends on where that block sits:");
+    ui_puts("L1, L2, L3 or main memory, each several times slower than the last.");
+    cachelab_print_counters_note();
+
+    ui_puts("\n" C_CYAN "Random walk over a working set" C_RESET " (each load waits for the last):");
+    cachelab_print_header("working set");
+    for (size_t bytes = CACHELAB_MIN_BYTES; bytes <= max; bytes *= 4) {
+        cachelab_format_size(label, sizeof(label), bytes);
+        run_row(CL_CHASE, bytes, 0, label);
+    }
+
+    cachelab_format_size(label, sizeof(label), big);
+    ui_printf("\n" C_CYAN "One double every N bytes" C_RESET " of a %s array:\n", label);
+    cachelab_print_header("stride");
+    static const size_t STRIDES[] = { 8, 16, 32, 64, 128, 512, 4096 };
+    for (size_t i = 0; i < sizeof(STRIDES) / sizeof(STRIDES[0]); ++i) {
+        snprintf(label, sizeof(label), "%zu B", STRIDES[i]);
+        run_row(CL_STRIDED, big, STRIDES[i], label);
+    }
+
+    ui_puts("\n" C_CYAN "Sum one field of 4-double structs" C_RESET ":");
+    cachelab_print_header("layout");
+    run_row(CL_AOS, big, 0, "AoS p[i].x");
+    run_row(CL_SOA, big, 0, "SoA x[i]");
+
+    ui_puts("\nWHY: Memory moves in 64-byte lines.  Once the working set outgrows a cache");
+    ui_puts("level every miss costs the next level's latency; strides past 64 B waste the");
+    ui_puts("rest of each line, and past 4096 B each load needs a new page translation.");
 }
@@ -1,4 +1,44 @@
 #include "common.h"
+#include "cachelab.h"
+#include "ui.h"
+
+static void run_row(ClKind kind, size_t bytes, const char *label) {
+    ClResult r;
+    if (cachelab_run(kind, bytes, 0, &r) != OK) {
+        ui_printf("  %-16s out of memory\n", label);
+        return;
+    }
+    cachelab_print_row(label, &r);
+}
+
+/* row vs column (or naive vs tiled) at each size up to the lab maximum */
+static void compare(ClKind first, ClKind second, size_t from) {
+    char label[32], size[16];
+    cachelab_print_header("order");
+    for (size_t bytes = from; bytes <= cachelab_max_bytes(); bytes *= 16) {
+        cachelab_format_size(size, sizeof(size), bytes);
+        snprintf(label, sizeof(label), "%-9s %s", cachelab_kind_name(first), size);
+        run_row(first, bytes, label);
+        snprintf(label, sizeof(label), "%-9s %s", cachelab_kind_name(second), size);
+        run_row(second, bytes, label);
+    }
+}
+
 void station_arrays_ptrs(void) {
-    puts(C_DIM "(placeholder) Arrays↔Pointers — 2D indexing vs pointer forms." C_RESET);
+    ui_puts(C_BOLD "Arrays <-> Pointers: m[i][j] is *(*(m + i) + j)" C_RESET);
+    ui_puts("C stores a 2D array row after row, so m[i][j] lives at");
+    ui_puts("(char *)m + (i * COLS + j) * sizeof m[0][0].  Walking j in the inner loop");
+    ui_puts("steps 8 bytes; walking i steps a whole row, a new cache line every time.");
+    cachelab_print_counters_note();
+
+    ui_puts("\n" C_CYAN "Sum an n x n double matrix" C_RESET ":");
+    compare(CL_ROW_MAJOR, CL_COL_MAJOR, (size_t)16 << 10);
+
+    ui_printf("\n" C_CYAN "Transpose b[j][i] = a[i][j]" C_RESET ", naive vs %dx%d tiles:\n",
+              CACHELAB_TILE, CACHELAB_TILE);
+    compare(CL_TRANSPOSE, CL_TRANSPOSE_TILED, (size_t)64 << 10);
+
+    ui_puts("\nWHY: Row order reads each line once; column order pulls in a line per element");
+    ui_puts("and, once the matrix outgrows the cache, evicts it before the neighbours are");
+    ui_puts("used.  A transpose must do one of the two; tiles keep both blocks in cache.");
 }
@@ -1,28 +1,30 @@
 #include "common.h"
 #include "engine.h"
+#include "stations.h"
+#include "ui.h"
 
-void station_compilation(void) {
-    const Task tasks[] = {
-        {
-            TASK_QUIZ,
-            "Which step removes comments and expands macros?",
-            {"Lexical Analysis", "Preprocessing", "Optimization", NULL, NULL},
-            1,
-            {NULL},
-            "It's before lexical analysis",
-            "WHY: The preprocessor handles macros and comments before tokenization."
-        },
-        {
-            TASK_ASK,
-            "What structure represents nested syntax rules?",
-            {NULL, NULL, NULL, NULL, NULL},
-            -1,
-            {"context free grammar", "cfg", NULL, NULL, NULL},
-            "Think grammar types",
-            "WHY: Context-Free Grammar defines valid language syntax for parsers."
-        }
-    };
+static const Task TASKS[] = {
+    {
+        .type = TASK_QUIZ,
+        .prompt = "Which step removes comments and expands macros?",
+        .options = TASK_LIST("Lexical Analysis", "Preprocessing", "Optimization"),
+        .correct_index = 1,
+        .hint = "It's before lexical analysis",
+        .why = "WHY: The preprocessor handles macros and comments before tokenization.",
+    },
+    {
+        .type = TASK_ASK,
+        .prompt = "What structure represents nested syntax rules?",
+        .typos = ASK_TYPOS_AUTO,
+        .answers = TASK_LIST("context free grammar", "cfg"),
+        .hint = "Think grammar types",
+        .why = "WHY: Context-Free Grammar defines valid language syntax for parsers.",
+    }
+};
+
+TaskBank BANK_COMPILATION = { TASKS, (int)(sizeof(TASKS) / sizeof(TASKS[0])), NULL, NULL, NULL };
 
-    StationResult res = run_station(2, tasks, (int)(sizeof(tasks) / sizeof(tasks[0])));
-    printf("Points earned: %d\n", res.total_points);
+void station_compilation(void) {
+    StationResult res = run_station(2, BANK_COMPILATION.tasks, BANK_COMPILATION.count);
+    ui_printf("Points earned: %d\n", res.total_points);
 }
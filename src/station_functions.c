@@ -1,5 +1,6 @@
 #include "common.h"
+#include "ui.h"
 void station_functions(void) {
-    puts(C_DIM "(placeholder) Functions station — prototypes, pass-by-value, scope." C_RESET);
+    ui_puts(C_DIM "(placeholder) Functions station — prototypes, pass-by-value, scope." C_RESET);
 }
 
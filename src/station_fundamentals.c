@@ -1,4 +1,5 @@
 #include "common.h"
+#include "ui.h"
 void station_fundamentals(void) {
-    puts(C_DIM "(placeholder) Fundamentals station — specifiers, scanf &, 5/2 vs (double)5/2." C_RESET);
+    ui_puts(C_DIM "(placeholder) Fundamentals station — specifiers, scanf &, 5/2 vs (double)5/2." C_RESET);
 }
@@ -1,4 +1,246 @@
+#include <errno.h>
+#include <time.h>
+
 #include "common.h"
+#include "perfctr.h"
+#include "router.h"
+#include "shell.h"
+#include "tracker.h"
+#include "ui.h"
+
+/* one byte-code program per run: big enough to swamp the timer, small
+ * enough to stay in L2 */
+#define FUNPTR_OPS   ((size_t)1 << 18)
+#define FUNPTR_REPS  5
+#define FUNPTR_LOOKUPS 200000
+
+typedef enum { DISPATCH_SWITCH, DISPATCH_TABLE, DISPATCH_GOTO, DISPATCHES } Dispatch;
+
+static const char *const DISPATCH_NAMES[DISPATCHES] = { "switch", "fn-ptr table", "computed goto" };
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+/* ===== a toy 8-instruction machine, three ways ===== */
+#define OP0(a) ((a) + 1)
+#define OP1(a) ((a) - 3)
+#define OP2(a) ((a) ^ 0x5555)
+#define OP3(a) (((a) << 1) | ((a) >> 63))
+#define OP4(a) ((a) * 3)
+#define OP5(a) ((a) >> 1 | (a) << 63)
+#define OP6(a) ((a) + ((a) >> 7))
+#define OP7(a) (~(a))
+
+static uint64_t run_switch(const uint8_t *prog, size_t n) {
+    uint64_t a = 1;
+    for (size_t i = 0; i < n; ++i) {
+        switch (prog[i]) {
+            case 0: a = OP0(a); break;
+            case 1: a = OP1(a); break;
+            case 2: a = OP2(a); break;
+            case 3: a = OP3(a); break;
+            case 4: a = OP4(a); break;
+            case 5: a = OP5(a); break;
+            case 6: a = OP6(a); break;
+            default: a = OP7(a); break;
+        }
+    }
+    return a;
+}
+
+static uint64_t op0(uint64_t a) { return OP0(a); }
+static uint64_t op1(uint64_t a) { return OP1(a); }
+static uint64_t op2(uint64_t a) { return OP2(a); }
+static uint64_t op3(uint64_t a) { return OP3(a); }
+static uint64_t op4(uint64_t a) { return OP4(a); }
+static uint64_t op5(uint64_t a) { return OP5(a); }
+static uint64_t op6(uint64_t a) { return OP6(a); }
+static uint64_t op7(uint64_t a) { return OP7(a); }
+
+static uint64_t (*const OPS[8])(uint64_t) = { op0, op1, op2, op3, op4, op5, op6, op7 };
+
+static uint64_t run_table(const uint8_t *prog, size_t n) {
+    uint64_t a = 1;
+    for (size_t i = 0; i < n; ++i) a = OPS[prog[i]](a);
+    return a;
+}
+
+#if defined(__GNUC__)
+/* Each handler ends in its own indirect jump, so the predictor keeps
+ * separate history per opcode instead of one shared jump. */
+static uint64_t run_goto(const uint8_t *prog, size_t n) {
+    static const void *const LABELS[8] = { &&l0, &&l1, &&l2, &&l3, &&l4, &&l5, &&l6, &&l7 };
+    const uint8_t *p = prog, *end = prog + n;
+    uint64_t a = 1;
+#define NEXT do { if (p == end) return a; goto *LABELS[*p++]; } while (0)
+    NEXT;
+l0: a = OP0(a); NEXT;
+l1: a = OP1(a); NEXT;
+l2: a = OP2(a); NEXT;
+l3: a = OP3(a); NEXT;
+l4: a = OP4(a); NEXT;
+l5: a = OP5(a); NEXT;
+l6: a = OP6(a); NEXT;
+l7: a = OP7(a); NEXT;
+#undef NEXT
+}
+#endif
+
+static uint64_t (*const RUNNERS[DISPATCHES])(const uint8_t *, size_t) = {
+    run_switch, run_table,
+#if defined(__GNUC__)
+    run_goto,
+#else
+    NULL,
+#endif
+};
+
+static volatile uint64_t sink;
+
+typedef struct {
+    double ns;              /* per op */
+    bool have_misses;
+    double misses;          /* branch misses per op */
+} DispatchTime;
+
+static DispatchTime time_run(Dispatch d, const uint8_t *prog, size_t n) {
+    DispatchTime t = { 0, false, 0 };
+    PerfCounter ctr;
+    uint64_t best = UINT64_MAX, misses = 0;
+    if (!perf_counter_open(&ctr, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES)) ctr.fd = -1;
+    sink = RUNNERS[d](prog, n);
+    for (int r = 0; r < FUNPTR_REPS; ++r) {
+        uint64_t count = 0;
+        perf_counter_start(&ctr);
+        uint64_t t0 = now_ns();
+        sink = RUNNERS[d](prog, n);
+        uint64_t dt = now_ns() - t0;
+        if (perf_counter_stop(&ctr, &count)) t.have_misses = true;
+        if (dt < best) {
+            best = dt;
+            misses = count;
+        }
+    }
+    perf_counter_close(&ctr);
+    t.ns = (double)best / (double)n;
+    t.misses = (double)misses / (double)n;
+    return t;
+}
+
+/* ===== the shell's router vs a scan of the same keys ===== */
+static void show_router(const char *what, const Router *r) {
+    const char *keys[ROUTER_SLOTS];
+    size_t lens[ROUTER_SLOTS], n = 0;
+    for (uint32_t s = 0; s <= r->mask; ++s) {
+        if (r->slot[s].len) {
+            keys[n] = r->slot[s].key;
+            lens[n++] = r->slot[s].len;
+        }
+    }
+
+    /* every key once, in a scrambled order, plus as many misses */
+    static const char *const MISSES[] = { "xyzzy", "plugh", "stat", "pl4y", "zz", "pointer" };
+    uint64_t rng = 0x9e3779b97f4a7c15ull, t0, dt_hash, dt_scan;
+    size_t hits = 0;
+    t0 = now_ns();
+    for (int i = 0; i < FUNPTR_LOOKUPS; ++i) {
+        size_t k = (size_t)(xorshift(&rng) % (2 * n));
+        const char *w = k < n ? keys[k] : MISSES[k % 6];
+        size_t len = k < n ? lens[k] : strlen(w);
+        hits += router_lookup(r, w, len) >= 0;
+    }
+    dt_hash = now_ns() - t0;
+    rng = 0x9e3779b97f4a7c15ull;
+    t0 = now_ns();
+    for (int i = 0; i < FUNPTR_LOOKUPS; ++i) {
+        size_t k = (size_t)(xorshift(&rng) % (2 * n));
+        const char *w = k < n ? keys[k] : MISSES[k % 6];
+        size_t len = k < n ? lens[k] : strlen(w);
+        for (size_t j = 0; j < n; ++j) {
+            if (strk_equals_ignore_case(keys[j], lens[j], w, len)) {
+                hits++;
+                break;
+            }
+        }
+    }
+    dt_scan = now_ns() - t0;
+    sink = hits;
+    ui_printf("  %-9s %3u keys (%3u prefixes) in %3u slots: %6.1f ns hashed, %7.1f ns scanned\n",
+              what, r->keys, r->prefixes, r->mask + 1, (double)dt_hash / FUNPTR_LOOKUPS,
+              (double)dt_scan / FUNPTR_LOOKUPS);
+}
+
 void station_funptr(void) {
-    puts(C_DIM "(placeholder) Function Pointers — dispatch table, function addresses." C_RESET);
+    ui_puts(C_BOLD "Function Pointers: one call site, many destinations" C_RESET);
+    ui_puts("int (*op)(int) holds a function's address; op(x) jumps wherever it points.");
+    ui_puts("An array of them is a dispatch table: OPS[code](x) replaces a switch.  Both");
+    ui_puts("end in an indirect jump, and the CPU must guess its target before it knows");
+    ui_puts("the code.  A wrong guess throws away ~15-20 cycles of work.");
+
+    uint8_t *prog = tracked_malloc(FUNPTR_OPS);
+    if (!prog) {
+        ui_puts("Not enough memory for the demo program.");
+        return;
+    }
+    PerfCounter probe;
+    bool counters = perf_counter_open(&probe, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    const char *why = counters ? NULL : perf_counter_why(errno);
+    perf_counter_close(&probe);
+    if (counters) {
+        ui_puts(C_DIM "Misses: branch mispredictions per op, user space." C_RESET);
+    } else {
+        ui_printf(C_DIM "Branch-miss counter unavailable: %s.\n"
+                  "The cost of a miss is estimated from the two timings." C_RESET "\n", why);
+    }
+
+    ui_printf("\n" C_CYAN "%zu ops of an 8-instruction toy machine" C_RESET " (ns/op):\n",
+              FUNPTR_OPS);
+    ui_printf("  %-14s %10s %10s %14s\n", "dispatch", "repeating", "random",
+              counters ? "misses/op" : "ns per miss");
+    DispatchTime t[2][DISPATCHES];
+    for (int pattern = 0; pattern < 2; ++pattern) {
+        uint64_t rng = 0x2545f4914f6cdd1dull;
+        for (size_t i = 0; i < FUNPTR_OPS; ++i) {
+            prog[i] = (uint8_t)(pattern ? xorshift(&rng) & 7 : i & 7);
+        }
+        for (int d = 0; d < DISPATCHES; ++d) {
+            if (RUNNERS[d]) t[pattern][d] = time_run((Dispatch)d, prog, FUNPTR_OPS);
+        }
+    }
+    tracked_free(prog);
+    for (int d = 0; d < DISPATCHES; ++d) {
+        if (!RUNNERS[d]) {
+            ui_printf("  %-14s %10s\n", DISPATCH_NAMES[d], "n/a");
+            continue;
+        }
+        ui_printf("  %-14s %10.2f %10.2f", DISPATCH_NAMES[d], t[0][d].ns, t[1][d].ns);
+        if (t[0][d].have_misses && t[1][d].have_misses) {
+            ui_printf("   %4.2f -> %4.2f\n", t[0][d].misses, t[1][d].misses);
+        } else {
+            /* a uniformly random target among 8 is guessed wrong 7 times in 8 */
+            ui_printf(" %14.2f\n", (t[1][d].ns - t[0][d].ns) / (7.0 / 8.0));
+        }
+    }
+    ui_flush();
+
+    ui_puts("\n" C_CYAN "This shell's own router" C_RESET " (names, aliases and unique prefixes;"
+            " per lookup):");
+    show_router("commands", shell_command_router());
+    show_router("stations", shell_station_router());
+
+    ui_puts("\nWHY: Dispatch is cheap when the next target is predictable and expensive");
+    ui_puts("when it is not; per-handler jumps (computed goto) give the predictor more");
+    ui_puts("to go on.  For lookups by name, a perfect hash costs one probe whatever the");
+    ui_puts("table size, where a scan of string compares grows with every entry.");
 }
@@ -1,4 +1,5 @@
 #include "common.h"
+#include "ui.h"
 void station_imperative(void) {
-    puts(C_DIM "(placeholder) Imperative station — state mutation, branching, loops." C_RESET);
+    ui_puts(C_DIM "(placeholder) Imperative station — state mutation, branching, loops." C_RESET);
 }
@@ -1,4 +1,36 @@
 #include "common.h"
+#include "tracker.h"
+#include "ui.h"
+
+static void show(const char *step) {
+    TrackerStats t = tracker_stats();
+    ui_printf("  %-34s live %6zu B in %zu blocks (peak %zu B)\n",
+           step, t.live_bytes, t.live_blocks, t.peak_bytes);
+}
+
 void station_memory(void) {
-    puts(C_DIM "(placeholder) Memory — stack vs heap, malloc/calloc/realloc/free, live bytes." C_RESET);
+    ui_puts(C_DIM "Memory — stack vs heap, malloc/calloc/realloc/free, live bytes." C_RESET);
+    ui_puts("Every call below goes through the arcade's tracking allocator:");
+    show("start");
+
+    int *a = tracked_malloc(100 * sizeof(int));
+    show("malloc(100 * sizeof(int))");
+
+    double *z = tracked_calloc(64, sizeof(double));
+    show("calloc(64, sizeof(double))");
+
+    int *grown = tracked_realloc(a, 1000 * sizeof(int));
+    if (grown) a = grown;
+    show("realloc(a, 1000 * sizeof(int))");
+
+    tracked_free(z);
+    show("free(z)");
+
+    tracked_free(a);
+    show("free(a)");
+
+    ui_puts("Freeing a twice is caught instead of corrupting the heap:");
+    tracked_free(a);
+    ui_printf("  bad frees so far: %llu\n", (unsigned long long)tracker_stats().bad_frees);
+    ui_puts(C_DIM "WHY: a leak is live bytes nobody points to; 'mem' shows who allocated them." C_RESET);
 }
@@ -1,4 +1,49 @@
 #include "common.h"
+#include "engine.h"
+#include "stations.h"
+#include "ui.h"
+
+static const Task TASKS[] = {
+    {
+        .type = TASK_EXPR,
+        .prompt = "What is the value of *(a + 2)?",
+        .options = TASK_LIST("int a[] = {10, 20, 30, 40}"),
+        .expr_flags = EXPR_CONSTANT,
+        .answers = TASK_LIST("*(a + 2)"),
+        .hint = "a decays to &a[0]; + 2 moves two ints, not two bytes.",
+        .why = "WHY: *(a + i) is a[i] by definition; pointer arithmetic scales by sizeof(int).",
+    },
+    {
+        .type = TASK_EXPR,
+        .prompt = "How many bytes is sizeof(int *) here?",
+        .expr_flags = EXPR_CONSTANT,
+        .answers = TASK_LIST("sizeof(int *)"),
+        .hint = "It does not depend on what the pointer points to.",
+        .why = "WHY: On LP64 every object pointer is 8 bytes; an int is still 4.",
+    },
+    {
+        .type = TASK_EXPR,
+        .prompt = "Write an expression using p that points to a[3].",
+        .options = TASK_LIST("int a[] = {10, 20, 30, 40}", "int *p = &a[1]"),
+        .expr_flags = EXPR_SAME_VARS,
+        .answers = TASK_LIST("p + 2"),
+        .hint = "p already points to a[1]; how many elements further is a[3]?",
+        .why = "WHY: p + 2 is &p[2], and p[2] is a[1 + 2].",
+    },
+    {
+        .type = TASK_EXPR,
+        .prompt = "What is p - a?",
+        .options = TASK_LIST("int a[] = {10, 20, 30, 40}", "int *p = &a[1]"),
+        .expr_flags = EXPR_CONSTANT,
+        .answers = TASK_LIST("p - a"),
+        .hint = "Subtracting pointers counts elements, not bytes.",
+        .why = "WHY: p - a is a ptrdiff_t (long here) equal to the index distance: 1.",
+    }
+};
+
+TaskBank BANK_POINTERS = { TASKS, (int)(sizeof(TASKS) / sizeof(TASKS[0])), NULL, NULL, NULL };
+
 void station_pointers(void) {
-    puts(C_DIM "(placeholder) Pointers station — %p, p++, (*p)++, *(++p), void* cast." C_RESET);
+    StationResult res = run_station(9, BANK_POINTERS.tasks, BANK_POINTERS.count);
+    ui_printf("Points earned: %d\n", res.total_points);
 }
@@ -1,4 +1,68 @@
 #include "common.h"
+#include "engine.h"
+#include "stations.h"
+#include "ui.h"
+
+static const Task TASKS[] = {
+    {
+        .type = TASK_MACRO,
+        .prompt = "What does SQUARE(1 + 2) become?",
+        .options = TASK_LIST("#define SQUARE(x) x * x"),
+        .answers = TASK_LIST("SQUARE(1 + 2)"),
+        .hint = "The argument's tokens replace x as they are; no parentheses are added.",
+        .why = "WHY: 1 + 2 * 1 + 2 is 5, not 9.  Write ((x) * (x)) to keep the argument whole.",
+    },
+    {
+        .type = TASK_MACRO,
+        .prompt = "What do STR(LEVEL) and XSTR(LEVEL) become?",
+        .options = TASK_LIST("#define STR(x) #x", "#define XSTR(x) STR(x)", "#define LEVEL 3"),
+        .answers = TASK_LIST("STR(LEVEL) XSTR(LEVEL)"),
+        .hint = "An argument next to # is not expanded first; one passed on to another macro is.",
+        .why = "WHY: STR sees the token LEVEL; XSTR expands it to 3 before handing it to STR.",
+    },
+    {
+        .type = TASK_MACRO,
+        .prompt = "What does CAT(x, CAT(1, 2)) become?",
+        .options = TASK_LIST("#define CAT(a, b) a ## b"),
+        .answers = TASK_LIST("CAT(x, CAT(1, 2))"),
+        .hint = "Arguments next to ## are pasted before anything expands them.",
+        .why = "WHY: x ## CAT gives xCAT, a new name; (1, 2) is just what follows it.",
+    },
+    {
+        .type = TASK_MACRO,
+        .prompt = "What do x and y become?",
+        .options = TASK_LIST("#define x (4 + y)", "#define y (2 * x)"),
+        .answers = TASK_LIST("x y"),
+        .hint = "A macro's name inside its own expansion is left alone.",
+        .why = "WHY: Expanding x reaches y, whose x is inside x's expansion and stays; the same "
+               "goes the other way for y.",
+    },
+    {
+        .type = TASK_MACRO,
+        .prompt = "What does main.c become?",
+        .options = TASK_LIST("// config.h\n#ifndef CONFIG_H\n#define CONFIG_H\n"
+                             "#define LEVEL 2\n#endif"),
+        .answers = TASK_LIST("#include \"config.h\"\n#include \"config.h\"\n#if LEVEL > 1\n"
+                             "int verbose = LEVEL;\n#else\nint verbose = 0;\n#endif"),
+        .hint = "The second #include finds CONFIG_H defined; #if compares LEVEL's value.",
+        .why = "WHY: The include guard makes config.h count once, and 2 > 1 keeps the first group.",
+    },
+    {
+        .type = TASK_QUIZ,
+        .prompt = "Which MAX is safe in any expression?",
+        .options = TASK_LIST("#define MAX(a, b) a > b ? a : b",
+                             "#define MAX(a, b) ((a) > (b) ? (a) : (b))",
+                             "#define MAX(a, b) (a > b ? a : b)"),
+        .correct_index = 1,
+        .hint = "Think of MAX(x & 1, y) and of 2 * MAX(x, y).",
+        .why = "WHY: Each argument and the whole body need their own parentheses.  Arguments with "
+               "side effects are still evaluated twice.",
+    }
+};
+
+TaskBank BANK_PREPROCESSOR = { TASKS, (int)(sizeof(TASKS) / sizeof(TASKS[0])), NULL, NULL, NULL };
+
 void station_preprocessor(void) {
-    puts(C_DIM "(placeholder) Preprocessor station — macros, guards, DEBUG toggles." C_RESET);
+    StationResult res = run_station(8, BANK_PREPROCESSOR.tasks, BANK_PREPROCESSOR.count);
+    ui_printf("Points earned: %d\n", res.total_points);
 }
@@ -1,4 +1,5 @@
 #include "common.h"
+#include "ui.h"
 void station_ptrptr(void) {
-    puts(C_DIM "(placeholder) Pointer-to-Pointer — swap/insert using T** (why single-ptr fails)." C_RESET);
+    ui_puts(C_DIM "(placeholder) Pointer-to-Pointer — swap/insert using T** (why single-ptr fails)." C_RESET);
 }
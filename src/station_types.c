@@ -1,4 +1,5 @@
 #include "common.h"
+#include "ui.h"
 void station_types(void) {
-    puts(C_DIM "(placeholder) Type System station — promotions, casts, size_t/%zu." C_RESET);
+    ui_puts(C_DIM "(placeholder) Type System station — promotions, casts, size_t/%zu." C_RESET);
 }
@@ -0,0 +1,232 @@
+#include <time.h>
+
+#include "stats.h"
+
+typedef struct {
+    Histogram h[STAT_METRICS];
+} StatSet;
+
+typedef struct {
+    int station_id;             /* 0 = free slot */
+    int task;
+    StatSet set;
+} TaskSlot;
+
+static StatSet g_station[STATION_COUNT];
+static TaskSlot g_tasks[STATS_TASK_SLOTS];
+static Histogram g_dispatch;
+static bool g_off;
+
+/* ===== histogram ===== */
+static int bucket_of(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    if (e >= HIST_MAX_BITS) return HIST_BUCKETS - 1;
+    return (e - HIST_SUB_BITS + 1) * HIST_SUB + (int)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* largest value that lands in bucket b */
+static uint64_t bucket_upper(int b) {
+    if (b < HIST_SUB) return (uint64_t)b;
+    int g = b / HIST_SUB;
+    uint64_t sub = (uint64_t)(b % HIST_SUB);
+    return ((HIST_SUB + sub + 1) << (g - 1)) - 1;
+}
+
+void hist_record(Histogram *h, uint64_t value) {
+    h->buckets[bucket_of(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+}
+
+uint64_t hist_percentile(const Histogram *h, double p) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->count + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint64_t up = bucket_upper(b);
+            return up < h->max ? up : h->max;
+        }
+    }
+    return h->max;
+}
+
+/* ===== recording ===== */
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static StatSet *station_set(int station_id) {
+    int i = station_id - 2;
+    return i >= 0 && i < STATION_COUNT ? &g_station[i] : NULL;
+}
+
+static StatSet *task_set(int station_id, int task) {
+    uint32_t h = ((uint32_t)station_id * 0x9e3779b1u) ^ ((uint32_t)task * 0x85ebca6bu);
+    h ^= h >> 15;
+    for (int probe = 0; probe < STATS_TASK_SLOTS; ++probe) {
+        TaskSlot *s = &g_tasks[(h + (uint32_t)probe) & (STATS_TASK_SLOTS - 1)];
+        if (s->station_id == station_id && s->task == task) return &s->set;
+        if (s->station_id == 0) {
+            s->station_id = station_id;
+            s->task = task;
+            return &s->set;
+        }
+    }
+    return NULL;
+}
+
+void stats_set_enabled(bool on) {
+    g_off = !on;
+}
+
+void stats_record(int station_id, int task, StatMetric m, uint64_t value) {
+    StatSet *st = g_off ? NULL : station_set(station_id);
+    if (!st) return;
+    hist_record(&st->h[m], value);
+    StatSet *t = task_set(station_id, task);
+    if (t) hist_record(&t->h[m], value);
+}
+
+void stats_record_dispatch(uint64_t ns) {
+    if (!g_off) hist_record(&g_dispatch, ns);
+}
+
+/* ===== REPL view ===== */
+static const char *fmt_ns(char buf[16], uint64_t ns) {
+    if (ns < 1000) snprintf(buf, 16, "%lluns", (unsigned long long)ns);
+    else if (ns < 1000000) snprintf(buf, 16, "%.1fus", (double)ns / 1e3);
+    else if (ns < 1000000000) snprintf(buf, 16, "%.1fms", (double)ns / 1e6);
+    else snprintf(buf, 16, "%.1fs", (double)ns / 1e9);
+    return buf;
+}
+
+static double mean(const Histogram *h) {
+    return h->count ? (double)h->sum / (double)h->count : 0.0;
+}
+
+static void print_row(EngineOut *out, const char *label, const StatSet *s) {
+    const Histogram *think = &s->h[STAT_THINK_US], *eng = &s->h[STAT_ENGINE_NS];
+    char a[16], b[16], c[16], d[16], e[16];
+    engine_out_printf(out, "  %-6s %6llu  %7s %7s %7s  %7s %7s  %5llu %8.2f %6.2f\n", label,
+                      (unsigned long long)think->count,
+                      fmt_ns(a, hist_percentile(think, 50) * 1000),
+                      fmt_ns(b, hist_percentile(think, 90) * 1000),
+                      fmt_ns(c, hist_percentile(think, 99) * 1000),
+                      fmt_ns(d, hist_percentile(eng, 50)),
+                      fmt_ns(e, hist_percentile(eng, 99)),
+                      (unsigned long long)s->h[STAT_ATTEMPTS].count,
+                      mean(&s->h[STAT_ATTEMPTS]), mean(&s->h[STAT_HINTS]));
+}
+
+static int by_task(const void *a, const void *b) {
+    const TaskSlot *x = *(const TaskSlot *const *)a, *y = *(const TaskSlot *const *)b;
+    return (x->task > y->task) - (x->task < y->task);
+}
+
+void stats_print(EngineOut *out, int station_id) {
+    engine_out_puts(out, C_CYAN "Response times:" C_RESET);
+    engine_out_printf(out, "  %-6s %6s  %7s %7s %7s  %7s %7s  %5s %8s %6s\n", "", "lines",
+                      "think50", "p90", "p99", "engine50", "p99", "tasks", "attempts", "hints");
+    int rows = 0;
+    if (station_id == 0) {
+        for (int i = 0; i < STATION_COUNT; ++i) {
+            if (g_station[i].h[STAT_THINK_US].count == 0) continue;
+            char label[8];
+            snprintf(label, sizeof(label), "[%02d]", i + 2);
+            print_row(out, label, &g_station[i]);
+            rows++;
+        }
+        char a[16], b[16];
+        engine_out_printf(out, "  shell dispatch: %llu commands, p50 %s, p99 %s\n",
+                          (unsigned long long)g_dispatch.count,
+                          fmt_ns(a, hist_percentile(&g_dispatch, 50)),
+                          fmt_ns(b, hist_percentile(&g_dispatch, 99)));
+    } else {
+        const TaskSlot *found[STATS_TASK_SLOTS];
+        int n = 0;
+        for (int i = 0; i < STATS_TASK_SLOTS; ++i) {
+            if (g_tasks[i].station_id == station_id) found[n++] = &g_tasks[i];
+        }
+        qsort(found, (size_t)n, sizeof(found[0]), by_task);
+        for (int i = 0; i < n; ++i) {
+            char label[24];
+            snprintf(label, sizeof(label), "task %d", found[i]->task + 1);
+            print_row(out, label, &found[i]->set);
+            rows++;
+        }
+    }
+    if (!rows) engine_out_puts(out, "  (nothing recorded yet)");
+}
+
+/* ===== Prometheus dump ===== */
+static const struct {
+    const char *name;
+    const char *help;
+    double scale;               /* recorded units per exported unit */
+} METRIC[STAT_METRICS] = {
+    [STAT_THINK_US]  = { "think_seconds",  "Time from prompt to the learner's next line.", 1e6 },
+    [STAT_ENGINE_NS] = { "engine_seconds", "Engine time to process one input line.",      1e9 },
+    [STAT_ATTEMPTS]  = { "attempts",       "Graded answers per finished task.",           1.0 },
+    [STAT_HINTS]     = { "hints",          "Hint requests per finished task.",            1.0 },
+};
+
+static void write_hist(FILE *f, const char *name, const char *labels, const Histogram *h,
+                       double scale) {
+    const char *sep = labels[0] ? "," : "";
+    uint64_t cum = 0;
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        if (!h->buckets[b]) continue;
+        cum += h->buckets[b];
+        fprintf(f, "%s_bucket{%s%sle=\"%.9g\"} %llu\n", name, labels, sep,
+                (double)bucket_upper(b) / scale, (unsigned long long)cum);
+    }
+    fprintf(f, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep,
+            (unsigned long long)h->count);
+    fprintf(f, "%s_sum{%s} %.9g\n", name, labels, (double)h->sum / scale);
+    fprintf(f, "%s_count{%s} %llu\n", name, labels, (unsigned long long)h->count);
+}
+
+Status stats_write_prometheus(const char *path) {
+    char tmp[512];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return ERR;
+    FILE *f = fopen(tmp, "w");
+    if (!f) return ERR;
+
+    char name[64], labels[64];
+    for (int m = 0; m < STAT_METRICS; ++m) {
+        snprintf(name, sizeof(name), "c_arcade_station_%s", METRIC[m].name);
+        fprintf(f, "# HELP %s %s\n# TYPE %s histogram\n", name, METRIC[m].help, name);
+        for (int i = 0; i < STATION_COUNT; ++i) {
+            if (!g_station[i].h[m].count) continue;
+            snprintf(labels, sizeof(labels), "station=\"%02d\"", i + 2);
+            write_hist(f, name, labels, &g_station[i].h[m], METRIC[m].scale);
+        }
+        snprintf(name, sizeof(name), "c_arcade_task_%s", METRIC[m].name);
+        fprintf(f, "# HELP %s %s\n# TYPE %s histogram\n", name, METRIC[m].help, name);
+        for (int i = 0; i < STATS_TASK_SLOTS; ++i) {
+            const TaskSlot *s = &g_tasks[i];
+            if (!s->station_id || !s->set.h[m].count) continue;
+            snprintf(labels, sizeof(labels), "station=\"%02d\",task=\"%d\"", s->station_id,
+                     s->task + 1);
+            write_hist(f, name, labels, &s->set.h[m], METRIC[m].scale);
+        }
+    }
+    fprintf(f, "# HELP c_arcade_dispatch_seconds Shell time to handle one command line.\n"
+               "# TYPE c_arcade_dispatch_seconds histogram\n");
+    write_hist(f, "c_arcade_dispatch_seconds", "", &g_dispatch, 1e9);
+
+    bool ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return ERR;
+    }
+    return OK;
+}
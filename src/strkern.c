@@ -0,0 +1,177 @@
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "strkern.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STRK_X86 1
+#include <immintrin.h>
+#else
+#define STRK_X86 0
+#endif
+
+#define STRK_CAT2(a, b) a##_##b
+#define STRK_CAT(a, b) STRK_CAT2(a, b)
+
+static inline bool space_byte(char c) {
+    return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
+
+static inline char fold_byte(char c) {
+    return (unsigned char)(c - 'A') < 26 ? (char)(c | 0x20) : c;
+}
+
+/* ===== scalar ===== */
+static size_t eol_scalar(const char *s, size_t n) {
+    size_t i = 0;
+    while (i < n && s[i] && s[i] != '\n' && s[i] != '\r') i++;
+    return i;
+}
+
+static size_t span_space_scalar(const char *s, size_t n) {
+    size_t i = 0;
+    while (i < n && space_byte(s[i])) i++;
+    return i;
+}
+
+static size_t span_word_scalar(const char *s, size_t n) {
+    size_t i = 0;
+    while (i < n && !space_byte(s[i])) i++;
+    return i;
+}
+
+static size_t rspan_space_scalar(const char *s, size_t n) {
+    size_t i = n;
+    while (i > 0 && space_byte(s[i - 1])) i--;
+    return n - i;
+}
+
+static void lower_scalar(char *dst, const char *src, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = fold_byte(src[i]);
+}
+
+static int casecmp_scalar(const char *a, const char *b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        int d = (unsigned char)fold_byte(a[i]) - (unsigned char)fold_byte(b[i]);
+        if (d) return d;
+    }
+    return 0;
+}
+
+/* ===== SIMD: strkern_simd.inc once per instruction set ===== */
+#if STRK_X86
+#define STRK_SUFFIX sse2
+#define STRK_TARGET __attribute__((target("sse2")))
+#define STRK_W      16
+#define bvec        __m128i
+#define B_LOAD(p)       _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define B_STORE(p, v)   _mm_storeu_si128((__m128i *)(void *)(p), (v))
+#define B_SET1(c)       _mm_set1_epi8(c)
+#define B_EQ(a, b)      _mm_cmpeq_epi8((a), (b))
+#define B_LT(a, b)      _mm_cmplt_epi8((a), (b))
+#define B_ADD(a, b)     _mm_add_epi8((a), (b))
+#define B_AND(a, b)     _mm_and_si128((a), (b))
+#define B_OR(a, b)      _mm_or_si128((a), (b))
+#define B_MASK(v)       ((uint32_t)_mm_movemask_epi8(v))
+#include "strkern_simd.inc"
+#undef STRK_SUFFIX
+#undef STRK_TARGET
+#undef STRK_W
+#undef bvec
+#undef B_LOAD
+#undef B_STORE
+#undef B_SET1
+#undef B_EQ
+#undef B_LT
+#undef B_ADD
+#undef B_AND
+#undef B_OR
+#undef B_MASK
+
+#define STRK_SUFFIX avx2
+#define STRK_TARGET __attribute__((target("avx2")))
+#define STRK_W      32
+#define bvec        __m256i
+#define B_LOAD(p)       _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define B_STORE(p, v)   _mm256_storeu_si256((__m256i *)(void *)(p), (v))
+#define B_SET1(c)       _mm256_set1_epi8(c)
+#define B_EQ(a, b)      _mm256_cmpeq_epi8((a), (b))
+#define B_LT(a, b)      _mm256_cmpgt_epi8((b), (a))
+#define B_ADD(a, b)     _mm256_add_epi8((a), (b))
+#define B_AND(a, b)     _mm256_and_si256((a), (b))
+#define B_OR(a, b)      _mm256_or_si256((a), (b))
+#define B_MASK(v)       ((uint32_t)_mm256_movemask_epi8(v))
+#include "strkern_simd.inc"
+#endif /* STRK_X86 */
+
+/* ===== dispatch ===== */
+static const StrKernels KERNELS[FPK_ISAS] = {
+    [FPK_SCALAR] = { eol_scalar, span_space_scalar, span_word_scalar,
+                     rspan_space_scalar, lower_scalar, casecmp_scalar },
+#if STRK_X86
+    [FPK_SSE2] = { eol_sse2, span_space_sse2, span_word_sse2,
+                   rspan_space_sse2, lower_sse2, casecmp_sse2 },
+    [FPK_AVX2] = { eol_avx2, span_space_avx2, span_word_avx2,
+                   rspan_space_avx2, lower_avx2, casecmp_avx2 },
+#endif
+};
+
+const StrKernels *strk_kernels(FpkIsa isa) {
+    if ((unsigned)isa >= FPK_ISAS || isa > fpk_detect_isa() || !KERNELS[isa].eol) {
+        return NULL;
+    }
+    return &KERNELS[isa];
+}
+
+FpkIsa strk_active_isa(void) {
+    FpkIsa isa = fpk_detect_isa();
+    while (isa > FPK_SCALAR && !KERNELS[isa].eol) isa--;
+    return isa;
+}
+
+/* Picked on first use; every thread computes the same pointer. */
+static _Atomic(const StrKernels *) g_active;
+
+static const StrKernels *active(void) {
+    const StrKernels *k = atomic_load_explicit(&g_active, memory_order_relaxed);
+    if (!k) {
+        k = &KERNELS[strk_active_isa()];
+        atomic_store_explicit(&g_active, k, memory_order_relaxed);
+    }
+    return k;
+}
+
+size_t strk_eol(const char *s, size_t n) {
+    return active()->eol(s, n);
+}
+
+size_t strk_span_space(const char *s, size_t n) {
+    return active()->span_space(s, n);
+}
+
+size_t strk_span_word(const char *s, size_t n) {
+    return active()->span_word(s, n);
+}
+
+size_t strk_trim(const char *s, size_t n, size_t *start) {
+    const StrKernels *k = active();
+    size_t lead = k->span_space(s, n);
+    *start = lead;
+    return lead == n ? 0 : n - lead - k->rspan_space(s + lead, n - lead);
+}
+
+void strk_lower(char *s, size_t n) {
+    active()->lower(s, s, n);
+}
+
+void strk_lower_copy(char *dst, const char *src, size_t n) {
+    active()->lower(dst, src, n);
+}
+
+int strk_casecmp(const char *a, const char *b, size_t n) {
+    return active()->casecmp(a, b, n);
+}
+
+bool strk_equals_ignore_case(const char *a, size_t alen, const char *b, size_t blen) {
+    return alen == blen && active()->casecmp(a, b, alen) == 0;
+}
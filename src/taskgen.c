@@ -0,0 +1,394 @@
+#include <stdarg.h>
+
+#include "taskgen.h"
+
+typedef struct {
+    uint64_t s;
+} Rng;
+
+uint64_t taskgen_mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static uint64_t next(Rng *r) {
+    r->s += 0x9e3779b97f4a7c15ull;
+    uint64_t x = r->s;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* uniform in [0, n) for small n (multiply-shift, no division) */
+static int below(Rng *r, int n) {
+    return (int)(((next(r) >> 32) * (uint64_t)n) >> 32);
+}
+
+static int between(Rng *r, int lo, int hi) {
+    return lo + below(r, hi - lo + 1);
+}
+
+/* ===== text helpers ===== */
+typedef struct {
+    TaskgenText *x;
+    int answers;
+} Out;
+
+static void put(char *dst, size_t cap, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+static void put(char *dst, size_t cap, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(dst, cap, fmt, ap);
+    va_end(ap);
+}
+
+static void accept(Out *o, const char *s) {
+    if (o->answers < TASKGEN_ANSWERS) {
+        put(o->x->answer[o->answers++], TASKGEN_ANSWER, "%s", s);
+    }
+}
+
+static void accept_int(Out *o, long long v) {
+    char buf[TASKGEN_ANSWER];
+    snprintf(buf, sizeof(buf), "%lld", v);
+    accept(o, buf);
+}
+
+/* "{12, 7, 33}" */
+static void fmt_list(char *dst, size_t cap, const int *v, int n) {
+    size_t len = 0;
+    for (int i = 0; i < n && len < cap; ++i) {
+        len += (size_t)snprintf(dst + len, cap - len, "%s%d", i ? ", " : "{", v[i]);
+    }
+    if (len < cap) snprintf(dst + len, cap - len, "}");
+}
+
+static void fill(Rng *r, int *v, int n, int lo, int hi) {
+    for (int i = 0; i < n; ++i) v[i] = between(r, lo, hi);
+}
+
+/* ===== templates ===== */
+#define ARR_MAX 8
+
+/* *(a + k), a[k], k[a], and the same through a pointer into the array */
+static void gen_ptr_index(Rng *r, Out *o) {
+    int v[ARR_MAX], n = between(r, 4, ARR_MAX), k = below(r, n);
+    char list[64];
+    fill(r, v, n, 1, 99);
+    fmt_list(list, sizeof(list), v, n);
+
+    int form = below(r, 4);
+    if (form < 2) {
+        static const char *const EXPR[] = { "*(a + %d)", "%d[a]" };
+        char e[16];
+        snprintf(e, sizeof(e), EXPR[form], k);
+        put(o->x->prompt, TASKGEN_PROMPT, "What is %s?\n    int a[] = %s;", e, list);
+        put(o->x->hint, TASKGEN_HINT, "x[i] means *(x + i); count from a[0].");
+        put(o->x->why, TASKGEN_WHY,
+            "WHY: x[i] is defined as *(x + i), and addition commutes, so %s is a[%d] = %d.", e, k,
+            v[k]);
+    } else {
+        int m = between(r, 1, n - 1), j = k - m;
+        char e[16];
+        if (form == 2) {
+            snprintf(e, sizeof(e), "*(p %c %d)", j < 0 ? '-' : '+', j < 0 ? -j : j);
+        } else {
+            snprintf(e, sizeof(e), "p[%d]", j);
+        }
+        put(o->x->prompt, TASKGEN_PROMPT, "What is %s?\n    int a[] = %s;\n    int *p = &a[%d];",
+            e, list, m);
+        put(o->x->hint, TASKGEN_HINT, "p points at a[%d]; move %d int%s %s from there.", m,
+            j < 0 ? -j : j, j == 1 || j == -1 ? "" : "s", j < 0 ? "back" : "on");
+        put(o->x->why, TASKGEN_WHY,
+            "WHY: p is &a[%d], so %s is a[%d] = %d.  Negative offsets are fine while they stay "
+            "inside the array.", m, e, k, v[k]);
+    }
+    accept_int(o, v[k]);
+}
+
+typedef struct {
+    const char *name;
+    int size;
+} CType;
+
+static const CType ELEMS[] = {
+    { "char", 1 }, { "short", 2 }, { "int", 4 }, { "float", 4 },
+    { "long", 8 }, { "double", 8 },
+};
+#define ELEMS_N ((int)(sizeof(ELEMS) / sizeof(ELEMS[0])))
+
+/* q - p counts elements; the same through char * counts bytes */
+static void gen_ptr_diff(Rng *r, Out *o) {
+    const CType *t = &ELEMS[below(r, ELEMS_N)];
+    int n = between(r, 5, 12), i = below(r, n), j = below(r, n);
+    bool bytes = below(r, 3) == 0;
+    int d = j - i;
+    if (bytes) {
+        put(o->x->prompt, TASKGEN_PROMPT,
+            "What is (char *)q - (char *)p?\n    %s a[%d];\n    %s *p = &a[%d], *q = &a[%d];",
+            t->name, n, t->name, i, j);
+        put(o->x->hint, TASKGEN_HINT, "Through char * the difference is in bytes; sizeof(%s) = %d.",
+            t->name, t->size);
+        put(o->x->why, TASKGEN_WHY,
+            "WHY: q - p is %d element%s; as char pointers that is %d * sizeof(%s) = %d bytes.", d,
+            d == 1 || d == -1 ? "" : "s", d, t->name, d * t->size);
+        accept_int(o, (long long)d * t->size);
+    } else {
+        put(o->x->prompt, TASKGEN_PROMPT,
+            "What is q - p?\n    %s a[%d];\n    %s *p = &a[%d], *q = &a[%d];", t->name, n, t->name,
+            i, j);
+        put(o->x->hint, TASKGEN_HINT, "Pointer subtraction counts elements, not bytes.");
+        put(o->x->why, TASKGEN_WHY,
+            "WHY: q - p is a ptrdiff_t holding the index distance %d - %d = %d, whatever "
+            "sizeof(%s) is.", j, i, d, t->name);
+        accept_int(o, d);
+    }
+}
+
+/* sizeof of an array, of one element, and of what it decays to */
+static void gen_sizeof_array(Rng *r, Out *o) {
+    const CType *t = &ELEMS[below(r, ELEMS_N)];
+    int n = between(r, 2, 24);
+    static const char *const ASK[] = { "sizeof a", "sizeof a / sizeof a[0]", "sizeof (a + 0)",
+                                       "sizeof &a" };
+    int q = below(r, 4);
+    long long v = q == 0 ? (long long)n * t->size : q == 1 ? n : 8;
+    put(o->x->prompt, TASKGEN_PROMPT, "What is %s?\n    %s a[%d];", ASK[q], t->name, n);
+    switch (q) {
+        case 0:
+            put(o->x->hint, TASKGEN_HINT, "sizeof an array is the whole array, in bytes.");
+            put(o->x->why, TASKGEN_WHY, "WHY: a is not converted to a pointer under sizeof: "
+                "%d elements * %d bytes = %lld.", n, t->size, v);
+            break;
+        case 1:
+            put(o->x->hint, TASKGEN_HINT, "Whole array bytes over one element's bytes.");
+            put(o->x->why, TASKGEN_WHY, "WHY: %lld / %d = %d, the element count; it only works "
+                "where a is still an array, not a pointer parameter.", (long long)n * t->size,
+                t->size, n);
+            break;
+        case 2:
+            put(o->x->hint, TASKGEN_HINT, "Is a + 0 still an array?");
+            put(o->x->why, TASKGEN_WHY, "WHY: a decays to %s * before + 0 applies, and every "
+                "object pointer is 8 bytes on LP64.", t->name);
+            break;
+        default:
+            put(o->x->hint, TASKGEN_HINT, "&a is an address, however big a is.");
+            put(o->x->why, TASKGEN_WHY, "WHY: &a is a %s (*)[%d], a pointer to the whole array, "
+                "and every object pointer is 8 bytes on LP64.", t->name, n);
+            break;
+    }
+    accept_int(o, v);
+}
+
+/* int m[R][C] walked through pointers */
+static void gen_array2d(Rng *r, Out *o) {
+    int R = between(r, 2, 5), C = between(r, 2, 6), i = below(r, R), j = below(r, C);
+    int q = below(r, 3);
+    if (q == 0) {
+        put(o->x->prompt, TASKGEN_PROMPT,
+            "What is *(*(m + %d) + %d)?\n    int m[%d][%d];   /* m[r][c] == 10 * r + c */", i, j,
+            R, C);
+        put(o->x->hint, TASKGEN_HINT, "*(m + i) is row i; + j then moves along that row.");
+        put(o->x->why, TASKGEN_WHY, "WHY: *(*(m + i) + j) is m[i][j] = 10 * %d + %d = %d.", i, j,
+            10 * i + j);
+        accept_int(o, 10 * i + j);
+    } else if (q == 1) {
+        put(o->x->prompt, TASKGEN_PROMPT, "What is &m[%d][%d] - &m[0][0]?\n    int m[%d][%d];", i,
+            j, R, C);
+        put(o->x->hint, TASKGEN_HINT, "Rows are stored one after another, %d ints each.", C);
+        put(o->x->why, TASKGEN_WHY, "WHY: row-major layout puts m[i][j] at i * %d + j ints from "
+            "m[0][0]: %d * %d + %d = %d.", C, i, C, j, i * C + j);
+        accept_int(o, i * C + j);
+    } else {
+        put(o->x->prompt, TASKGEN_PROMPT, "What is sizeof *(m + %d)?\n    int m[%d][%d];", i, R,
+            C);
+        put(o->x->hint, TASKGEN_HINT, "m + %d points to a whole row.", i);
+        put(o->x->why, TASKGEN_WHY, "WHY: m decays to int (*)[%d]; *(m + %d) is a row, an "
+            "int[%d] of %d bytes.", C, i, C, 4 * C);
+        accept_int(o, 4 * C);
+    }
+}
+
+/* usual arithmetic conversions, LP64 */
+typedef struct {
+    const char *name;
+    int rank;           /* 1 char .. 5 long long; 6 float, 7 double */
+    bool is_unsigned;
+    int size;
+} Arith;
+
+static const Arith ARITH[] = {
+    { "char", 1, false, 1 },          { "unsigned char", 1, true, 1 },
+    { "short", 2, false, 2 },         { "unsigned short", 2, true, 2 },
+    { "int", 3, false, 4 },           { "unsigned int", 3, true, 4 },
+    { "long", 4, false, 8 },          { "unsigned long", 4, true, 8 },
+    { "long long", 5, false, 8 },     { "unsigned long long", 5, true, 8 },
+    { "float", 6, false, 4 },         { "double", 7, false, 8 },
+};
+#define ARITH_N ((int)(sizeof(ARITH) / sizeof(ARITH[0])))
+#define ARITH_INT 4     /* index of int */
+
+static const Arith *promote(const Arith *t) {
+    /* everything below int fits in int on LP64 */
+    return t->rank < 3 ? &ARITH[ARITH_INT] : t;
+}
+
+static const Arith *common_type(const Arith *a, const Arith *b) {
+    a = promote(a);
+    b = promote(b);
+    if (a->rank >= 6 || b->rank >= 6) return a->rank > b->rank ? a : b;
+    if (a->is_unsigned == b->is_unsigned) return a->rank >= b->rank ? a : b;
+    const Arith *u = a->is_unsigned ? a : b, *s = a->is_unsigned ? b : a;
+    if (u->rank >= s->rank) return u;
+    if (s->size > u->size) return s;            /* signed holds every unsigned value */
+    return s + 1;                               /* unsigned version of the signed type */
+}
+
+static void accept_type(Out *o, const Arith *t) {
+    accept(o, t->name);
+    if (strcmp(t->name, "unsigned int") == 0) {
+        accept(o, "unsigned");
+    } else if (t->rank == 4 || t->rank == 5) {
+        char buf[TASKGEN_ANSWER];
+        snprintf(buf, sizeof(buf), "%s int", t->name);
+        accept(o, buf);
+    }
+}
+
+static void gen_arith_type(Rng *r, Out *o) {
+    const Arith *a = &ARITH[below(r, ARITH_N)], *b = &ARITH[below(r, ARITH_N)];
+    static const char OPS[] = "+-*/<";
+    char op = OPS[below(r, 5)];
+    put(o->x->prompt, TASKGEN_PROMPT, "What type is x %c y?\n    %s x;\n    %s y;", op, a->name,
+        b->name);
+    if (op == '<') {
+        put(o->x->hint, TASKGEN_HINT, "Relational operators answer yes or no.");
+        put(o->x->why, TASKGEN_WHY, "WHY: the operands are converted to a common type to be "
+            "compared, but the result of < is always int, 0 or 1.");
+        accept_type(o, &ARITH[ARITH_INT]);
+        return;
+    }
+    const Arith *t = common_type(a, b), *pa = promote(a), *pb = promote(b);
+    put(o->x->hint, TASKGEN_HINT, "Promote types below int first, then convert to the wider or "
+        "unsigned one.");
+    if (t->rank >= 6) {
+        put(o->x->why, TASKGEN_WHY, "WHY: with a floating operand the other converts to it; the "
+            "result is %s.", t->name);
+    } else if (pa->is_unsigned != pb->is_unsigned && !t->is_unsigned) {
+        put(o->x->why, TASKGEN_WHY, "WHY: after promotion (%s, %s), %s is wider than the "
+            "unsigned operand and holds all its values, so the result is %s.", pa->name,
+            pb->name, t->name, t->name);
+    } else if (pa->is_unsigned != pb->is_unsigned) {
+        put(o->x->why, TASKGEN_WHY, "WHY: after promotion (%s, %s), the signed operand cannot "
+            "hold every unsigned value, so both convert to %s.", pa->name, pb->name, t->name);
+    } else {
+        put(o->x->why, TASKGEN_WHY, "WHY: after promotion (%s, %s), the higher rank wins: %s.",
+            pa->name, pb->name, t->name);
+    }
+    accept_type(o, t);
+}
+
+/* conversions to unsigned types wrap modulo 2^N */
+static void gen_int_wrap(Rng *r, Out *o) {
+    static const struct {
+        const char *type;
+        int bits;
+    } U[] = { { "unsigned char", 8 }, { "unsigned short", 16 }, { "unsigned int", 32 } };
+    int u = below(r, 3);
+    uint64_t mod = (uint64_t)1 << U[u].bits;
+    long long v = below(r, 2) ? -(long long)between(r, 1, 300)
+                              : (long long)mod + between(r, 0, u == 0 ? 700 : 9999);
+    unsigned long long res = (unsigned long long)(((v % (long long)mod) + (long long)mod) %
+                                                  (long long)mod);
+    put(o->x->prompt, TASKGEN_PROMPT, "What value does x hold?\n    %s x = %lld;", U[u].type, v);
+    put(o->x->hint, TASKGEN_HINT, "%s holds 0 .. %llu; add or subtract %llu until it fits.",
+        U[u].type, (unsigned long long)(mod - 1), (unsigned long long)mod);
+    put(o->x->why, TASKGEN_WHY, "WHY: converting to an unsigned type is reduced modulo 2^%d = "
+        "%llu, which is defined behavior: %lld becomes %llu.", U[u].bits,
+        (unsigned long long)mod, v, res);
+    accept_int(o, (long long)res);
+}
+
+/* pointer to pointer: which object does each level reach? */
+static void gen_ptrptr(Rng *r, Out *o) {
+    int x = between(r, 1, 50), y = between(r, 51, 99), k = between(r, 100, 199);
+    bool redirect = below(r, 2);
+    bool store = below(r, 2);
+    int q = below(r, 2);        /* ask x, or *p */
+
+    char stmts[64] = "";
+    int len = 0;
+    if (redirect) len += snprintf(stmts + len, sizeof(stmts) - (size_t)len, "\n    *pp = &y;");
+    if (store) snprintf(stmts + len, sizeof(stmts) - (size_t)len, "\n    **pp = %d;", k);
+
+    int px = store && !redirect ? k : x;            /* x afterwards */
+    int py = store && redirect ? k : y;             /* y afterwards */
+    int ans = q == 1 && redirect ? py : px;
+
+    put(o->x->prompt, TASKGEN_PROMPT,
+        "What is %s afterwards?\n    int x = %d, y = %d;\n    int *p = &x;\n    int **pp = &p;%s",
+        q == 0 ? "x" : "*p", x, y, stmts);
+    put(o->x->hint, TASKGEN_HINT, "*pp is p itself; **pp is whatever p points to at that "
+        "moment.");
+    put(o->x->why, TASKGEN_WHY, "WHY: %s%s so %s is %d.",
+        redirect ? "*pp = &y changes p to point at y; " : "p still points at x; ",
+        store ? (redirect ? "**pp then writes y, " : "**pp then writes x, ") : "",
+        q == 0 ? "x" : "*p", ans);
+    accept_int(o, ans);
+}
+
+typedef struct {
+    const char *name;
+    int station;
+    void (*make)(Rng *r, Out *o);
+} Template;
+
+static const Template TEMPLATES[] = {
+    { "arith_type",   7, gen_arith_type },
+    { "int_wrap",     7, gen_int_wrap },
+    { "ptr_index",    9, gen_ptr_index },
+    { "ptr_diff",     9, gen_ptr_diff },
+    { "sizeof_array", 10, gen_sizeof_array },
+    { "array2d",      11, gen_array2d },
+    { "ptrptr",       13, gen_ptrptr },
+};
+#define TEMPLATES_N ((int)(sizeof(TEMPLATES) / sizeof(TEMPLATES[0])))
+
+int taskgen_count(void) {
+    return TEMPLATES_N;
+}
+
+const char *taskgen_name(int tmpl) {
+    return TEMPLATES[tmpl].name;
+}
+
+int taskgen_station(int tmpl) {
+    return TEMPLATES[tmpl].station;
+}
+
+int taskgen_find(const char *name) {
+    for (int i = 0; i < TEMPLATES_N; ++i) {
+        if (strcmp(TEMPLATES[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+void taskgen_make(int tmpl, uint64_t seed, Task *task, TaskgenText *text) {
+    /* the template index is mixed in, so one seed gives unrelated variants */
+    Rng r = { taskgen_mix(seed ^ ((uint64_t)tmpl << 56)) };
+    Out o = { text, 0 };
+    TEMPLATES[tmpl].make(&r, &o);
+    for (int i = 0; i < o.answers; ++i) text->answers[i] = text->answer[i];
+    text->answers[o.answers] = NULL;
+
+    *task = (Task){
+        .type = TASK_ASK,
+        .prompt = text->prompt,
+        .typos = ASK_TYPOS_EXACT,
+        .answers = text->answers,
+        .hint = text->hint,
+        .why = text->why,
+    };
+}
@@ -0,0 +1,245 @@
+#include <stdatomic.h>
+#include <sys/single_threaded.h>
+#include <time.h>
+
+#include "common.h"
+#include "tracker.h"
+
+#define TRACKER_MIN_CAP  1024       /* slots; always a power of two */
+#define TRACKER_SITES    64         /* distinct sites tracker_sites() folds */
+
+typedef struct {
+    uintptr_t addr;                 /* 0 = empty */
+    size_t size;
+    const char *file;
+    int line;
+    uint32_t stamp_ms;              /* coarse monotonic ms at allocation */
+} Block;
+
+static Block *g_slots;
+static size_t g_mask;               /* capacity - 1 */
+static size_t g_used;
+static TrackerStats g_stats;
+static atomic_flag g_lock = ATOMIC_FLAG_INIT;
+
+/* glibc clears __libc_single_threaded once a second thread is created
+ * (and never sets it back), so the single-threaded REPL skips the lock.
+ * lock() returns whether it locked; hand that to unlock(). */
+static bool lock(void) {
+    if (__libc_single_threaded) return false;
+    while (atomic_flag_test_and_set_explicit(&g_lock, memory_order_acquire)) {
+    }
+    return true;
+}
+
+static void unlock(bool locked) {
+    if (locked) atomic_flag_clear_explicit(&g_lock, memory_order_release);
+}
+
+static uint32_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+/* malloc results are 16-byte aligned: drop the dead low bits, then mix */
+static size_t slot_of(uintptr_t addr) {
+    uint64_t h = (uint64_t)(addr >> 4) * 0x9e3779b97f4a7c15ull;
+    return (size_t)(h >> 20) & g_mask;
+}
+
+static void put(Block b) {
+    size_t i = slot_of(b.addr);
+    while (g_slots[i].addr) i = (i + 1) & g_mask;
+    g_slots[i] = b;
+    g_used++;
+}
+
+/* Grow at 50% load; false when the table itself cannot be allocated. */
+static bool reserve(void) {
+    if (g_slots && (g_used + 1) * 2 <= g_mask + 1) return true;
+
+    size_t cap = g_slots ? (g_mask + 1) * 2 : TRACKER_MIN_CAP;
+    Block *old = g_slots;
+    size_t old_cap = g_slots ? g_mask + 1 : 0;
+    Block *slots = calloc(cap, sizeof(Block));
+    if (!slots) return false;
+
+    g_slots = slots;
+    g_mask = cap - 1;
+    g_used = 0;
+    for (size_t i = 0; i < old_cap; ++i) if (old[i].addr) put(old[i]);
+    free(old);
+    return true;
+}
+
+static Block *find(uintptr_t addr) {
+    if (!g_slots) return NULL;
+    for (size_t i = slot_of(addr); g_slots[i].addr; i = (i + 1) & g_mask) {
+        if (g_slots[i].addr == addr) return &g_slots[i];
+    }
+    return NULL;
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones. */
+static void erase(Block *b) {
+    size_t i = (size_t)(b - g_slots);
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & g_mask;
+        if (!g_slots[j].addr) break;
+        size_t home = slot_of(g_slots[j].addr);
+        /* move j back to i unless its home lies cyclically in (i, j] */
+        bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            g_slots[i] = g_slots[j];
+            i = j;
+        }
+    }
+    g_slots[i].addr = 0;
+    g_used--;
+}
+
+static void record(void *p, size_t size, const char *file, int line) {
+    if (!reserve()) return;     /* keep running untracked rather than fail */
+    put((Block){ (uintptr_t)p, size, file, line, now_ms() });
+    g_stats.allocs++;
+    g_stats.live_blocks++;
+    g_stats.live_bytes += size;
+    if (g_stats.live_bytes > g_stats.peak_bytes) g_stats.peak_bytes = g_stats.live_bytes;
+}
+
+/* false when p was not a live tracked block */
+static bool forget(void *p, const char *file, int line) {
+    Block *b = find((uintptr_t)p);
+    if (!b) {
+        g_stats.bad_frees++;
+        fprintf(stderr, "tracker: free of untracked or already-freed %p at %s:%d\n",
+                p, file, line);
+        return false;
+    }
+    g_stats.frees++;
+    g_stats.live_blocks--;
+    g_stats.live_bytes -= b->size;
+    erase(b);
+    return true;
+}
+
+/* ===== public ===== */
+void *tracker_malloc(size_t size, const char *file, int line) {
+    void *p = malloc(size ? size : 1);
+    if (!p) return NULL;
+    bool locked = lock();
+    record(p, size, file, line);
+    unlock(locked);
+    return p;
+}
+
+void *tracker_calloc(size_t count, size_t size, const char *file, int line) {
+    void *p = calloc(count ? count : 1, size ? size : 1);
+    if (!p) return NULL;
+    bool locked = lock();
+    record(p, count * size, file, line);
+    unlock(locked);
+    return p;
+}
+
+void *tracker_realloc(void *ptr, size_t size, const char *file, int line) {
+    if (!ptr) return tracker_malloc(size, file, line);
+
+    uintptr_t addr = (uintptr_t)ptr;
+    bool locked = lock();
+    bool known = find(addr) != NULL;
+    unlock(locked);
+    if (!known) {
+        fprintf(stderr, "tracker: realloc of untracked %p at %s:%d\n", ptr, file, line);
+        return NULL;
+    }
+
+    void *np = realloc(ptr, size ? size : 1);
+    if (!np) return NULL;           /* old block stays live and tracked */
+    locked = lock();
+    Block *b = find(addr);
+    if (b) {
+        g_stats.live_blocks--;
+        g_stats.live_bytes -= b->size;
+        erase(b);
+    }
+    record(np, size, file, line);
+    g_stats.allocs--;               /* a move, not a new allocation */
+    unlock(locked);
+    return np;
+}
+
+void tracker_free(void *ptr, const char *file, int line) {
+    if (!ptr) return;
+    bool locked = lock();
+    bool ok = forget(ptr, file, line);
+    unlock(locked);
+    if (ok) free(ptr);
+}
+
+TrackerStats tracker_stats(void) {
+    bool locked = lock();
+    TrackerStats s = g_stats;
+    unlock(locked);
+    return s;
+}
+
+int tracker_sites(TrackerSite *out, int max) {
+    TrackerSite site[TRACKER_SITES];
+    int n = 0;
+
+    bool locked = lock();
+    for (size_t i = 0; g_slots && i <= g_mask; ++i) {
+        const Block *b = &g_slots[i];
+        if (!b->addr) continue;
+        int k = 0;
+        while (k < n && (site[k].line != b->line || strcmp(site[k].file, b->file) != 0)) k++;
+        if (k == n) {
+            if (n == TRACKER_SITES) continue;
+            site[n] = (TrackerSite){ b->file, b->line, 0, 0 };
+            n++;
+        }
+        site[k].bytes += b->size;
+        site[k].blocks++;
+    }
+    unlock(locked);
+
+    /* few sites: a partial selection sort is plenty */
+    int filled = 0;
+    for (; filled < n && filled < max; ++filled) {
+        int best = filled;
+        for (int k = filled + 1; k < n; ++k) if (site[k].bytes > site[best].bytes) best = k;
+        TrackerSite t = site[filled];
+        site[filled] = site[best];
+        site[best] = t;
+        out[filled] = site[filled];
+    }
+    return filled;
+}
+
+size_t tracker_report_leaks(FILE *f) {
+    size_t leaks = 0, bytes = 0;
+    uint32_t now = now_ms();
+    bool locked = lock();
+    for (size_t i = 0; g_slots && i <= g_mask; ++i) {
+        const Block *b = &g_slots[i];
+        if (!b->addr) continue;
+        leaks++;
+        bytes += b->size;
+        fprintf(f, "  leak: %zu B at %s:%d (age %.1f s)\n", b->size, b->file, b->line,
+                (double)(uint32_t)(now - b->stamp_ms) / 1000.0);
+    }
+    unlock(locked);
+    if (leaks) fprintf(f, "tracker: %zu block(s), %zu B still live at exit\n", leaks, bytes);
+    return leaks;
+}
+
+static void exit_report(void) {
+    tracker_report_leaks(stderr);
+}
+
+void tracker_install_exit_report(void) {
+    atexit(exit_report);
+}
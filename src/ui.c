@@ -0,0 +1,87 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "ui.h"
+
+static bool spill(EngineOut *out);
+
+static char g_text[UI_FRAME_CAP];
+static EngineOut g_frame = { g_text, sizeof(g_text), 0, false, spill, NULL };
+static UiStats g_stats;
+static int g_color = -1;        /* -1 = not probed yet */
+
+bool ui_color(void) {
+    if (g_color < 0) {
+        const char *no = getenv("NO_COLOR");
+        g_color = isatty(STDOUT_FILENO) && !(no && *no);
+    }
+    return g_color;
+}
+
+EngineOut *ui_frame(void) {
+    return &g_frame;
+}
+
+/* A full frame is shipped, whether the write came through ui_printf() or
+ * engine_out_printf(ui_frame(), ...). */
+static bool spill(EngineOut *out) {
+    (void)out;
+    ui_flush();
+    return true;
+}
+
+void ui_printf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    engine_out_vprintf(&g_frame, fmt, ap);
+    va_end(ap);
+}
+
+void ui_puts(const char *s) {
+    ui_printf("%s\n", s);
+}
+
+size_t ui_strip_ansi(char *s, size_t len) {
+    size_t w = 0;
+    for (size_t r = 0; r < len; ++r) {
+        if (s[r] == '\x1b' && r + 1 < len && s[r + 1] == '[') {
+            size_t k = r + 2;
+            while (k < len && (isdigit((unsigned char)s[k]) || s[k] == ';')) k++;
+            if (k < len && s[k] == 'm') {
+                r = k;
+                continue;
+            }
+        }
+        s[w++] = s[r];
+    }
+    if (w < len) s[w] = '\0';
+    return w;
+}
+
+void ui_flush(void) {
+    /* anything that still went through stdio must land first */
+    fflush(stdout);
+    if (g_frame.len == 0) return;
+
+    size_t len = g_frame.len;
+    if (!ui_color()) len = ui_strip_ansi(g_frame.data, len);
+
+    const char *p = g_frame.data;
+    g_stats.frames++;
+    g_stats.bytes += len;
+    while (len) {
+        ssize_t n = write(STDOUT_FILENO, p, len);
+        g_stats.writes++;
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;          /* stdout gone: drop the frame */
+        p += n;
+        len -= (size_t)n;
+    }
+    engine_out_reset(&g_frame);
+}
+
+UiStats ui_stats(void) {
+    return g_stats;
+}
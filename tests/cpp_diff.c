@@ -0,0 +1,313 @@
+/* Differential test: the in-process preprocessor (cpp.h) against cc -E.
+ *
+ *   cpp_diff [cc]
+ *
+ * Every case -- the corpus below, then each TASK_MACRO task of station 08
+ * -- is preprocessed both ways: cpp_macros_new() + cpp_run(), and `cc -E
+ * -P -undef -nostdinc` over the same definitions and source written to a
+ * temporary directory, headers next to them.  The outputs must hold the
+ * same tokens (whitespace aside), and a case one side rejects the other
+ * must reject too.  A memoized cpp_expand() must then hit and agree.
+ *
+ * Exits 77 (skipped) when there is no cc.  Also prints the mean time per
+ * case of cc -E, an uncached cpp_run() and a memo hit; those are for
+ * reading, not checked. */
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "cpp.h"
+#include "stations.h"
+#include "tracker.h"
+
+#define REPS 200
+
+typedef struct {
+    const char *name;
+    const char *const *defs;    /* cpp_macros_new() lines; NULL = none */
+    const char *src;
+    bool error;                 /* both sides must reject it */
+} Case;
+
+#define L TASK_LIST
+
+static const Case CASES[] = {
+    { "object", L("#define N 10", "#define M N + N"), "int a[M];", false },
+    { "function", L("#define SQ(x) x * x", "#define SQP(x) ((x) * (x))"),
+      "SQ(1 + 2) SQP(1 + 2) SQ SQ (3)", false },
+    { "nested args", L("#define f(a, b) [a|b]", "#define g(x) f(x, (x))"),
+      "f((1, 2), 3) g(f(1, 2)) f(,) f( , )", false },
+    { "rescan", L("#define AB x", "#define A() AB", "#define call(m) m()"), "call(A) A ()", false },
+    { "self", L("#define x (4 + y)", "#define y (2 * x)", "#define foo foo bar"), "x y foo", false },
+    { "blue via arg", L("#define f(a) a*g", "#define g(a) f(a)"), "f(2)(9)", false },
+    { "name only", L("#define f(x) <x>", "#define g f"), "g g(1) f f (2) (f)(3)", false },
+    { "stringize", L("#define S(x) #x", "#define X(x) S(x)", "#define V 7"),
+      "S(a  +   b) S( \"q\\\"t\" '\\\\' ) S() X(V) S(V) X(  lead   trail  )", false },
+    { "paste", L("#define C(a, b) a ## b", "#define C3(a, b, c) a ## b ## c", "#define X C(1, 2)"),
+      "C(x, y) C(x, C(1, 2)) C(,y) C(x,) C(,) C(<, <) C(-, =) C3(1, .5, e+3) C(X, Y)", false },
+    { "paste then expand", L("#define C(a, b) a ## b", "#define xy done", "#define id(x) x"),
+      "C(x, y) id(C(x, y)) C(i, d)(7)", false },
+    { "variadic", L("#define P(fmt, ...) printf(fmt, __VA_ARGS__)", "#define V(...) [__VA_ARGS__]",
+                    "#define SV(...) #__VA_ARGS__"),
+      "P(\"%d\", 1) P(\"%d %d\", 1, (2, 3)) V() V(a) V(a,b , c) SV(a,  b,c)", false },
+    { "variadic empty", L("#define E(a, ...) <a|__VA_ARGS__>"), "E(1) E(1,) E(1, 2)", false },
+    { "undef redefine", L("#define A 1", "#undef A", "#define A 2", "#define B A", "#define A 3"),
+      "A B", false },
+    { "same redefine", L("#define A (1 +  2)", "#define A (1 + 2)", "#define F(x) x", "#define F(x) x"),
+      "A F(3)", false },
+    { "directives in src", NULL, "#define T 1\nT\n#undef T\nT\n#define T 2\nT", false },
+    { "multi line call", L("#define f(a, b) a + b"), "f(1,\n 2) f\n(3, 4)", false },
+    { "splice and comments", L("#define LONG 1 + \\\n 2 /* gone */ + 3 // gone too"),
+      "LONG /* x */ a/**/b a/\\\n/ c", false },
+
+    /* C17 6.10.3.5, examples 3 to 5 and 7 */
+    { "std example 3",
+      L("#define x 3", "#define f(a) f(x * (a))", "#undef x", "#define x 2", "#define g f",
+        "#define z z[0]", "#define h g(~", "#define m(a) a(w)", "#define w 0,1", "#define t(a) a",
+        "#define p() int", "#define q(x) x", "#define r(x,y) x ## y", "#define str(x) # x"),
+      "f(y+1) + f(f(z)) % t(t(g)(0) + t)(1);\n"
+      "g(x+(3,4)-w) | h 5) & m\n(f)^m(m);\n"
+      "p() i[q()] = { q(1), r(2,3), r(4,), r(,5), r(,) };\n"
+      "char c[2][6] = { str(hello), str() };", false },
+    { "std example 4",
+      L("#define str(s) # s", "#define xstr(s) str(s)",
+        "#define debug(s, t) printf(\"x\" # s \"= %d, x\" # t \"= %s\", \\\n x ## s, x ## t)",
+        "#define INCFILE(n) vers ## n", "#define glue(a, b) a ## b", "#define xglue(a, b) glue(a, b)",
+        "#define HIGHLOW \"hello\"", "#define LOW LOW \", world\""),
+      "debug(1, 2);\n"
+      "fputs(str(strncmp(\"abc\\0d\", \"abc\", '\\4') // this goes away\n== 0) str(: @\\n), s);\n"
+      "xstr(INCFILE(2).h)\nglue(HIGH, LOW);\nxglue(HIGH, LOW)", false },
+    { "std example 5", L("#define t(x,y,z) x ## y ## z"),
+      "int j[] = { t(1,2,3), t(,4,5), t(6,,7), t(8,9,),\nt(10,,), t(,11,), t(,,12), t(,,) };", false },
+    { "std example 7",
+      L("#define debug(...) fprintf(stderr, __VA_ARGS__)", "#define showlist(...) puts(#__VA_ARGS__)",
+        "#define report(test, ...) ((test)?puts(#test):\\\n printf(__VA_ARGS__))"),
+      "debug(\"Flag\");\ndebug(\"X = %d\\n\", x);\nshowlist(The first, second, and third items.);\n"
+      "report(x>y, \"x is %d but y is %d\", x, y);", false },
+
+    { "if arithmetic", L("#define LEVEL 3", "#define ON"),
+      "#if LEVEL * 2 + 1 == 7 && defined ON && defined(LEVEL) && !defined OFF\nyes1\n#endif\n"
+      "#if (1 ? 2 : 3) == 2 && (0, 5) == 5 && -1 < 0 && ~0 == -1 && 7 / 2 == 3 && -7 % 2 == -1\nyes2\n#endif\n"
+      "#if UNKNOWN == 0 && 0x1F == 31 && 017 == 15 && 0b101 == 5 && 10L == 10 && 'a' == 97\nyes3\n#endif\n"
+      "#if '\\377' < 0 && '\\n' == 10 && '\\x41' == 65 && 'ab' == 24930\nyes4\n#endif", false },
+    { "if unsigned", NULL,
+      "#if -1 > 0u\nu1\n#endif\n#if 0xFFFFFFFFFFFFFFFF == -1\nu2\n#endif\n"
+      "#if 18446744073709551615 / 2 == 9223372036854775807\nu3\n#endif\n"
+      "#if (0 ? 1u : -1) > 0\nu4\n#endif\n#if -9223372036854775807 - 1 < 0\nu5\n#endif", false },
+    { "if shifts", NULL,
+      "#if (1 << 63) < 0 && (-16 >> 2) == -4 && (1 << 64) == 0 && (1 >> -1) == 2 && (-1 >> 70) == -1\n"
+      "s1\n#endif\n#if (1u << 63) > 0 && (8 >> 100u) == 0\ns2\n#endif", false },
+    { "if short circuit", NULL,
+      "#if 0 && 1 / 0\nno\n#elif 1 || 1 / 0\nyes\n#endif\n#if 1 ? 2 : 1 / 0\nyes2\n#endif", false },
+    { "elif chain", L("#define V 2"),
+      "#if V == 1\none\n#elif V == 2\ntwo\n#elif V == 2\nagain\n#else\nother\n#endif\n"
+      "#ifdef V\n#if 0\n#error not here\n#elif 0\n#else\nnested\n#endif\n#else\n#error nor here\n#endif\n"
+      "#ifndef V\nno\n#else\nelse\n#endif", false },
+    { "if with macros", L("#define ZERO 0", "#define F(x) (x + 1)", "#define D defined(ZERO)"),
+      "#if F(ZERO) == 1\nm1\n#endif\n#if F(F(1)) - 3\nm2\n#else\nm3\n#endif", false },
+    { "skipped garbage", NULL,
+      "#if 0\n#bogus directive\n' unterminated\n#if nested\n#else\n#endif\n#endif\nok", false },
+    { "include guard",
+      L("// guard.h\n#ifndef GUARD_H\n#define GUARD_H\nint g;\n#define G 1\n#endif\n",
+        "// once.h\n#pragma once\nint o;\n", "// plain.h\nint p;\n"),
+      "#include \"guard.h\"\n#include \"guard.h\"\n#include \"once.h\"\n#include \"once.h\"\n"
+      "#include \"plain.h\"\n#include <plain.h>\nG", false },
+    { "include nested", L("// a.h\n#define A 1\n#include \"b.h\"\n", "// b.h\nb A B\n#define B 2\n"),
+      "#include \"a.h\"\nB", false },
+    { "empty and null", L("#define E", "#define F()"), "#\n[E] [F()] E F() x\n#  \ny", false },
+    { "spacing", L("#define P +", "#define M -", "#define I(x) x"),
+      "P+ -M I(+)+ I(-)M a I(.)5 x/I(/)y", false },
+
+    { "error directive", NULL, "#error stop here", true },
+    { "unterminated call", L("#define f(x) x"), "f(1, 2", true },
+    { "too many args", L("#define f(x) x"), "f(1, 2)", true },
+    { "too few args", L("#define f(x, y) x"), "f(1)", true },
+    { "bad paste", L("#define C(a, b) a ## b"), "C(x, +)", true },
+    { "paste at edge", L("#define C(a) ## a"), "C(1)", true },
+    { "stringize non param", L("#define S(a) #b"), "S(1)", true },
+    { "unknown directive", NULL, "#frobnicate\nx", true },
+    { "else after else", NULL, "#if 1\n#else\n#else\n#endif", true },
+    { "unterminated if", NULL, "#if 1\nx", true },
+    { "stray endif", NULL, "#endif", true },
+    { "missing header", NULL, "#include \"nope.h\"", true },
+    { "divide by zero", NULL, "#if 1 / 0\n#endif", true },
+    { "float in if", NULL, "#if 1.5\n#endif", true },
+    { "defined no name", NULL, "#if defined\n#endif", true },
+    { "bad operator", NULL, "#if 1 2\n#endif", true },
+    { "unterminated comment", NULL, "x /* never closed", true },
+    { "duplicate param", L("#define f(a, a) a"), "f(1, 2)", true },
+    { "va_args outside", L("#define f(a) __VA_ARGS__ a"), "f(1)", false },
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool write_file(const char *dir, const char *name, const char *text, size_t len) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    bool ok = fwrite(text, 1, len, f) == len && fputc('\n', f) != EOF;
+    return fclose(f) == 0 && ok;
+}
+
+/* cc -E over the case; false when cc rejected it.  out gets its output,
+ * or its first error when it did. */
+static bool run_cc(const char *cc, const char *dir, const Case *c, char *out, size_t cap) {
+    char main_c[4096];
+    size_t n = 0;
+    for (int i = 0; c->defs && c->defs[i]; ++i) {
+        const char *d = c->defs[i];
+        if (cpp_is_header(d)) {
+            const char *nl = strchr(d, '\n');
+            char name[CPP_NAME];
+            snprintf(name, sizeof(name), "%.*s", (int)(nl - d - 2), d + 2);
+            char *p = name;
+            while (*p == ' ') p++;
+            write_file(dir, p, nl + 1, strlen(nl + 1));
+        } else {
+            n += (size_t)snprintf(main_c + n, sizeof(main_c) - n, "%s\n", d);
+        }
+    }
+    snprintf(main_c + n, sizeof(main_c) - n, "%s", c->src);
+    write_file(dir, "main.c", main_c, strlen(main_c));
+
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "cd '%s' && %s -E -P -undef -nostdinc -std=c17 -I. main.c 2>err.txt",
+             dir, cc);
+    FILE *p = popen(cmd, "r");
+    if (!p) return false;
+    size_t len = fread(out, 1, cap - 1, p);
+    out[len] = '\0';
+    if (pclose(p) == 0) return true;
+
+    char path[256], line[512];
+    snprintf(path, sizeof(path), "%s/err.txt", dir);
+    FILE *f = fopen(path, "r");
+    out[0] = '\0';
+    while (f && fgets(line, sizeof(line), f)) {
+        if (strstr(line, "error:")) {
+            snprintf(out, cap, "%s", line);
+            break;
+        }
+    }
+    if (f) fclose(f);
+    return false;
+}
+
+static void remove_files(const char *dir, const Case *c) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/main.c", dir);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/err.txt", dir);
+    remove(path);
+    for (int i = 0; c->defs && c->defs[i]; ++i) {
+        if (!cpp_is_header(c->defs[i])) continue;
+        const char *d = c->defs[i] + 2, *nl = strchr(d, '\n');
+        while (*d == ' ') d++;
+        snprintf(path, sizeof(path), "%s/%.*s", dir, (int)(nl - d), d);
+        remove(path);
+    }
+}
+
+/* Ours: definitions, then the source against them. */
+static bool run_ours(const Case *c, CppMacros **m, CppResult *r) {
+    *m = cpp_macros_new(c->defs, r->error, sizeof(r->error));
+    return *m && cpp_run(*m, c->src, r);
+}
+
+static void show(const char *label, const char *text) {
+    printf("    %s:\n", label);
+    for (const char *p = text; *p;) {
+        int n = (int)strcspn(p, "\n");
+        printf("      | %.*s\n", n, p);
+        p += n + (p[n] == '\n');
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *cc = argc > 1 ? argv[1] : "cc";
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "%s --version >/dev/null 2>&1", cc);
+    if (system(cmd) != 0) {
+        printf("no %s here; skipped\n", cc);
+        return 77;
+    }
+    char dir[] = "/tmp/cpp_diffXXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    /* the corpus, then station 08's macro tasks */
+    enum { NCORPUS = sizeof(CASES) / sizeof(CASES[0]) };
+    Case cases[NCORPUS + 32];
+    char names[32][24];
+    int ncases = 0;
+    for (int i = 0; i < NCORPUS; ++i) cases[ncases++] = CASES[i];
+    for (int i = 0; i < BANK_PREPROCESSOR.count && i < 32; ++i) {
+        const Task *t = &BANK_PREPROCESSOR.tasks[i];
+        if (t->type != TASK_MACRO) continue;
+        snprintf(names[i], sizeof(names[i]), "station 08 task %d", i + 1);
+        cases[ncases++] = (Case){ names[i], t->options, t->answers[0], false };
+    }
+
+    int failures = 0;
+    uint64_t cc_ns = 0, run_ns = 0, hit_ns = 0;
+    static char theirs[8192];
+    for (int i = 0; i < ncases; ++i) {
+        const Case *c = &cases[i];
+        uint64_t t0 = now_ns();
+        bool cc_ok = run_cc(cc, dir, c, theirs, sizeof(theirs));
+        cc_ns += now_ns() - t0;
+        remove_files(dir, c);
+
+        CppMacros *m;
+        static CppResult r, again;
+        bool ok = run_ours(c, &m, &r);
+        const char *verdict = NULL;
+        if (ok != cc_ok) verdict = ok ? "cc rejects it, we accept it" : "we reject it, cc accepts it";
+        else if (ok == c->error) verdict = c->error ? "both accept it" : "both reject it";
+        else if (ok && !cpp_same_tokens(r.text, theirs, NULL)) verdict = "outputs differ";
+        if (verdict) {
+            failures++;
+            printf("FAIL %s: %s\n", c->name, verdict);
+            show("ours", ok ? r.text : r.error);
+            show("cc -E", theirs);
+        }
+
+        if (m) {
+            t0 = now_ns();
+            for (int k = 0; k < REPS; ++k) cpp_run(m, c->src, &again);
+            run_ns += (now_ns() - t0) / REPS;
+
+            CppMemoStats before = cpp_memo_stats();
+            cpp_expand(m, c->src, &again);      /* miss: fills the slot */
+            t0 = now_ns();
+            for (int k = 0; k < REPS; ++k) cpp_expand(m, c->src, &again);
+            hit_ns += (now_ns() - t0) / REPS;
+            CppMemoStats after = cpp_memo_stats();
+            if (after.hits - before.hits != REPS || again.ok != r.ok || strcmp(again.text, r.text) != 0) {
+                failures++;
+                printf("FAIL %s: the memo did not hit or did not agree\n", c->name);
+            }
+        }
+        cpp_macros_free(m);
+    }
+    rmdir(dir);
+
+    CppMemoStats st = cpp_memo_stats();
+    printf("%d cases, %d failures\n", ncases, failures);
+    printf("mean per case: cc -E %.1f us, cpp_run %.2f us, memo hit %.2f us\n",
+           (double)cc_ns / ncases / 1e3, (double)run_ns / ncases / 1e3, (double)hit_ns / ncases / 1e3);
+    printf("memo: %llu hits, %llu misses, %u entries\n", (unsigned long long)st.hits,
+           (unsigned long long)st.misses, st.entries);
+
+    cpp_memo_clear();
+    if (tracker_report_leaks(stdout) > 0) failures++;
+    return failures ? 1 : 0;
+}
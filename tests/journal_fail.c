@@ -0,0 +1,121 @@
+/* Failure test: the progress journal (journal.h) while its disk is full.
+ *
+ *   journal_fail
+ *
+ * Opens a journal in a fresh temporary directory, then puts /dev/full
+ * under its descriptor so every commit fails with ENOSPC, and appends
+ * many batches' worth of score, attempt and completion records, as a
+ * long session would.  The real file then goes back under the descriptor.
+ * After one commit and a reopen, the recovered state must equal the last
+ * values appended.  Run it under ASan to see the buffer stay in bounds.
+ *
+ * Prints "N cases, M failures" and exits 1 on any failure or leak. */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "journal.h"
+#include "tracker.h"
+
+#define APPENDS 2000
+
+/* The descriptor this process holds on <dir>/progress.journal, or -1. */
+static int journal_fd(const char *dir) {
+    char want[512], link[512], path[64];
+    snprintf(want, sizeof(want), "%s/progress.journal", dir);
+    for (int fd = 3; fd < 256; ++fd) {
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        ssize_t n = readlink(path, link, sizeof(link) - 1);
+        if (n > 0 && (link[n] = '\0', strcmp(link, want) == 0)) return fd;
+    }
+    return -1;
+}
+
+static bool same_state(const GameState *a, const GameState *b) {
+    bool same = a->total_score == b->total_score;
+    for (int i = 0; i < STATION_COUNT; ++i) {
+        same = same && a->station_scores[i] == b->station_scores[i] &&
+               a->completed[i] == b->completed[i] && a->attempted[i] == b->attempted[i];
+    }
+    return same;
+}
+
+static void remove_state(const char *dir) {
+    static const char *const FILES[] = { "progress.snap", "progress.journal", "progress.snap.tmp" };
+    char path[512];
+    for (size_t i = 0; i < sizeof(FILES) / sizeof(FILES[0]); ++i) {
+        snprintf(path, sizeof(path), "%s/%s", dir, FILES[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+int main(void) {
+    char dir[] = "/tmp/journal_fail.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    GameState g, want;
+    memset(&want, 0, sizeof(want));
+    int failures = 0, cases = 0;
+
+    Journal *j = journal_open(dir, &g);
+    int fd = j ? journal_fd(dir) : -1;
+    int saved = fd >= 0 ? dup(fd) : -1;
+    int full = open("/dev/full", O_WRONLY | O_CLOEXEC);
+    if (!j || saved < 0 || full < 0 || dup2(full, fd) < 0) {
+        printf("FAIL setup (journal %p, fd %d, /dev/full %d)\n", (void *)j, fd, full);
+        remove_state(dir);
+        return 1;
+    }
+    close(full);
+
+    uint64_t x = 0x10u;
+    for (int i = 0; i < APPENDS; ++i) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        int station = (int)(x >> 33) % STATION_COUNT, value = (int)(x >> 45) % 100;
+        switch (i % 3) {
+            case 0:
+                want.total_score += value - want.station_scores[station];
+                want.station_scores[station] = value;
+                journal_append(j, JR_SCORE, station, value);
+                break;
+            case 1:
+                want.attempted[station] = value;
+                journal_append(j, JR_ATTEMPTED, station, value);
+                break;
+            default:
+                want.completed[station] = value & 1;
+                journal_append(j, JR_COMPLETED, station, value & 1);
+                break;
+        }
+    }
+    cases++;
+    if (journal_commit(j) == OK) {
+        printf("FAIL commit succeeded on /dev/full\n");
+        failures++;
+    }
+
+    dup2(saved, fd);
+    close(saved);
+    cases++;
+    if (journal_commit(j) != OK) {
+        printf("FAIL commit after the disk came back\n");
+        failures++;
+    }
+    journal_close(j);
+
+    j = journal_open(dir, &g);
+    cases++;
+    if (!j || !same_state(&g, &want)) {
+        printf("FAIL recovered state differs from the last values appended\n");
+        failures++;
+    }
+    journal_close(j);
+    remove_state(dir);
+
+    printf("%d cases, %d failures\n", cases, failures);
+    if (tracker_report_leaks(stdout) > 0) failures++;
+    return failures ? 1 : 0;
+}
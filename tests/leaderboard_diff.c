@@ -0,0 +1,185 @@
+/* Differential test: the skip-list leaderboard (leaderboard.h) against a
+ * sorted array rebuilt from scratch.
+ *
+ *   leaderboard_diff [ops] [seed]
+ *
+ * Learners join and get random station scores (few distinct values, so
+ * ties are common; now and then out of range or back to 0) while a plain
+ * table mirrors every lb_set().  Every so often each board is sorted by
+ * (score desc, learner asc) and compared: its size, every learner's
+ * score and competition rank, lb_top() from random places and lb_around()
+ * for random learners and radii.
+ *
+ * Prints "N cases, M failures" and exits 1 on any failure or leak. */
+#include "common.h"
+#include "leaderboard.h"
+#include "tracker.h"
+
+#define LEARNERS 3000
+#define CHECK_EVERY 2500
+#define LIST_MAX 64
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static size_t below(size_t n) {
+    return (size_t)(rng() % n);
+}
+
+static int32_t scores[LEARNERS][STATION_COUNT];
+static uint32_t order[LEARNERS];
+static int sort_board;
+
+static int32_t ref_score(uint32_t learner, int board) {
+    if (board != LB_OVERALL) return scores[learner][board - 1];
+    int32_t total = 0;
+    for (int s = 0; s < STATION_COUNT; ++s) total += scores[learner][s];
+    return total;
+}
+
+static int by_place(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    int32_t sx = ref_score(x, sort_board), sy = ref_score(y, sort_board);
+    if (sx != sy) return sx > sy ? -1 : 1;
+    return (x > y) - (x < y);
+}
+
+/* The board's learners in place order; competition rank of order[i] is
+ * ranks[i]. */
+static uint32_t ref_board(int board, uint32_t count, uint32_t *ranks) {
+    uint32_t n = 0;
+    for (uint32_t l = 0; l < count; ++l) {
+        if (board == LB_OVERALL || scores[l][board - 1] > 0) order[n++] = l;
+    }
+    sort_board = board;
+    qsort(order, n, sizeof(*order), by_place);
+    for (uint32_t i = 0; i < n; ++i) {
+        bool tie = i > 0 && ref_score(order[i], board) == ref_score(order[i - 1], board);
+        ranks[i] = tie ? ranks[i - 1] : i + 1;
+    }
+    return n;
+}
+
+static int check_list(const char *what, int board, const LbEntry *got, size_t got_n,
+                      uint32_t first, size_t want_n, const uint32_t *ranks) {
+    if (got_n != want_n) {
+        printf("FAIL %s board %d from %u: %zu entries, want %zu\n", what, board, first, got_n,
+               want_n);
+        return 1;
+    }
+    for (size_t i = 0; i < got_n; ++i) {
+        uint32_t p = first - 1 + (uint32_t)i;
+        if (got[i].learner != order[p] || got[i].score != ref_score(order[p], board) ||
+            got[i].rank != ranks[p]) {
+            printf("FAIL %s board %d place %u: learner %u score %d rank %u, want %u %d %u\n",
+                   what, board, p + 1, got[i].learner, got[i].score, got[i].rank, order[p],
+                   ref_score(order[p], board), ranks[p]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_boards(const Leaderboard *lb, uint32_t count, int *cases) {
+    static uint32_t ranks[LEARNERS];
+    static uint32_t place[LEARNERS];
+    LbEntry list[LIST_MAX];
+    int failures = 0;
+
+    for (int board = 0; board < LB_BOARDS; ++board) {
+        uint32_t n = ref_board(board, count, ranks);
+        (*cases)++;
+        if (lb_size(lb, board) != n) {
+            printf("FAIL size board %d: %u, want %u\n", board, lb_size(lb, board), n);
+            failures++;
+            continue;
+        }
+        for (uint32_t i = 0; i < n; ++i) place[order[i]] = i;
+        for (uint32_t l = 0; l < count; ++l) {
+            bool on = board == LB_OVERALL || scores[l][board - 1] > 0;
+            uint32_t want = on ? ranks[place[l]] : 0;
+            (*cases)++;
+            if (lb_score(lb, board, l) != ref_score(l, board) || lb_rank(lb, board, l) != want) {
+                if (failures++ < 10) {
+                    printf("FAIL rank board %d learner %u: score %d rank %u, want %d %u\n", board,
+                           l, lb_score(lb, board, l), lb_rank(lb, board, l), ref_score(l, board),
+                           want);
+                }
+            }
+        }
+        for (int q = 0; q < 8; ++q) {
+            uint32_t first = 1 + (uint32_t)below(n + 2);
+            size_t max = 1 + below(LIST_MAX);
+            size_t want = first > n ? 0 : n - first + 1 < max ? n - first + 1 : max;
+            (*cases)++;
+            failures += check_list("top", board, list, lb_top(lb, board, first, list, max),
+                                   first, want, ranks);
+        }
+        for (int q = 0; q < 8 && n > 0; ++q) {
+            uint32_t l = order[below(n)], radius = (uint32_t)below(LIST_MAX / 2);
+            uint32_t p = place[l] + 1, first = p > radius ? p - radius : 1;
+            uint32_t last = p + radius < n ? p + radius : n;
+            size_t max = 1 + below(LIST_MAX);
+            size_t want = last - first + 1 < max ? last - first + 1 : max;
+            (*cases)++;
+            failures += check_list("around", board, list,
+                                   lb_around(lb, board, l, radius, list, max), first, want,
+                                   ranks);
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    int ops = argc > 1 ? atoi(argv[1]) : 100000;
+    rng_state = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x1eadull;
+
+    Leaderboard *lb = lb_new();
+    if (!lb) {
+        printf("FAIL out of memory\n");
+        return 1;
+    }
+    int failures = 0, cases = 0;
+    uint32_t count = 0;
+    for (int op = 1; op <= ops; ++op) {
+        if (count < LEARNERS && (count < 2 || below(8) == 0)) {
+            char name[LB_NAME_MAX + 8];
+            snprintf(name, sizeof(name), "learner-with-a-long-name-%u", count);
+            cases++;
+            if (lb_join(lb, name) != (int32_t)count ||
+                strncmp(lb_name(lb, count), name, LB_NAME_MAX - 1) != 0) {
+                printf("FAIL join %u\n", count);
+                failures++;
+            }
+            count++;
+        } else {
+            uint32_t l = (uint32_t)below(count);
+            int station = (int)below(STATION_COUNT);
+            int score = below(5) == 0 ? 0 : 1 + (int)below(12);
+            if (below(50) == 0) score = below(2) ? -(int)below(100) : UINT16_MAX + (int)below(100);
+            cases++;
+            if (lb_set(lb, l, station, score) != OK) {
+                printf("FAIL set learner %u station %d score %d\n", l, station, score);
+                failures++;
+            }
+            scores[l][station] = score < 0 ? 0 : score > UINT16_MAX ? UINT16_MAX : score;
+        }
+        if (op % CHECK_EVERY == 0 || op == ops) failures += check_boards(lb, count, &cases);
+    }
+    cases += 2;
+    if (lb_set(lb, count, 0, 1) == OK || lb_set(lb, 0, STATION_COUNT, 1) == OK) {
+        printf("FAIL set accepted an unknown learner or station\n");
+        failures++;
+    }
+    lb_free(lb);
+
+    printf("%d cases, %d failures\n", cases, failures);
+    if (tracker_report_leaks(stdout) > 0) failures++;
+    return failures ? 1 : 0;
+}
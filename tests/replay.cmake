@@ -0,0 +1,62 @@
+# Golden-path replay: feeds SCRIPT to ARCADE on stdin and compares the
+# transcript (stdout + stderr, colors stripped) with GOLDEN.
+#
+#   cmake -DARCADE=<c_arcade> -DSCRIPT=<script> -DGOLDEN=<transcript>
+#         [-DACTUAL=<file>] [-DRECORD=<file.rec>] [-DUPDATE=ON] -P replay.cmake
+#
+# UPDATE=ON rewrites GOLDEN from the current build instead of comparing.
+# RECORD also records the run there and then checks that `--replay` of
+# that log dispatches and grades every line the same way.
+
+foreach(var ARCADE SCRIPT GOLDEN)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "replay.cmake: -D${var}=... is required")
+    endif()
+endforeach()
+
+set(record off)
+if(DEFINED RECORD AND NOT UPDATE)
+    file(REMOVE ${RECORD})
+    set(record ${RECORD})
+endif()
+
+set(ENV{NO_COLOR} 1)
+execute_process(
+        COMMAND ${ARCADE} --record ${record}
+        INPUT_FILE ${SCRIPT}
+        OUTPUT_VARIABLE transcript
+        ERROR_VARIABLE transcript
+        RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${ARCADE} exited with ${rc}")
+endif()
+
+string(ASCII 27 esc)
+string(REGEX REPLACE "${esc}\\[[0-9;]*m" "" transcript "${transcript}")
+
+if(UPDATE)
+    file(WRITE ${GOLDEN} "${transcript}")
+    message(STATUS "golden transcript updated: ${GOLDEN}")
+    return()
+endif()
+
+file(READ ${GOLDEN} expected)
+if(NOT transcript STREQUAL expected)
+    if(NOT DEFINED ACTUAL)
+        set(ACTUAL ${GOLDEN}.actual)
+    endif()
+    file(WRITE ${ACTUAL} "${transcript}")
+    message(FATAL_ERROR "transcript differs from golden; compare with\n"
+            "  diff ${GOLDEN} ${ACTUAL}")
+endif()
+
+if(NOT record STREQUAL "off")
+    execute_process(
+            COMMAND ${ARCADE} --replay ${record}
+            OUTPUT_QUIET
+            ERROR_VARIABLE replayed
+            RESULT_VARIABLE rc)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "replay of ${record} differs:\n${replayed}")
+    endif()
+endif()
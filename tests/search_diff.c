@@ -0,0 +1,293 @@
+/* Differential test: the inverted index behind `find` (search.h) against
+ * scoring every document in a linear scan.
+ *
+ *   search_diff [queries] [seed]
+ *
+ * Random documents are drawn from a skewed vocabulary: mixed case, digits
+ * and '_', one-letter and over-long words, a hundred words sharing one
+ * prefix (more than SEARCH_EXPAND_MAX), NULL and empty texts.  The
+ * reference tokenizes them with its own loop, keeps a sorted dictionary and
+ * per-document term counts, and for each query applies the rules search.h
+ * states: exact terms at full weight, the first SEARCH_EXPAND_MAX dictionary
+ * terms from the prefix's place at SEARCH_PREFIX_WEIGHT, BM25 (k1 = 1.2,
+ * b = 0.75) summed per document.  The hits must have the reference's best
+ * scores in order (within float rounding), each hit's key must name a
+ * document with that score, and the count must match.
+ *
+ * Prints "N cases, M failures" and exits 1 on any failure or leak. */
+#include <math.h>
+
+#include "common.h"
+#include "search.h"
+#include "tracker.h"
+
+#define DOCS      500
+#define VOCAB     400
+#define SHARED    100               /* vocabulary words starting "pre" */
+#define WORD_MAX  40
+#define DOC_WORDS 60
+#define HITS      12
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static size_t below(size_t n) {
+    return (size_t)(rng() % n);
+}
+
+static char vocab[VOCAB][WORD_MAX + 1];
+
+/* Reference index: sorted dictionary, and per document (term, count)
+ * pairs in first-seen order. */
+static char terms[DOCS * DOC_WORDS][SEARCH_TOKEN_MAX + 1];
+static uint32_t nterms;
+static uint32_t doc_terms[DOCS][DOC_WORDS], doc_tf[DOCS][DOC_WORDS], doc_n[DOCS], doc_len[DOCS];
+static uint32_t df[DOCS * DOC_WORDS];
+static float ref_score[DOCS];
+
+static void make_vocab(void) {
+    static const char CHARS[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+    for (int i = 0; i < VOCAB; ++i) {
+        size_t len = i < SHARED ? 4 + below(6) : 1 + below(below(10) ? 10 : WORD_MAX);
+        for (size_t k = 0; k < len; ++k) {
+            vocab[i][k] = CHARS[below(k == 0 || below(4) ? 26 : sizeof(CHARS) - 1)];
+        }
+        if (i < SHARED) memcpy(vocab[i], "pre", 3);
+        vocab[i][len] = '\0';
+    }
+}
+
+/* Squaring a uniform draw skews it toward the first words. */
+static const char *pick_word(void) {
+    uint64_t r = below(1u << 16);
+    return vocab[r * r * VOCAB >> 32];
+}
+
+static void random_text(char *s, size_t cap) {
+    static const char *const SEPS[] = { " ", " ", ", ", "(", "->", "\n", " - ", "*" };
+    size_t n = 0, words = below(DOC_WORDS / 3);
+    for (size_t w = 0; w < words; ++w) {
+        const char *word = pick_word(), *sep = SEPS[below(8)];
+        if (n + strlen(word) + strlen(sep) + 1 > cap) break;
+        bool upper = below(5) == 0;
+        for (const char *p = word; *p; ++p) s[n++] = upper ? (char)toupper((unsigned char)*p) : *p;
+        for (const char *p = sep; *p; ++p) s[n++] = *p;
+    }
+    s[n] = '\0';
+}
+
+static int cmp_term(const void *a, const void *b) {
+    return strcmp(a, b);
+}
+
+static int64_t find_term(const char *w) {
+    char (*t)[SEARCH_TOKEN_MAX + 1] = bsearch(w, terms, nterms, sizeof(terms[0]), cmp_term);
+    return t ? t - terms : -1;
+}
+
+/* Words of letters, digits and '_', lower-cased, cut at SEARCH_TOKEN_MAX,
+ * at least two characters; fn is called on each. */
+static void tokenize(const char *s, void (*fn)(const char *, void *), void *ctx) {
+    while (*s) {
+        if (!isalnum((unsigned char)*s) && *s != '_') {
+            s++;
+            continue;
+        }
+        char tok[SEARCH_TOKEN_MAX + 1];
+        size_t n = 0;
+        for (; isalnum((unsigned char)*s) || *s == '_'; ++s) {
+            if (n < SEARCH_TOKEN_MAX) tok[n++] = (char)tolower((unsigned char)*s);
+        }
+        tok[n] = '\0';
+        if (n >= 2) fn(tok, ctx);
+    }
+}
+
+static void collect(const char *tok, void *ctx) {
+    (void)ctx;
+    memcpy(terms[nterms++], tok, SEARCH_TOKEN_MAX + 1);
+}
+
+static void count_term(const char *tok, void *ctx) {
+    uint32_t d = *(uint32_t *)ctx, t = (uint32_t)find_term(tok), i = 0;
+    while (i < doc_n[d] && doc_terms[d][i] != t) i++;
+    if (i == doc_n[d]) {
+        doc_terms[d][doc_n[d]++] = t;
+        doc_tf[d][i] = 0;
+        df[t]++;
+    }
+    doc_tf[d][i]++;
+    doc_len[d]++;
+}
+
+static uint32_t tf_of(uint32_t d, uint32_t t) {
+    for (uint32_t i = 0; i < doc_n[d]; ++i) {
+        if (doc_terms[d][i] == t) return doc_tf[d][i];
+    }
+    return 0;
+}
+
+typedef struct {
+    uint32_t term;
+    float weight;
+} RefTerm;
+
+static size_t ref_query_terms(const char *query, RefTerm *q) {
+    size_t nq = 0;
+    int words = 0;
+    const char *s = query;
+    while (*s && words < SEARCH_QUERY_TERMS) {
+        if (!isalnum((unsigned char)*s) && *s != '_') {
+            s++;
+            continue;
+        }
+        char tok[SEARCH_TOKEN_MAX + 1];
+        size_t n = 0;
+        for (; isalnum((unsigned char)*s) || *s == '_'; ++s) {
+            if (n < SEARCH_TOKEN_MAX) tok[n++] = (char)tolower((unsigned char)*s);
+        }
+        tok[n] = '\0';
+        if (n < 2) continue;
+        words++;
+        int64_t exact = find_term(tok);
+        if (exact >= 0) q[nq++] = (RefTerm){ (uint32_t)exact, 1.0f };
+        if (n < SEARCH_PREFIX_MIN) continue;
+        uint32_t i = 0;
+        while (i < nterms && strcmp(terms[i], tok) < 0) i++;
+        for (int k = 0; i < nterms && k < SEARCH_EXPAND_MAX; ++i, ++k) {
+            if (strncmp(terms[i], tok, n) != 0) break;
+            if ((int64_t)i != exact) q[nq++] = (RefTerm){ i, SEARCH_PREFIX_WEIGHT };
+        }
+    }
+    return nq;
+}
+
+static bool close_to(float a, float b) {
+    return fabsf(a - b) <= 1e-5f * fmaxf(fabsf(a), fabsf(b));
+}
+
+static int cmp_desc(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x < y) - (x > y);
+}
+
+static void random_query(char *s, size_t cap) {
+    size_t n = 0, words = 1 + below(below(3) ? 1 : SEARCH_QUERY_TERMS + 2);
+    for (size_t w = 0; w < words && n + WORD_MAX + 2 < cap; ++w) {
+        /* "pre" expands to more terms than the cap; "zzqx" is a miss */
+        const char *word = below(10) ? pick_word() : below(2) ? "pre" : "zzqx";
+        size_t len = strlen(word);
+        if (below(3) == 0 && len > 1) len = 1 + below(len);        /* a prefix */
+        memcpy(s + n, word, len);
+        n += len;
+        s[n++] = below(4) ? ' ' : ',';
+    }
+    s[n] = '\0';
+}
+
+int main(int argc, char **argv) {
+    int queries = argc > 1 ? atoi(argv[1]) : 3000;
+    rng_state = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x5ea7c4ull;
+    make_vocab();
+
+    static char text[DOCS][3][DOC_WORDS * 6];
+    SearchIndex *ix = search_new();
+    if (!ix) {
+        printf("FAIL out of memory\n");
+        return 1;
+    }
+    int failures = 0, cases = 0;
+    for (uint32_t d = 0; d < DOCS; ++d) {
+        const char *texts[3];
+        for (int i = 0; i < 3; ++i) {
+            random_text(text[d][i], sizeof(text[d][i]));
+            texts[i] = below(8) ? text[d][i] : NULL;
+            if (texts[i]) tokenize(texts[i], collect, NULL);
+        }
+        if (search_add(ix, 1000 + 3 * d, texts, 3) != OK) failures++;
+        for (int i = 0; i < 3; ++i) {
+            if (!texts[i]) text[d][i][0] = '\0';
+        }
+    }
+    if (search_finish(ix) != OK) failures++;
+
+    qsort(terms, nterms, sizeof(terms[0]), cmp_term);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < nterms; ++i) {
+        if (!unique || strcmp(terms[unique - 1], terms[i]) != 0) {
+            memmove(terms[unique++], terms[i], sizeof(terms[0]));
+        }
+    }
+    nterms = unique;
+    uint64_t total = 0;
+    for (uint32_t d = 0; d < DOCS; ++d) {
+        for (int i = 0; i < 3; ++i) tokenize(text[d][i], count_term, &d);
+        total += doc_len[d];
+    }
+    cases += 2;
+    if (search_docs(ix) != DOCS || search_terms(ix) != nterms) {
+        printf("FAIL sizes: %u docs, %u terms; want %u, %u\n", search_docs(ix),
+               search_terms(ix), DOCS, nterms);
+        failures++;
+    }
+
+    float mean = (float)total / (float)DOCS;
+    static RefTerm q[SEARCH_QUERY_TERMS * (1 + SEARCH_EXPAND_MAX)];
+    for (int k = 0; k < queries; ++k) {
+        char query[SEARCH_QUERY_TERMS * 3 * (WORD_MAX + 2)];
+        random_query(query, sizeof(query));
+        size_t nq = ref_query_terms(query, q);
+
+        size_t want = 0;
+        for (uint32_t d = 0; d < DOCS; ++d) {
+            float s = 0;
+            for (size_t i = 0; i < nq; ++i) {
+                float tf = (float)tf_of(d, q[i].term);
+                if (tf == 0) continue;
+                float idf = logf(1.0f + ((float)DOCS - (float)df[q[i].term] + 0.5f) /
+                                        ((float)df[q[i].term] + 0.5f));
+                float norm = 1.2f * (1.0f - 0.75f + 0.75f * (float)doc_len[d] / mean);
+                s += q[i].weight * idf * (tf * (1.2f + 1) / (tf + norm));
+            }
+            ref_score[d] = s;
+            if (s > 0) want++;
+        }
+        static float best[DOCS];
+        memcpy(best, ref_score, sizeof(best));
+        qsort(best, DOCS, sizeof(best[0]), cmp_desc);
+
+        SearchHit hits[HITS];
+        size_t max = 1 + below(HITS);
+        if (want > max) want = max;
+        size_t got = search_query(ix, query, hits, max);
+        cases++;
+        const char *what = NULL;
+        bool seen[DOCS] = { false };
+        for (size_t i = 0; i < got && !what; ++i) {
+            uint32_t d = (hits[i].key - 1000) / 3;
+            if (hits[i].key < 1000 || (hits[i].key - 1000) % 3 || d >= DOCS || seen[d]) {
+                what = "key";
+            } else if (!close_to(hits[i].score, ref_score[d])) {
+                what = "score of the document";
+            } else if (!close_to(hits[i].score, best[i])) {
+                what = "order";
+            }
+            if (d < DOCS) seen[d] = true;
+        }
+        if (!what && got != want) what = "count";
+        if (what && failures++ < 10) {
+            printf("FAIL \"%s\": %s (%zu hits, want %zu)\n", query, what, got, want);
+        }
+    }
+    search_free(ix);
+
+    printf("%d cases, %d failures\n", cases, failures);
+    if (tracker_report_leaks(stdout) > 0) failures++;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+/* Differential test: every instruction set of the string kernels
+ * (strkern.h) against plain byte loops.
+ *
+ *   strkern_diff [cases] [seed]
+ *
+ * Each case is a random buffer (whitespace, line ends, '\0', both cases
+ * and high bytes) of 0..300 bytes at a random misalignment, copied into a
+ * block of exactly that size so an ASan build catches a read past s + n.
+ * eol, span_space, span_word and rspan_space must return the reference
+ * length; lower must produce the same bytes (in place and into a second
+ * buffer); casecmp must agree in sign on the buffer against a copy with
+ * random case flips and at most one changed byte.
+ *
+ * ISAs the build or CPU lacks are listed as skipped.  Prints "N cases, M
+ * failures" and exits 1 on any failure or leak. */
+#include "common.h"
+#include "strkern.h"
+#include "tracker.h"
+
+#define LEN_MAX 300
+#define ALIGN   64
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static size_t below(size_t n) {
+    return (size_t)(rng() % n);
+}
+
+static bool is_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static unsigned char fold(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + 32) : c;
+}
+
+static size_t ref_eol(const char *s, size_t n) {
+    size_t i = 0;
+    while (i < n && s[i] != '\0' && s[i] != '\n' && s[i] != '\r') i++;
+    return i;
+}
+
+static size_t ref_span(const char *s, size_t n, bool space) {
+    size_t i = 0;
+    while (i < n && is_space((unsigned char)s[i]) == space) i++;
+    return i;
+}
+
+static size_t ref_rspan_space(const char *s, size_t n) {
+    size_t i = n;
+    while (i > 0 && is_space((unsigned char)s[i - 1])) i--;
+    return n - i;
+}
+
+static int ref_casecmp(const char *a, const char *b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        int d = fold((unsigned char)a[i]) - fold((unsigned char)b[i]);
+        if (d) return d;
+    }
+    return 0;
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+/* Long runs of one class, so every kernel sees both whole-vector hits and
+ * matches that land in the scalar tail. */
+static void random_text(char *s, size_t n) {
+    static const char SPACE[] = " \t\n\v\f\r";
+    size_t i = 0;
+    while (i < n) {
+        size_t run = 1 + below(below(4) ? 8 : 80);
+        int kind = (int)below(8);
+        for (; run > 0 && i < n; --run, ++i) {
+            switch (kind) {
+                case 0:  s[i] = SPACE[below(below(3) ? 2 : 6)]; break;
+                case 1:  s[i] = (char)('A' + below(26)); break;
+                case 2:  s[i] = (char)(0x80 + below(128)); break;
+                case 3:  s[i] = below(40) ? (char)('a' + below(26)) : '\0'; break;
+                default: s[i] = (char)(below(2) ? 'a' + below(26) : 0x20 + below(95)); break;
+            }
+        }
+    }
+}
+
+static int check_isa(FpkIsa isa, const StrKernels *k, int cases) {
+    static char pool[LEN_MAX + ALIGN], other[LEN_MAX], want[LEN_MAX];
+    int failures = 0;
+
+#define EXPECT(cond, what)                                                   \
+    do {                                                                     \
+        if (!(cond) && failures++ < 10) {                                    \
+            printf("FAIL %s %s: length %zu offset %zu\n",                    \
+                   fpk_isa_name(isa), (what), n, off);                       \
+        }                                                                    \
+    } while (0)
+
+    for (int c = 0; c < cases; ++c) {
+        size_t n = below(5) ? below(LEN_MAX / 4) : below(LEN_MAX + 1);
+        size_t off = below(ALIGN);
+        random_text(pool + off, n);
+        char *s = tracked_malloc(n ? n : 1);
+        char *dst = tracked_malloc(n ? n : 1);
+        if (!s || !dst) {
+            printf("FAIL out of memory\n");
+            tracked_free(s);
+            tracked_free(dst);
+            return failures + 1;
+        }
+        memcpy(s, pool + off, n);
+
+        EXPECT(k->eol(s, n) == ref_eol(s, n), "eol");
+        EXPECT(k->span_space(s, n) == ref_span(s, n, true), "span_space");
+        EXPECT(k->span_word(s, n) == ref_span(s, n, false), "span_word");
+        EXPECT(k->rspan_space(s, n) == ref_rspan_space(s, n), "rspan_space");
+
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char ch = (unsigned char)s[i];
+            other[i] = (char)(ch >= 'a' && ch <= 'z' && below(2) ? ch - 32 : ch);
+            want[i] = (char)fold(ch);
+        }
+        if (n > 0 && below(2)) other[below(n)] = (char)below(256);
+        EXPECT(sign(k->casecmp(s, other, n)) == sign(ref_casecmp(s, other, n)), "casecmp");
+        EXPECT(sign(k->casecmp(other, s, n)) == sign(ref_casecmp(other, s, n)), "casecmp");
+
+        k->lower(dst, s, n);
+        EXPECT(memcmp(dst, want, n) == 0, "lower");
+        EXPECT(memcmp(s, pool + off, n) == 0, "lower (source)");
+        k->lower(s, s, n);
+        EXPECT(memcmp(s, want, n) == 0, "lower (in place)");
+
+        tracked_free(s);
+        tracked_free(dst);
+    }
+#undef EXPECT
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    int cases = argc > 1 ? atoi(argv[1]) : 100000;
+    rng_state = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x57e4ull;
+
+    int failures = 0, total = 0;
+    for (int isa = 0; isa < FPK_ISAS; ++isa) {
+        const StrKernels *k = strk_kernels((FpkIsa)isa);
+        if (!k) {
+            printf("%s: skipped\n", fpk_isa_name((FpkIsa)isa));
+            continue;
+        }
+        failures += check_isa((FpkIsa)isa, k, cases);
+        total += cases;
+    }
+
+    printf("%d cases, %d failures\n", total, failures);
+    if (tracker_report_leaks(stdout) > 0) failures++;
+    return failures ? 1 : 0;
+}
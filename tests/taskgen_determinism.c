@@ -0,0 +1,97 @@
+/* Determinism test: parametric tasks (taskgen.h) depend on nothing but
+ * (template, seed).
+ *
+ *   taskgen_determinism [seeds]
+ *
+ * Every template makes each seed twice, into storage pre-filled with
+ * different garbage; the two Tasks must be identical, field by field and
+ * string by string, and the second must not depend on what was generated
+ * in between.  Each task must also be well formed: TASK_ASK, strings
+ * terminated inside their buffers and pointing into them, 1..TASKGEN_ANSWERS
+ * non-empty answers.  The names must round-trip through taskgen_find(), and
+ * a template must not give the same prompt for every seed.
+ *
+ * Prints "N cases, M failures" and exits 1 on any failure or leak. */
+#include "common.h"
+#include "taskgen.h"
+#include "tracker.h"
+
+static bool terminated(const char *s, size_t cap) {
+    return memchr(s, '\0', cap) != NULL;
+}
+
+static const char *malformed(const Task *t, const TaskgenText *x) {
+    if (t->type != TASK_ASK) return "type";
+    if (t->prompt != x->prompt || !terminated(x->prompt, sizeof(x->prompt)) || !x->prompt[0]) {
+        return "prompt";
+    }
+    if (t->hint != x->hint || !terminated(x->hint, sizeof(x->hint))) return "hint";
+    if (t->why != x->why || !terminated(x->why, sizeof(x->why))) return "why";
+    if (t->answers != x->answers || !t->answers[0]) return "answers";
+    for (int i = 0; t->answers[i]; ++i) {
+        if (i == TASKGEN_ANSWERS || t->answers[i] != x->answer[i] ||
+            !terminated(x->answer[i], sizeof(x->answer[i])) || !x->answer[i][0]) {
+            return "answers";
+        }
+    }
+    return NULL;
+}
+
+static const char *differs(const Task *a, const Task *b) {
+    if (a->type != b->type || a->typos != b->typos) return "type";
+    if (a->options != b->options || a->harness != b->harness) return "options";
+    if (strcmp(a->prompt, b->prompt) != 0) return "prompt";
+    if (strcmp(a->hint, b->hint) != 0) return "hint";
+    if (strcmp(a->why, b->why) != 0) return "why";
+    int i = 0;
+    for (; a->answers[i] && b->answers[i]; ++i) {
+        if (strcmp(a->answers[i], b->answers[i]) != 0) return "answers";
+    }
+    return a->answers[i] || b->answers[i] ? "answers" : NULL;
+}
+
+int main(int argc, char **argv) {
+    int seeds = argc > 1 ? atoi(argv[1]) : 2000;
+    static TaskgenText first, second, other;
+    Task a, b, c;
+    int failures = 0, cases = 0;
+
+    for (int tmpl = 0; tmpl < taskgen_count(); ++tmpl) {
+        const char *name = taskgen_name(tmpl);
+        int station = taskgen_station(tmpl);
+        cases++;
+        if (taskgen_find(name) != tmpl || station < 2 || station > 15) {
+            printf("FAIL %s: find %d, station %d\n", name, taskgen_find(name), station);
+            failures++;
+        }
+
+        int varied = 0;
+        char prompt0[TASKGEN_PROMPT] = "";
+        for (int s = 0; s < seeds; ++s) {
+            uint64_t seed = s % 2 ? taskgen_mix((uint64_t)s) : (uint64_t)s;
+            memset(&first, 0x5a, sizeof(first));
+            memset(&second, 0xa5, sizeof(second));
+            taskgen_make(tmpl, seed, &a, &first);
+            taskgen_make((tmpl + 1) % taskgen_count(), seed + 1, &c, &other);
+            taskgen_make(tmpl, seed, &b, &second);
+
+            const char *what = malformed(&a, &first);
+            if (!what) what = differs(&a, &b);
+            cases++;
+            if (what && failures++ < 10) {
+                printf("FAIL %s seed %llu: %s\n", name, (unsigned long long)seed, what);
+            }
+            if (s == 0) snprintf(prompt0, sizeof(prompt0), "%s", a.prompt);
+            else varied += strcmp(prompt0, a.prompt) != 0;
+        }
+        cases++;
+        if (seeds > 1 && !varied) {
+            printf("FAIL %s: the same prompt for all %d seeds\n", name, seeds);
+            failures++;
+        }
+    }
+
+    printf("%d cases, %d failures\n", cases, failures);
+    if (tracker_report_leaks(stdout) > 0) failures++;
+    return failures ? 1 : 0;
+}
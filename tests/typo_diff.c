@@ -0,0 +1,204 @@
+/* Differential test: the typo-tolerant answer check (answers.h) against a
+ * plain dynamic-programming Levenshtein distance.
+ *
+ *   typo_diff [pairs] [seed]
+ *
+ * answer_edit_distance() runs on random pairs (alphabets of 2, 4, 27 and
+ * 255 bytes; a of 1..64 bytes, b of 0..80; a random cap): within the cap
+ * it must return the exact distance, above it anything over the cap.
+ * answer_index_fuzzy() then runs on random ASK tasks and inputs (answers
+ * with a few edits, and unrelated text) under every tolerance setting; it
+ * must pick the first answer at the smallest distance within that
+ * answer's budget as answers.h describes it, and report that distance.
+ *
+ * Prints "N cases, M failures" and exits 1 on any failure or leak. */
+#include "common.h"
+#include "answers.h"
+#include "tracker.h"
+
+#define TASKS    64
+#define ANSWERS  8
+#define TEXT_MAX 96
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static size_t below(size_t n) {
+    return (size_t)(rng() % n);
+}
+
+static int dp_distance(const char *a, size_t alen, const char *b, size_t blen) {
+    int row[TEXT_MAX + 1];
+    for (size_t j = 0; j <= blen; ++j) row[j] = (int)j;
+    for (size_t i = 1; i <= alen; ++i) {
+        int diag = row[0];
+        row[0] = (int)i;
+        for (size_t j = 1; j <= blen; ++j) {
+            int up = row[j];
+            int best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best) best = up + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    return row[blen];
+}
+
+static void random_bytes(char *s, size_t n, int alphabet) {
+    static const char WORDS[] = "abcdefghijklmnopqrstuvwxyz ";
+    for (size_t i = 0; i < n; ++i) {
+        switch (alphabet) {
+            case 0:  s[i] = "ab"[below(2)]; break;
+            case 1:  s[i] = "acgt"[below(4)]; break;
+            case 2:  s[i] = WORDS[below(sizeof(WORDS) - 1)]; break;
+            default: s[i] = (char)(1 + below(255)); break;
+        }
+    }
+}
+
+static int check_distance(int pairs) {
+    int failures = 0;
+    char a[TEXT_MAX], b[TEXT_MAX];
+    for (int k = 0; k < pairs; ++k) {
+        int alphabet = (int)below(4);
+        size_t alen = 1 + below(64), blen = below(81);
+        random_bytes(a, alen, alphabet);
+        if (below(2)) {
+            /* a few edits of a: the interesting, small distances */
+            blen = 0;
+            for (size_t i = 0; i < alen && blen < 80; ++i) {
+                size_t op = below(8);
+                if (op == 0) continue;
+                if (op == 1) random_bytes(b + blen++, 1, alphabet);
+                else if (op == 2 && blen < 79) { b[blen++] = a[i]; random_bytes(b + blen++, 1, alphabet); }
+                else b[blen++] = a[i];
+            }
+        } else {
+            random_bytes(b, blen, alphabet);
+        }
+        int max = (int)below(alen + blen + 2);
+        int want = dp_distance(a, alen, b, blen);
+        int got = answer_edit_distance(a, alen, b, blen, max);
+        if (want <= max ? got != want : got <= max) {
+            if (failures++ < 10) {
+                printf("FAIL distance: alen %zu blen %zu max %d: want %d, got %d\n",
+                       alen, blen, max, want, got);
+            }
+        }
+    }
+    return failures;
+}
+
+/* The budget answers.h documents, for a normalized answer. */
+static int budget(const char *s, size_t len, int tolerance) {
+    int scaled = len < 5 || len > 64 ? 0 : len < 12 ? 1 : len < 24 ? 2 : 3;
+    if (tolerance == ASK_TYPOS_EXACT) return 0;
+    if (tolerance > 0) return tolerance < scaled ? tolerance : scaled;
+    return strspn(s, "abcdefghijklmnopqrstuvwxyz ") == len ? scaled : 0;
+}
+
+/* Lower-case words, single spaces, sometimes a digit: already normalized. */
+static size_t random_answer(char *s) {
+    size_t len = 1 + below(below(4) ? 30 : 70);
+    for (size_t i = 0; i < len; ++i) {
+        bool space = i > 0 && i + 1 < len && s[i - 1] != ' ' && below(6) == 0;
+        s[i] = space ? ' ' : below(40) == 0 ? (char)('0' + below(10)) : (char)('a' + below(26));
+    }
+    s[len] = '\0';
+    return len;
+}
+
+static int check_fuzzy(int rounds, int *cases) {
+    static char text[TASKS][ANSWERS][TEXT_MAX];
+    static const char *lists[TASKS][ANSWERS + 1];
+    static Task tasks[TASKS];
+    static const int TOLERANCES[] = { ASK_TYPOS_AUTO, ASK_TYPOS_EXACT, 1, 2, 3 };
+    int failures = 0;
+
+    for (int round = 0; round < rounds; ++round) {
+        for (int t = 0; t < TASKS; ++t) {
+            int n = 1 + (int)below(ANSWERS);
+            for (int j = 0; j < n; ++j) {
+                bool fresh;
+                do {    /* distinct spellings: the index keeps only the first */
+                    random_answer(text[t][j]);
+                    fresh = true;
+                    for (int i = 0; i < j; ++i) fresh = fresh && strcmp(text[t][i], text[t][j]) != 0;
+                } while (!fresh);
+                lists[t][j] = text[t][j];
+            }
+            lists[t][n] = NULL;
+            tasks[t] = (Task){ .type = TASK_ASK, .prompt = "?", .typos = ASK_TYPOS_EXACT,
+                               .answers = lists[t] };
+        }
+        AnswerIndex *ix = answer_index_build(tasks, TASKS);
+        if (!ix) {
+            printf("FAIL out of memory\n");
+            return failures + 1;
+        }
+        for (int t = 0; t < TASKS; ++t) {
+            char in[TEXT_MAX];
+            size_t n = 0;
+            while (lists[t][n]) n++;
+            const char *src = lists[t][below(n)];
+            size_t len = strlen(src);
+            memcpy(in, src, len + 1);
+            if (below(4) == 0) {
+                len = random_answer(in);
+            } else {
+                for (size_t e = below(5); e > 0 && len > 1; --e) {
+                    size_t at = below(len);
+                    if (below(2)) {
+                        in[at] = (char)('a' + below(26));
+                    } else {
+                        memmove(in + at, in + at + 1, len - at);
+                        len--;
+                    }
+                }
+            }
+            int tolerance = TOLERANCES[below(sizeof(TOLERANCES) / sizeof(TOLERANCES[0]))];
+
+            int want = -1, want_edits = 0;
+            for (int j = 0; lists[t][j]; ++j) {
+                size_t alen = strlen(lists[t][j]);
+                int b = budget(lists[t][j], alen, tolerance);
+                int d = dp_distance(lists[t][j], alen, in, len);
+                if (b > 0 && d <= b && (want < 0 || d < want_edits)) {
+                    want = j;
+                    want_edits = d;
+                }
+            }
+            int edits = -1;
+            int got = answer_index_fuzzy(ix, t, in, len, tolerance, &edits);
+            (*cases)++;
+            if (got != want || (got >= 0 && edits != want_edits)) {
+                if (failures++ < 10) {
+                    printf("FAIL fuzzy: \"%s\" (tolerance %d): want %d (%d edits), got %d (%d edits)\n",
+                           in, tolerance, want, want_edits, got, edits);
+                }
+            }
+        }
+        answer_index_free(ix);
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    int pairs = argc > 1 ? atoi(argv[1]) : 200000;
+    rng_state = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x7e57ull;
+
+    int failures = check_distance(pairs);
+    int cases = pairs;
+    failures += check_fuzzy(pairs / 200, &cases);
+
+    printf("%d cases, %d failures\n", cases, failures);
+    if (tracker_report_leaks(stdout) > 0) failures++;
+    return failures ? 1 : 0;
+}
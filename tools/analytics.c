@@ -0,0 +1,282 @@
+/* analytics: cohort-wide questions over a *.cohort store (see cohort.h).
+ *
+ *   analytics gen     <file> <learners> [seed]   synthetic cohort
+ *   analytics import  <file> <state-dir>...      one learner per --state dir
+ *   analytics summary <file>                     per station: done, mean, stuck
+ *   analytics hist    <file> <station> [width]   score histogram
+ *   analytics filter  <file> <station>... [not <station>...]
+ *   analytics stuck   <file> [min-attempts]      attempted, never completed
+ *   analytics bench   <file>                     every kernel, every ISA
+ *
+ * Stations are given as on the map (02..15).  `filter 09 not 11` counts
+ * the learners that completed 09 but not 11.  Each query prints the time
+ * it took; the store is mapped, not read, so a warm one answers straight
+ * from the page cache.  import recovers each directory through the
+ * journal, which compacts it as the shell would on exit. */
+#include <sys/stat.h>
+#include <time.h>
+
+#include "common.h"
+#include "cohort.h"
+#include "journal.h"
+
+#define DEFAULT_SEED   0x9e3779b97f4a7c15ull
+#define STUCK_MIN      3
+#define HIST_BINS      10
+#define BENCH_REPS     20
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+static double ms_since(uint64_t t0) {
+    return (double)(now_ns() - t0) / 1e6;
+}
+
+/* "02".."15" (or "2".."15") to a REG index; -1 otherwise */
+static int station_arg(const char *s) {
+    char *end;
+    long n = strtol(s, &end, 10);
+    if (*s == '\0' || *end != '\0' || n < 2 || n >= 2 + STATION_COUNT) {
+        fprintf(stderr, "analytics: no station %s (02..%02d)\n", s, 1 + STATION_COUNT);
+        return -1;
+    }
+    return (int)n - 2;
+}
+
+static int usage(void) {
+    fprintf(stderr,
+            "usage: analytics gen <file> <learners> [seed]\n"
+            "       analytics import <file> <state-dir>...\n"
+            "       analytics summary <file>\n"
+            "       analytics hist <file> <station> [width]\n"
+            "       analytics filter <file> <station>... [not <station>...]\n"
+            "       analytics stuck <file> [min-attempts]\n"
+            "       analytics bench <file>\n");
+    return 2;
+}
+
+/* ===== building a cohort ===== */
+
+/* A funnel: learners take the stations in order and most finish each
+ * one; the rest retry it for a while and stop there. */
+static void synth_learner(GameState *g, uint64_t *rng) {
+    memset(g, 0, sizeof(*g));
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        uint64_t r = xorshift(rng);
+        g->attempted[s] = 1 + (int)(r % 3);
+        if ((r >> 8) % 100 < 12) {                      /* stuck here */
+            g->attempted[s] += (int)((r >> 16) % 12);
+            g->station_scores[s] = (int)((r >> 24) % 10);
+            break;
+        }
+        g->completed[s] = true;
+        g->station_scores[s] = 10 + (int)((r >> 24) % 31);
+        if ((r >> 32) % 100 < 5) break;                 /* walked away */
+    }
+}
+
+static int cmd_gen(const char *path, uint32_t learners, uint64_t seed) {
+    Cohort c;
+    if (cohort_create(&c, path, learners) != OK) return 1;
+    uint64_t rng = seed ? seed : DEFAULT_SEED, t0 = now_ns();
+    GameState g;
+    for (uint32_t i = 0; i < learners; ++i) {
+        synth_learner(&g, &rng);
+        cohort_append(&c, &g);
+    }
+    printf("%s: %u learners in %.1f ms, %.1f MiB\n", path, cohort_learners(&c), ms_since(t0),
+           (double)c.map_len / (1 << 20));
+    cohort_close(&c);
+    return 0;
+}
+
+static bool has_state(const char *dir) {
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/progress.snap", dir);
+    if (stat(path, &st) == 0) return true;
+    snprintf(path, sizeof(path), "%s/progress.journal", dir);
+    return stat(path, &st) == 0;
+}
+
+static int cmd_import(const char *path, char **dirs, int n) {
+    Cohort c;
+    if (cohort_create(&c, path, (uint32_t)n) != OK) return 1;
+    int bad = 0;
+    for (int i = 0; i < n; ++i) {
+        GameState g = { 0 };
+        Journal *j = has_state(dirs[i]) ? journal_open(dirs[i], &g) : NULL;
+        if (!j) {
+            fprintf(stderr, "analytics: %s: no learner state, skipped\n", dirs[i]);
+            bad++;
+            continue;
+        }
+        journal_close(j);
+        cohort_append(&c, &g);
+    }
+    printf("%s: %u learners imported\n", path, cohort_learners(&c));
+    cohort_close(&c);
+    return bad ? 1 : 0;
+}
+
+/* ===== queries ===== */
+static int cmd_summary(const Cohort *c, uint16_t stuck_min) {
+    uint32_t n = cohort_learners(c);
+    printf("%u learners, %s kernels\n", n, fpk_isa_name(cohort_active_isa()));
+    printf("  st       done   %%done    mean   max      tried  stuck(%u+)\n", stuck_min);
+    uint64_t t0 = now_ns();
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        CohortScoreStats st = cohort_score_stats(c, s);
+        uint32_t done = cohort_completed(c, s);
+        uint32_t tried = done + cohort_stuck(c, s, 1, NULL);
+        uint32_t stuck = cohort_stuck(c, s, stuck_min, NULL);
+        printf("  %02d  %9u  %6.2f  %6.2f  %4d  %9u  %9u\n", s + 2, done,
+               n ? 100.0 * done / n : 0.0, st.nonzero ? (double)st.sum / st.nonzero : 0.0,
+               st.max, tried, stuck);
+    }
+    printf("(%.2f ms)\n", ms_since(t0));
+    return 0;
+}
+
+static int cmd_hist(const Cohort *c, int station, int32_t width) {
+    uint32_t bins[HIST_BINS], top = 1;
+    uint64_t t0 = now_ns();
+    cohort_histogram(c, station, width, bins, HIST_BINS);
+    double ms = ms_since(t0);
+    for (int b = 0; b < HIST_BINS; ++b) top = bins[b] > top ? bins[b] : top;
+    printf("station %02d scores, width %d\n", station + 2, width);
+    for (int b = 0; b < HIST_BINS; ++b) {
+        int bar = (int)((uint64_t)bins[b] * 40 / top);
+        printf("  %4d%s %9u  %.*s\n", b * width, b == HIST_BINS - 1 ? "+" : " ", bins[b], bar,
+               "########################################");
+    }
+    printf("(%.2f ms)\n", ms);
+    return 0;
+}
+
+static int cmd_filter(const Cohort *c, char **args, int n) {
+    uint32_t have = 0, lack = 0;
+    bool negate = false;
+    for (int i = 0; i < n; ++i) {
+        if (strcmp(args[i], "not") == 0) {
+            negate = true;
+            continue;
+        }
+        int s = station_arg(args[i]);
+        if (s < 0) return 2;
+        *(negate ? &lack : &have) |= 1u << s;
+    }
+    uint64_t t0 = now_ns();
+    uint32_t hits = cohort_filter(c, have, lack, NULL);
+    double ms = ms_since(t0);
+    uint32_t total = cohort_learners(c);
+    printf("%u of %u learners (%.2f%%)  (%.2f ms)\n", hits, total,
+           total ? 100.0 * hits / total : 0.0, ms);
+    return 0;
+}
+
+static int cmd_stuck(const Cohort *c, uint16_t min) {
+    uint64_t t0 = now_ns();
+    uint32_t per[STATION_COUNT], worst = 0;
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        per[s] = cohort_stuck(c, s, min, NULL);
+        if (per[s] > per[worst]) worst = (uint32_t)s;
+    }
+    double ms = ms_since(t0);
+    printf("attempted %u+ times without completing:\n", min);
+    for (int s = 0; s < STATION_COUNT; ++s) {
+        printf("  %02d  %9u%s\n", s + 2, per[s], (uint32_t)s == worst && per[s] ? "  <- most" : "");
+    }
+    printf("(%.2f ms)\n", ms);
+    return 0;
+}
+
+/* Best of BENCH_REPS over all stations, per kernel and ISA. */
+static int cmd_bench(const Cohort *c) {
+    uint32_t n = cohort_learners(c);
+    size_t words = n / 64;
+    const uint64_t *have[1] = { c->completed[7] }, *lack[1] = { c->completed[9] };
+    printf("%u learners; best of %d, all %d stations\n", n, BENCH_REPS, STATION_COUNT);
+    printf("  isa      score-stats    stuck      filter      (ms; GB/s of column read)\n");
+    uint64_t check = 0;
+    for (int isa = FPK_SCALAR; isa < FPK_ISAS; ++isa) {
+        const CohortKernels *k = cohort_kernels((FpkIsa)isa);
+        if (!k) continue;
+        uint64_t best[3] = { UINT64_MAX, UINT64_MAX, UINT64_MAX };
+        for (int rep = 0; rep < BENCH_REPS; ++rep) {
+            uint64_t t0 = now_ns();
+            for (int s = 0; s < STATION_COUNT; ++s) {
+                CohortScoreStats st;
+                k->score_stats(c->score[s], n, &st);
+                check += (uint64_t)st.sum;
+            }
+            uint64_t t1 = now_ns();
+            for (int s = 0; s < STATION_COUNT; ++s) {
+                check += k->stuck(c->attempts[s], c->completed[s], words, STUCK_MIN, NULL);
+            }
+            uint64_t t2 = now_ns();
+            for (int s = 0; s < STATION_COUNT; ++s) {
+                check += k->filter(have, 1, lack, 1, words, NULL);
+            }
+            uint64_t t3 = now_ns();
+            uint64_t d[3] = { t1 - t0, t2 - t1, t3 - t2 };
+            for (int i = 0; i < 3; ++i) best[i] = d[i] < best[i] ? d[i] : best[i];
+        }
+        double bytes[3] = { 4.0 * n * STATION_COUNT, (2.0 + 1.0 / 8) * n * STATION_COUNT,
+                            2.0 / 8 * n * STATION_COUNT };
+        printf("  %-7s", fpk_isa_name((FpkIsa)isa));
+        for (int i = 0; i < 3; ++i) {
+            printf("  %6.2f %5.1f", (double)best[i] / 1e6, bytes[i] / (double)best[i]);
+        }
+        printf("\n");
+    }
+    printf("(checksum %llu)\n", (unsigned long long)check);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) return usage();
+    const char *cmd = argv[1], *path = argv[2];
+
+    if (strcmp(cmd, "gen") == 0) {
+        if (argc < 4) return usage();
+        uint32_t n = (uint32_t)strtoul(argv[3], NULL, 10);
+        return cmd_gen(path, n, argc > 4 ? strtoull(argv[4], NULL, 0) : 0);
+    }
+    if (strcmp(cmd, "import") == 0) {
+        return argc < 4 ? usage() : cmd_import(path, argv + 3, argc - 3);
+    }
+
+    Cohort c;
+    if (cohort_open(&c, path, false) != OK) return 1;
+    int rc;
+    if (strcmp(cmd, "summary") == 0) {
+        rc = cmd_summary(&c, STUCK_MIN);
+    } else if (strcmp(cmd, "hist") == 0 && argc > 3) {
+        int s = station_arg(argv[3]);
+        int32_t width = argc > 4 ? (int32_t)strtol(argv[4], NULL, 10) : 5;
+        rc = s < 0 ? 2 : cmd_hist(&c, s, width > 0 ? width : 5);
+    } else if (strcmp(cmd, "filter") == 0 && argc > 3) {
+        rc = cmd_filter(&c, argv + 3, argc - 3);
+    } else if (strcmp(cmd, "stuck") == 0) {
+        long min = argc > 3 ? strtol(argv[3], NULL, 10) : STUCK_MIN;
+        rc = cmd_stuck(&c, (uint16_t)(min < 1 ? 1 : min > UINT16_MAX ? UINT16_MAX : min));
+    } else if (strcmp(cmd, "bench") == 0) {
+        rc = cmd_bench(&c);
+    } else {
+        rc = usage();
+    }
+    cohort_close(&c);
+    return rc;
+}
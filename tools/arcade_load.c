@@ -0,0 +1,176 @@
+/* Load generator for `c_arcade --serve`.
+ *
+ * Opens N learner connections from one thread and drives each one through a
+ * closed loop of shell commands and station answers: send a line, wait for
+ * the next "> " prompt, record the round trip, send the next line.  Prints
+ * p50/p90/p99 latency, commands/sec and an estimate of learners per core.
+ *
+ *   arcade_load <socket> [-c conns] [-n cmds-per-conn] [-t think-seconds] [-p server-pid]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* One pass through the compilation station plus the cheap shell commands. */
+static const char *SCRIPT[] = {
+    "map\n", "play 02\n", "hint\n", "2\n", "nope\n", "cfg\n", "score\n", "help\n",
+};
+#define SCRIPT_N (sizeof(SCRIPT) / sizeof(SCRIPT[0]))
+
+typedef struct {
+    int fd;
+    int step;           /* commands sent so far */
+    uint64_t sent_ns;
+    char tail[2];       /* last two bytes received */
+    bool ready;         /* saw the prompt for the previous command */
+} Client;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int connect_unix(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* utime+stime of a process in seconds, or -1 */
+static double proc_cpu_seconds(int pid) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    char *p = strrchr(buf, ')');
+    if (!p) return -1;
+    unsigned long ut = 0, st = 0;
+    /* fields after ")" start at 3 (state); utime is 14, stime 15 */
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &ut, &st) != 2)
+        return -1;
+    return (double)(ut + st) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static void send_next(Client *c) {
+    const char *line = SCRIPT[c->step % SCRIPT_N];
+    size_t len = strlen(line);
+    c->ready = false;
+    c->sent_ns = now_ns();
+    if (send(c->fd, line, len, MSG_NOSIGNAL) != (ssize_t)len) {
+        perror("send");
+        exit(1);
+    }
+    c->step++;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <socket> [-c conns] [-n cmds] [-t think-s] [-p server-pid]\n", argv[0]);
+        return 2;
+    }
+    const char *path = argv[1];
+    int conns = 300, cmds = 200, pid = 0;
+    double think = 5.0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-c") == 0) conns = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-n") == 0) cmds = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-t") == 0) think = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-p") == 0) pid = atoi(argv[i + 1]);
+    }
+    if (conns <= 0 || cmds <= 0) return 2;
+
+    Client *cl = calloc((size_t)conns, sizeof(*cl));
+    uint64_t *lat = malloc((size_t)conns * (size_t)cmds * sizeof(*lat));
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (!cl || !lat || ep < 0) { perror("setup"); return 1; }
+
+    for (int i = 0; i < conns; ++i) {
+        cl[i].fd = connect_unix(path);
+        if (cl[i].fd < 0) { perror(path); return 1; }
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+        epoll_ctl(ep, EPOLL_CTL_ADD, cl[i].fd, &ev);
+    }
+
+    double cpu0 = pid ? proc_cpu_seconds(pid) : -1;
+    uint64_t t0 = now_ns();
+    size_t nlat = 0;
+    int finished = 0;
+    char buf[16384];
+    struct epoll_event evs[256];
+
+    while (finished < conns) {
+        int n = epoll_wait(ep, evs, 256, 10000);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            fprintf(stderr, "timed out waiting for the server\n");
+            return 1;
+        }
+        for (int k = 0; k < n; ++k) {
+            Client *c = &cl[evs[k].data.u32];
+            ssize_t r = recv(c->fd, buf, sizeof(buf), 0);
+            if (r <= 0) { fprintf(stderr, "server closed a connection\n"); return 1; }
+            if (r >= 2) { c->tail[0] = buf[r - 2]; c->tail[1] = buf[r - 1]; }
+            else { c->tail[0] = c->tail[1]; c->tail[1] = buf[0]; }
+            if (c->tail[0] != '>' || c->tail[1] != ' ') continue;
+
+            /* response complete */
+            if (c->step > 0) lat[nlat++] = now_ns() - c->sent_ns;
+            if (c->step == cmds) {
+                finished++;
+                c->step++;
+                continue;
+            }
+            if (c->step < cmds) send_next(c);
+        }
+    }
+
+    double wall = (double)(now_ns() - t0) / 1e9;
+    double cpu1 = pid ? proc_cpu_seconds(pid) : -1;
+    qsort(lat, nlat, sizeof(*lat), cmp_u64);
+
+    double rate = (double)nlat / wall;
+    double cpu = (cpu0 >= 0 && cpu1 > cpu0) ? cpu1 - cpu0 : wall;
+    double per_core = (double)nlat / cpu;   /* commands per server CPU-second */
+
+    printf("connections      : %d\n", conns);
+    printf("commands         : %zu in %.3f s  (%.0f cmd/s)\n", nlat, wall, rate);
+    printf("latency p50      : %.1f us\n", (double)lat[nlat / 2] / 1e3);
+    printf("latency p90      : %.1f us\n", (double)lat[nlat * 9 / 10] / 1e3);
+    printf("latency p99      : %.1f us\n", (double)lat[nlat * 99 / 100] / 1e3);
+    printf("latency max      : %.1f us\n", (double)lat[nlat - 1] / 1e3);
+    printf("server CPU       : %s%.3f s\n", pid ? "" : "(wall, no -p) ", cpu);
+    printf("learners per core: %.0f  (one command every %.1f s each)\n", per_core * think, think);
+
+    for (int i = 0; i < conns; ++i) close(cl[i].fd);
+    close(ep);
+    free(cl);
+    free(lat);
+    return 0;
+}
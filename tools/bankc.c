@@ -0,0 +1,372 @@
+/* bankc: compile a task source file into a binary *.bank (see bank.h).
+ *
+ *   bankc <source.toml> <out.bank>
+ *   bankc -d <file.bank>            dump a compiled bank
+ *
+ * The source is a small TOML subset:
+ *
+ *   station = 2
+ *
+ *   [[task]]
+ *   type    = "quiz"               # or "ask"
+ *   prompt  = "Which step removes comments and expands macros?"
+ *   options = ["Lexical Analysis", "Preprocessing", "Optimization"]
+ *   correct = 2                    # 1-based, as the learner sees it
+ *   hint    = "It's before lexical analysis"
+ *   why     = "WHY: ..."
+ *
+ *   [[task]]
+ *   type    = "ask"
+ *   prompt  = "What structure represents nested syntax rules?"
+ *   answers = ["context free grammar", "cfg"]
+ *   typos   = "auto"               # or "exact", or a number of edits
+ *
+ *   [[task]]
+ *   type    = "code"               # compiled and run by the sandbox
+ *   prompt  = "Write int add(int a, int b)."
+ *   harness = "#include <stdio.h>\nint add(int, int);\nint main(void) { ... }"
+ *   inputs  = ["1 2", "-3 3"]      # stdin of each test (alias: options)
+ *   outputs = ["3", "0"]           # expected stdout      (alias: answers)
+ *
+ *   [[task]]
+ *   type    = "expr"               # C expression, evaluated in-process
+ *   prompt  = "What is *(a + 2)?"
+ *   env     = ["int a[] = {10, 20, 30}"]   # declarations (alias: options)
+ *   reference = "*(a + 2)"         # the learner's value must equal this one
+ *   check   = ["constant"]         # optional: constant, type, approx, vars
+ *
+ *   [[task]]
+ *   type    = "macro"              # preprocessor output, in-process (cpp.h)
+ *   prompt  = "What does SQ(1 + 2) become?"
+ *   defs    = ["#define SQ(x) x * x"]      # directives, or "// name\n..." headers
+ *   expand  = "SQ(1 + 2)"          # the learner gives the tokens this becomes
+ *
+ * Strings take "basic" (with \" \\ \n \t escapes) or 'literal' quoting;
+ * arrays may span lines; '#' starts a comment. */
+#include <errno.h>
+
+#include "common.h"
+#include "engine.h"
+#include "bank.h"
+#include "cexpr.h"
+#include "cpp.h"
+
+typedef struct {
+    const char *path;
+    const char *p;
+    int line;
+} Src;
+
+typedef struct {
+    char **items;
+    size_t n, cap;
+} StrVec;
+
+typedef struct {
+    Task t;
+    StrVec options, answers;
+    bool has_type, has_correct, has_typos, has_check;
+    int line;
+} SrcTask;
+
+static void die(const Src *s, const char *msg) {
+    fprintf(stderr, "%s:%d: %s\n", s->path, s->line, msg);
+    exit(1);
+}
+
+static void *xrealloc(void *p, size_t n) {
+    void *q = realloc(p, n);
+    if (!q) { perror("bankc"); exit(1); }
+    return q;
+}
+
+static void vec_push(StrVec *v, char *s) {
+    if (v->n + 1 >= v->cap) {
+        v->cap = v->cap ? v->cap * 2 : 8;
+        v->items = xrealloc(v->items, v->cap * sizeof(char *));
+    }
+    v->items[v->n++] = s;
+    v->items[v->n] = NULL;
+}
+
+/* skip blanks, comments and (if allowed) newlines */
+static void skip_ws(Src *s, bool newlines) {
+    for (;;) {
+        while (*s->p == ' ' || *s->p == '\t' || *s->p == '\r') s->p++;
+        if (*s->p == '#') {
+            while (*s->p && *s->p != '\n') s->p++;
+        }
+        if (newlines && *s->p == '\n') {
+            s->p++;
+            s->line++;
+            continue;
+        }
+        return;
+    }
+}
+
+static void end_of_line(Src *s) {
+    skip_ws(s, false);
+    if (*s->p && *s->p != '\n') die(s, "unexpected text after value");
+}
+
+static char *parse_string(Src *s) {
+    char quote = *s->p;
+    if (quote != '"' && quote != '\'') die(s, "expected a quoted string");
+    s->p++;
+
+    size_t cap = 64, n = 0;
+    char *out = xrealloc(NULL, cap);
+    for (;;) {
+        char c = *s->p++;
+        if (c == '\0' || c == '\n') die(s, "unterminated string");
+        if (c == quote) break;
+        if (c == '\\' && quote == '"') {
+            char e = *s->p++;
+            switch (e) {
+                case 'n':  c = '\n'; break;
+                case 't':  c = '\t'; break;
+                case '"':  c = '"';  break;
+                case '\\': c = '\\'; break;
+                default:   die(s, "unknown escape");
+            }
+        }
+        if (n + 2 > cap) out = xrealloc(out, cap *= 2);
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    return out;
+}
+
+static long parse_int(Src *s) {
+    char *end;
+    errno = 0;
+    long v = strtol(s->p, &end, 10);
+    if (end == s->p || errno) die(s, "expected an integer");
+    s->p = end;
+    return v;
+}
+
+static void parse_array(Src *s, StrVec *v) {
+    if (*s->p != '[') die(s, "expected '['");
+    s->p++;
+    for (;;) {
+        skip_ws(s, true);
+        if (*s->p == ']') { s->p++; return; }
+        vec_push(v, parse_string(s));
+        skip_ws(s, true);
+        if (*s->p == ',') { s->p++; continue; }
+        if (*s->p == ']') { s->p++; return; }
+        die(s, "expected ',' or ']'");
+    }
+}
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror(path); exit(1); }
+    size_t cap = 1 << 16, n = 0;
+    char *buf = xrealloc(NULL, cap);
+    size_t r;
+    while ((r = fread(buf + n, 1, cap - n - 1, f)) > 0) {
+        n += r;
+        if (n + 1 == cap) buf = xrealloc(buf, cap *= 2);
+    }
+    fclose(f);
+    buf[n] = '\0';
+    return buf;
+}
+
+static void finish_task(const Src *s, SrcTask *st) {
+    Task *t = &st->t;
+    Src at = *s;
+    at.line = st->line;
+    if (!st->has_type) die(&at, "task has no type");
+    if (!t->prompt) die(&at, "task has no prompt");
+    if (st->has_typos && t->type != TASK_ASK) die(&at, "only ask tasks take 'typos'");
+    if (st->has_correct && t->type != TASK_QUIZ) die(&at, "only quiz tasks take 'correct'");
+    if (st->has_check && t->type != TASK_EXPR) die(&at, "only expr tasks take 'check'");
+    if (t->type == TASK_QUIZ) {
+        if (st->options.n == 0) die(&at, "quiz task has no options");
+        if (!st->has_correct) die(&at, "quiz task has no 'correct'");
+        if (t->correct_index < 0 || (size_t)t->correct_index >= st->options.n)
+            die(&at, "'correct' is out of range");
+        if (st->answers.n) die(&at, "quiz tasks take options, not answers");
+    } else if (t->type == TASK_CODE) {
+        if (st->answers.n == 0) die(&at, "code task has no outputs");
+        if (st->options.n > st->answers.n) die(&at, "code task has more inputs than outputs");
+    } else if (t->type == TASK_EXPR) {
+        if (st->answers.n != 1) die(&at, "expr task needs exactly one 'reference'");
+        /* compile the declarations and the reference now, not in class */
+        Task probe = *t;
+        probe.options = (const char *const *)st->options.items;
+        probe.answers = (const char *const *)st->answers.items;
+        CexprTable *tab = cexpr_table_build(&probe, 1);
+        const CexprTask *x = cexpr_table_task(tab, 0);
+        if (!x || x->error[0]) die(&at, x ? x->error : "out of memory");
+        cexpr_table_free(tab);
+    } else if (t->type == TASK_MACRO) {
+        if (st->answers.n != 1) die(&at, "macro task needs exactly one 'expand'");
+        /* the definitions and the source must preprocess now, not in class */
+        Task probe = *t;
+        probe.options = (const char *const *)st->options.items;
+        probe.answers = (const char *const *)st->answers.items;
+        CppTable *tab = cpp_table_build(&probe, 1);
+        const CppTask *x = cpp_table_task(tab, 0);
+        if (!x || x->error[0]) die(&at, x ? x->error : "out of memory");
+        cpp_table_free(tab);
+        cpp_memo_clear();
+    } else {
+        if (st->answers.n == 0) die(&at, "ask task has no answers");
+        if (st->options.n) die(&at, "ask tasks take answers, not options");
+        if (!st->has_typos) t->typos = ASK_TYPOS_AUTO;
+    }
+    t->options = (const char *const *)st->options.items;
+    t->answers = (const char *const *)st->answers.items;
+}
+
+static int compile(const char *in, const char *out) {
+    Src s = { in, read_file(in), 1 };
+    SrcTask *tasks = NULL;
+    size_t n = 0, cap = 0;
+    long station = -1;
+
+    for (;;) {
+        skip_ws(&s, true);
+        if (!*s.p) break;
+
+        if (strncmp(s.p, "[[task]]", 8) == 0) {
+            s.p += 8;
+            end_of_line(&s);
+            if (n) finish_task(&s, &tasks[n - 1]);
+            if (n == cap) tasks = xrealloc(tasks, (cap = cap ? cap * 2 : 64) * sizeof(*tasks));
+            memset(&tasks[n], 0, sizeof(tasks[n]));
+            tasks[n].line = s.line;
+            n++;
+            continue;
+        }
+
+        const char *k = s.p;
+        while (isalnum((unsigned char)*s.p) || *s.p == '_') s.p++;
+        size_t klen = (size_t)(s.p - k);
+        if (!klen) die(&s, "expected a key or [[task]]");
+        skip_ws(&s, false);
+        if (*s.p != '=') die(&s, "expected '='");
+        s.p++;
+        skip_ws(&s, false);
+
+#define KEY(name) (klen == sizeof(name) - 1 && strncmp(k, name, klen) == 0)
+        if (!n) {
+            if (!KEY("station")) die(&s, "only 'station' may appear before the first [[task]]");
+            station = parse_int(&s);
+            if (station < 2 || station > 999) die(&s, "station id out of range");
+            end_of_line(&s);
+            continue;
+        }
+
+        SrcTask *st = &tasks[n - 1];
+        if (KEY("type")) {
+            char *v = parse_string(&s);
+            if (strcmp(v, "ask") == 0) st->t.type = TASK_ASK;
+            else if (strcmp(v, "quiz") == 0) st->t.type = TASK_QUIZ;
+            else if (strcmp(v, "code") == 0) st->t.type = TASK_CODE;
+            else if (strcmp(v, "expr") == 0) st->t.type = TASK_EXPR;
+            else if (strcmp(v, "macro") == 0) st->t.type = TASK_MACRO;
+            else die(&s, "type must be \"ask\", \"quiz\", \"code\", \"expr\" or \"macro\"");
+            st->has_type = true;
+            free(v);
+        } else if (KEY("prompt")) {
+            st->t.prompt = parse_string(&s);
+        } else if (KEY("hint")) {
+            st->t.hint = parse_string(&s);
+        } else if (KEY("why")) {
+            st->t.why = parse_string(&s);
+        } else if (KEY("correct")) {
+            st->t.correct_index = (int)parse_int(&s) - 1;
+            st->has_correct = true;
+        } else if (KEY("harness")) {
+            st->t.harness = parse_string(&s);
+        } else if (KEY("options") || KEY("inputs") || KEY("env") || KEY("defs")) {
+            parse_array(&s, &st->options);
+        } else if (KEY("answers") || KEY("outputs")) {
+            parse_array(&s, &st->answers);
+        } else if (KEY("reference") || KEY("expand")) {
+            vec_push(&st->answers, parse_string(&s));
+        } else if (KEY("typos")) {
+            if (*s.p == '"' || *s.p == '\'') {
+                char *v = parse_string(&s);
+                if (strcmp(v, "auto") == 0) st->t.typos = ASK_TYPOS_AUTO;
+                else if (strcmp(v, "exact") == 0) st->t.typos = ASK_TYPOS_EXACT;
+                else die(&s, "typos takes \"auto\", \"exact\" or a number");
+                free(v);
+            } else {
+                long v = parse_int(&s);
+                if (v < 0 || v > 64) die(&s, "typos out of range");
+                st->t.typos = (int)v;
+            }
+            st->has_typos = true;
+        } else if (KEY("check")) {
+            StrVec flags = {0};
+            parse_array(&s, &flags);
+            st->t.expr_flags = 0;
+            for (size_t i = 0; i < flags.n; ++i) {
+                if (strcmp(flags.items[i], "constant") == 0) st->t.expr_flags |= EXPR_CONSTANT;
+                else if (strcmp(flags.items[i], "type") == 0) st->t.expr_flags |= EXPR_SAME_TYPE;
+                else if (strcmp(flags.items[i], "approx") == 0) st->t.expr_flags |= EXPR_APPROX;
+                else if (strcmp(flags.items[i], "vars") == 0) st->t.expr_flags |= EXPR_SAME_VARS;
+                else die(&s, "check takes \"constant\", \"type\", \"approx\" or \"vars\"");
+                free(flags.items[i]);
+            }
+            free(flags.items);
+            st->has_check = true;
+        } else {
+            die(&s, "unknown key");
+        }
+#undef KEY
+        end_of_line(&s);
+    }
+
+    if (station < 0) die(&s, "missing 'station = <id>'");
+    if (n) finish_task(&s, &tasks[n - 1]);
+    if (n > INT32_MAX) die(&s, "too many tasks");
+
+    Task *flat = xrealloc(NULL, (n ? n : 1) * sizeof(Task));
+    for (size_t i = 0; i < n; ++i) flat[i] = tasks[i].t;
+    if (bank_write(out, (int)station, flat, (int)n) != OK) return 1;
+    printf("%s: station %02ld, %zu tasks\n", out, station, n);
+    return 0;
+}
+
+static void dump_list(const char *label, const char *const *l) {
+    if (!l) return;
+    printf("  %s:", label);
+    for (int i = 0; l[i]; ++i) printf(" [%s]", l[i]);
+    printf("\n");
+}
+
+static int dump(const char *path) {
+    BankFile bf;
+    if (bank_open(&bf, path) != OK) return 1;
+    printf("station %02d, %d tasks\n", bf.station_id, bf.bank.count);
+    for (int i = 0; i < bf.bank.count; ++i) {
+        const Task *t = &bf.bank.tasks[i];
+        static const char *const TYPES[] = { "ask", "quiz", "code", "expr", "macro" };
+        printf("%d. (%s) %s\n", i + 1, TYPES[t->type], t->prompt);
+        dump_list("options", t->options);
+        if (t->type == TASK_QUIZ) printf("  correct: %d\n", t->correct_index + 1);
+        if (t->type == TASK_EXPR) printf("  check: %d\n", t->expr_flags);
+        if (t->type == TASK_ASK && t->typos != ASK_TYPOS_AUTO) printf("  typos: %d\n", t->typos);
+        dump_list("answers", t->answers);
+        if (t->hint) printf("  hint: %s\n", t->hint);
+        if (t->why) printf("  why: %s\n", t->why);
+        if (t->harness) printf("  harness: %zu bytes\n", strlen(t->harness));
+    }
+    bank_close(&bf);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "-d") == 0) return dump(argv[2]);
+    if (argc == 3) return compile(argv[1], argv[2]);
+    fprintf(stderr, "usage: %s <source.toml> <out.bank>\n       %s -d <file.bank>\n", argv[0], argv[0]);
+    return 2;
+}